@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Common/KelpFile.hpp"
+#include "Common/ThreadPool.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Batched reader for the payloads of a .kelp file.
+ * On Linux, chunked O_DIRECT reads are kept in flight through io_uring, straight into the destinations when they are aligned
+ * and otherwise into a pool of aligned buffers registered with the kernel. Every request is handed off as soon as its last chunk
+ * completes, while the next ones are still being read.
+ * Where io_uring is unavailable (old kernels, seccomp filtered containers), requests are read with pread by the thread pool
+ * instead, and on Windows copied from the memory mapping of the KelpFile.
+ */
+class AsyncFileReader {
+    public:
+        struct Request {
+            uint64_t offset;                    // Offset of the range in the file
+            size_t size;
+            void* dst;                          // Must hold at least size bytes, no alignment required
+            std::function<void()> onComplete;   // Called once dst is filled, must be quick: hand heavy work off to a thread pool
+        };
+
+        AsyncFileReader(const KelpFile& file, ThreadPool& threadPool);
+        ~AsyncFileReader();
+
+        AsyncFileReader(const AsyncFileReader&) = delete;
+        AsyncFileReader& operator=(const AsyncFileReader&) = delete;
+
+        AsyncFileReader(AsyncFileReader&&) = delete;
+        AsyncFileReader& operator=(AsyncFileReader&&) = delete;
+
+
+        /**
+         * @brief Read every request, in any order, and block until all of them completed and their callbacks returned.
+         * Callbacks are called from the calling thread with io_uring, and from the thread pool workers otherwise.
+         *
+         * @param requests The ranges to read.
+         * @throws std::runtime_error if a read fails, or the first exception thrown by a callback, once the reads in flight are drained.
+         */
+        void read(const std::vector<Request>& requests);
+
+
+        /* Getters */
+        [[nodiscard]] const char* getBackendName() const noexcept;
+        [[nodiscard]] uint64_t getBytesRead() const noexcept { return m_bytesRead; }
+        [[nodiscard]] double getReadSeconds() const noexcept { return m_readSeconds; }
+        [[nodiscard]] uint64_t getBytesCopied() const noexcept { return m_bytesCopied; }     // Out of the read buffers or the mapping, rather than read in place
+
+
+    private:
+        void readPositioned(const std::vector<Request>& requests);
+        void readMapped(const std::vector<Request>& requests);
+
+
+    private:
+        struct IoUring;
+
+        const KelpFile& m_file;
+        ThreadPool& m_threadPool;
+        std::unique_ptr<IoUring> m_ioUring;
+        int m_fd = -1;                          // Of the pread fallback, -1 with io_uring or where pread is unavailable
+
+        uint64_t m_bytesRead = 0;
+        double m_readSeconds = 0;
+        std::atomic<uint64_t> m_bytesCopied = 0;    // Added to by the thread pool workers of the mapping fallback
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+
+/**
+ * @brief Decoder for the BC1-5 & BC7 block compressed formats, to 8-bit RGBA texels.
+ *
+ * Every 4x4 block is decoded independently following the Khronos Data Format specification, channels missing from
+ * the format read as they are sampled (0 for green & blue, opaque alpha). Signed BC4 & BC5 values are remapped from
+ * [-1, 1] to [0, 255]. BC6H holds HDR values that don't fit 8-bit texels and isn't supported.
+ */
+class BcDecoder {
+    public:
+        BcDecoder() = delete;
+
+        enum class Format : uint8_t {
+            Bc1Rgb,         // 8 bytes per block, the 3 color mode's transparent texels are opaque black
+            Bc1Rgba,        // 8 bytes per block, 1-bit alpha
+            Bc2,            // 16 bytes per block, 4-bit explicit alpha
+            Bc3,            // 16 bytes per block, interpolated alpha
+            Bc4Unorm,       // 8 bytes per block, red only
+            Bc4Snorm,
+            Bc5Unorm,       // 16 bytes per block, red & green
+            Bc5Snorm,
+            Bc7,            // 16 bytes per block, 8 modes of 1 to 3 subsets
+        };
+
+
+        /**
+         * @brief Format of the blocks of a VkFormat value, std::nullopt for the formats that can't be decoded (BC6H & the uncompressed ones).
+         */
+        [[nodiscard]] static std::optional<Format> getFormat(uint32_t vkFormat) noexcept;
+
+        /**
+         * @brief Size in bytes of a 4x4 block of the format.
+         */
+        [[nodiscard]] static uint32_t getBlockSize(Format format) noexcept;
+
+        /**
+         * @brief Decode a block compressed image, the blocks past its edges are cropped.
+         *
+         * @param src The blocks, in row major order.
+         * @param dst Destination of the decoded texels, width * height * 4 bytes.
+         * @param width Width of the image in texels.
+         * @param height Height of the image in texels.
+         * @param format The format of the blocks.
+         * @throws std::runtime_error if src or dst doesn't match the image size.
+         */
+        static void decode(std::span<const uint8_t> src, std::span<uint8_t> dst, uint32_t width, uint32_t height, Format format);
+
+
+    private:
+        static void decodeBlock(const uint8_t* block, uint8_t* texels, Format format);
+        static void decodeColorBlock(const uint8_t* block, uint8_t* texels, bool threeColorMode, bool transparentBlack);
+        static void decodeAlphaBlock(const uint8_t* block, uint8_t* texels, bool isSigned);
+        static void decodeExplicitAlphaBlock(const uint8_t* block, uint8_t* texels);
+        static void decodeBc7Block(const uint8_t* block, uint8_t* texels);
+};
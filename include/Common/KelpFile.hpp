@@ -0,0 +1,123 @@
+#pragma once
+
+#include "Common/KelpFormat.hpp"
+#include "Common/ThreadPool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Read-only access to a .kelp file.
+ * The header and the TOC are validated on opening, then the whole file is memory mapped: payloads can be viewed
+ * in place and copied once, straight from the page cache to their destination, from any thread.
+ * Small sections can also be read with positional reads, which are thread safe as well.
+ * The TOC and the metadata sections are checked against their checksums when read, the payloads are checked by their readers.
+ */
+class KelpFile {
+    public:
+        explicit KelpFile(const std::filesystem::path& path);
+        ~KelpFile();
+
+        KelpFile(const KelpFile&) = delete;
+        KelpFile& operator=(const KelpFile&) = delete;
+
+        KelpFile(KelpFile&&) = delete;
+        KelpFile& operator=(KelpFile&&) = delete;
+
+
+        /**
+         * @brief Read a range of the file. Can be called concurrently from any thread.
+         *
+         * @param offset Offset of the range from the start of the file.
+         * @param dst Destination, must hold at least size bytes.
+         * @param size Size of the range in bytes.
+         * @throws std::runtime_error if the range is out of the file or the read fails.
+         */
+        void read(uint64_t offset, void* dst, size_t size) const;
+
+        /**
+         * @brief View a range of the memory mapped file, valid as long as the KelpFile lives. Can be called concurrently from any thread.
+         *
+         * @throws std::runtime_error if the range is out of the file.
+         */
+        [[nodiscard]] std::span<const std::byte> view(uint64_t offset, size_t size) const;
+
+        /**
+         * @brief Hint that a range is about to be viewed, so the kernel starts reading it ahead asynchronously.
+         */
+        void prefetch(uint64_t offset, size_t size) const noexcept;
+
+        /**
+         * @brief Drop the pages of a range once its content has been uploaded, so the scene isn't kept twice in RAM.
+         * Only the pages entirely inside the range are dropped, they are read again from the disk if the range is viewed again.
+         */
+        void evict(uint64_t offset, size_t size) const noexcept;
+
+        /**
+         * @brief Find a section in the TOC.
+         *
+         * @throws std::runtime_error if the file has no section of this type.
+         */
+        [[nodiscard]] const KelpFormat::SectionEntry& getSection(KelpFormat::SectionType type) const;
+
+        /**
+         * @brief Read a whole metadata section as an array of T.
+         *
+         * @throws std::runtime_error if the section is missing, its size is not a multiple of sizeof(T) or it doesn't match its checksum.
+         */
+        template <typename T>
+        [[nodiscard]] std::vector<T> readSection(KelpFormat::SectionType type) const {
+            const KelpFormat::SectionEntry& section = getSection(type);
+            if (section.size % sizeof(T) != 0)
+                throw std::runtime_error("Invalid .kelp section " + std::to_string(static_cast<uint32_t>(type)) + " size: " + std::to_string(section.size));
+
+            std::vector<T> elements(section.size / sizeof(T));
+            read(section.offset, elements.data(), section.size);
+            verifyChecksum(section, elements.data());
+            return elements;
+        }
+
+        /**
+         * @brief Check the checksums of the whole file, hashing the sections and the payloads in parallel from the memory mapping.
+         *
+         * @param threadPool Pool the hashing is spread on.
+         * @return A description of every corrupted section or payload, empty if the file is intact.
+         */
+        [[nodiscard]] std::vector<std::string> verify(ThreadPool& threadPool) const;
+
+
+        /* Getters */
+        [[nodiscard]] const std::filesystem::path& getPath() const noexcept { return m_path; }
+        [[nodiscard]] const KelpFormat::FileHeader& getHeader() const noexcept { return m_header; }
+        [[nodiscard]] const std::vector<KelpFormat::SectionEntry>& getSections() const noexcept { return m_sections; }
+        [[nodiscard]] uint64_t getMappedSize() const noexcept { return (m_header.fileSize + m_pageSize - 1) / m_pageSize * m_pageSize; }   // Whole pages, zero filled past the end of the file
+
+
+    private:
+        void readTableOfContents();
+        void verifyChecksum(const KelpFormat::SectionEntry& section, const void* data) const;
+        void mapFile();
+        void closeFile() noexcept;
+
+
+    private:
+        std::filesystem::path m_path;
+
+        #ifdef _WIN32
+            void* m_handle = nullptr;
+            void* m_mappingHandle = nullptr;
+        #else
+            int m_fd = -1;
+        #endif
+
+        const std::byte* m_mapping = nullptr;
+        size_t m_pageSize = 4096;
+
+        KelpFormat::FileHeader m_header{};
+        std::vector<KelpFormat::SectionEntry> m_sections;
+};
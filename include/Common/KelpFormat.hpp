@@ -0,0 +1,260 @@
+#pragma once
+
+#include "shared.hpp"
+
+#include "glm/ext/matrix_float4x4.hpp"
+#include "glm/ext/vector_float3.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * .kelp v8 container layout:
+ *
+ *   FileHeader | SectionEntry[sectionCount] (TOC) | padding | sections...
+ *
+ * The header and the TOC fit in the first SECTION_ALIGNMENT bytes so a single read is enough to locate everything.
+ * Every section, and every texture and mesh payload inside the data sections, starts on a SECTION_ALIGNMENT
+ * boundary so that it can be memory mapped or read with O_DIRECT, independently and in any order.
+ * All values are little endian.
+ *
+ * The payload sections can be compressed (SECTION_FLAG_COMPRESSED): each payload is then split into chunks of
+ * COMPRESSION_CHUNK_SIZE bytes, compressed independently with LZ4 and stored back to back from the payload offset.
+ * The chunks of a payload are located by its firstChunk index in the chunk directory, and its size stays the decompressed one.
+ *
+ * The mesh data section can also be encoded (SECTION_FLAG_ENCODED_MESHES): each mesh payload is then an EncodedMeshHeader
+ * followed by the MeshCodec streams of its vertices, indices and LOD indices, and its size is the encoded one.
+ * Encoding happens before compression, both can be combined.
+ *
+ * Everything is covered by XXH64 checksums (see Xxh64) of the bytes as stored: the TOC by FileHeader::tocChecksum,
+ * the metadata sections by SectionEntry::checksum, and the payload sections by the checksum of each payload in its directory entry
+ * and of each compressed chunk. The viewer verifies the payloads while they are uploaded: the compressed ones chunk by chunk, the
+ * uncompressed meshes as a whole, and the uncompressed textures mip by mip (TextureEntry::mipChecksums), as it reads their mip tails alone.
+ *
+ * The instances are partitioned into spatial cells (CellEntry), streamed in and out as a whole by the viewer: the instances
+ * of a cell are contiguous in the instance section, and the meshes and textures it needs are listed in the cell resources section.
+ */
+namespace KelpFormat {
+
+    static constexpr std::array<char, 8> MAGIC = { 'K', 'E', 'L', 'P', 'M', 'O', 'D', 'L' };
+    static constexpr uint32_t VERSION = 8;
+    static constexpr uint64_t SECTION_ALIGNMENT = 4096;
+    static constexpr uint32_t MAX_LOD_COUNT = 4;
+    static constexpr uint32_t MAX_MIP_COUNT = 16;
+    static constexpr uint32_t MAX_SECTION_COUNT = 64;  // Sanity bound of the table of contents, well above the section types
+
+    static constexpr uint32_t SECTION_FLAG_COMPRESSED = 1U << 0;
+    static constexpr uint32_t SECTION_FLAG_ENCODED_MESHES = 1U << 1;
+    static constexpr uint64_t COMPRESSION_CHUNK_SIZE = 256ULL * 1024;   // Small enough to spread a single texture over every core on load
+
+    enum class SectionType : uint32_t {
+        TextureDirectory,   // TextureEntry[]
+        Materials,          // Material[]
+        OpacityMicromaps,   // Serialized OMM SDK blob
+        MeshDirectory,      // MeshEntry[]
+        MeshInstances,      // InstanceEntry[]
+        TextureData,        // Texture payloads, located by TextureEntry::offset
+        MeshData,           // Mesh payloads, located by MeshEntry::offset
+        ChunkDirectory,     // ChunkEntry[], for the compressed sections
+        Cells,              // CellEntry[]
+        CellResources,      // uint32_t[], located by CellEntry::firstResource
+    };
+
+    enum class TextureCollection : uint32_t {
+        Albedo,             // RGBA8
+        Alpha,              // R8, decoded out of the albedo texture even when that one is kept block compressed
+        Normal,             // RGBA8
+        MetallicRoughness,  // RG8
+        Emissive,           // RGBA8
+        Count
+    };
+
+    struct FileHeader {
+        std::array<char, 8> magic;
+        uint32_t version;
+        uint32_t sectionCount;
+        uint64_t tocOffset;
+        uint64_t fileSize;
+        uint64_t tocChecksum;
+    };
+
+    struct SectionEntry {
+        SectionType type;
+        uint32_t flags;
+        uint64_t offset;
+        uint64_t size;
+        uint64_t alignment;
+        uint64_t elementCount;
+        uint64_t checksum;      // 0 for the payload sections, covered by the checksums of their payloads
+    };
+
+    /**
+     * @brief Texture directory entry, the payload holds every mip level tightly packed from the biggest one.
+     * Mip n is max(1, width >> n) x max(1, height >> n) texels of channelCount bytes, or the 4x4 blocks covering them for block compressed formats.
+     */
+    struct TextureEntry {
+        TextureCollection collection;
+        uint32_t channelCount;  // Bytes per texel, 0 for block compressed formats
+        uint32_t width;
+        uint32_t height;
+        uint32_t mipCount;      // Down to 1x1, except for the textures passed through with their own mip chain
+        uint32_t firstChunk;    // Only used if the texture data section is compressed
+        uint32_t vkFormat;      // VkFormat of the payload passed through from a KTX2 source, 0 (VK_FORMAT_UNDEFINED) for the format of the collection
+        uint32_t blockSize;     // Bytes per 4x4 block of the block compressed formats, 0 for the uncompressed ones
+        std::array<uint64_t, MAX_MIP_COUNT> mipChecksums;   // Of every mip level, decompressed
+        uint64_t offset;
+        uint64_t size;
+        uint64_t checksum;      // Of the payload as stored, compressed or not
+    };
+
+    struct MeshLodEntry {
+        float error;            // Max deviation from the full resolution mesh, in object space units
+        uint32_t indexCount;
+    };
+
+    /**
+     * @brief Mesh directory entry, the payload holds Vertex[vertexCount], uint32_t[indexCount],
+     * then the uint32_t indices of every LOD in order.
+     */
+    struct MeshEntry {
+        uint32_t materialIndex;
+        int32_t ommIndex;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t lodCount;
+        float boundsRadius;
+        glm::vec3 boundsCenter;
+        uint32_t firstChunk;    // Only used if the mesh data section is compressed
+        std::array<MeshLodEntry, MAX_LOD_COUNT> lods;
+        uint64_t offset;
+        uint64_t size;
+        uint64_t checksum;      // Of the payload as stored, compressed or not
+    };
+
+    /**
+     * @brief Start of an encoded mesh payload: the sizes of the vertex stream, the index stream,
+     * then of the index stream of every LOD, stored back to back after the header.
+     */
+    struct EncodedMeshHeader {
+        std::array<uint64_t, 2 + MAX_LOD_COUNT> streamSizes;
+    };
+
+    /**
+     * @brief Chunk directory entry, a chunk that doesn't compress is stored as is, with compressedSize == size.
+     */
+    struct ChunkEntry {
+        uint64_t offset;
+        uint32_t compressedSize;
+        uint32_t size;
+        uint64_t checksum;      // Of the chunk as stored
+    };
+
+    struct InstanceEntry {
+        glm::mat4 transform;
+        int32_t meshIndex;
+    };
+
+    /**
+     * @brief Cell entry, its resources are the indices of meshCount mesh directory entries
+     * followed by the indices of textureCount texture directory entries.
+     */
+    struct CellEntry {
+        glm::vec3 boundsMin;    // World space bounds of the instances of the cell
+        uint32_t firstInstance;
+        glm::vec3 boundsMax;
+        uint32_t instanceCount;
+        uint32_t firstResource;
+        uint32_t meshCount;
+        uint32_t textureCount;
+    };
+
+    static_assert(sizeof(FileHeader) == 40);
+    static_assert(sizeof(SectionEntry) == 48);
+    static_assert(sizeof(TextureEntry) == 184);
+    static_assert(sizeof(MeshEntry) == 96);
+    static_assert(sizeof(EncodedMeshHeader) == 48);
+    static_assert(sizeof(ChunkEntry) == 24);
+    static_assert(sizeof(InstanceEntry) == 68);
+    static_assert(sizeof(CellEntry) == 44);
+    static_assert(sizeof(Vertex) == 32);
+
+
+    [[nodiscard]] constexpr std::string_view getSectionName(SectionType type) noexcept {
+        switch (type) {
+            case SectionType::TextureDirectory: return "texture directory";
+            case SectionType::Materials:        return "materials";
+            case SectionType::OpacityMicromaps: return "opacity micromaps";
+            case SectionType::MeshDirectory:    return "mesh directory";
+            case SectionType::MeshInstances:    return "mesh instances";
+            case SectionType::TextureData:      return "texture data";
+            case SectionType::MeshData:         return "mesh data";
+            case SectionType::ChunkDirectory:   return "chunk directory";
+            case SectionType::Cells:            return "cells";
+            case SectionType::CellResources:    return "cell resources";
+        }
+        return "unknown section";
+    }
+
+    /**
+     * @brief Whether a section holds payloads located by a directory, rather than metadata read as a whole.
+     */
+    [[nodiscard]] constexpr bool isPayloadSection(SectionType type) noexcept {
+        return type == SectionType::TextureData || type == SectionType::MeshData;
+    }
+
+    [[nodiscard]] constexpr uint64_t alignUp(uint64_t value, uint64_t alignment = SECTION_ALIGNMENT) noexcept {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    [[nodiscard]] constexpr uint32_t mipDimension(uint32_t size, uint32_t level) noexcept {
+        return std::max(1U, size >> level);
+    }
+
+    [[nodiscard]] constexpr uint64_t mipSize(const TextureEntry& texture, uint32_t level) noexcept {
+        if (texture.blockSize != 0)
+            return static_cast<uint64_t>((mipDimension(texture.width, level) + 3) / 4) * ((mipDimension(texture.height, level) + 3) / 4) * texture.blockSize;
+        return static_cast<uint64_t>(mipDimension(texture.width, level)) * mipDimension(texture.height, level) * texture.channelCount;
+    }
+
+    /**
+     * @brief Offset of a mip level from the start of the texture payload.
+     */
+    [[nodiscard]] constexpr uint64_t mipOffset(const TextureEntry& texture, uint32_t level) noexcept {
+        uint64_t offset = 0;
+        for (uint32_t i = 0; i < level; i++)
+            offset += mipSize(texture, i);
+        return offset;
+    }
+
+    [[nodiscard]] constexpr uint64_t meshIndicesOffset(const MeshEntry& mesh) noexcept {
+        return static_cast<uint64_t>(mesh.vertexCount) * sizeof(Vertex);
+    }
+
+    /**
+     * @brief Offset of the indices of a LOD from the start of the mesh payload, LOD 0 being the full resolution mesh.
+     */
+    [[nodiscard]] constexpr uint64_t meshLodIndicesOffset(const MeshEntry& mesh, uint32_t lod) noexcept {
+        if (lod == 0)
+            return meshIndicesOffset(mesh);
+
+        uint64_t offset = meshIndicesOffset(mesh) + (static_cast<uint64_t>(mesh.indexCount) * sizeof(uint32_t));
+        for (uint32_t i = 0; i + 1 < lod; i++)
+            offset += static_cast<uint64_t>(mesh.lods[i].indexCount) * sizeof(uint32_t);
+        return offset;
+    }
+
+    [[nodiscard]] constexpr uint64_t chunkCount(uint64_t payloadSize) noexcept {
+        return (payloadSize + COMPRESSION_CHUNK_SIZE - 1) / COMPRESSION_CHUNK_SIZE;
+    }
+
+    /**
+     * @brief Size of the decoded mesh payload, also its stored size unless the mesh data section is encoded.
+     */
+    [[nodiscard]] constexpr uint64_t meshPayloadSize(const MeshEntry& mesh) noexcept {
+        return meshLodIndicesOffset(mesh, mesh.lodCount + 1);
+    }
+
+}   // namespace KelpFormat
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+ * @brief Compressor and decompressor for the LZ4 block format: byte oriented, no entropy coding,
+ * so decoding runs at several GB/s per core and a few threads keep up with a PCIe upload.
+ * Used for the optional compression of the .kelp payload sections.
+ */
+class Lz4 {
+    public:
+        Lz4() = delete;
+
+
+        /**
+         * @brief Worst case compressed size of size bytes, for incompressible data.
+         */
+        [[nodiscard]] static constexpr size_t compressBound(size_t size) noexcept {
+            return size + (size / 255) + 16;
+        }
+
+        /**
+         * @brief Compress a block.
+         *
+         * @param src Data to compress.
+         * @param srcSize Size of the data in bytes.
+         * @param dst Destination of the compressed block.
+         * @param dstCapacity Size of dst, compressBound(srcSize) always fits, a smaller capacity can be used to give up on data that doesn't compress well.
+         * @return The compressed size, or 0 if it doesn't fit in dstCapacity.
+         */
+        [[nodiscard]] static size_t compress(const std::byte* src, size_t srcSize, std::byte* dst, size_t dstCapacity) noexcept;
+
+        /**
+         * @brief Decompress a block, every read and write is bounds checked.
+         *
+         * @param src Compressed block.
+         * @param srcSize Size of the compressed block in bytes.
+         * @param dst Destination of the decompressed data.
+         * @param dstSize Exact decompressed size.
+         * @throws std::runtime_error if the block is malformed or doesn't decompress to exactly dstSize bytes.
+         */
+        static void decompress(const std::byte* src, size_t srcSize, std::byte* dst, size_t dstSize);
+};
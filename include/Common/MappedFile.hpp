@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+/**
+ * @brief Read-only memory mapping of a whole file.
+ * Pages are only read from the disk when first touched and can be dropped by the kernel under memory pressure,
+ * so large inputs can be viewed in place without being copied into RAM first.
+ */
+class MappedFile {
+    public:
+        /**
+         * @brief Map a file.
+         *
+         * @throws std::runtime_error if the file can't be opened or mapped.
+         */
+        explicit MappedFile(const std::filesystem::path& path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        MappedFile(MappedFile&&) = delete;
+        MappedFile& operator=(MappedFile&&) = delete;
+
+
+        /* Getters */
+        [[nodiscard]] const std::filesystem::path& getPath() const noexcept { return m_path; }
+        [[nodiscard]] std::span<const std::byte> getData() const noexcept { return { m_mapping, m_size }; }
+
+
+    private:
+        std::filesystem::path m_path;
+
+        const std::byte* m_mapping = nullptr;
+        size_t m_size = 0;
+};
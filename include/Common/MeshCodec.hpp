@@ -0,0 +1,62 @@
+#pragma once
+
+#include "shared.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * @brief Codec for the vertex and index buffers of the .kelp meshes.
+ *
+ * Attributes are quantized (positions on a power of two grid of POSITION_PRECISION_BITS over the mesh extent,
+ * normals to 16-bit octahedral coordinates, UVs are kept exact), split into one 32-bit lane per component
+ * and delta coded against the previous vertex. Indices are delta coded against the previous index.
+ * The zigzagged deltas are then cut into byte planes and bit packed by groups of 16 bytes, each group
+ * using 0, 2, 4 or 8 bits per byte, which decodes with a few SIMD shifts and masks per group.
+ *
+ * Streams are made of independent blocks of BLOCK_SIZE elements so that they can be decoded in parallel.
+ */
+class MeshCodec {
+    public:
+        MeshCodec() = delete;
+
+        static constexpr uint32_t BLOCK_SIZE = 16384;
+        static constexpr int POSITION_PRECISION_BITS = 20;
+
+
+        /**
+         * @brief Encode a vertex buffer into a stream.
+         */
+        [[nodiscard]] static std::vector<std::byte> encodeVertices(std::span<const Vertex> vertices);
+
+        /**
+         * @brief Encode an index buffer into a stream, works best with vertices ordered by first use.
+         */
+        [[nodiscard]] static std::vector<std::byte> encodeIndices(std::span<const uint32_t> indices);
+
+        /**
+         * @brief Validate the header of a stream and get its number of blocks.
+         *
+         * @param stream The encoded stream.
+         * @param elementCount Number of vertices or indices the stream is expected to hold.
+         * @throws std::runtime_error if the header or the block table is invalid.
+         */
+        [[nodiscard]] static size_t getBlockCount(std::span<const std::byte> stream, size_t elementCount);
+
+        /**
+         * @brief Decode one block of a vertex stream. Blocks can be decoded concurrently, in any order.
+         *
+         * @param stream The encoded stream, validated by getBlockCount().
+         * @param block Index of the block.
+         * @param vertices The whole decoded vertex buffer, only the range of the block is written.
+         * @throws std::runtime_error if the block is malformed.
+         */
+        static void decodeVertexBlock(std::span<const std::byte> stream, size_t block, std::span<Vertex> vertices);
+
+        /**
+         * @brief Decode one block of an index stream, see decodeVertexBlock().
+         */
+        static void decodeIndexBlock(std::span<const std::byte> stream, size_t block, std::span<uint32_t> indices);
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+    public:
+        explicit ThreadPool(uint32_t threadCount = std::thread::hardware_concurrency());
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        ThreadPool(ThreadPool&&) = delete;
+        ThreadPool& operator=(ThreadPool&&) = delete;
+
+
+        /**
+         * @brief Push a task to the queue, it will be executed by the first available worker.
+         * Exceptions thrown by the task are caught and rethrown by the next call to waitIdle().
+         *
+         * @param task The task to execute.
+         */
+        void submit(std::function<void()> task);
+
+        /**
+         * @brief Block until every submitted task is finished.
+         *
+         * @throws The first exception thrown by a task since the last call, if any.
+         */
+        void waitIdle();
+
+        /**
+         * @brief Call func(i) for every i in [0, count) using the workers and the calling thread.
+         * Indices are handed out dynamically, so the order of execution is not deterministic,
+         * but every index is processed exactly once. Can safely be called from inside a task.
+         *
+         * @param count The number of indices to process.
+         * @param func The function to call for each index.
+         * @throws The first exception thrown by func, once every index has been processed or skipped.
+         */
+        void parallelFor(size_t count, const std::function<void(size_t)>& func);
+
+
+        /* Getters */
+        [[nodiscard]] uint32_t getThreadCount() const noexcept { return static_cast<uint32_t>(m_workers.size()); }
+
+
+    private:
+        void workerLoop();
+
+
+    private:
+        std::vector<std::thread> m_workers;
+        std::deque<std::function<void()>> m_tasks;
+
+        std::mutex m_mutex;
+        std::condition_variable m_taskAvailable;
+        std::condition_variable m_idle;
+
+        size_t m_activeTaskCount = 0;
+        std::exception_ptr m_firstException;
+        bool m_stopping = false;
+};
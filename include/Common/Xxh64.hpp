@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief XXH64 hash, compatible with the reference implementation: four independent 64-bit lanes
+ * keep every core's multipliers busy, so it runs at memory bandwidth. Not cryptographic,
+ * used for the integrity checksums of the .kelp files.
+ */
+class Xxh64 {
+    public:
+        explicit Xxh64(uint64_t seed = 0) noexcept;
+
+
+        /**
+         * @brief Hash a whole buffer at once.
+         */
+        [[nodiscard]] static uint64_t hash(const void* data, size_t size, uint64_t seed = 0) noexcept;
+
+        /**
+         * @brief Append data to the hashed stream, the result is the same as a single hash() of the concatenation.
+         */
+        void update(const void* data, size_t size) noexcept;
+
+        /**
+         * @brief Hash of everything appended so far, the stream can still be extended afterwards.
+         */
+        [[nodiscard]] uint64_t digest() const noexcept;
+
+
+    private:
+        static constexpr size_t STRIPE_SIZE = 32;
+
+        uint64_t m_seed;
+        std::array<uint64_t, 4> m_lanes{};
+        std::array<std::byte, STRIPE_SIZE> m_buffer{};
+        size_t m_bufferSize = 0;
+        uint64_t m_totalSize = 0;
+};
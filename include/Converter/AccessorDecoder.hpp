@@ -0,0 +1,48 @@
+#pragma once
+
+#include "fastgltf/types.hpp"
+#include "glm/ext/vector_float2.hpp"
+#include "glm/ext/vector_float3.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+class AccessorDecoder {
+    public:
+        AccessorDecoder() = delete;
+
+
+        /**
+         * @brief Decode a VEC3 accessor into a strided array of glm::vec3 (e.g. a member of an interleaved vertex).
+         * Float accessors are bulk copied, normalized and quantized integer accessors go through a SIMD conversion path.
+         *
+         * @param asset The asset owning the accessor.
+         * @param accessor The accessor to decode, must be of type VEC3.
+         * @param dst Pointer to the first destination element.
+         * @param dstStride Distance in bytes between two destination elements.
+         * @throws std::runtime_error if the accessor type is not VEC3.
+         */
+        static void decodeVec3(const fastgltf::Asset& asset, const fastgltf::Accessor& accessor, glm::vec3* dst, size_t dstStride);
+
+        /**
+         * @brief Decode a VEC2 accessor into a strided array of glm::vec2, see decodeVec3().
+         */
+        static void decodeVec2(const fastgltf::Asset& asset, const fastgltf::Accessor& accessor, glm::vec2* dst, size_t dstStride);
+
+        /**
+         * @brief Decode a SCALAR index accessor of any unsigned component type into 32-bit indices.
+         *
+         * @param asset The asset owning the accessor.
+         * @param accessor The accessor to decode.
+         * @param dst Destination array, must hold at least accessor.count elements.
+         */
+        static void decodeIndices(const fastgltf::Asset& asset, const fastgltf::Accessor& accessor, uint32_t* dst);
+
+
+    private:
+        template <size_t ComponentCount>
+        static void decodeFloatVector(const fastgltf::Asset& asset, const fastgltf::Accessor& accessor, float* dst, size_t dstStride);
+
+        template <typename T, size_t ComponentCount>
+        static void decodeIntegerVector(const std::byte* src, size_t srcStride, size_t count, bool normalized, float* dst, size_t dstStride);
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Common/ThreadPool.hpp"
+#include "Converter/Converter.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+struct BatchOptions {
+    ConversionOptions conversion;   // Applied to every input, step logs are always disabled
+    uint64_t memoryBudget = 0;      // Estimated memory of the conversions in flight, 0 to only limit them to the thread count
+    bool force = false;             // Also convert the inputs whose output is up to date
+};
+
+/**
+ * @brief Converter of many independent inputs into one .kelp file each, sharing a single thread pool.
+ * Several files are converted at once, the largest first, and each of them spreads its own work over the same pool, so the small
+ * files fill the gaps left by the large ones. A file only starts once its estimated memory fits in the budget left by the ones in flight.
+ */
+class BatchConverter {
+    public:
+        enum class Status : uint8_t {
+            Converted,
+            UpToDate,
+            Failed,
+        };
+
+        struct Result {
+            std::filesystem::path input;
+            std::filesystem::path output;
+            Status status = Status::Failed;
+            double seconds = 0;
+            uint64_t inputSize = 0;     // The input and the files it may read, see getDependencies()
+            uint64_t outputSize = 0;
+            std::string error;
+        };
+
+        explicit BatchConverter(const BatchOptions& options);
+
+        /**
+         * @brief Convert every input found in a directory (recursively) or listed in a text file, one path per line.
+         * Outputs keep the layout of the inputs relative to the directory or to the list file, with a .kelp extension.
+         * A failing input doesn't stop the others, its error is reported in its result.
+         *
+         * @param source The input directory or list file.
+         * @param outputDirectory Where the .kelp files are written, created if needed.
+         * @return The result of every input, in input order.
+         * @throws std::runtime_error if the source can't be read or two inputs would be written to the same output.
+         */
+        std::vector<Result> convert(const std::filesystem::path& source, const std::filesystem::path& outputDirectory);
+
+        /**
+         * @brief Print a table of the status, time & sizes of every input, then the totals.
+         */
+        static void printSummary(const std::vector<Result>& results, double seconds);
+
+
+    private:
+        struct Job {
+            std::filesystem::path input;
+            std::filesystem::path output;
+            uint64_t inputSize;
+            uint64_t estimatedMemory;
+            std::filesystem::file_time_type lastInputWrite;     // Newest write among the input & its dependencies
+        };
+
+        // Decoded textures, meshes & their LODs of a typical asset, relative to its encoded size
+        static constexpr uint64_t ESTIMATED_MEMORY_PER_INPUT_BYTE = 4;
+
+        static bool isConvertible(const std::filesystem::path& path);
+        static std::vector<std::filesystem::path> collectInputs(const std::filesystem::path& source);
+        static std::vector<std::filesystem::path> getDependencies(const std::filesystem::path& input);
+        static bool isUpToDate(const Job& job);
+        void runJob(const Job& job, Result& result);
+
+        BatchOptions m_options;
+        ThreadPool m_threadPool;
+};
@@ -1,13 +1,28 @@
 #pragma once
 
+#include "Common/KelpFormat.hpp"
+#include "Common/MappedFile.hpp"
+#include "Common/ThreadPool.hpp"
+#include "Converter/KelpWriter.hpp"
 #include "shared.hpp"
 
 #include "fastgltf/types.hpp"
+#include "glm/ext/matrix_float4x4.hpp"
 #include "glm/ext/vector_int2.hpp"
 #include "omm.hpp"
 
+#include <array>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <span>
+#include <utility>
 #include <vector>
 
 struct MipLevel {
@@ -16,26 +31,44 @@ struct MipLevel {
 };
 
 struct Texture {
-    int gltfIndex;
-    std::vector<MipLevel> mipLevels;
+    int gltfIndex;                      // Among the textures of every input, see Converter::getSourceTexture()
+    std::vector<MipLevel> mipLevels;    // Only filled while the texture is being processed
+    size_t entryIndex = 0;              // Index in the texture directory
+};
+
+struct MeshLod {
+    std::vector<uint32_t> indices;
+    float error;    // Max deviation from the full resolution mesh, in object space units
 };
 
 struct Mesh {
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
+    std::vector<MeshLod> lods;  // Simplified index buffers over the same vertices, from the most to the least detailed
     int materialIndex;
     int ommIndex;
-    int gltfIndex;
 };
 
-struct KelpMeshInstance {
-    glm::mat4 transform;
-    int meshIndex;
+struct ConversionOptions {
+    bool compress = false;      // LZ4 compression of the texture & mesh payloads, in chunks decompressed in parallel on load
+    bool encodeMeshes = false;  // Quantized, delta coded & bit packed mesh payloads (see MeshCodec), decoded in parallel on load
+    float cellSize = 0;         // Edge length of the streaming cells, 0 to split the largest extent of the scene in DEFAULT_CELLS_PER_AXIS
+    bool verbose = true;        // Timings & statistics of every step on stdout
+};
+
+struct BundleInput {
+    std::filesystem::path path;
+    glm::mat4 transform = glm::mat4(1);    // Applied on top of the glTF scene transforms
 };
 
 class Converter {
     public:
-        Converter() = default;
+        Converter();
+
+        /**
+         * @brief Run the conversion on a pool shared with other converters, which must outlive the converter.
+         */
+        explicit Converter(ThreadPool& threadPool);
         ~Converter() = default;
 
         Converter(const Converter&) = delete;
@@ -44,29 +77,119 @@ class Converter {
         Converter(Converter&&) = delete;
         Converter& operator=(Converter&&) = delete;
 
-        void convert(const std::filesystem::path& inputFile, const std::filesystem::path& outputFile);
+        void convert(const std::filesystem::path& inputFile, const std::filesystem::path& outputFile, const ConversionOptions& options = {});
+
+        /**
+         * @brief Convert several glTF files into a single .kelp scene.
+         * Equal textures, materials & meshes are stored once whichever input they come from, every input is processed on the same thread pool.
+         */
+        void convertBundle(const std::vector<BundleInput>& inputs, const std::filesystem::path& outputFile, const ConversionOptions& options = {});
 
     private:
-        static fastgltf::Asset parseFile(const std::filesystem::path& inputFile);
-        static void funcTime(const std::string& context, const std::function<void()>& func);
+        struct Input {
+            std::filesystem::path path;
+            fastgltf::Asset asset;
+            glm::mat4 transform;
+            int firstTexture;       // Offsets of the input textures, materials & meshes among the ones of every input
+            int firstMaterial;
+            int firstMesh;
+        };
+
+        struct ImageSource {
+            std::span<const uint8_t> bytes;     // Encoded image embedded in the glTF, empty for external files
+            std::filesystem::path path;
+        };
+
+        struct CompressionStats {
+            uint64_t size = 0;
+            uint64_t compressedSize = 0;
+        };
+
+        struct TextureCollectionInfo {
+            std::vector<Texture>* textures;
+            uint32_t channelCount;
+        };
+
+        static constexpr uint32_t SECTION_COUNT = 10;
+        static constexpr float DEFAULT_CELLS_PER_AXIS = 8;
+        static_assert(sizeof(KelpFormat::FileHeader) + (SECTION_COUNT * sizeof(KelpFormat::SectionEntry)) <= KelpFormat::SECTION_ALIGNMENT);
+
+        fastgltf::Asset parseFile(const std::filesystem::path& inputFile);
+        void mapBuffers(fastgltf::Asset& asset, const std::filesystem::path& inputFile);
+        void decodeMeshoptBuffers(fastgltf::Asset& asset);
+        fastgltf::Asset importMeshFile(const std::filesystem::path& inputFile);
+        const MappedFile& mapInputFile(const std::filesystem::path& path);
+        static std::span<const std::byte> getGlbBinaryChunk(const MappedFile& glbFile);
+        void funcTime(const std::string& context, const std::function<void()>& func) const;
+        [[nodiscard]] std::ostream& log() const;
         static void generateMipmaps(Texture& texture, int channels);
 
-        void loadMaterials(const fastgltf::Asset& asset);
+        void parseInputs(const std::vector<BundleInput>& inputs);
+        void loadMaterials(const Input& input);
+        std::pair<Input&, const fastgltf::Texture&> getSourceTexture(int gltfIndex);
+        void deduplicateTextures();
+        bool hasSameImage(int gltfIndex, int otherGltfIndex);
+        void deduplicateMaterials();
         static int processTextureIndex(int originalIndex, std::vector<Texture>& textureCollection);
         void initTextureCollections();
-        void loadTextures(fastgltf::Asset& asset, const std::filesystem::path& inputFile);
-        static std::pair<glm::ivec2, uint8_t*> loadTexture(fastgltf::Asset& asset, const std::filesystem::path& inputFile, const fastgltf::Texture& gltfTexture, int desiredChannels);
+        std::array<TextureCollectionInfo, static_cast<size_t>(KelpFormat::TextureCollection::Count)> getTextureCollections();
+        void layoutTextures();
+        void loadTextures();
+        static ImageSource getImageSource(fastgltf::Asset& asset, const std::filesystem::path& inputFile, const fastgltf::Texture& gltfTexture);
+        static MipLevel loadTexture(fastgltf::Asset& asset, const std::filesystem::path& inputFile, const fastgltf::Texture& gltfTexture, int desiredChannels);
+        static void readImage(const ImageSource& source, const std::function<void(std::span<const uint8_t>)>& read);
+        static KelpFormat::TextureEntry readTextureHeader(fastgltf::Asset& asset, const std::filesystem::path& inputFile, const fastgltf::Texture& gltfTexture, KelpFormat::TextureCollection collection, uint32_t channelCount);
+        [[nodiscard]] bool isPassedThrough(const Texture& texture) const;
+        void passThroughTexture(const Texture& texture, Texture* alphaTexture);
+        void writeTexture(const Texture& texture);
+        void writeTexturePayload(KelpFormat::TextureEntry& entry, const std::vector<std::span<const std::byte>>& mipLevels);
+        void writePayload(KelpFormat::SectionType section, const std::vector<std::span<const std::byte>>& parts, uint64_t& offset, uint32_t& firstChunk, uint64_t& checksum);
+        void addPayloadSection(KelpFormat::SectionType type, uint64_t offset, uint64_t elementCount, uint32_t flags = 0);
+        static void releaseTexture(Texture& texture);
         void bakeOpacityMicromaps();
-        void loadMeshes(fastgltf::Asset& asset);
-        void loadGltfScene(const std::filesystem::path& filePath, const fastgltf::Asset& asset, const fastgltf::Scene& scene);
-        void loadGltfNode(const std::filesystem::path& filePath, const fastgltf::Asset& asset, const fastgltf::Node& node, const glm::mat4& parentTransform = glm::mat4(1));
+        void loadMeshes();
+        Mesh loadPrimitive(const fastgltf::Asset& asset, const fastgltf::Primitive& primitive);
+        void deduplicateMeshes(const std::vector<int>& primitiveMeshes);
+        static void generateLods(Mesh& mesh);
+        void generateMeshLods();
+        static std::vector<std::byte> encodeMesh(Mesh& mesh);
+        void writeMeshes();
+        void loadGltfScene(const Input& input);
+        void loadGltfNode(const Input& input, const fastgltf::Node& node, const glm::mat4& parentTransform);
+        void partitionCells();
         void concatenateTextures();
+        void writeKelpFile();
+
+        ConversionOptions m_options;
+        std::unique_ptr<ThreadPool> m_ownedThreadPool;      // Only set when the pool isn't shared
+        ThreadPool& m_threadPool;
+        mutable std::ostream m_discardedLog{nullptr};      // Stream without buffer, returned by log() when not verbose. Per converter, as writes set its state
+
+        std::mutex m_inputMutex;                                   // Guards the mappings while the inputs are parsed in parallel
+        std::vector<std::unique_ptr<MappedFile>> m_inputMappings;  // Must outlive the glTF assets, their buffers point into them
+        std::vector<std::unique_ptr<std::vector<std::byte>>> m_decodedBuffers;    // Decoded meshopt buffer views & imported OBJ/PLY geometry, must outlive the glTF assets too
+        std::vector<Input> m_inputs;
+
+        std::unique_ptr<KelpWriter> m_writer;
+        uint64_t m_fileCursor = 0;                          // End of the last section laid out
+        std::vector<KelpFormat::SectionEntry> m_sections;
+        std::vector<KelpFormat::TextureEntry> m_textureEntries;
+        std::vector<KelpFormat::MeshEntry> m_meshEntries;
+
+        std::mutex m_layoutMutex;                           // Guards the cursor, the chunks & the stats while compressed payloads are placed
+        std::vector<KelpFormat::ChunkEntry> m_chunkEntries;
+        std::map<KelpFormat::SectionType, CompressionStats> m_compressionStats;
 
         std::vector<Mesh> m_meshes;
-        std::vector<KelpMeshInstance> m_meshInstances;
+        std::atomic<bool> m_ignoredTextureTransforms = false;      // Set by the primitives whose texture transforms can't be baked in, reported once
+        std::vector<std::vector<int>> m_gltfMeshPrimitives;         // Output meshes of each glTF mesh of every input
+        std::vector<KelpFormat::InstanceEntry> m_meshInstances;    // Grouped by cell once the scene is partitioned
+        std::vector<KelpFormat::CellEntry> m_cells;
+        std::vector<uint32_t> m_cellResources;
         omm::Cpu::SerializedResult m_serializedOmms = nullptr;
 
         std::vector<Material> m_materials;
+        std::vector<int> m_gltfMaterialIndices;                     // Output material of each glTF material of every input
 
         std::vector<Texture> m_finalTextures;
 
@@ -75,4 +198,4 @@ class Converter {
         std::vector<Texture> m_normalTextures;
         std::vector<Texture> m_metallicRoughnessTextures;
         std::vector<Texture> m_emissiveTextures;
-};
+};
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+/**
+ * @brief Write-only access to a .kelp file being converted.
+ * Every write lands at an absolute offset with a positional write, so textures and meshes can be written
+ * from any thread as soon as they are processed, in any order. The gaps left between payloads read back as zeros.
+ */
+class KelpWriter {
+    public:
+        explicit KelpWriter(const std::filesystem::path& path);
+        ~KelpWriter();
+
+        KelpWriter(const KelpWriter&) = delete;
+        KelpWriter& operator=(const KelpWriter&) = delete;
+
+        KelpWriter(KelpWriter&&) = delete;
+        KelpWriter& operator=(KelpWriter&&) = delete;
+
+
+        /**
+         * @brief Write a range of the file. Can be called concurrently from any thread.
+         *
+         * @param offset Offset of the range from the start of the file.
+         * @param data Data to write.
+         * @param size Size of the range in bytes.
+         * @throws std::runtime_error if the write fails.
+         */
+        void write(uint64_t offset, const void* data, size_t size) const;
+
+        /**
+         * @brief Set the final size of the file, padding it with zeros, and close it.
+         *
+         * @throws std::runtime_error if the file can't be resized or closed.
+         */
+        void finish(uint64_t fileSize);
+
+
+        /* Getters */
+        [[nodiscard]] const std::filesystem::path& getPath() const noexcept { return m_path; }
+
+
+    private:
+        void closeFile() noexcept;
+
+
+    private:
+        std::filesystem::path m_path;
+
+        #ifdef _WIN32
+            void* m_handle = nullptr;
+        #else
+            int m_fd = -1;
+        #endif
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * @brief Reader for KTX2 containers holding uncompressed 8-bit or BCn payloads with their mip chain.
+ * The levels are returned as views into the container, so they can be stored in the .kelp file without decoding anything,
+ * or decoded when the texture needs its texels.
+ * Supercompressed (Basis Universal, Zstandard) containers would need a transcoder and are rejected.
+ */
+class Ktx2 {
+    public:
+        Ktx2() = delete;
+
+        struct Image {
+            uint32_t width;
+            uint32_t height;
+            uint32_t vkFormat;                              // Sampled format, sRGB formats are mapped to their UNORM counterpart like the decoded textures
+            uint32_t texelSize;                             // Bytes per texel of the uncompressed formats, 0 for the block compressed ones
+            uint32_t blockSize;                             // Bytes per 4x4 block of the block compressed formats, 0 for the uncompressed ones
+            uint32_t channelCount;                          // Channels stored by the format, the others are sampled as 0 (green & blue) or opaque (alpha)
+            std::vector<std::span<const uint8_t>> levels;   // From the biggest one, level n is max(1, width >> n) x max(1, height >> n) texels
+        };
+
+
+        /**
+         * @brief Whether the data starts with the KTX2 file identifier.
+         */
+        [[nodiscard]] static bool isKtx2(std::span<const uint8_t> data) noexcept;
+
+        /**
+         * @brief Parse a KTX2 container, every level is bounds & size checked.
+         *
+         * @param data The whole container, must outlive the returned image.
+         * @throws std::runtime_error if the container is malformed, supercompressed, not a single 2D image or of an unsupported format.
+         */
+        [[nodiscard]] static Image parse(std::span<const uint8_t> data);
+
+        /**
+         * @brief Decode a level of an image to 8-bit RGBA texels, as they would be sampled.
+         *
+         * @param image The parsed image.
+         * @param level Index of the level to decode.
+         * @throws std::runtime_error if the format holds HDR values (BC6H).
+         */
+        [[nodiscard]] static std::vector<uint8_t> decode(const Image& image, size_t level);
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Common/ThreadPool.hpp"
+
+#include "glm/ext/vector_float3.hpp"
+#include "glm/ext/vector_float4.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Importers of Wavefront OBJ (with its MTL libraries) and PLY files.
+ *
+ * The file is memory mapped and split into chunks at line boundaries that are parsed in parallel, numbers going through
+ * a parser converting 8 digits per multiplication. Binary PLY elements are fixed size or indexed by a sequential scan of
+ * their list counts, then decoded in parallel too. The geometry is returned as ready to use attribute streams, so the
+ * converter can wrap it in an in-memory glTF asset and run the same pipeline as for glTF inputs.
+ */
+class MeshImporter {
+    public:
+        MeshImporter() = delete;
+
+        struct Material {
+            glm::vec4 baseColorFactor{ 1.0F };
+            glm::vec3 emissiveFactor{ 0.0F };
+            float metallicFactor = 0.0F;
+            float roughnessFactor = 1.0F;
+            bool alphaMask = false;         // Cut out by the base color alpha (MTL map_d), blended if the base color alpha is below 1 otherwise
+            std::string baseColorTexture;   // Paths relative to the input file directory, empty if there is none
+            std::string normalTexture;
+            std::string emissiveTexture;
+        };
+
+        struct Primitive {
+            uint32_t materialIndex;
+            uint32_t vertexCount;
+            uint32_t indexCount;
+            std::vector<std::byte> data;    // Positions & normals (vec3), then UVs (vec2, glTF orientation) of every vertex, then the uint32_t triangle indices
+
+            [[nodiscard]] static constexpr size_t positionsOffset() noexcept { return 0; }
+            [[nodiscard]] size_t normalsOffset() const noexcept { return static_cast<size_t>(vertexCount) * sizeof(glm::vec3); }
+            [[nodiscard]] size_t uvsOffset() const noexcept { return static_cast<size_t>(vertexCount) * 2 * sizeof(glm::vec3); }
+            [[nodiscard]] size_t indicesOffset() const noexcept { return static_cast<size_t>(vertexCount) * ((2 * sizeof(glm::vec3)) + (2 * sizeof(float))); }
+        };
+
+        struct Scene {
+            std::vector<Material> materials;
+            std::vector<Primitive> primitives;  // One per used material, placed at the origin
+        };
+
+
+        /**
+         * @brief Whether the file extension is one of the imported formats (.obj, .ply).
+         */
+        [[nodiscard]] static bool isSupported(const std::filesystem::path& path);
+
+        /**
+         * @brief Import an OBJ or PLY file, missing normals are generated and missing UVs set to 0.
+         *
+         * @param path The file to import, its extension selects the format.
+         * @param threadPool Workers the chunks are parsed with.
+         * @throws std::runtime_error if the file can't be read, is malformed or has more vertices than 32-bit indices can address.
+         */
+        [[nodiscard]] static Scene import(const std::filesystem::path& path, ThreadPool& threadPool);
+
+
+    private:
+        static Scene importObj(const std::filesystem::path& path, ThreadPool& threadPool);
+        static Scene importPly(const std::filesystem::path& path, ThreadPool& threadPool);
+        static void parseMtl(const std::filesystem::path& path, const std::filesystem::path& inputDirectory, std::vector<Material>& materials, std::vector<std::string>& names);
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "shared.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class MeshSimplifier {
+    public:
+        MeshSimplifier() = delete;
+
+        struct Result {
+            std::vector<uint32_t> indices;
+            float error;    // Max geometric deviation introduced by the simplification, in object space units
+        };
+
+
+        /**
+         * @brief Simplify a triangle list with quadric error metric edge collapses.
+         * Vertices are never moved nor created, the result indexes the same vertex array, so LODs can share one vertex buffer.
+         * Border and attribute seam vertices (glTF splits vertices on UV/normal seams) are locked, and the collapse cost
+         * includes the normal and UV difference so that attribute discontinuities are preserved.
+         *
+         * @param vertices The vertex array.
+         * @param indices The triangle list to simplify.
+         * @param targetIndexCount The index count to reach, the result can be bigger if maxError is reached first.
+         * @param maxError The max deviation allowed, relative to the mesh extent (0.01 = 1% of the bounding box diagonal).
+         * @return Result The simplified triangle list and the deviation it introduced.
+         */
+        static Result simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, size_t targetIndexCount, float maxError);
+};
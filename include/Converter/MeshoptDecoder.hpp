@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+/**
+ * @brief Decoder for the buffer views compressed with EXT_meshopt_compression (meshoptimizer vertex codec v0, index codec v1).
+ *
+ * Attribute streams are split into blocks of up to 256 vertices whose bytes are bit packed by groups of 16, then
+ * delta coded against the previous vertex. The groups are unpacked byte plane by byte plane, then the deltas of 16
+ * vertices are transposed back and prefix summed 4 bytes at a time with SSE2. The optional filters run afterwards.
+ */
+class MeshoptDecoder {
+    public:
+        MeshoptDecoder() = delete;
+
+        enum class Mode : uint8_t {
+            Attributes,     // Vertex codec, any stride multiple of 4 up to 256 bytes
+            Triangles,      // Index codec, 2 or 4 bytes per index
+            Indices,        // Index sequence codec, 2 or 4 bytes per index
+        };
+
+        enum class Filter : uint8_t {
+            None,
+            Octahedral,     // 4 snorm8 or snorm16 components, xy octahedral coordinates
+            Quaternion,     // 4 snorm16 components, the biggest one reconstructed
+            Exponential,    // 32-bit floats stored as a 24-bit mantissa & an 8-bit exponent
+        };
+
+
+        /**
+         * @brief Decode a compressed buffer view, every read is bounds checked.
+         *
+         * @param src The compressed data.
+         * @param dst Destination of the decoded data, count * stride bytes.
+         * @param count Number of elements (vertices or indices).
+         * @param stride Size of an element in bytes.
+         * @param mode The codec of the stream.
+         * @param filter The filter applied after decoding, attributes only.
+         * @throws std::runtime_error if the stream is malformed or the parameters are not allowed for the mode.
+         */
+        static void decode(std::span<const std::byte> src, std::span<std::byte> dst, size_t count, size_t stride, Mode mode, Filter filter);
+
+
+    private:
+        static void decodeVertexBuffer(std::span<const uint8_t> src, uint8_t* dst, size_t count, size_t stride);
+        static void decodeIndexBuffer(std::span<const uint8_t> src, std::byte* dst, size_t count, size_t stride);
+        static void decodeIndexSequence(std::span<const uint8_t> src, std::byte* dst, size_t count, size_t stride);
+        static void applyFilter(std::byte* data, size_t count, size_t stride, Filter filter);
+};
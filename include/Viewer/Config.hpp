@@ -14,6 +14,46 @@ namespace Config {
     static constexpr float CAMERA_SPEED = 10;
     static constexpr float CAMERA_SENSITIVITY = 0.1;
 
+    // Mesh LOD selection: the coarsest LOD whose error projects under this many pixels is used,
+    // a coarser LOD is only picked once its error goes under LOD_HYSTERESIS times the threshold to avoid popping back and forth
+    static constexpr float LOD_PIXEL_ERROR_THRESHOLD = 1;
+    static constexpr float LOD_HYSTERESIS = 0.75;
+
+    // Asset loading: texture and mesh payloads are read in batches of at most this many bytes of staging memory, suballocated from a
+    // persistent ring. A batch is at most half the ring, so that it never waits for its own allocations
+    static constexpr uint64_t STAGING_RING_SIZE = 256ULL * 1024 * 1024;
+    static constexpr uint64_t MAX_STAGING_BATCH_SIZE = STAGING_RING_SIZE / 2;
+
+    // Uncompressed payloads at least this large are copied by the GPU straight from the pages of the mapped file when the device can
+    // import host memory, the smaller ones are cheaper to copy into staging memory than to pin
+    static constexpr uint64_t MIN_IMPORTED_PAYLOAD_SIZE = 256ULL * 1024;
+
+    // Vertices and indices of the resident meshes are suballocated from buffers of this size, a mesh larger than that gets a buffer of its own
+    static constexpr uint64_t GEOMETRY_BUFFER_SIZE = 256ULL * 1024 * 1024;
+
+    // Bottom level acceleration structures: the meshes loaded together are built in batches sharing one scratch buffer of at most this
+    // many bytes (a build needing more gets a batch of its own), then compacted together. Most meshes are cheap to build and get the
+    // fastest traversal, the ones above BLAS_FAST_BUILD_TRIANGLE_COUNT triangles prefer a fast build and the ones above
+    // BLAS_LOW_MEMORY_TRIANGLE_COUNT also a smaller footprint, as they dominate build time and memory
+    static constexpr uint64_t BLAS_SCRATCH_BUDGET = 128ULL * 1024 * 1024;
+    static constexpr uint32_t BLAS_FAST_BUILD_TRIANGLE_COUNT = 500'000;
+    static constexpr uint32_t BLAS_LOW_MEMORY_TRIANGLE_COUNT = 2'000'000;
+
+    // Cell streaming: without a memory budget on the command line, this share of the VRAM left free once the viewer is set up is used.
+    // Cells farther than the prefetch radius times STREAMING_EVICTION_FACTOR are evicted even within the budget, so that moving
+    // back and forth across the radius doesn't reload them. The streaming thread checks the camera position every poll interval when idle
+    static constexpr float STREAMING_VRAM_BUDGET_SHARE = 0.8;
+    static constexpr float STREAMING_EVICTION_FACTOR = 1.5;
+    static constexpr uint32_t STREAMING_POLL_INTERVAL_MS = 50;
+
+    // Textures are streamed in with their mip tail only, the mips at most TEXTURE_MIP_TAIL_SIZE texels on a side, so that a cell shows up as
+    // soon as its meshes are built. The hit shaders record the finest resolution they sample from each texture, read back once each frame
+    // is complete, and the finest of every TEXTURE_FEEDBACK_FRAMES frames is handed to the streaming thread. It loads the finer mips
+    // sampled within the memory budget, and drops the mips more than TEXTURE_MIP_EVICTION_SLACK levels finer than sampled
+    static constexpr uint32_t TEXTURE_MIP_TAIL_SIZE = 64;
+    static constexpr uint32_t TEXTURE_FEEDBACK_FRAMES = 30;
+    static constexpr uint32_t TEXTURE_MIP_EVICTION_SLACK = 1;
+
     static constexpr std::array<const char *const, 1> REQUIRED_VALIDATION_LAYERS = {
         "VK_LAYER_KHRONOS_validation"
     };
@@ -1,23 +1,48 @@
 #pragma once
 
+#include "Common/AsyncFileReader.hpp"
+#include "Common/KelpFile.hpp"
+#include "Common/ThreadPool.hpp"
 #include "Viewer/Camera.hpp"
+#include "Viewer/Config.hpp"
 #include "Viewer/Window.hpp"
 #include "Vulkan/Buffer.hpp"
 #include "Vulkan/DescriptorManager.hpp"
 #include "Vulkan/Device.hpp"
+#include "Vulkan/GeometryBuffer.hpp"
+#include "Vulkan/HostPointerBuffer.hpp"
 #include "Vulkan/Image.hpp"
+#include "Vulkan/StagingUploader.hpp"
 #include "Vulkan/Swapchain.hpp"
 #include "omm.hpp"
 #include "shared.hpp"
 
+#include "glm/ext/vector_float3.hpp"
 #include "glm/ext/vector_int2.hpp"
 #include <vulkan/vulkan_core.h>
 
+#include <array>
+#include <condition_variable>
+#include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <exception>
 #include <filesystem>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <utility>
 #include <vector>
 
+struct StreamingOptions {
+    uint64_t memoryBudget = 0;                                  // Bytes of meshes, BLASes & textures kept resident, 0 for a share of the free VRAM
+    float prefetchRadius = std::numeric_limits<float>::max();   // Cells closer than this to the camera are streamed in, nearest first
+    bool meshLods = true;                                       // Build & select the LOD BLASes, false to always trace the full resolution meshes
+};
+
 class Viewer {
     public:
         Viewer();
@@ -29,59 +54,134 @@ class Viewer {
         Viewer(Viewer&&) noexcept = delete;
         Viewer& operator=(Viewer&&) = delete;
 
-        void run(const std::filesystem::path& filePath);
+        void run(const std::filesystem::path& filePath, const StreamingOptions& options = {});
 
 
     private: // Assets
         struct AccelerationStructure {
             VkAccelerationStructureKHR handle;
             VkDeviceAddress deviceAddress;
+            VkDeviceSize size;
             Buffer buffer;
             std::unique_ptr<Buffer> micromapBuffer;
             VkMicromapEXT micromap;
         };
 
+        struct MeshLod {
+            VkDeviceAddress indexAddress;   // In the geometry of the full resolution mesh, indexes its vertices
+            uint32_t indexCount;
+            float error;            // Max deviation from the full resolution mesh, in object space units
+            AccelerationStructure accelerationStructure;
+        };
+
         struct Mesh {
-            Buffer vertexBuffer;
-            Buffer indexBuffer;
+            GeometryBuffer::Allocation geometry;    // Vertices, indices then LOD indices, laid out like the mesh payload
+            VkDeviceAddress vertexAddress;
+            VkDeviceAddress indexAddress;
             uint32_t indexCount;
             AccelerationStructure accelerationStructure;
             int materialIndex;
+            std::vector<MeshLod> lods;  // From the most to the least detailed, the full resolution mesh is LOD 0
+            glm::vec3 boundsCenter;
+            float boundsRadius;
+        };
+
+        struct SceneInstance {
+            glm::vec3 center;           // World space bounding sphere
+            float radius;
+            float scale;                // Max axis scale of the transform, converts object space errors to world space
+            int meshIndex;
+            uint32_t firstMeshInstance; // Index of the LOD 0 entry in the mesh instance buffer, LOD n is at firstMeshInstance + n
+            uint32_t lod;
         };
 
         struct Texture {
             std::shared_ptr<Image> image;
-            uint32_t bindlessId;
+            uint32_t bindlessId;        // Slot of its descriptor, the texture slot buffer maps its directory entry to it once resident
         };
 
-        std::vector<Texture> m_albedoTextures;
-        std::vector<Texture> m_alphaTextures;
-        std::vector<Texture> m_normalTextures;
-        std::vector<Texture> m_metallicRoughnessTextures;
-        std::vector<Texture> m_emissiveTextures;
+        struct FileRange {
+            uint64_t offset;
+            uint64_t size;          // Decompressed size
+            uint32_t firstChunk;    // Only used if the section is compressed
+            uint64_t checksum;      // Of the range as stored, checked once it is read. Compressed ranges are checked chunk by chunk instead
+            bool hostMemory = false;    // Read into plain host memory instead of staging memory, handed to the upload without buffer
+            const KelpFormat::TextureEntry* texture = nullptr;  // For a texture payload, whose mips from firstMip are checked one by one instead
+            uint32_t firstMip = 0;
+        };
+
+        struct BottomLevelBuild {
+            VkAccelerationStructureGeometryKHR geometry;                        // Its pNext is set by the build, to ommLinkInfo if the mesh has a micromap
+            uint32_t triangleCount;
+            std::vector<VkMicromapUsageEXT> ommUsageCounts;
+            VkAccelerationStructureTrianglesOpacityMicromapEXT ommLinkInfo;     // Only used if its micromap is set, pUsageCounts is set by the build
+        };
+
+        struct MicromapBuild {
+            VkMicromapBuildInfoEXT buildInfo;                                   // pUsageCounts & scratchData are set by the build
+            std::vector<VkMicromapUsageEXT> usageCounts;
+            VkDeviceSize scratchSize;
+        };
+
+        struct UploadSource {
+            const std::byte* data;      // The range, readable by the CPU
+            VkBuffer buffer;            // Holding the range at offset, to copy from. VK_NULL_HANDLE for the ranges read into host memory
+            VkDeviceSize offset;
+        };
+
+        std::vector<KelpFormat::TextureEntry> m_textureEntries;
+        std::vector<bool> m_decodedTextures;            // Passed through textures of a format the device can't sample, decoded to RGBA8 when loaded
+        std::vector<KelpFormat::MeshEntry> m_meshEntries;
+        std::vector<Texture> m_textures;                // Indexed like the texture directory, null images for the textures not resident
+        std::unique_ptr<Image> m_placeholderTexture;    // Sampled in place of the textures not resident, at PLACEHOLDER_TEXTURE_SLOT
+        std::unique_ptr<Buffer> m_textureSlotBuffer;    // Descriptor slot of every texture of the directory, written by the render thread
+        std::array<std::unique_ptr<Buffer>, Config::MAX_FRAMES_IN_FLIGHT> m_textureFeedbackBuffers;            // Device local, written by the hit shaders of each frame in flight
+        std::array<std::unique_ptr<Buffer>, Config::MAX_FRAMES_IN_FLIGHT> m_textureFeedbackReadbackBuffers;    // Host copies of the feedback of each frame in flight
 
         omm::Cpu::DeserializedResult m_ommDeserializedResult = nullptr;
         std::vector<omm::Cpu::BakeResultDesc> m_ommBakeResults;
 
-        std::vector<std::shared_ptr<Mesh>> m_meshes;
+        std::vector<std::shared_ptr<Mesh>> m_meshes;    // Indexed like the mesh directory, null for the meshes not resident
         std::vector<VkAccelerationStructureInstanceKHR> m_accelerationStructureInstances;
+        std::vector<SceneInstance> m_sceneInstances;
         std::vector<Material> m_materials;
 
         std::unique_ptr<Buffer> m_materialBuffer;
         std::unique_ptr<Buffer> m_meshInstanceBuffer;
         VkSampler m_defaultSampler{};
+        ThreadPool m_threadPool;
+
+        std::shared_ptr<KelpFile> m_file;               // Kept open for the whole session, the payloads are read as cells are streamed in, the imported ones keep it mapped
+        std::unique_ptr<AsyncFileReader> m_reader;
+        bool m_importPayloads = false;                  // Whether the device can import the pages of the file mapping
 
         void loadAssetsFromFile(const std::filesystem::path& filePath);
-        void loadAndUploadTextureCollection(const std::filesystem::path& filePath, std::ifstream& file, std::vector<Texture>& targetCollection, VkFormat textureFormat, int channelCount);
-        void loadMaterials(std::ifstream& file);
-        void loadOMMs(std::ifstream& file);
-        void loadMeshes(std::ifstream& file);
-        void loadMeshInstances(std::ifstream& file);
+        void loadTextureDirectory();
+        std::vector<Texture> loadTextures(const std::vector<uint32_t>& textureIndices, const std::vector<uint32_t>& firstMips);    // With the mips from firstMips[i] on
+        static uint32_t getMipTail(const KelpFormat::TextureEntry& entry);     // First mip of the tail, 0 if the whole texture is small enough
+        void createPlaceholderTexture();
+        void createTextureFeedbackBuffers();
+        void loadMaterials();
+        void loadOMMs();
+        void loadMeshDirectory();
+        std::vector<std::shared_ptr<Mesh>> loadMeshes(const std::vector<uint32_t>& meshIndices);
+        void loadMeshInstances();
+        void loadCells();
+        void uploadFileRanges(KelpFormat::SectionType section, const std::vector<FileRange>& ranges, const std::function<void(size_t, const UploadSource&)>& upload);
+        uint64_t uploadToBuffer(const Buffer& buffer, const void* data, VkDeviceSize size, VkDeviceSize offset, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask);    // Returns the ticket of the copy
+        static void verifyChecksum(KelpFormat::SectionType section, uint64_t offset, const void* data, uint64_t size, uint64_t checksum);
+        static void verifyFileRange(KelpFormat::SectionType section, const FileRange& range, const std::byte* data);
+        StagingUploader::Allocation decodeMeshPayload(const KelpFormat::MeshEntry& entry, const std::byte* payload);     // To release once its copy is queued
+        [[nodiscard]] std::unique_ptr<HostPointerBuffer> importMappedRange(uint64_t offset, uint64_t size) const;     // nullptr if the range has to be staged
+        std::vector<AccelerationStructure> buildBottomLevelAccelerationStructures(std::vector<BottomLevelBuild>& builds, const std::vector<MicromapBuild>& micromapBuilds);     // Compacted, in build order
+        static VkBuildAccelerationStructureFlagsKHR getBottomLevelBuildFlags(uint32_t triangleCount);
+        void cmdBuildTopLevelAccelerationStructure(VkCommandBuffer commandBuffer, const Buffer& instancesBuffer, uint32_t instanceCount) const;
         static void funcTime(const std::string& context, const std::function<void()>& func);
 
 
     private: // Raytracing preparation
         VkPhysicalDeviceRayTracingPipelinePropertiesKHR m_raytracingProperties{};
+        VkPhysicalDeviceAccelerationStructurePropertiesKHR m_accelerationStructureProperties{};
         VkPipelineLayout m_pipelineLayout{};
         VkPipeline m_raytracingPipeline{};
 
@@ -99,6 +199,97 @@ class Viewer {
         void transferOutputImageToSwapchain(VkCommandBuffer commandBuffer);
         void bindDescriptors(VkCommandBuffer commandBuffer);
         void updateWindowTitle(float deltaTime);
+        [[nodiscard]] std::pair<uint64_t, uint64_t> getVramUsage() const;
+        bool selectMeshLods();
+        void updateTopLevelAccelerationStructure(VkCommandBuffer commandBuffer);
+        void readTextureFeedback();
+
+        uint64_t m_selectedTriangleCount = 0;
+
+
+    private: // Streaming
+        enum class Residency : uint8_t {
+            Absent,
+            Resident,
+            Retiring,       // Evicted, until no frame in flight uses it anymore
+        };
+
+        enum class StreamingEventType : uint8_t {
+            StreamedIn,
+            Evicted,
+            MipsChanged,        // Resident textures reloaded with finer or coarser mips, of any cell
+        };
+
+        struct StreamingEvent {
+            uint32_t cell;                                                      // Unused by MipsChanged
+            StreamingEventType type;
+            std::vector<std::pair<uint32_t, std::shared_ptr<Mesh>>> meshes;     // Loaded for the cell, by directory index
+            std::vector<std::pair<uint32_t, Texture>> textures;
+            std::vector<uint32_t> releasedMeshes;                               // No longer used by any streamed cell
+            std::vector<uint32_t> releasedTextures;
+        };
+
+        struct RetiredResources {
+            uint64_t frame;                                                     // First frame whose TLAS doesn't reference them
+            std::vector<std::pair<uint32_t, std::shared_ptr<Mesh>>> meshes;
+            std::vector<std::pair<uint32_t, Texture>> textures;
+            std::vector<Texture> replacedTextures;                              // Replaced by the same textures with other mips, which stay resident
+        };
+
+        static constexpr uint32_t PLACEHOLDER_TEXTURE_SLOT = 0;
+
+        void startStreaming(const StreamingOptions& options);
+        void stopStreaming();
+        void streamCells();
+        bool streamNextCell(const glm::vec3& cameraPosition);
+        bool streamTextureMips(const std::vector<uint32_t>& textureFeedback);
+        void streamInCell(uint32_t cellIndex);
+        void evictCell(uint32_t cellIndex);
+        void writeMeshInstances(const KelpFormat::CellEntry& cell);
+        void pushStreamingEvent(StreamingEvent&& event);
+        void printMemoryReport() const;
+        bool updateResidency(VkCommandBuffer commandBuffer);
+        [[nodiscard]] std::span<const uint32_t> getCellMeshes(const KelpFormat::CellEntry& cell) const;
+        [[nodiscard]] std::span<const uint32_t> getCellTextures(const KelpFormat::CellEntry& cell) const;
+        static float getCellDistance(const KelpFormat::CellEntry& cell, const glm::vec3& position);
+        static uint64_t getMeshSize(const KelpFormat::MeshEntry& entry, const Mesh& mesh);
+        static uint64_t getTextureSize(const KelpFormat::TextureEntry& entry, uint32_t firstMip);
+
+        StreamingOptions m_streamingOptions;
+        std::vector<KelpFormat::CellEntry> m_cells;
+        std::vector<uint32_t> m_cellResources;
+
+        // Streaming thread state, the thread holds a reference to every mesh it streamed in until it evicts it
+        std::vector<bool> m_cellStreamed;
+        std::vector<uint32_t> m_meshReferences;         // Streamed cells using each mesh & texture
+        std::vector<uint32_t> m_textureReferences;
+        std::vector<Residency> m_meshResidency;
+        std::vector<Residency> m_textureResidency;
+        std::vector<std::shared_ptr<Mesh>> m_streamedMeshes;
+        std::vector<uint64_t> m_meshSizes;
+        std::vector<uint32_t> m_textureFirstMips;       // Finest resident mip of each resident texture
+        uint64_t m_streamedSize = 0;
+
+        // Shared between the threads
+        std::mutex m_streamingMutex;
+        std::condition_variable m_streamingCondition;
+        glm::vec3 m_streamingCameraPosition{};
+        bool m_stopStreaming = false;
+        std::deque<StreamingEvent> m_streamingEvents;
+        std::vector<uint32_t> m_retiredMeshIndices;     // Destroyed by the render thread, may be streamed in again
+        std::vector<uint32_t> m_retiredTextureIndices;
+        std::vector<uint32_t> m_freeTextureSlots;       // Descriptor slots no frame in flight uses, taken by the streaming thread
+        std::vector<uint32_t> m_textureFeedback;        // Of the last complete feedback window, empty once taken by the streaming thread
+        std::exception_ptr m_streamingException;        // Rethrown by the render thread
+        std::thread m_streamingThread;
+
+        // Render thread state
+        std::vector<uint32_t> m_residentCells;          // Whose instances are in the TLAS
+        std::deque<RetiredResources> m_retiredResources;
+        uint64_t m_frameNumber = 0;
+        uint32_t m_residentInstanceCount = 0;
+        std::vector<uint32_t> m_textureFeedbackWindow;  // Finest resolution sampled from each texture by the frames read back since the last window
+        uint32_t m_textureFeedbackFrames = 0;
 
 
     private:
@@ -106,12 +297,19 @@ class Viewer {
         const std::shared_ptr<Device> m_device = std::make_shared<Device>(m_window);
         Swapchain m_swapchain{m_device, m_window->getSize()};
         DescriptorManager m_descriptorManager{m_device};
+        StagingUploader m_stagingUploader{m_device, Config::STAGING_RING_SIZE};
+        const std::shared_ptr<GeometryBuffer> m_geometryBuffer = std::make_shared<GeometryBuffer>(m_device, Config::GEOMETRY_BUFFER_SIZE);  // Shared with the meshes, which free their range
 
         Camera m_camera{m_window};
 
         std::unique_ptr<Buffer> m_topLevelAccelerationStructureBuffer;
+        std::unique_ptr<Buffer> m_topLevelScratchBuffer;
         VkAccelerationStructureKHR m_topLevelAccelerationStructure{};
 
+        // Per frame in flight copies of the resident TLAS instances, rewritten when the selected LODs or the resident cells change
+        std::array<std::unique_ptr<Buffer>, Config::MAX_FRAMES_IN_FLIGHT> m_accelerationStructureInstanceBuffers;
+        std::array<void*, Config::MAX_FRAMES_IN_FLIGHT> m_mappedAccelerationStructureInstanceBuffers{};
+
         std::unique_ptr<Buffer> m_raygenShaderBindingTable;
         void *m_mappedRaygenShaderBindingTable{};
 
@@ -11,7 +11,7 @@
 
 class Buffer {
     public:
-        Buffer(const std::shared_ptr<Device>& device, size_t size, VkBufferUsageFlags bufferUsage, VmaAllocationCreateFlags allocationFlags = 0, VkDeviceSize alignment = 0);
+        Buffer(const std::shared_ptr<Device>& device, size_t size, VkBufferUsageFlags bufferUsage, VmaAllocationCreateFlags allocationFlags = 0, VkDeviceSize alignment = 0, VmaPool pool = VK_NULL_HANDLE);
         ~Buffer();
 
         Buffer(const Buffer&) = delete;
@@ -33,20 +33,54 @@ class Buffer {
         */
         void unmap() const noexcept;
 
+        /**
+        * @brief Make the host writes to the mapped memory visible to the device, needed if the memory isn't host coherent
+        *
+        * @param offset start of the written range
+        * @param size size of the written range, the whole buffer by default
+        */
+        void flush(VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE) const;
+
+        /**
+        * @brief Make the device writes to the mapped memory visible to the host, needed if the memory isn't host coherent
+        *
+        * @param offset start of the range to read
+        * @param size size of the range to read, the whole buffer by default
+        */
+        void invalidate(VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE) const;
+
         /**
         * @brief Copy data from a buffer to another
         *
         * @param commandBuffer command buffer to record the copy command
         * @param srcBuffer source buffer
         * @param size size of the data to copy
+        * @param srcOffset offset of the data in the source buffer
+        * @param dstOffset offset of the data in this buffer
+        */
+        void copyFrom(VkCommandBuffer commandBuffer, VkBuffer srcBuffer, VkDeviceSize size, VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0) const;
+
+        /**
+        * @brief Record the release or the acquire half of a queue family ownership transfer of a range of the buffer
+        *
+        * @param commandBuffer command buffer of the releasing queue, or of the acquiring one
+        * @param srcAccessMask accesses made available, 0 on the acquiring queue
+        * @param srcStageMask stages waited for, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT on the acquiring queue
+        * @param dstAccessMask accesses made visible, 0 on the releasing queue
+        * @param dstStageMask stages waiting, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT on the releasing queue
+        * @param srcQueueFamilyIndex family releasing the buffer, the same on both queues
+        * @param dstQueueFamilyIndex family acquiring the buffer, the same on both queues
+        * @param offset start of the range, the same on both queues
+        * @param size size of the range, the whole buffer by default
         */
-        void copyFrom(VkCommandBuffer commandBuffer, VkBuffer srcBuffer, VkDeviceSize size) const;
+        void cmdTransferOwnership(VkCommandBuffer commandBuffer, VkAccessFlags srcAccessMask, VkPipelineStageFlags srcStageMask, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask, uint32_t srcQueueFamilyIndex, uint32_t dstQueueFamilyIndex, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE) const;
 
 
         /* Getters */
         [[nodiscard]] VkBuffer          getHandle()         const noexcept { return m_buffer; };
         [[nodiscard]] VmaAllocation     getAllocation()     const noexcept { return m_allocation; };
         [[nodiscard]] VkDeviceAddress   getDeviceAddress()  const noexcept { return m_deviceAddress; };
+        [[nodiscard]] void*             getMappedData()     const noexcept { return m_mappedData; };   // Persistent mapping, only set with VMA_ALLOCATION_CREATE_MAPPED_BIT
 
 
     private:
@@ -59,4 +93,5 @@ class Buffer {
         VkDeviceAddress m_deviceAddress{};
         VmaAllocation m_allocation{};
         VkBuffer m_buffer{};
+        void* m_mappedData{};
 };
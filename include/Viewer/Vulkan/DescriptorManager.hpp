@@ -8,9 +8,12 @@
 
 #include <cstdint>
 #include <memory>
+#include <mutex>
 
 class DescriptorManager {
     public:
+        static constexpr uint32_t ARRAY_DESCRIPTOR_COUNT = 1000;    // Of the storage image & combined image sampler arrays
+
         DescriptorManager(const std::shared_ptr<Device>& device);
         ~DescriptorManager();
 
@@ -48,6 +51,16 @@ class DescriptorManager {
          */
         uint32_t storeSampledImage(VkImageView imageView, VkSampler sampler);
 
+        /**
+         * @brief Store an image view and a sampler in the array of combined image samplers of the descriptor set at index index.
+         * Thread safe like every store, the slot must not be used by a frame in flight.
+         *
+         * @param imageView image view to store
+         * @param sampler sampler to store
+         * @param index index of the image in the array
+         */
+        void storeSampledImage(VkImageView imageView, VkSampler sampler, uint32_t index);
+
         /**
          * @brief Store an acceleration structure in the descriptor set at binding ACCELERATION_STRUCTURE_BINDING
          *
@@ -74,4 +87,6 @@ class DescriptorManager {
 
         uint32_t m_storageImageCount = 0;
         uint32_t m_combinedImageSamplerCount = 0;
+
+        std::mutex m_mutex;     // Guards the descriptor set updates, textures are streamed in from another thread
 };
@@ -11,6 +11,8 @@
 #include <cstdint>
 #include <limits>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 class Device {
     public:
@@ -36,12 +38,14 @@ class Device {
         /**
         * @brief Waits for the device to finish executing all the commands.
         * Must be called before destroying the vulkan resources.
+        * Holds the queue mutex, submissions from other threads wait for it.
         */
         void waitIdle() const;
 
         /**
          * @brief Begins a single time command buffer for the given queue type.
-         * /!\ Only one single time command buffer per queue type can be active at a time.
+         * Only one single time command buffer can be recorded at a time: other threads calling this
+         * block until endSingleTimeCommands() is called, which must happen on the same thread.
          *
          * @param queueType The queue type to use for the command buffer.
          * @return VkCommandBuffer The single time command buffer.
@@ -59,6 +63,15 @@ class Device {
         */
         [[nodiscard]] uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
 
+        /**
+        * @brief Checks if images of a format can be written from the host straight into the given layout, with vkCopyMemoryToImage.
+        *
+        * @param format The format of the optimally tiled image.
+        * @param dstLayout The layout the image is in while it is copied to.
+        * @return true if the format supports host image transfers and the layout is a host copy destination layout.
+        */
+        [[nodiscard]] bool supportsHostImageCopy(VkFormat format, VkImageLayout dstLayout) const;
+
 
         /* Getters */
         [[nodiscard]] VkInstance        getInstance()                   const noexcept { return m_instance; };
@@ -67,14 +80,17 @@ class Device {
         [[nodiscard]] VkSurfaceKHR      getSurface()                    const noexcept { return m_windowSurface; };
         [[nodiscard]] VkDescriptorPool  getDescriptorPool()             const noexcept { return m_descriptorPool; };
         [[nodiscard]] VmaAllocator      getAllocator()                  const noexcept { return m_allocator; };
+        [[nodiscard]] VmaPool           getAccelerationStructurePool()  const noexcept { return m_accelerationStructurePool; };    // For acceleration structure, micromap & scratch buffers
 
         [[nodiscard]] VkCommandPool     getCommandPool(QueueType queueType)         const noexcept { return m_queueDatas[queueType].commandPool; };
         [[nodiscard]] uint32_t          getQueueFamilyIndex(QueueType queueType)    const noexcept { return m_queueDatas[queueType].queueFamilyIndex; };
         [[nodiscard]] VkQueue           getQueue(QueueType queueType)               const noexcept { return m_queueDatas[queueType].queue; };
+        [[nodiscard]] std::mutex&       getQueueMutex()                             const noexcept { return m_queueMutex; };
 
         [[nodiscard]] const VkPhysicalDeviceMemoryProperties&   getMemoryProperties()           const noexcept { return m_memoryProperties; };
         [[nodiscard]] const VkPhysicalDeviceProperties&         getProperties()                 const noexcept { return m_properties; };
         [[nodiscard]] VkSampleCountFlagBits                     getMaxMsaaSamples()             const noexcept { return m_maxMsaaSamples; };
+        [[nodiscard]] VkDeviceSize                              getMinImportedHostPointerAlignment() const noexcept { return m_minImportedHostPointerAlignment; };   // 0 if VK_EXT_external_memory_host is not available
 
 
 
@@ -107,6 +123,7 @@ class Device {
         bool findQueueFamilies(VkPhysicalDevice device, QueueFamilyIndices& indices);
         static bool checkForRequiredFeatures(VkPhysicalDevice device);
         static bool checkForRequiredExtensions(VkPhysicalDevice device);
+        static bool isExtensionAvailable(VkPhysicalDevice device, const char* extensionName);
         bool checkForDeviceSuitability(VkPhysicalDevice device);
 
 
@@ -119,11 +136,16 @@ class Device {
         VkSurfaceKHR m_windowSurface{};
         VkDescriptorPool m_descriptorPool{};
         VmaAllocator m_allocator{};
+        VmaPool m_accelerationStructurePool{};
         VkFence m_singleTimeCommandsFence{};
+        mutable std::mutex m_singleTimeCommandsMutex;   // Held from beginSingleTimeCommands() to endSingleTimeCommands()
+        mutable std::mutex m_queueMutex;                // Guards every submission & present, the queues may be shared between queue types
 
         VkPhysicalDeviceMemoryProperties m_memoryProperties{};
         VkPhysicalDeviceProperties m_properties{};
         VkSampleCountFlagBits m_maxMsaaSamples = VK_SAMPLE_COUNT_1_BIT;
+        std::vector<VkImageLayout> m_hostImageCopyDstLayouts;
+        VkDeviceSize m_minImportedHostPointerAlignment = 0;
 
         std::array<QueueDatas, 3> m_queueDatas;
 };
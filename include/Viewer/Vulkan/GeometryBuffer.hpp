@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Buffer.hpp"
+#include "Device.hpp"
+
+#include "vk_mem_alloc.h"
+#include <vulkan/vulkan_core.h>
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Device local storage shared by the vertices and indices of every resident mesh, suballocated from a few large buffers.
+ * Each buffer is managed as a VMA virtual block, so ranges freed by evicted meshes are reused by the next ones. A buffer is added
+ * when none has room, sized for the allocation if it is larger than the default, and destroyed once empty unless it is the last one.
+ * Allocations and frees may come from any thread.
+ */
+class GeometryBuffer {
+    public:
+        struct Allocation {
+            const Buffer* buffer;                       // Holding the range at offset, to copy to
+            VkDeviceSize offset;
+            VkDeviceAddress deviceAddress;              // Of the range
+            VmaVirtualAllocation virtualAllocation;
+        };
+
+        GeometryBuffer(const std::shared_ptr<Device>& device, VkDeviceSize blockSize);
+        ~GeometryBuffer();
+
+        GeometryBuffer(const GeometryBuffer&) = delete;
+        GeometryBuffer& operator=(const GeometryBuffer&) = delete;
+
+        GeometryBuffer(GeometryBuffer&&) noexcept = delete;
+        GeometryBuffer& operator=(GeometryBuffer&&) = delete;
+
+
+        /**
+         * @brief Suballocate a range, aligned for vertices and indices alike.
+         */
+        [[nodiscard]] Allocation allocate(VkDeviceSize size);
+
+        /**
+         * @brief Free a range, which must no longer be used by the GPU.
+         */
+        void free(const Allocation& allocation);
+
+
+        /* Getters */
+        [[nodiscard]] size_t getBufferCount() const;
+
+
+    private:
+        struct Block {
+            std::unique_ptr<Buffer> buffer;
+            VmaVirtualBlock virtualBlock;
+        };
+
+        static constexpr VkDeviceSize ALLOCATION_ALIGNMENT = 16;
+
+        std::shared_ptr<Device> m_device;
+        VkDeviceSize m_blockSize;
+
+        std::vector<Block> m_blocks;
+        mutable std::mutex m_mutex;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Device.hpp"
+
+#include <vulkan/vulkan_core.h>
+
+#include <memory>
+
+/**
+ * @brief Transfer source buffer over host memory imported with VK_EXT_external_memory_host, read by the GPU in place.
+ * The memory is only read, e.g. pages of a read-only file mapping, and is kept alive by its owner until the buffer is destroyed.
+ */
+class HostPointerBuffer {
+    public:
+        ~HostPointerBuffer();
+
+        HostPointerBuffer(const HostPointerBuffer&) = delete;
+        HostPointerBuffer& operator=(const HostPointerBuffer&) = delete;
+
+        HostPointerBuffer(HostPointerBuffer&&) = delete;
+        HostPointerBuffer& operator=(HostPointerBuffer&&) = delete;
+
+
+        /**
+         * @brief Import host memory as a buffer, if the device allows it for this memory.
+         *
+         * @param memoryOwner Kept until the buffer is destroyed, the imported memory must stay valid as long as it is.
+         * @param pointer Start of the memory, aligned to Device::getMinImportedHostPointerAlignment().
+         * @param size Bytes to import, a multiple of the same alignment.
+         * @return The buffer, or nullptr if the extension is missing, the memory is misaligned or the driver refuses it.
+         */
+        [[nodiscard]] static std::unique_ptr<HostPointerBuffer> tryImport(const std::shared_ptr<Device>& device, std::shared_ptr<const void> memoryOwner, const void* pointer, VkDeviceSize size);
+
+
+        /* Getters */
+        [[nodiscard]] VkBuffer getHandle() const noexcept { return m_buffer; };
+
+
+    private:
+        HostPointerBuffer(const std::shared_ptr<Device>& device, std::shared_ptr<const void> memoryOwner);
+
+
+    private:
+        std::shared_ptr<Device> m_device;
+        std::shared_ptr<const void> m_memoryOwner;
+
+        VkBuffer m_buffer{};
+        VkDeviceMemory m_memory{};
+};
@@ -45,10 +45,15 @@ class Image {
         Image& operator=(Image&& other) noexcept;
 
         void cmdTransitionLayout(VkCommandBuffer commandBuffer, const Layout& oldLayout, const Layout& newLayout, uint32_t baseMipLevel = 0, uint32_t levelCount = VK_REMAINING_MIP_LEVELS);
-        void cmdCopyFromBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer, const VkExtent3D& extent, uint32_t mipLevel = 0);
+        void cmdTransferOwnership(VkCommandBuffer commandBuffer, const Layout& oldLayout, const Layout& newLayout, uint32_t srcQueueFamilyIndex, uint32_t dstQueueFamilyIndex);   // Release or acquire half, with the same layouts & families on both queues
+        void cmdCopyFromBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer, const VkExtent3D& extent, uint32_t mipLevel = 0, VkDeviceSize bufferOffset = 0);
         void cmdGenerateMipmaps(VkCommandBuffer commandBuffer, const Layout& finalLayout);
         void cmdCopyFromImage(VkCommandBuffer commandBuffer, const Image& srcImage);
 
+        // Host image copies, executed right away by the calling thread: the image must be created with VK_IMAGE_USAGE_HOST_TRANSFER_BIT
+        void transitionLayoutOnHost(VkImageLayout oldLayout, VkImageLayout newLayout);
+        void copyFromMemory(const void* data, const VkExtent3D& extent, uint32_t mipLevel, VkImageLayout layout);
+
         [[nodiscard]] VkImage getHandle() const { return m_image; }
         [[nodiscard]] VkImageView getImageView() const { return m_imageView; }
         [[nodiscard]] VmaAllocation getAllocation() const { return m_allocation; }
@@ -61,6 +66,7 @@ class Image {
         void createImage();
         void createImageView();
         void cleanup();
+        void cmdBarrier(VkCommandBuffer commandBuffer, const Layout& oldLayout, const Layout& newLayout, uint32_t baseMipLevel, uint32_t levelCount, uint32_t srcQueueFamilyIndex, uint32_t dstQueueFamilyIndex);
         [[nodiscard]] bool supportsLinearBlitting() const;
 
     private:
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "Buffer.hpp"
+#include "Device.hpp"
+#include "Image.hpp"
+
+#define VK_NO_PROTOTYPES
+#include "volk.h"
+#include <vulkan/vulkan_core.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Uploader of staged data to the GPU, without a blocking submission per upload.
+ *
+ * Staging memory is suballocated from a persistently mapped ring buffer. Any thread records its copies by pushing a
+ * function to a bounded lock-free queue, and a single submitter thread records every queued function into one command
+ * buffer per batch, submitted to the transfer queue so that uploads overlap rendering. When the transfer queue has its own
+ * family, what the copies wrote is released by the transfer queue and acquired by a second command buffer submitted to the
+ * graphics queue, which waits for the transfer through a semaphore. Requests are numbered in queue order and a batch signals
+ * the number of the last request it holds once acquired, so the ticket returned for a request is the value of the timeline
+ * semaphore at which its resources are usable on the graphics queue. Batches grow on their own while the GPU is busy with the previous ones.
+ */
+class StagingUploader {
+    public:
+        struct Allocation {
+            std::byte* data;                            // Mapped and cached: can be read back, e.g. to verify checksums
+            VkBuffer buffer;
+            VkDeviceSize offset;                        // Of data in buffer, to copy from
+            VkDeviceSize size;
+            uint64_t ringEnd;                           // Ring position right after the allocation, identifies it on release
+            std::shared_ptr<Buffer> dedicatedBuffer;    // Only set for the allocations too large for the ring
+        };
+
+        struct Commands {
+            VkCommandBuffer transfer;           // Copies, then the release of what they wrote, on the transfer queue
+            VkCommandBuffer acquire;            // Acquire of what the copies wrote on the graphics queue, VK_NULL_HANDLE without ownership transfer
+            uint32_t srcQueueFamilyIndex;       // Of the ownership transfer barriers, VK_QUEUE_FAMILY_IGNORED without ownership transfer
+            uint32_t dstQueueFamilyIndex;
+        };
+
+        StagingUploader(const std::shared_ptr<Device>& device, VkDeviceSize ringSize);
+        ~StagingUploader();
+
+        StagingUploader(const StagingUploader&) = delete;
+        StagingUploader& operator=(const StagingUploader&) = delete;
+
+        StagingUploader(StagingUploader&&) noexcept = delete;
+        StagingUploader& operator=(StagingUploader&&) = delete;
+
+
+        /**
+         * @brief Suballocate staging memory, blocking until the released allocations in the way are no longer read by the GPU.
+         * Allocations larger than half the ring get a buffer of their own. A thread must not hold unreleased allocations of
+         * more than half the ring in total when it allocates, or it could wait for itself.
+         *
+         * @param size Bytes to allocate, the offset is aligned for any buffer to buffer or buffer to image copy.
+         * @return The allocation, to release once the copies reading it are queued.
+         */
+        [[nodiscard]] Allocation allocate(VkDeviceSize size);
+
+        /**
+         * @brief Release an allocation, its memory is reused once the request with the given ticket is complete.
+         */
+        void release(Allocation&& allocation, uint64_t ticket);
+
+        /**
+         * @brief Keep a resource read by queued copies, e.g. a source buffer that isn't staging memory, until the request with the given ticket is complete.
+         */
+        void retain(std::shared_ptr<const void> resource, uint64_t ticket);
+
+        /**
+         * @brief Queue copies, recorded later by the submitter thread, without blocking unless the queue is full.
+         * The function and what it captures are kept until the copies are complete, the resources it copies to
+         * must stay alive until then. The copies are visible to anything submitted to the graphics queue once the ticket is reached.
+         *
+         * @param record Records the copies and the release of what they wrote into the transfer command buffer of a batch,
+         * and the matching acquire into its acquire command buffer if there is one, from the submitter thread.
+         * @return The ticket of the request, to wait for.
+         */
+        uint64_t enqueue(std::function<void(const Commands&)>&& record);
+
+        /**
+         * @brief Make what the copies of a request wrote usable on the graphics queue, from its record: a barrier without ownership
+         * transfer, the release and acquire halves of one otherwise. The image must be in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, only
+         * the given range of the buffer is handed over.
+         */
+        static void cmdHandOver(const Commands& commands, Image& image, const Image::Layout& newLayout);
+        static void cmdHandOver(const Commands& commands, const Buffer& buffer, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+        /**
+         * @brief Block until the request with the given ticket and all the ones queued before it are complete.
+         * @throws std::runtime_error if a batch failed to be recorded or submitted.
+         */
+        void wait(uint64_t ticket) const;
+
+
+        /* Getters */
+        [[nodiscard]] VkSemaphore   getTimelineSemaphore()  const noexcept { return m_timelineSemaphore; };
+        [[nodiscard]] uint64_t      getLastTicket()         const noexcept { return m_enqueuePosition.load(std::memory_order_acquire); };   // Of the last request queued by any thread
+
+
+    private:
+        struct Slot {
+            std::atomic<uint64_t> sequence;             // Position + 1 once published, position + capacity once recorded
+            std::function<void(const Commands&)> record;
+        };
+
+        struct Batch {
+            uint64_t lastTicket;                        // Signaled by the batch
+            Commands commands;
+            std::vector<std::function<void(const Commands&)>> records;
+        };
+
+        struct RingEntry {
+            uint64_t end;
+            uint64_t ticket;                            // Reusable once complete, only set once released
+            bool released;
+        };
+
+        static constexpr size_t QUEUE_CAPACITY = 4096;                  // Power of two
+        static constexpr size_t MAX_BATCHES_IN_FLIGHT = 2;
+        static constexpr VkDeviceSize ALLOCATION_ALIGNMENT = 256;       // Multiple of every texel block size & of optimalBufferCopyOffsetAlignment in practice
+
+        void submitLoop();
+        void submitBatch();
+        void retireBatches(bool waitForOldest);
+        void reclaimRing();                                             // With m_ringMutex held
+        [[nodiscard]] uint64_t getCompletedTicket() const;
+        void rethrowSubmitterException() const;
+
+
+    private:
+        std::shared_ptr<Device> m_device;
+
+        VkSemaphore m_timelineSemaphore{};
+        VkSemaphore m_transferSemaphore{};                              // Signaled by the transfer queue for the acquire, only with ownership transfers
+        bool m_ownershipTransfer;                                       // If the transfer queue family isn't the graphics one
+
+        // Ring, positions grow forever and wrap around the buffer
+        std::unique_ptr<Buffer> m_ringBuffer;
+        VkDeviceSize m_ringSize;
+        uint64_t m_ringHead = 0;
+        uint64_t m_ringTail = 0;
+        std::deque<RingEntry> m_ringEntries;                            // Live allocations, in ring order
+        std::deque<std::pair<uint64_t, std::shared_ptr<const void>>> m_retainedResources;    // Released dedicated buffers & retained resources, by ticket
+        std::mutex m_ringMutex;
+        std::condition_variable m_ringCondition;
+
+        // Queue, written by any thread and read by the submitter only
+        std::unique_ptr<Slot[]> m_slots;
+        std::atomic<uint64_t> m_enqueuePosition = 0;
+        std::atomic<uint32_t> m_wakeups = 0;                            // Bumped once a request is published, the submitter sleeps on it
+        std::atomic<bool> m_stop = false;
+
+        // Submitter thread state
+        uint64_t m_dequeuePosition = 0;
+        VkCommandPool m_transferCommandPool{};
+        VkCommandPool m_acquireCommandPool{};
+        std::vector<Commands> m_freeCommands;
+        std::deque<Batch> m_batches;
+
+        mutable std::mutex m_exceptionMutex;
+        std::exception_ptr m_submitterException;
+        std::thread m_submitterThread;
+};
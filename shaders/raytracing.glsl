@@ -51,6 +51,20 @@ vec3 computeBarycentrics(Vertex vertices[3], vec3 rayOrigin, vec3 rayDir) {
     return vec3(1.0 - alpha - beta, alpha, beta);
 }
 
+// Record the resolution the footprint of a sample needs, as log2 of its texels per UV unit plus one so that 0 means unsampled.
+// Anisotropic filtering reads the mip of the minor axis, up to the anisotropy of the sampler
+const float MAX_SAMPLER_ANISOTROPY = 16.0;
+void recordTextureFeedback(int textureIndex, vec2 texGradX, vec2 texGradY) {
+    const float lengthX = length(texGradX);
+    const float lengthY = length(texGradY);
+    const float footprint = max(max(lengthX, lengthY) / MAX_SAMPLER_ANISOTROPY, min(lengthX, lengthY));
+    const uint resolution = uint(clamp(ceil(-log2(footprint)), 0.0, 30.0)) + 1;
+
+    // Most samples ask for what is already recorded, only the finer ones pay for an atomic
+    if (pc.data.textureFeedbackBuffer.resolutions[textureIndex] < resolution)
+        atomicMax(pc.data.textureFeedbackBuffer.resolutions[textureIndex], resolution);
+}
+
 
 #ifdef RAYGEN_SHADER
     layout(location = 0) rayPayloadEXT Payload payload;
@@ -105,7 +119,8 @@ vec3 computeBarycentrics(Vertex vertices[3], vec3 rayOrigin, vec3 rayDir) {
         if (material.alphaTexture == -1)
             return;
 
-        const float alpha = textureGrad(textures[material.alphaTexture], texCoords, texGradX, texGradY).r;
+        recordTextureFeedback(material.alphaTexture, texGradX, texGradY);
+        const float alpha = textureGrad(textures[nonuniformEXT(pc.data.textureSlotBuffer.slots[material.alphaTexture])], texCoords, texGradX, texGradY).r;
         if (alpha < material.alphaCutoff)
             ignoreIntersectionEXT;
     }
@@ -146,7 +161,8 @@ vec3 computeBarycentrics(Vertex vertices[3], vec3 rayOrigin, vec3 rayDir) {
             return;
         }
 
-        payload.hitValue = textureGrad(textures[textureIndex], texCoords, texGradX, texGradY).rgb;
+        recordTextureFeedback(textureIndex, texGradX, texGradY);
+        payload.hitValue = textureGrad(textures[nonuniformEXT(pc.data.textureSlotBuffer.slots[textureIndex])], texCoords, texGradX, texGradY).rgb;
     }
 #endif // CLOSEST_HIT_SHADER
 
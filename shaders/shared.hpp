@@ -58,6 +58,8 @@ struct MeshInstance {
 #ifndef __cplusplus
     layout(buffer_reference, scalar) buffer Materials { Material materials[]; };
     layout(buffer_reference, scalar) buffer MeshInstances { MeshInstance meshInstances[]; };
+    layout(buffer_reference, scalar) buffer TextureSlots { uint slots[]; };
+    layout(buffer_reference, scalar) buffer TextureFeedback { uint resolutions[]; };
 #endif
 
 struct PushConstant {
@@ -66,8 +68,12 @@ struct PushConstant {
     #ifdef __cplusplus
         VkDeviceAddress meshInstanceBuffer;
         VkDeviceAddress materialsBuffer;
+        VkDeviceAddress textureSlotBuffer;     // Descriptor of each texture of the directory, the placeholder until it is resident
+        VkDeviceAddress textureFeedbackBuffer; // Finest resolution sampled from each texture of the directory by this frame, see recordTextureFeedback()
     #else
         MeshInstances meshInstanceBuffer;
         Materials materialBuffer;
+        TextureSlots textureSlotBuffer;
+        TextureFeedback textureFeedbackBuffer;
     #endif
 };
@@ -0,0 +1,397 @@
+#include "Common/AsyncFileReader.hpp"
+
+#include "Common/KelpFile.hpp"
+#include "Common/KelpFormat.hpp"
+#include "Common/ThreadPool.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+    #define KELP_HAS_PREAD
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+    #define KELP_HAS_IO_URING
+    #include <cstdlib>
+    #include <linux/io_uring.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <sys/uio.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef KELP_HAS_IO_URING
+
+namespace {
+    // 64 reads of 1 MiB in flight, enough to keep the queues of a NVMe array busy
+    constexpr uint32_t QUEUE_DEPTH = 64;
+    constexpr size_t CHUNK_SIZE = 1 << 20;
+    constexpr size_t DIRECT_IO_ALIGNMENT = KelpFormat::SECTION_ALIGNMENT;
+
+    struct Chunk {
+        size_t request;
+        uint64_t offset;    // In the file
+        size_t size;
+        size_t dstOffset;   // In the destination of the request
+        bool direct;        // Read with O_DIRECT, set on submission
+        bool inPlace;       // Read straight into the destination rather than into a buffer, set on submission
+        bool bounce;        // Read into a buffer even if the destination qualifies, once an in-place O_DIRECT read was refused
+    };
+}   // namespace
+
+struct AsyncFileReader::IoUring {
+    int directFd = -1;
+    int bufferedFd = -1;
+    bool direct = false;
+    bool registeredBuffers = false;
+
+    int ringFd = -1;
+    void* sqRing = MAP_FAILED;
+    void* cqRing = MAP_FAILED;
+    size_t sqRingSize = 0;
+    size_t cqRingSize = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqesSize = 0;
+
+    uint32_t* sqTail = nullptr;
+    uint32_t sqMask = 0;
+    uint32_t* sqArray = nullptr;
+    uint32_t* cqHead = nullptr;
+    uint32_t* cqTail = nullptr;
+    uint32_t cqMask = 0;
+    io_uring_cqe* cqes = nullptr;
+
+    std::byte* buffers = nullptr;   // QUEUE_DEPTH buffers of CHUNK_SIZE bytes, one per read in flight
+
+
+    ~IoUring() {
+        if (sqes != MAP_FAILED)
+            munmap(sqes, sqesSize);
+        if (cqRing != MAP_FAILED && cqRing != sqRing)
+            munmap(cqRing, cqRingSize);
+        if (sqRing != MAP_FAILED)
+            munmap(sqRing, sqRingSize);
+        if (ringFd != -1)
+            close(ringFd);
+
+        std::free(buffers);
+
+        if (directFd != -1)
+            close(directFd);
+        if (bufferedFd != -1)
+            close(bufferedFd);
+    }
+
+    /**
+     * @brief Create the ring, the buffers and open the file.
+     *
+     * @return false if io_uring is unavailable, the reader then falls back to pread or the memory mapping.
+     */
+    bool init(const KelpFile& file) {
+        io_uring_params params{};
+        ringFd = static_cast<int>(syscall(__NR_io_uring_setup, QUEUE_DEPTH, &params));
+        if (ringFd < 0) {
+            ringFd = -1;
+            return false;
+        }
+
+
+        // Rings mapping
+        sqRingSize = params.sq_off.array + (params.sq_entries * sizeof(uint32_t));
+        cqRingSize = params.cq_off.cqes + (params.cq_entries * sizeof(io_uring_cqe));
+        if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0)
+            sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED)
+            return false;
+
+        cqRing = (params.features & IORING_FEAT_SINGLE_MMAP) != 0 ? sqRing : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED)
+            return false;
+
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED)
+            return false;
+
+        auto* sq = static_cast<std::byte*>(sqRing);
+        sqTail = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+        sqMask = *reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+
+        auto* cq = static_cast<std::byte*>(cqRing);
+        cqHead = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+        cqMask = *reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+
+        // Aligned buffers, registered so that the kernel doesn't have to pin them for every read
+        // Registration counts against RLIMIT_MEMLOCK on older kernels, plain reads are used if it fails
+        buffers = static_cast<std::byte*>(std::aligned_alloc(DIRECT_IO_ALIGNMENT, QUEUE_DEPTH * CHUNK_SIZE));
+        if (buffers == nullptr)
+            throw std::runtime_error("Failed to allocate the read buffers");
+
+        std::vector<iovec> iovecs(QUEUE_DEPTH);
+        for (uint32_t i = 0; i < QUEUE_DEPTH; i++)
+            iovecs[i] = iovec{ .iov_base = buffers + (i * CHUNK_SIZE), .iov_len = CHUNK_SIZE };
+        registeredBuffers = syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_BUFFERS, iovecs.data(), QUEUE_DEPTH) == 0;
+
+
+        // O_DIRECT bypasses the page cache, it is refused by some filesystems (tmpfs, some FUSE ones)
+        directFd = open(file.getPath().c_str(), O_RDONLY | O_DIRECT | O_CLOEXEC);
+        direct = directFd != -1;
+        if (!direct && !openBuffered(file))
+            return false;
+
+        return true;
+    }
+
+    bool openBuffered(const KelpFile& file) {
+        direct = false;
+        if (bufferedFd == -1)
+            bufferedFd = open(file.getPath().c_str(), O_RDONLY | O_CLOEXEC);
+        return bufferedFd != -1;
+    }
+
+    void pushRead(Chunk& chunk, uint32_t slot, std::byte* dst) {
+        // Buffered reads land in the destination. O_DIRECT reads must start and end on a block boundary: they land in the destination
+        // when it is aligned too, otherwise in a buffer where the chunk is found at head bytes
+        chunk.direct = direct;
+        chunk.inPlace = !chunk.bounce && (!direct || (chunk.offset % DIRECT_IO_ALIGNMENT == 0 && chunk.size % DIRECT_IO_ALIGNMENT == 0 && reinterpret_cast<uintptr_t>(dst) % DIRECT_IO_ALIGNMENT == 0));
+        const uint64_t head = direct ? chunk.offset % DIRECT_IO_ALIGNMENT : 0;
+        const uint64_t readOffset = chunk.offset - head;
+        const uint64_t readSize = direct ? KelpFormat::alignUp(head + chunk.size, DIRECT_IO_ALIGNMENT) : chunk.size;
+
+        const uint32_t tail = *sqTail;
+        const uint32_t index = tail & sqMask;
+
+        io_uring_sqe& sqe = sqes[index];
+        std::memset(&sqe, 0, sizeof(io_uring_sqe));
+        sqe.opcode = registeredBuffers && !chunk.inPlace ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe.fd = direct ? directFd : bufferedFd;
+        sqe.addr = reinterpret_cast<uint64_t>(chunk.inPlace ? dst : buffers + (static_cast<size_t>(slot) * CHUNK_SIZE));
+        sqe.len = static_cast<uint32_t>(readSize);
+        sqe.off = readOffset;
+        sqe.buf_index = static_cast<uint16_t>(slot);
+        sqe.user_data = slot;
+
+        sqArray[index] = index;
+        std::atomic_ref<uint32_t>(*sqTail).store(tail + 1, std::memory_order_release);
+    }
+
+    void enter(uint32_t submitCount, uint32_t waitCount) const {
+        while (syscall(__NR_io_uring_enter, ringFd, submitCount, waitCount, IORING_ENTER_GETEVENTS, nullptr, 0) < 0) {
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                throw std::runtime_error(std::string("io_uring_enter failed: ") + std::strerror(errno));
+        }
+    }
+};
+
+#else
+
+struct AsyncFileReader::IoUring {};
+
+#endif
+
+AsyncFileReader::AsyncFileReader(const KelpFile& file, ThreadPool& threadPool) : m_file(file), m_threadPool(threadPool) {
+    #ifdef KELP_HAS_IO_URING
+        m_ioUring = std::make_unique<IoUring>();
+        if (!m_ioUring->init(file))
+            m_ioUring.reset();
+    #endif
+
+    #ifdef KELP_HAS_PREAD
+        if (!m_ioUring)
+            m_fd = open(file.getPath().c_str(), O_RDONLY | O_CLOEXEC);
+    #endif
+}
+
+AsyncFileReader::~AsyncFileReader() {
+    #ifdef KELP_HAS_PREAD
+        if (m_fd != -1)
+            close(m_fd);
+    #endif
+}
+
+const char* AsyncFileReader::getBackendName() const noexcept {
+    #ifdef KELP_HAS_IO_URING
+        if (m_ioUring)
+            return m_ioUring->direct ? "io_uring, O_DIRECT" : "io_uring, buffered";
+    #endif
+
+    return m_fd != -1 ? "pread" : "memory mapping";
+}
+
+void AsyncFileReader::read(const std::vector<Request>& requests) {
+    const auto timeStart = std::chrono::steady_clock::now();
+
+    if (!m_ioUring && m_fd != -1) {
+        readPositioned(requests);
+    } else if (!m_ioUring) {
+        readMapped(requests);
+    } else {
+        #ifdef KELP_HAS_IO_URING
+            IoUring& ring = *m_ioUring;
+
+
+            // Requests are split in chunks that each fit in one buffer, even once widened to the O_DIRECT alignment
+            std::deque<Chunk> pendingChunks;
+            std::vector<size_t> remainingSizes(requests.size());
+            for (size_t i = 0; i < requests.size(); i++) {
+                remainingSizes[i] = requests[i].size;
+                for (size_t dstOffset = 0; dstOffset < requests[i].size;) {
+                    const uint64_t offset = requests[i].offset + dstOffset;
+                    const size_t size = std::min<size_t>(requests[i].size - dstOffset, CHUNK_SIZE - (offset % DIRECT_IO_ALIGNMENT));
+                    pendingChunks.push_back(Chunk{ .request = i, .offset = offset, .size = size, .dstOffset = dstOffset, .direct = false, .inPlace = false, .bounce = false });
+                    dstOffset += size;
+                }
+            }
+
+            std::vector<Chunk> slotChunks(QUEUE_DEPTH);
+            std::vector<uint32_t> freeSlots(QUEUE_DEPTH);
+            for (uint32_t i = 0; i < QUEUE_DEPTH; i++)
+                freeSlots[i] = QUEUE_DEPTH - 1 - i;
+
+            std::exception_ptr firstException;
+            uint32_t inFlightCount = 0;
+
+            const auto completeChunk = [&](const Chunk& chunk, const std::byte* data) {
+                if (!chunk.inPlace) {
+                    std::memcpy(static_cast<std::byte*>(requests[chunk.request].dst) + chunk.dstOffset, data, chunk.size);
+                    m_bytesCopied += chunk.size;
+                }
+
+                remainingSizes[chunk.request] -= chunk.size;
+                if (remainingSizes[chunk.request] == 0 && requests[chunk.request].onComplete)
+                    requests[chunk.request].onComplete();
+            };
+
+
+            // Keep the queue full, then reap whatever completed, until every chunk landed or a failure was drained
+            while (inFlightCount > 0 || (!pendingChunks.empty() && !firstException)) {
+                uint32_t submitCount = 0;
+                while (!firstException && !pendingChunks.empty() && !freeSlots.empty()) {
+                    const uint32_t slot = freeSlots.back();
+                    freeSlots.pop_back();
+
+                    slotChunks[slot] = pendingChunks.front();
+                    pendingChunks.pop_front();
+
+                    ring.pushRead(slotChunks[slot], slot, static_cast<std::byte*>(requests[slotChunks[slot].request].dst) + slotChunks[slot].dstOffset);
+                    submitCount++;
+                }
+
+                inFlightCount += submitCount;
+                ring.enter(submitCount, 1);
+
+                uint32_t head = *ring.cqHead;
+                const uint32_t tail = std::atomic_ref<uint32_t>(*ring.cqTail).load(std::memory_order_acquire);
+                for (; head != tail; head++) {
+                    const io_uring_cqe& cqe = ring.cqes[head & ring.cqMask];
+                    const auto slot = static_cast<uint32_t>(cqe.user_data);
+                    const Chunk chunk = slotChunks[slot];
+                    const int result = cqe.res;
+
+                    freeSlots.push_back(slot);
+                    inFlightCount--;
+                    if (firstException)
+                        continue;
+
+                    try {
+                        // The destination of an in-place read may need a stricter alignment, it is read into a buffer instead. Some
+                        // filesystems accept O_DIRECT on open but not on read, go on with buffered reads
+                        if (result == -EINVAL && chunk.inPlace && chunk.direct) {
+                            pendingChunks.push_front(Chunk{ .request = chunk.request, .offset = chunk.offset, .size = chunk.size, .dstOffset = chunk.dstOffset, .direct = false, .inPlace = false, .bounce = true });
+                            continue;
+                        }
+                        if (result == -EINVAL && chunk.direct) {
+                            if (ring.direct && !ring.openBuffered(m_file))
+                                throw std::runtime_error("Failed to reopen \"" + m_file.getPath().string() + "\" without O_DIRECT");
+                            pendingChunks.push_front(chunk);
+                            continue;
+                        }
+
+                        if (result < 0)
+                            throw std::runtime_error("Failed to read \"" + m_file.getPath().string() + "\" at offset " + std::to_string(chunk.offset) + ": " + std::strerror(-result));
+
+                        const uint64_t alignmentHead = chunk.direct ? chunk.offset % DIRECT_IO_ALIGNMENT : 0;
+                        if (static_cast<uint64_t>(result) <= alignmentHead)
+                            throw std::runtime_error("Unexpected end of \"" + m_file.getPath().string() + "\" at offset " + std::to_string(chunk.offset));
+
+
+                        // Short reads are completed by reading the rest as a new chunk
+                        const size_t readSize = std::min<size_t>(chunk.size, static_cast<size_t>(result - alignmentHead));
+                        completeChunk(Chunk{ .request = chunk.request, .offset = chunk.offset, .size = readSize, .dstOffset = chunk.dstOffset, .direct = chunk.direct, .inPlace = chunk.inPlace, .bounce = chunk.bounce }, ring.buffers + (static_cast<size_t>(slot) * CHUNK_SIZE) + alignmentHead);
+
+                        if (readSize < chunk.size)
+                            pendingChunks.push_front(Chunk{ .request = chunk.request, .offset = chunk.offset + readSize, .size = chunk.size - readSize, .dstOffset = chunk.dstOffset + readSize, .direct = false, .inPlace = false, .bounce = chunk.bounce });
+                    } catch (...) {
+                        firstException = std::current_exception();
+                    }
+                }
+                std::atomic_ref<uint32_t>(*ring.cqHead).store(head, std::memory_order_release);
+            }
+
+            if (firstException)
+                std::rethrow_exception(firstException);
+        #endif
+    }
+
+    for (const Request& request : requests)
+        m_bytesRead += request.size;
+    m_readSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - timeStart).count();
+}
+
+void AsyncFileReader::readPositioned(const std::vector<Request>& requests) {
+    #ifdef KELP_HAS_PREAD
+        // Straight into the destinations, without page faults on the mapping nor a copy out of it
+        m_threadPool.parallelFor(requests.size(), [&](size_t i) {
+            const Request& request = requests[i];
+
+            for (size_t readSize = 0; readSize < request.size;) {
+                const ssize_t result = pread(m_fd, static_cast<std::byte*>(request.dst) + readSize, request.size - readSize, static_cast<off_t>(request.offset + readSize));
+                if (result < 0 && errno == EINTR)
+                    continue;
+                if (result < 0)
+                    throw std::runtime_error("Failed to read \"" + m_file.getPath().string() + "\" at offset " + std::to_string(request.offset + readSize) + ": " + std::strerror(errno));
+                if (result == 0)
+                    throw std::runtime_error("Unexpected end of \"" + m_file.getPath().string() + "\" at offset " + std::to_string(request.offset + readSize));
+                readSize += static_cast<size_t>(result);
+            }
+
+            if (request.onComplete)
+                request.onComplete();
+        });
+    #else
+        readMapped(requests);
+    #endif
+}
+
+void AsyncFileReader::readMapped(const std::vector<Request>& requests) {
+    m_threadPool.parallelFor(requests.size(), [&](size_t i) {
+        const Request& request = requests[i];
+
+        m_file.prefetch(request.offset, request.size);
+        std::memcpy(request.dst, m_file.view(request.offset, request.size).data(), request.size);
+        m_file.evict(request.offset, request.size);
+        m_bytesCopied += request.size;
+
+        if (request.onComplete)
+            request.onComplete();
+    });
+}
@@ -0,0 +1,451 @@
+#include "Common/BcDecoder.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace {
+    constexpr uint32_t BLOCK_DIMENSION = 4;
+    constexpr uint32_t BLOCK_TEXEL_COUNT = BLOCK_DIMENSION * BLOCK_DIMENSION;
+
+    struct Bc7Mode {
+        uint32_t subsetCount;
+        uint32_t partitionBits;
+        uint32_t rotationBits;
+        uint32_t indexSelectionBits;
+        uint32_t colorBits;
+        uint32_t alphaBits;
+        bool endpointPBits;         // One P-bit per endpoint
+        bool sharedPBits;           // One P-bit per subset
+        uint32_t indexBits;
+        uint32_t secondaryIndexBits;
+    };
+
+    constexpr std::array<Bc7Mode, 8> BC7_MODES = {{
+        { .subsetCount = 3, .partitionBits = 4, .rotationBits = 0, .indexSelectionBits = 0, .colorBits = 4, .alphaBits = 0, .endpointPBits = true,  .sharedPBits = false, .indexBits = 3, .secondaryIndexBits = 0 },
+        { .subsetCount = 2, .partitionBits = 6, .rotationBits = 0, .indexSelectionBits = 0, .colorBits = 6, .alphaBits = 0, .endpointPBits = false, .sharedPBits = true,  .indexBits = 3, .secondaryIndexBits = 0 },
+        { .subsetCount = 3, .partitionBits = 6, .rotationBits = 0, .indexSelectionBits = 0, .colorBits = 5, .alphaBits = 0, .endpointPBits = false, .sharedPBits = false, .indexBits = 2, .secondaryIndexBits = 0 },
+        { .subsetCount = 2, .partitionBits = 6, .rotationBits = 0, .indexSelectionBits = 0, .colorBits = 7, .alphaBits = 0, .endpointPBits = true,  .sharedPBits = false, .indexBits = 2, .secondaryIndexBits = 0 },
+        { .subsetCount = 1, .partitionBits = 0, .rotationBits = 2, .indexSelectionBits = 1, .colorBits = 5, .alphaBits = 6, .endpointPBits = false, .sharedPBits = false, .indexBits = 2, .secondaryIndexBits = 3 },
+        { .subsetCount = 1, .partitionBits = 0, .rotationBits = 2, .indexSelectionBits = 0, .colorBits = 7, .alphaBits = 8, .endpointPBits = false, .sharedPBits = false, .indexBits = 2, .secondaryIndexBits = 2 },
+        { .subsetCount = 1, .partitionBits = 0, .rotationBits = 0, .indexSelectionBits = 0, .colorBits = 7, .alphaBits = 7, .endpointPBits = true,  .sharedPBits = false, .indexBits = 4, .secondaryIndexBits = 0 },
+        { .subsetCount = 2, .partitionBits = 6, .rotationBits = 0, .indexSelectionBits = 0, .colorBits = 5, .alphaBits = 5, .endpointPBits = true,  .sharedPBits = false, .indexBits = 2, .secondaryIndexBits = 0 },
+    }};
+
+    // Subset of every texel for the 2 subset partitions, one bit per texel (set for the second subset)
+    constexpr std::array<uint16_t, 64> BC7_PARTITIONS_2 = {
+        0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+        0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+        0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+        0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+        0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+        0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+        0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+        0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22
+    };
+
+    // Subset of every texel for the 3 subset partitions
+    constexpr std::array<std::array<uint8_t, BLOCK_TEXEL_COUNT>, 64> BC7_PARTITIONS_3 = {{
+        { 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 1, 2, 2, 2, 2 },
+        { 0, 0, 0, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 2, 1 },
+        { 0, 0, 0, 0, 2, 0, 0, 1, 2, 2, 1, 1, 2, 2, 1, 1 },
+        { 0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 1, 0, 1, 1, 1 },
+        { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2 },
+        { 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 2, 2 },
+        { 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1 },
+        { 0, 0, 1, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1 },
+        { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2 },
+        { 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2 },
+        { 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2 },
+        { 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2 },
+        { 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2 },
+        { 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2 },
+        { 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2, 1, 2, 2, 2 },
+        { 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0, 2, 2, 2, 0 },
+        { 0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2 },
+        { 0, 1, 1, 1, 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0 },
+        { 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2 },
+        { 0, 0, 2, 2, 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1 },
+        { 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2, 0, 2, 2, 2 },
+        { 0, 0, 0, 1, 0, 0, 0, 1, 2, 2, 2, 1, 2, 2, 2, 1 },
+        { 0, 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2 },
+        { 0, 0, 0, 0, 1, 1, 0, 0, 2, 2, 1, 0, 2, 2, 1, 0 },
+        { 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1, 0, 0, 0, 0 },
+        { 0, 0, 1, 2, 0, 0, 1, 2, 1, 1, 2, 2, 2, 2, 2, 2 },
+        { 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1, 0, 1, 1, 0 },
+        { 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1 },
+        { 0, 0, 2, 2, 1, 1, 0, 2, 1, 1, 0, 2, 0, 0, 2, 2 },
+        { 0, 1, 1, 0, 0, 1, 1, 0, 2, 0, 0, 2, 2, 2, 2, 2 },
+        { 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1 },
+        { 0, 0, 0, 0, 2, 0, 0, 0, 2, 2, 1, 1, 2, 2, 2, 1 },
+        { 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 2, 2, 2 },
+        { 0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 2, 0, 0, 1, 1 },
+        { 0, 0, 1, 1, 0, 0, 1, 2, 0, 0, 2, 2, 0, 2, 2, 2 },
+        { 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0 },
+        { 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0 },
+        { 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0 },
+        { 0, 1, 2, 0, 2, 0, 1, 2, 1, 2, 0, 1, 0, 1, 2, 0 },
+        { 0, 0, 1, 1, 2, 2, 0, 0, 1, 1, 2, 2, 0, 0, 1, 1 },
+        { 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0, 1, 1 },
+        { 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2 },
+        { 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1 },
+        { 0, 0, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2, 1, 1, 2, 2 },
+        { 0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 1, 1 },
+        { 0, 2, 2, 0, 1, 2, 2, 1, 0, 2, 2, 0, 1, 2, 2, 1 },
+        { 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 0, 1, 0, 1 },
+        { 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1 },
+        { 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2 },
+        { 0, 2, 2, 2, 0, 1, 1, 1, 0, 2, 2, 2, 0, 1, 1, 1 },
+        { 0, 0, 0, 2, 1, 1, 1, 2, 0, 0, 0, 2, 1, 1, 1, 2 },
+        { 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2 },
+        { 0, 2, 2, 2, 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2 },
+        { 0, 0, 0, 2, 1, 1, 1, 2, 1, 1, 1, 2, 0, 0, 0, 2 },
+        { 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2 },
+        { 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2 },
+        { 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2, 2, 2, 2, 2 },
+        { 0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2 },
+        { 0, 0, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2 },
+        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2 },
+        { 0, 0, 0, 2, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 1 },
+        { 0, 2, 2, 2, 1, 2, 2, 2, 0, 2, 2, 2, 1, 2, 2, 2 },
+        { 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2 },
+        { 0, 1, 1, 1, 2, 0, 1, 1, 2, 2, 0, 1, 2, 2, 2, 0 }
+    }};
+
+    // Anchor texel of the second subset of the 2 subset partitions, the first subset's one is always texel 0
+    constexpr std::array<uint8_t, 64> BC7_ANCHORS_2 = {
+        15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+        15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+        15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6,
+        6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15
+    };
+
+    // Anchor texels of the second & third subsets of the 3 subset partitions
+    constexpr std::array<uint8_t, 64> BC7_ANCHORS_3_SECOND = {
+        3, 3, 15, 15, 8, 3, 15, 15, 8, 8, 6, 6, 6, 5, 3, 3,
+        3, 3, 8, 15, 3, 3, 6, 10, 5, 8, 8, 6, 8, 5, 15, 15,
+        8, 15, 3, 5, 6, 10, 8, 15, 15, 3, 15, 5, 15, 15, 15, 15,
+        3, 15, 5, 5, 5, 8, 5, 10, 5, 10, 8, 13, 15, 12, 3, 3
+    };
+
+    constexpr std::array<uint8_t, 64> BC7_ANCHORS_3_THIRD = {
+        15, 8, 8, 3, 15, 15, 3, 8, 15, 15, 15, 15, 15, 15, 15, 8,
+        15, 8, 15, 3, 15, 8, 15, 8, 3, 15, 6, 10, 15, 15, 10, 8,
+        15, 3, 15, 10, 10, 8, 9, 10, 6, 15, 8, 15, 3, 6, 6, 8,
+        15, 3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 3, 15, 15, 8
+    };
+
+    constexpr std::array<uint8_t, 4> BC7_WEIGHTS_2 = { 0, 21, 43, 64 };
+    constexpr std::array<uint8_t, 8> BC7_WEIGHTS_3 = { 0, 9, 18, 27, 37, 46, 55, 64 };
+    constexpr std::array<uint8_t, 16> BC7_WEIGHTS_4 = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    /**
+     * @brief Read count bits of a block, least significant first.
+     */
+    uint32_t readBits(const uint8_t* block, uint32_t& position, uint32_t count) {
+        uint32_t value = 0;
+        for (uint32_t i = 0; i < count; i++, position++)
+            value |= ((block[position / 8] >> (position % 8)) & 1U) << i;
+        return value;
+    }
+
+    /**
+     * @brief Expand a value of bits bits to 8 bits by replicating its most significant ones.
+     */
+    uint8_t expandBits(uint32_t value, uint32_t bits) {
+        value <<= 8 - bits;
+        return static_cast<uint8_t>(value | (value >> bits));
+    }
+
+    uint8_t interpolateBc7(uint8_t e0, uint8_t e1, uint32_t index, uint32_t indexBits) {
+        const uint32_t weight = indexBits == 2 ? BC7_WEIGHTS_2[index] : indexBits == 3 ? BC7_WEIGHTS_3[index] : BC7_WEIGHTS_4[index];
+        return static_cast<uint8_t>((((64 - weight) * e0) + (weight * e1) + 32) >> 6);
+    }
+
+    uint32_t getBc7Subset(const Bc7Mode& mode, uint32_t partition, uint32_t texel) {
+        if (mode.subsetCount == 2)
+            return (BC7_PARTITIONS_2[partition] >> texel) & 1U;
+        if (mode.subsetCount == 3)
+            return BC7_PARTITIONS_3[partition][texel];
+        return 0;
+    }
+
+    bool isBc7Anchor(const Bc7Mode& mode, uint32_t partition, uint32_t texel) {
+        if (texel == 0)
+            return true;
+        if (mode.subsetCount == 2)
+            return texel == BC7_ANCHORS_2[partition];
+        if (mode.subsetCount == 3)
+            return texel == BC7_ANCHORS_3_SECOND[partition] || texel == BC7_ANCHORS_3_THIRD[partition];
+        return false;
+    }
+}
+
+std::optional<BcDecoder::Format> BcDecoder::getFormat(uint32_t vkFormat) noexcept {
+    // VkFormat values of the UNORM & SNORM formats, sRGB ones are mapped to them when the textures are read
+    switch (vkFormat) {
+        case 131: return Format::Bc1Rgb;
+        case 133: return Format::Bc1Rgba;
+        case 135: return Format::Bc2;
+        case 137: return Format::Bc3;
+        case 139: return Format::Bc4Unorm;
+        case 140: return Format::Bc4Snorm;
+        case 141: return Format::Bc5Unorm;
+        case 142: return Format::Bc5Snorm;
+        case 145: return Format::Bc7;
+        default: return std::nullopt;
+    }
+}
+
+uint32_t BcDecoder::getBlockSize(Format format) noexcept {
+    switch (format) {
+        case Format::Bc1Rgb:
+        case Format::Bc1Rgba:
+        case Format::Bc4Unorm:
+        case Format::Bc4Snorm:
+            return 8;
+        default:
+            return 16;
+    }
+}
+
+void BcDecoder::decode(std::span<const uint8_t> src, std::span<uint8_t> dst, uint32_t width, uint32_t height, Format format) {
+    const uint32_t blockCountX = (width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+    const uint32_t blockCountY = (height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+    const uint32_t blockSize = getBlockSize(format);
+    if (src.size() != static_cast<size_t>(blockCountX) * blockCountY * blockSize)
+        throw std::runtime_error("Block compressed image of " + std::to_string(width) + "x" + std::to_string(height) + " has " + std::to_string(src.size()) + " bytes of blocks, " + std::to_string(static_cast<size_t>(blockCountX) * blockCountY * blockSize) + " expected");
+    if (dst.size() != static_cast<size_t>(width) * height * 4)
+        throw std::runtime_error("Block compressed image of " + std::to_string(width) + "x" + std::to_string(height) + " decoded to a buffer of " + std::to_string(dst.size()) + " bytes");
+
+    std::array<uint8_t, static_cast<size_t>(BLOCK_TEXEL_COUNT) * 4> texels{};
+    for (uint32_t blockY = 0; blockY < blockCountY; blockY++) {
+        for (uint32_t blockX = 0; blockX < blockCountX; blockX++) {
+            decodeBlock(src.data() + ((static_cast<size_t>(blockY) * blockCountX + blockX) * blockSize), texels.data(), format);
+
+            // Only the rows & columns inside the image are copied, the edge blocks may be partial
+            const uint32_t rowSize = std::min(BLOCK_DIMENSION, width - (blockX * BLOCK_DIMENSION)) * 4;
+            for (uint32_t y = 0; y < BLOCK_DIMENSION && (blockY * BLOCK_DIMENSION) + y < height; y++) {
+                const size_t dstOffset = ((static_cast<size_t>(blockY * BLOCK_DIMENSION + y) * width) + (blockX * BLOCK_DIMENSION)) * 4;
+                std::memcpy(dst.data() + dstOffset, texels.data() + (static_cast<size_t>(y) * BLOCK_DIMENSION * 4), rowSize);
+            }
+        }
+    }
+}
+
+void BcDecoder::decodeBlock(const uint8_t* block, uint8_t* texels, Format format) {
+    switch (format) {
+        case Format::Bc1Rgb:
+            decodeColorBlock(block, texels, true, false);
+            break;
+
+        case Format::Bc1Rgba:
+            decodeColorBlock(block, texels, true, true);
+            break;
+
+        case Format::Bc2:
+            decodeColorBlock(block + 8, texels, false, false);
+            decodeExplicitAlphaBlock(block, texels + 3);
+            break;
+
+        case Format::Bc3:
+            decodeColorBlock(block + 8, texels, false, false);
+            decodeAlphaBlock(block, texels + 3, false);
+            break;
+
+        case Format::Bc4Unorm:
+        case Format::Bc4Snorm:
+        case Format::Bc5Unorm:
+        case Format::Bc5Snorm: {
+            const bool isSigned = format == Format::Bc4Snorm || format == Format::Bc5Snorm;
+            const bool hasGreen = format == Format::Bc5Unorm || format == Format::Bc5Snorm;
+            for (uint32_t i = 0; i < BLOCK_TEXEL_COUNT; i++) {
+                texels[(i * 4) + 1] = 0;
+                texels[(i * 4) + 2] = 0;
+                texels[(i * 4) + 3] = UINT8_MAX;
+            }
+
+            decodeAlphaBlock(block, texels, isSigned);
+            if (hasGreen)
+                decodeAlphaBlock(block + 8, texels + 1, isSigned);
+            break;
+        }
+
+        case Format::Bc7:
+            decodeBc7Block(block, texels);
+            break;
+    }
+}
+
+void BcDecoder::decodeColorBlock(const uint8_t* block, uint8_t* texels, bool threeColorMode, bool transparentBlack) {
+    // Two RGB565 endpoints, then a 2-bit palette index per texel
+    const auto c0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+    const auto c1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+    const uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+
+    std::array<std::array<uint8_t, 4>, 4> palette{};
+    for (size_t i = 0; i < 2; i++) {
+        const uint16_t color = i == 0 ? c0 : c1;
+        palette[i] = { expandBits(color >> 11, 5), expandBits((color >> 5) & 0x3F, 6), expandBits(color & 0x1F, 5), UINT8_MAX };
+    }
+
+
+    // BC1 blocks whose first endpoint isn't the biggest hold 3 colors & a black one, BC2 & BC3 ones always hold 4 colors
+    const bool isThreeColorBlock = threeColorMode && c0 <= c1;
+    for (size_t channel = 0; channel < 3; channel++) {
+        const uint32_t e0 = palette[0][channel];
+        const uint32_t e1 = palette[1][channel];
+        if (isThreeColorBlock) {
+            palette[2][channel] = static_cast<uint8_t>((e0 + e1 + 1) / 2);
+            palette[3][channel] = 0;
+        } else {
+            palette[2][channel] = static_cast<uint8_t>(((2 * e0) + e1 + 1) / 3);
+            palette[3][channel] = static_cast<uint8_t>((e0 + (2 * e1) + 1) / 3);
+        }
+    }
+    palette[2][3] = UINT8_MAX;
+    palette[3][3] = isThreeColorBlock && transparentBlack ? 0 : UINT8_MAX;
+
+    for (uint32_t i = 0; i < BLOCK_TEXEL_COUNT; i++)
+        std::memcpy(texels + (i * 4), palette[(indices >> (i * 2)) & 3U].data(), 4);
+}
+
+void BcDecoder::decodeAlphaBlock(const uint8_t* block, uint8_t* texels, bool isSigned) {
+    // Two 8-bit endpoints, then a 3-bit palette index per texel. Signed endpoints are clamped to [-127, 127]
+    std::array<int32_t, 8> palette{};
+    const int32_t minValue = isSigned ? -127 : 0;
+    const int32_t maxValue = isSigned ? 127 : UINT8_MAX;
+    palette[0] = isSigned ? std::max<int32_t>(static_cast<int8_t>(block[0]), minValue) : block[0];
+    palette[1] = isSigned ? std::max<int32_t>(static_cast<int8_t>(block[1]), minValue) : block[1];
+
+    const auto interpolate = [&](int32_t i, int32_t count) {
+        const int32_t value = ((count - i) * palette[0]) + (i * palette[1]);
+        return (value + (value < 0 ? -(count / 2) : count / 2)) / count;    // Rounded to nearest, the division truncates toward zero
+    };
+
+    if (palette[0] > palette[1]) {
+        for (int32_t i = 1; i < 7; i++)
+            palette[i + 1] = interpolate(i, 7);
+    } else {
+        for (int32_t i = 1; i < 5; i++)
+            palette[i + 1] = interpolate(i, 5);
+        palette[6] = minValue;
+        palette[7] = maxValue;
+    }
+
+    uint64_t indices = 0;
+    for (size_t i = 0; i < 6; i++)
+        indices |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+
+    for (uint32_t i = 0; i < BLOCK_TEXEL_COUNT; i++) {
+        const int32_t value = palette[(indices >> (i * 3)) & 7U];
+        texels[i * 4] = static_cast<uint8_t>(isSigned ? (((value + 127) * UINT8_MAX) + 127) / 254 : value);
+    }
+}
+
+void BcDecoder::decodeExplicitAlphaBlock(const uint8_t* block, uint8_t* texels) {
+    // A 4-bit alpha per texel
+    for (uint32_t i = 0; i < BLOCK_TEXEL_COUNT; i++) {
+        const uint32_t value = (block[i / 2] >> ((i % 2) * 4)) & 0xFU;
+        texels[i * 4] = static_cast<uint8_t>(value * 17);
+    }
+}
+
+void BcDecoder::decodeBc7Block(const uint8_t* block, uint8_t* texels) {
+    // The mode is the number of zero bits before the first set one, reserved mode 8 blocks decode to transparent black
+    const auto modeIndex = static_cast<uint32_t>(std::countr_zero(block[0]));
+    if (modeIndex >= BC7_MODES.size()) {
+        std::memset(texels, 0, static_cast<size_t>(BLOCK_TEXEL_COUNT) * 4);
+        return;
+    }
+
+    const Bc7Mode& mode = BC7_MODES[modeIndex];
+    uint32_t position = modeIndex + 1;
+    const uint32_t partition = readBits(block, position, mode.partitionBits);
+    const uint32_t rotation = readBits(block, position, mode.rotationBits);
+    const uint32_t indexSelection = readBits(block, position, mode.indexSelectionBits);
+
+
+    // Endpoints, channel by channel then subset by subset, followed by their P-bits appended as an extra least significant bit
+    std::array<std::array<std::array<uint32_t, 4>, 2>, 3> endpoints{};
+    for (uint32_t channel = 0; channel < 4; channel++) {
+        const uint32_t bits = channel < 3 ? mode.colorBits : mode.alphaBits;
+        for (uint32_t subset = 0; subset < mode.subsetCount; subset++) {
+            for (uint32_t endpoint = 0; endpoint < 2; endpoint++)
+                endpoints[subset][endpoint][channel] = readBits(block, position, bits);
+        }
+    }
+
+    uint32_t colorBits = mode.colorBits;
+    uint32_t alphaBits = mode.alphaBits;
+    if (mode.endpointPBits || mode.sharedPBits) {
+        for (uint32_t subset = 0; subset < mode.subsetCount; subset++) {
+            uint32_t pBit = 0;
+            for (uint32_t endpoint = 0; endpoint < 2; endpoint++) {
+                if (mode.endpointPBits || endpoint == 0)
+                    pBit = readBits(block, position, 1);
+                for (uint32_t& value : endpoints[subset][endpoint])
+                    value = (value << 1) | pBit;
+            }
+        }
+
+        colorBits++;
+        if (alphaBits != 0)
+            alphaBits++;
+    }
+
+    std::array<std::array<std::array<uint8_t, 4>, 2>, 3> colors{};
+    for (uint32_t subset = 0; subset < mode.subsetCount; subset++) {
+        for (uint32_t endpoint = 0; endpoint < 2; endpoint++) {
+            for (uint32_t channel = 0; channel < 3; channel++)
+                colors[subset][endpoint][channel] = expandBits(endpoints[subset][endpoint][channel], colorBits);
+            colors[subset][endpoint][3] = alphaBits != 0 ? expandBits(endpoints[subset][endpoint][3], alphaBits) : UINT8_MAX;
+        }
+    }
+
+
+    // Indices, the anchor texels of the subsets have an implicit zero most significant bit. Modes 4 & 5 have a second set, for the alpha unless swapped by the index selection
+    std::array<uint32_t, BLOCK_TEXEL_COUNT> indices{};
+    for (uint32_t i = 0; i < BLOCK_TEXEL_COUNT; i++)
+        indices[i] = readBits(block, position, mode.indexBits - (isBc7Anchor(mode, partition, i) ? 1 : 0));
+
+    std::array<uint32_t, BLOCK_TEXEL_COUNT> secondaryIndices{};
+    if (mode.secondaryIndexBits != 0) {
+        for (uint32_t i = 0; i < BLOCK_TEXEL_COUNT; i++)
+            secondaryIndices[i] = readBits(block, position, mode.secondaryIndexBits - (i == 0 ? 1 : 0));
+    }
+
+    for (uint32_t i = 0; i < BLOCK_TEXEL_COUNT; i++) {
+        const auto& [e0, e1] = colors[getBc7Subset(mode, partition, i)];
+        uint8_t* texel = texels + (i * 4);
+
+        uint32_t colorIndex = indices[i];
+        uint32_t colorIndexBits = mode.indexBits;
+        uint32_t alphaIndex = indices[i];
+        uint32_t alphaIndexBits = mode.indexBits;
+        if (mode.secondaryIndexBits != 0) {
+            alphaIndex = secondaryIndices[i];
+            alphaIndexBits = mode.secondaryIndexBits;
+            if (indexSelection != 0) {
+                std::swap(colorIndex, alphaIndex);
+                std::swap(colorIndexBits, alphaIndexBits);
+            }
+        }
+
+        for (uint32_t channel = 0; channel < 3; channel++)
+            texel[channel] = interpolateBc7(e0[channel], e1[channel], colorIndex, colorIndexBits);
+        texel[3] = interpolateBc7(e0[3], e1[3], alphaIndex, alphaIndexBits);
+
+        // Rotation 1 to 3 swaps the alpha with the red, green or blue channel
+        if (rotation != 0)
+            std::swap(texel[3], texel[rotation - 1]);
+    }
+}
@@ -0,0 +1,324 @@
+#include "Common/KelpFile.hpp"
+#include "Common/KelpFormat.hpp"
+#include "Common/ThreadPool.hpp"
+#include "Common/Xxh64.hpp"
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <cerrno>
+    #include <cstring>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+    /**
+     * @brief Read a directory for verification, a corrupted one is reported instead of thrown.
+     */
+    template <typename T>
+    std::optional<std::vector<T>> tryReadSection(const KelpFile& file, KelpFormat::SectionType type, std::vector<std::string>& errors) {
+        try {
+            return file.readSection<T>(type);
+        } catch (const std::exception& e) {
+            errors.emplace_back(e.what());
+            return std::nullopt;
+        }
+    }
+}   // namespace
+
+KelpFile::KelpFile(const std::filesystem::path& path) : m_path(path) {
+    #ifdef _WIN32
+        m_handle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (m_handle == INVALID_HANDLE_VALUE) {
+            m_handle = nullptr;
+            throw std::runtime_error("Failed to open \"" + path.string() + "\": error " + std::to_string(GetLastError()));
+        }
+    #else
+        m_fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (m_fd == -1)
+            throw std::runtime_error("Failed to open \"" + path.string() + "\": " + std::strerror(errno));
+    #endif
+
+    try {
+        readTableOfContents();
+        mapFile();
+    } catch (...) {
+        closeFile();
+        throw;
+    }
+}
+
+KelpFile::~KelpFile() {
+    closeFile();
+}
+
+void KelpFile::closeFile() noexcept {
+    #ifdef _WIN32
+        if (m_mapping != nullptr)
+            UnmapViewOfFile(m_mapping);
+        if (m_mappingHandle != nullptr)
+            CloseHandle(m_mappingHandle);
+        m_mappingHandle = nullptr;
+
+        if (m_handle != nullptr)
+            CloseHandle(m_handle);
+        m_handle = nullptr;
+    #else
+        if (m_mapping != nullptr)
+            munmap(const_cast<std::byte*>(m_mapping), m_header.fileSize);
+
+        if (m_fd != -1)
+            close(m_fd);
+        m_fd = -1;
+    #endif
+
+    m_mapping = nullptr;
+}
+
+void KelpFile::readTableOfContents() {
+    // Header validation
+    read(0, &m_header, sizeof(KelpFormat::FileHeader));
+    if (m_header.magic != KelpFormat::MAGIC)
+        throw std::runtime_error("\"" + m_path.string() + "\" is not a .kelp file, or was written by an older converter: convert it again");
+    if (m_header.version != KelpFormat::VERSION)
+        throw std::runtime_error("Unsupported .kelp version " + std::to_string(m_header.version) + " (expected " + std::to_string(KelpFormat::VERSION) + "): convert the file again");
+
+    const uint64_t actualSize = std::filesystem::file_size(m_path);
+    if (m_header.fileSize != actualSize)
+        throw std::runtime_error("Truncated .kelp file: " + std::to_string(actualSize) + " bytes instead of " + std::to_string(m_header.fileSize));
+
+
+    // TOC validation, the table itself must be inside the file before it is read, then every section must be too and aligned as declared
+    if (m_header.sectionCount > KelpFormat::MAX_SECTION_COUNT)
+        throw std::runtime_error("Corrupted .kelp file: " + std::to_string(m_header.sectionCount) + " sections, at most " + std::to_string(KelpFormat::MAX_SECTION_COUNT) + " expected");
+
+    const uint64_t tocSize = static_cast<uint64_t>(m_header.sectionCount) * sizeof(KelpFormat::SectionEntry);
+    if (m_header.tocOffset > m_header.fileSize || tocSize > m_header.fileSize - m_header.tocOffset)
+        throw std::runtime_error("Corrupted .kelp file: the table of contents is out of the file bounds");
+
+    m_sections.resize(m_header.sectionCount);
+    read(m_header.tocOffset, m_sections.data(), m_sections.size() * sizeof(KelpFormat::SectionEntry));
+    if (Xxh64::hash(m_sections.data(), m_sections.size() * sizeof(KelpFormat::SectionEntry)) != m_header.tocChecksum)
+        throw std::runtime_error("Corrupted .kelp file: the table of contents doesn't match its checksum");
+
+    for (const KelpFormat::SectionEntry& section : m_sections) {
+        if (section.offset > m_header.fileSize || section.size > m_header.fileSize - section.offset)
+            throw std::runtime_error("Invalid .kelp section " + std::to_string(static_cast<uint32_t>(section.type)) + ": out of the file bounds");
+        if (section.alignment == 0 || section.offset % section.alignment != 0)
+            throw std::runtime_error("Invalid .kelp section " + std::to_string(static_cast<uint32_t>(section.type)) + ": misaligned");
+    }
+}
+
+void KelpFile::mapFile() {
+    #ifdef _WIN32
+        SYSTEM_INFO systemInfo{};
+        GetSystemInfo(&systemInfo);
+        m_pageSize = systemInfo.dwPageSize;
+
+        m_mappingHandle = CreateFileMappingW(m_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mappingHandle == nullptr)
+            throw std::runtime_error("Failed to map \"" + m_path.string() + "\": error " + std::to_string(GetLastError()));
+
+        m_mapping = static_cast<const std::byte*>(MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+        if (m_mapping == nullptr)
+            throw std::runtime_error("Failed to map \"" + m_path.string() + "\": error " + std::to_string(GetLastError()));
+    #else
+        m_pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+        void* mapping = mmap(nullptr, m_header.fileSize, PROT_READ, MAP_PRIVATE, m_fd, 0);
+        if (mapping == MAP_FAILED)
+            throw std::runtime_error("Failed to map \"" + m_path.string() + "\": " + std::strerror(errno));
+        m_mapping = static_cast<const std::byte*>(mapping);
+
+        // Payloads are mostly consumed in file order, so ask for aggressive readahead
+        madvise(mapping, m_header.fileSize, MADV_SEQUENTIAL);
+    #endif
+}
+
+void KelpFile::read(uint64_t offset, void* dst, size_t size) const {
+    auto* cursor = static_cast<std::byte*>(dst);
+    while (size > 0) {
+        #ifdef _WIN32
+            OVERLAPPED overlapped{};
+            overlapped.Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+            overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+            DWORD bytesRead = 0;
+            const DWORD chunkSize = static_cast<DWORD>(std::min<size_t>(size, 1U << 30));
+            if (ReadFile(m_handle, cursor, chunkSize, &bytesRead, &overlapped) == FALSE)
+                throw std::runtime_error("Failed to read \"" + m_path.string() + "\": error " + std::to_string(GetLastError()));
+        #else
+            const ssize_t bytesRead = pread(m_fd, cursor, size, static_cast<off_t>(offset));
+            if (bytesRead == -1) {
+                if (errno == EINTR)
+                    continue;
+                throw std::runtime_error("Failed to read \"" + m_path.string() + "\": " + std::strerror(errno));
+            }
+        #endif
+
+        if (bytesRead == 0)
+            throw std::runtime_error("Unexpected end of \"" + m_path.string() + "\" at offset " + std::to_string(offset));
+
+        cursor += bytesRead;
+        offset += static_cast<uint64_t>(bytesRead);
+        size -= static_cast<size_t>(bytesRead);
+    }
+}
+
+void KelpFile::verifyChecksum(const KelpFormat::SectionEntry& section, const void* data) const {
+    if (!KelpFormat::isPayloadSection(section.type) && Xxh64::hash(data, section.size) != section.checksum)
+        throw std::runtime_error("Corrupted .kelp file: the " + std::string(KelpFormat::getSectionName(section.type)) + " section doesn't match its checksum");
+}
+
+std::vector<std::string> KelpFile::verify(ThreadPool& threadPool) const {
+    struct Range {
+        std::string name;
+        uint64_t offset;
+        uint64_t size;
+        uint64_t checksum;
+    };
+
+    std::vector<std::string> errors;
+    std::vector<Range> ranges;
+
+
+    // Payloads, as stored: a compressed payload spans its chunks. Directories that are themselves corrupted were reported and are skipped
+    const auto chunks = tryReadSection<KelpFormat::ChunkEntry>(*this, KelpFormat::SectionType::ChunkDirectory, errors);
+    const auto addPayload = [&](KelpFormat::SectionType type, const std::string& name, uint64_t offset, uint64_t size, uint32_t firstChunk, uint64_t checksum) {
+        if ((getSection(type).flags & KelpFormat::SECTION_FLAG_COMPRESSED) == 0) {
+            ranges.push_back(Range{ .name = name, .offset = offset, .size = size, .checksum = checksum });
+            return;
+        }
+
+        const uint64_t chunkCount = KelpFormat::chunkCount(size);
+        if (!chunks || firstChunk + chunkCount > chunks->size()) {
+            errors.push_back(name + ": chunks out of the chunk directory");
+            return;
+        }
+
+        uint64_t storedSize = 0;
+        for (uint64_t i = 0; i < chunkCount; i++)
+            storedSize += (*chunks)[firstChunk + i].compressedSize;
+        ranges.push_back(Range{ .name = name, .offset = offset, .size = storedSize, .checksum = checksum });
+    };
+
+    // Uncompressed textures are checked mip by mip, the way the viewer reads them
+    if (const auto textures = tryReadSection<KelpFormat::TextureEntry>(*this, KelpFormat::SectionType::TextureDirectory, errors)) {
+        const bool compressedTextures = (getSection(KelpFormat::SectionType::TextureData).flags & KelpFormat::SECTION_FLAG_COMPRESSED) != 0;
+        for (size_t i = 0; i < textures->size(); i++) {
+            const KelpFormat::TextureEntry& entry = (*textures)[i];
+            const std::string name = "texture " + std::to_string(i);
+            if (compressedTextures) {
+                addPayload(KelpFormat::SectionType::TextureData, name, entry.offset, entry.size, entry.firstChunk, entry.checksum);
+                continue;
+            }
+
+            if (entry.mipCount > KelpFormat::MAX_MIP_COUNT) {
+                errors.push_back(name + ": " + std::to_string(entry.mipCount) + " mip levels, more than the " + std::to_string(KelpFormat::MAX_MIP_COUNT) + " supported");
+                continue;
+            }
+            for (uint32_t level = 0; level < entry.mipCount; level++)
+                ranges.push_back(Range{ .name = name + " mip " + std::to_string(level), .offset = entry.offset + KelpFormat::mipOffset(entry, level), .size = KelpFormat::mipSize(entry, level), .checksum = entry.mipChecksums[level] });
+        }
+    }
+
+    if (const auto meshes = tryReadSection<KelpFormat::MeshEntry>(*this, KelpFormat::SectionType::MeshDirectory, errors)) {
+        for (size_t i = 0; i < meshes->size(); i++) {
+            const KelpFormat::MeshEntry& entry = (*meshes)[i];
+            addPayload(KelpFormat::SectionType::MeshData, "mesh " + std::to_string(i), entry.offset, entry.size, entry.firstChunk, entry.checksum);
+        }
+    }
+
+
+    // Remaining metadata sections, then everything is hashed in file order straight from the mapping
+    for (const KelpFormat::SectionEntry& section : m_sections) {
+        const bool directory = section.type == KelpFormat::SectionType::TextureDirectory || section.type == KelpFormat::SectionType::MeshDirectory || section.type == KelpFormat::SectionType::ChunkDirectory;
+        if (!KelpFormat::isPayloadSection(section.type) && !directory)
+            ranges.push_back(Range{ .name = std::string(KelpFormat::getSectionName(section.type)) + " section", .offset = section.offset, .size = section.size, .checksum = section.checksum });
+    }
+    std::ranges::sort(ranges, {}, &Range::offset);
+
+    std::mutex errorMutex;
+    threadPool.parallelFor(ranges.size(), [&](size_t i) {
+        const Range& range = ranges[i];
+        if (range.offset > m_header.fileSize || range.size > m_header.fileSize - range.offset) {
+            const std::lock_guard<std::mutex> lock(errorMutex);
+            errors.push_back(range.name + ": out of the file bounds");
+            return;
+        }
+
+        if (Xxh64::hash(m_mapping + range.offset, range.size) != range.checksum) {
+            const std::lock_guard<std::mutex> lock(errorMutex);
+            errors.push_back(range.name + ": checksum mismatch, " + std::to_string(range.size) + " bytes at offset " + std::to_string(range.offset));
+        }
+    });
+
+    return errors;
+}
+
+const KelpFormat::SectionEntry& KelpFile::getSection(KelpFormat::SectionType type) const {
+    for (const KelpFormat::SectionEntry& section : m_sections) {
+        if (section.type == type)
+            return section;
+    }
+
+    throw std::runtime_error("Missing section " + std::to_string(static_cast<uint32_t>(type)) + " in \"" + m_path.string() + "\"");
+}
+
+std::span<const std::byte> KelpFile::view(uint64_t offset, size_t size) const {
+    if (offset > m_header.fileSize || size > m_header.fileSize - offset)
+        throw std::runtime_error("Out of bounds view of \"" + m_path.string() + "\": " + std::to_string(size) + " bytes at offset " + std::to_string(offset));
+
+    return { m_mapping + offset, size };
+}
+
+void KelpFile::prefetch(uint64_t offset, size_t size) const noexcept {
+    if (size == 0 || offset >= m_header.fileSize)
+        return;
+
+    // Widened to whole pages
+    const uint64_t begin = offset / m_pageSize * m_pageSize;
+    const uint64_t end = std::min<uint64_t>(offset + size, m_header.fileSize);
+
+    #ifdef _WIN32
+        WIN32_MEMORY_RANGE_ENTRY range{
+            .VirtualAddress = const_cast<std::byte*>(m_mapping + begin),
+            .NumberOfBytes = static_cast<SIZE_T>(end - begin),
+        };
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    #else
+        madvise(const_cast<std::byte*>(m_mapping + begin), end - begin, MADV_WILLNEED);
+    #endif
+}
+
+void KelpFile::evict(uint64_t offset, size_t size) const noexcept {
+    // Narrowed to whole pages, so that the neighbouring payloads are untouched
+    const uint64_t begin = (offset + m_pageSize - 1) / m_pageSize * m_pageSize;
+    const uint64_t end = std::min<uint64_t>(offset + size, m_header.fileSize) / m_pageSize * m_pageSize;
+    if (begin >= end)
+        return;
+
+    #ifdef _WIN32
+        // Unlocking pages that aren't locked removes them from the working set
+        VirtualUnlock(const_cast<std::byte*>(m_mapping + begin), static_cast<SIZE_T>(end - begin));
+    #else
+        madvise(const_cast<std::byte*>(m_mapping + begin), end - begin, MADV_DONTNEED);
+        posix_fadvise(m_fd, static_cast<off_t>(begin), static_cast<off_t>(end - begin), POSIX_FADV_DONTNEED);
+    #endif
+}
@@ -0,0 +1,270 @@
+#include "Common/Lz4.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+    constexpr size_t MIN_MATCH = 4;
+    constexpr size_t LAST_LITERALS = 5;         // The last bytes of a block are always literals
+    constexpr size_t MATCH_FIND_LIMIT = 12;     // No match can start in the last bytes of a block
+    constexpr size_t MAX_OFFSET = 65535;
+    constexpr uint32_t HASH_LOG = 14;
+    constexpr uint32_t SKIP_TRIGGER = 6;        // Search step grows every 2^SKIP_TRIGGER misses, so incompressible data is skipped quickly
+    constexpr size_t WILD_COPY_SIZE = 16;
+
+    uint32_t read32(const std::byte* src) noexcept {
+        uint32_t value = 0;
+        std::memcpy(&value, src, sizeof(uint32_t));
+        return value;
+    }
+
+    uint64_t read64(const std::byte* src) noexcept {
+        uint64_t value = 0;
+        std::memcpy(&value, src, sizeof(uint64_t));
+        return value;
+    }
+
+    /**
+     * @brief Number of leading bytes two 8-byte words read from memory have in common, diff being their xor.
+     */
+    size_t commonBytes(uint64_t diff) noexcept {
+        if constexpr (std::endian::native == std::endian::little)
+            return static_cast<size_t>(std::countr_zero(diff)) / 8;
+        else
+            return static_cast<size_t>(std::countl_zero(diff)) / 8;
+    }
+
+    uint32_t hash(uint32_t sequence) noexcept {
+        return (sequence * 2654435761U) >> (32 - HASH_LOG);
+    }
+
+    /**
+     * @brief Write a length overflowing its 4 bits of token as a run of 255 bytes, returns nullptr if it doesn't fit.
+     */
+    std::byte* writeLength(std::byte* dst, const std::byte* dstEnd, size_t length) noexcept {
+        for (; length >= 255; length -= 255) {
+            if (dst == dstEnd)
+                return nullptr;
+            *dst++ = std::byte{255};
+        }
+
+        if (dst == dstEnd)
+            return nullptr;
+        *dst++ = static_cast<std::byte>(length);
+        return dst;
+    }
+
+    /**
+     * @brief Write a sequence: token, literals, then the match offset and length if matchLength isn't 0.
+     */
+    std::byte* writeSequence(std::byte* dst, const std::byte* dstEnd, const std::byte* literals, size_t literalLength, size_t offset, size_t matchLength) noexcept {
+        if (dst == dstEnd)
+            return nullptr;
+
+        const size_t matchCode = matchLength == 0 ? 0 : matchLength - MIN_MATCH;
+        std::byte* token = dst++;
+        *token = static_cast<std::byte>((std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(matchCode, 15));
+
+        if (literalLength >= 15 && (dst = writeLength(dst, dstEnd, literalLength - 15)) == nullptr)
+            return nullptr;
+        if (static_cast<size_t>(dstEnd - dst) < literalLength)
+            return nullptr;
+        if (literalLength > 0)
+            std::memcpy(dst, literals, literalLength);
+        dst += literalLength;
+
+        if (matchLength == 0)
+            return dst;
+
+        if (dstEnd - dst < 2)
+            return nullptr;
+        *dst++ = static_cast<std::byte>(offset & 0xFF);
+        *dst++ = static_cast<std::byte>(offset >> 8);
+
+        if (matchCode >= 15 && (dst = writeLength(dst, dstEnd, matchCode - 15)) == nullptr)
+            return nullptr;
+        return dst;
+    }
+
+    /**
+     * @brief Read a length continued after its 4 bits of token.
+     */
+    size_t readLength(const std::byte*& src, const std::byte* srcEnd) {
+        size_t length = 0;
+        while (true) {
+            if (src == srcEnd)
+                throw std::runtime_error("Corrupted LZ4 block: truncated length");
+
+            const auto byte = static_cast<uint8_t>(*src++);
+            length += byte;
+            if (byte != 255)
+                return length;
+        }
+    }
+
+    /**
+     * @brief Copy by blocks of WILD_COPY_SIZE bytes, possibly writing up to WILD_COPY_SIZE - 1 bytes past dst + size.
+     */
+    void wildCopy(std::byte* dst, const std::byte* src, size_t size) noexcept {
+        const std::byte* end = dst + size;
+        do {
+            std::memcpy(dst, src, WILD_COPY_SIZE);
+            dst += WILD_COPY_SIZE;
+            src += WILD_COPY_SIZE;
+        } while (dst < end);
+    }
+}   // namespace
+
+size_t Lz4::compress(const std::byte* src, size_t srcSize, std::byte* dst, size_t dstCapacity) noexcept {
+    const std::byte* const srcEnd = src + srcSize;
+    const std::byte* const dstEnd = dst + dstCapacity;
+    std::byte* out = dst;
+
+    const std::byte* anchor = src;     // Start of the pending literals
+    if (srcSize > MATCH_FIND_LIMIT) {
+        std::array<uint32_t, size_t{1} << HASH_LOG> table{};
+        const std::byte* const matchLimit = srcEnd - LAST_LITERALS;
+        const std::byte* const searchLimit = srcEnd - MATCH_FIND_LIMIT;
+
+        const std::byte* ip = src + 1;
+        table[hash(read32(src))] = 0;
+
+        while (ip < searchLimit) {
+            // Match search, with a step growing while nothing is found
+            const std::byte* match = nullptr;
+            uint32_t misses = 1U << SKIP_TRIGGER;
+            while (ip < searchLimit) {
+                const uint32_t sequence = read32(ip);
+                uint32_t& slot = table[hash(sequence)];
+                const std::byte* candidate = src + slot;
+                slot = static_cast<uint32_t>(ip - src);
+
+                if (candidate < ip && static_cast<size_t>(ip - candidate) <= MAX_OFFSET && read32(candidate) == sequence) {
+                    match = candidate;
+                    break;
+                }
+                ip += misses++ >> SKIP_TRIGGER;
+            }
+            if (match == nullptr)
+                break;
+
+
+            // Extension backwards over the literals, then forwards
+            while (ip > anchor && match > src && ip[-1] == match[-1]) {
+                ip--;
+                match--;
+            }
+
+            const std::byte* matchEnd = ip + MIN_MATCH;
+            const std::byte* matchCursor = match + MIN_MATCH;
+            uint64_t diff = 0;
+            while (matchEnd + sizeof(uint64_t) <= matchLimit && (diff = read64(matchEnd) ^ read64(matchCursor)) == 0) {
+                matchEnd += sizeof(uint64_t);
+                matchCursor += sizeof(uint64_t);
+            }
+
+            if (diff != 0) {
+                matchEnd += commonBytes(diff);
+            } else {
+                while (matchEnd < matchLimit && *matchEnd == *matchCursor) {
+                    matchEnd++;
+                    matchCursor++;
+                }
+            }
+
+            out = writeSequence(out, dstEnd, anchor, static_cast<size_t>(ip - anchor), static_cast<size_t>(ip - match), static_cast<size_t>(matchEnd - ip));
+            if (out == nullptr)
+                return 0;
+
+            // Positions inside the match are only partially indexed, the next search starts right after it
+            if (matchEnd - 2 > src)
+                table[hash(read32(matchEnd - 2))] = static_cast<uint32_t>(matchEnd - 2 - src);
+            anchor = matchEnd;
+            ip = matchEnd;
+        }
+    }
+
+
+    // Last literals
+    out = writeSequence(out, dstEnd, anchor, static_cast<size_t>(srcEnd - anchor), 0, 0);
+    return out == nullptr ? 0 : static_cast<size_t>(out - dst);
+}
+
+void Lz4::decompress(const std::byte* src, size_t srcSize, std::byte* dst, size_t dstSize) {
+    const std::byte* ip = src;
+    const std::byte* const srcEnd = src + srcSize;
+    std::byte* op = dst;
+    std::byte* const dstEnd = dst + dstSize;
+
+    while (true) {
+        if (ip == srcEnd)
+            throw std::runtime_error("Corrupted LZ4 block: truncated sequence");
+        const auto token = static_cast<uint8_t>(*ip++);
+
+
+        // Literals, copied in wide blocks while far enough from both ends
+        size_t literalLength = token >> 4;
+        if (literalLength == 15)
+            literalLength += readLength(ip, srcEnd);
+        if (literalLength > static_cast<size_t>(srcEnd - ip) || literalLength > static_cast<size_t>(dstEnd - op))
+            throw std::runtime_error("Corrupted LZ4 block: literals out of bounds");
+
+        if (static_cast<size_t>(srcEnd - ip) >= literalLength + WILD_COPY_SIZE && static_cast<size_t>(dstEnd - op) >= literalLength + WILD_COPY_SIZE)
+            wildCopy(op, ip, literalLength);
+        else if (literalLength > 0)
+            std::memcpy(op, ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+
+        // The last sequence has no match
+        if (ip == srcEnd)
+            break;
+
+
+        // Match
+        if (srcEnd - ip < 2)
+            throw std::runtime_error("Corrupted LZ4 block: truncated match offset");
+        const size_t offset = static_cast<size_t>(static_cast<uint8_t>(ip[0])) | (static_cast<size_t>(static_cast<uint8_t>(ip[1])) << 8);
+        ip += 2;
+
+        size_t matchLength = token & 0xF;
+        if (matchLength == 15)
+            matchLength += readLength(ip, srcEnd);
+        matchLength += MIN_MATCH;
+
+        if (offset == 0 || offset > static_cast<size_t>(op - dst) || matchLength > static_cast<size_t>(dstEnd - op))
+            throw std::runtime_error("Corrupted LZ4 block: match out of bounds");
+
+        const std::byte* match = op - offset;
+        if (offset >= WILD_COPY_SIZE && static_cast<size_t>(dstEnd - op) >= matchLength + WILD_COPY_SIZE) {
+            wildCopy(op, match, matchLength);
+        } else if (static_cast<size_t>(dstEnd - op) >= matchLength + sizeof(uint64_t)) {
+            // Close match, copied 8 bytes at a time from a distance of at least 8 so each copy only reads bytes already written.
+            // A match closer than that repeats a pattern: once its first 8 bytes are written, any multiple of offset is a valid distance
+            size_t distance = offset;
+            size_t i = 0;
+            if (offset < sizeof(uint64_t)) {
+                for (; i < sizeof(uint64_t); i++)
+                    op[i] = match[i];
+                distance = offset * ((sizeof(uint64_t) + offset - 1) / offset);
+            }
+
+            for (; i < matchLength; i += sizeof(uint64_t))
+                std::memcpy(op + i, op + i - distance, sizeof(uint64_t));
+        } else {
+            // Overlapping match, repeating the last offset bytes
+            for (size_t i = 0; i < matchLength; i++)
+                op[i] = match[i];
+        }
+        op += matchLength;
+    }
+
+    if (op != dstEnd)
+        throw std::runtime_error("Corrupted LZ4 block: decompressed to " + std::to_string(op - dst) + " bytes instead of " + std::to_string(dstSize));
+}
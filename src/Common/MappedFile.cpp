@@ -0,0 +1,88 @@
+#include "Common/MappedFile.hpp"
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <cerrno>
+    #include <cstring>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include <cstddef>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+
+MappedFile::MappedFile(const std::filesystem::path& path) : m_path(path) {
+    // The file handles are closed right after mapping, the view keeps the file referenced until it is unmapped
+    #ifdef _WIN32
+        HANDLE handle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (handle == INVALID_HANDLE_VALUE)
+            throw std::runtime_error("Failed to open \"" + path.string() + "\": error " + std::to_string(GetLastError()));
+
+        LARGE_INTEGER size{};
+        if (GetFileSizeEx(handle, &size) == FALSE) {
+            const DWORD error = GetLastError();
+            CloseHandle(handle);
+            throw std::runtime_error("Failed to get the size of \"" + path.string() + "\": error " + std::to_string(error));
+        }
+
+        m_size = static_cast<size_t>(size.QuadPart);
+        if (m_size == 0) {
+            CloseHandle(handle);
+            return;
+        }
+
+        HANDLE mappingHandle = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mappingHandle != nullptr) {
+            m_mapping = static_cast<const std::byte*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+            CloseHandle(mappingHandle);
+        }
+
+        const DWORD error = GetLastError();
+        CloseHandle(handle);
+        if (m_mapping == nullptr)
+            throw std::runtime_error("Failed to map \"" + path.string() + "\": error " + std::to_string(error));
+    #else
+        const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1)
+            throw std::runtime_error("Failed to open \"" + path.string() + "\": " + std::strerror(errno));
+
+        struct stat fileStat{};
+        if (fstat(fd, &fileStat) == -1) {
+            const int error = errno;
+            close(fd);
+            throw std::runtime_error("Failed to get the size of \"" + path.string() + "\": " + std::strerror(error));
+        }
+
+        m_size = static_cast<size_t>(fileStat.st_size);
+        if (m_size == 0) {
+            close(fd);
+            return;
+        }
+
+        void* mapping = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        const int error = errno;
+        close(fd);
+        if (mapping == MAP_FAILED)
+            throw std::runtime_error("Failed to map \"" + path.string() + "\": " + std::strerror(error));
+
+        m_mapping = static_cast<const std::byte*>(mapping);
+    #endif
+}
+
+MappedFile::~MappedFile() {
+    if (m_mapping == nullptr)
+        return;
+
+    #ifdef _WIN32
+        UnmapViewOfFile(m_mapping);
+    #else
+        munmap(const_cast<std::byte*>(m_mapping), m_size);
+    #endif
+}
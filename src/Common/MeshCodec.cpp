@@ -0,0 +1,428 @@
+#include "Common/MeshCodec.hpp"
+
+#include "glm/common.hpp"
+#include "glm/geometric.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define KELP_SSE2
+#endif
+
+namespace {
+    struct StreamHeader {
+        uint32_t elementCount;
+        uint32_t blockCount;
+        uint32_t laneCount;
+        int32_t positionExponent;   // Vertex streams only, the position grid step is 2^positionExponent
+    };
+
+    constexpr uint32_t VERTEX_LANE_COUNT = 7;   // Position xyz, octahedral normal xy, UV xy
+    constexpr uint32_t INDEX_LANE_COUNT = 1;
+    constexpr size_t GROUP_SIZE = 16;
+    constexpr std::array<size_t, 4> GROUP_PAYLOAD_SIZES = { 0, 4, 8, 16 };  // For 0, 2, 4 and 8 bits per byte
+
+    // Large enough for a block rounded up to whole groups
+    constexpr size_t LANE_CAPACITY = (MeshCodec::BLOCK_SIZE + GROUP_SIZE - 1) / GROUP_SIZE * GROUP_SIZE;
+
+
+    uint32_t zigzag(uint32_t delta) noexcept {
+        return (delta << 1) ^ static_cast<uint32_t>(static_cast<int32_t>(delta) >> 31);
+    }
+
+    uint32_t unzigzag(uint32_t value) noexcept {
+        return (value >> 1) ^ (0U - (value & 1));
+    }
+
+    /**
+     * @brief Map a unit vector to 16-bit octahedral coordinates, a null vector maps to +Z.
+     */
+    std::array<int16_t, 2> encodeOctahedral(const glm::vec3& normal) noexcept {
+        const float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+        if (!(length > 0))
+            return { 0, 0 };
+
+        float x = normal.x / length;
+        float y = normal.y / length;
+        if (normal.z < 0) {
+            const float foldedX = (1 - std::abs(y)) * (x >= 0 ? 1.0F : -1.0F);
+            y = (1 - std::abs(x)) * (y >= 0 ? 1.0F : -1.0F);
+            x = foldedX;
+        }
+
+        return {
+            static_cast<int16_t>(std::lround(std::clamp(x, -1.0F, 1.0F) * 32767.0F)),
+            static_cast<int16_t>(std::lround(std::clamp(y, -1.0F, 1.0F) * 32767.0F)),
+        };
+    }
+
+    glm::vec3 decodeOctahedral(int16_t encodedX, int16_t encodedY) noexcept {
+        float x = static_cast<float>(encodedX) / 32767.0F;
+        float y = static_cast<float>(encodedY) / 32767.0F;
+        const float z = 1 - std::abs(x) - std::abs(y);
+        const float fold = std::max(-z, 0.0F);
+        x += x >= 0 ? -fold : fold;
+        y += y >= 0 ? -fold : fold;
+        return glm::normalize(glm::vec3(x, y, z));
+    }
+
+    /**
+     * @brief Exponent of the power of two position grid: POSITION_PRECISION_BITS over the extent of the mesh
+     * (or over its coordinates when it is flat on every axis), coarsened if needed so that every coordinate fits in 31 bits.
+     */
+    int32_t getPositionExponent(std::span<const Vertex> vertices) {
+        glm::vec3 boundsMin(std::numeric_limits<float>::max());
+        glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+        for (const Vertex& vertex : vertices) {
+            if (!std::isfinite(vertex.position.x) || !std::isfinite(vertex.position.y) || !std::isfinite(vertex.position.z))
+                throw std::runtime_error("Failed to encode mesh: non finite vertex position");
+
+            boundsMin = glm::min(boundsMin, vertex.position);
+            boundsMax = glm::max(boundsMax, vertex.position);
+        }
+        if (vertices.empty())
+            return 0;
+
+        const glm::vec3 extent = boundsMax - boundsMin;
+        const float maxExtent = std::max({ extent.x, extent.y, extent.z });
+        const float maxCoordinate = std::max({ std::abs(boundsMin.x), std::abs(boundsMin.y), std::abs(boundsMin.z), std::abs(boundsMax.x), std::abs(boundsMax.y), std::abs(boundsMax.z) });
+
+        const float reference = maxExtent > 0 ? maxExtent : maxCoordinate;
+        int32_t exponent = reference > 0 ? std::ilogb(reference) - MeshCodec::POSITION_PRECISION_BITS : 0;
+        while (maxCoordinate >= std::ldexp(1.0F, exponent + 30))
+            exponent++;
+        return exponent;
+    }
+
+
+    /**
+     * @brief Append a lane of values, plane by plane from the least significant byte.
+     * Each plane holds a 2-bit header per group (width code), then the packed groups:
+     * with 2 bits, byte k holds the values k, k + 4, k + 8 and k + 12; with 4 bits, byte k holds the values k and k + 8.
+     */
+    void encodeLane(const uint32_t* values, size_t count, std::vector<std::byte>& out) {
+        const size_t groupCount = (count + GROUP_SIZE - 1) / GROUP_SIZE;
+
+        for (uint32_t plane = 0; plane < 4; plane++) {
+            const size_t headerOffset = out.size();
+            out.resize(out.size() + ((groupCount + 3) / 4));
+
+            for (size_t group = 0; group < groupCount; group++) {
+                std::array<uint8_t, GROUP_SIZE> bytes{};
+                for (size_t i = 0; i < GROUP_SIZE && (group * GROUP_SIZE) + i < count; i++)
+                    bytes[i] = static_cast<uint8_t>(values[(group * GROUP_SIZE) + i] >> (plane * 8));
+
+                const uint8_t maxByte = *std::ranges::max_element(bytes);
+                const uint8_t code = maxByte == 0 ? 0 : maxByte < 4 ? 1 : maxByte < 16 ? 2 : 3;
+                out[headerOffset + (group / 4)] |= static_cast<std::byte>(code << ((group % 4) * 2));
+
+                if (code == 1) {
+                    for (size_t k = 0; k < 4; k++)
+                        out.push_back(static_cast<std::byte>(bytes[k] | (bytes[k + 4] << 2) | (bytes[k + 8] << 4) | (bytes[k + 12] << 6)));
+                } else if (code == 2) {
+                    for (size_t k = 0; k < 8; k++)
+                        out.push_back(static_cast<std::byte>(bytes[k] | (bytes[k + 8] << 4)));
+                } else if (code == 3) {
+                    for (const uint8_t byte : bytes)
+                        out.push_back(static_cast<std::byte>(byte));
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Unpack the 16 bytes of a group.
+     */
+    void decodeGroup(uint32_t code, const std::byte* src, uint8_t* dst) noexcept {
+        #ifdef KELP_SSE2
+            __m128i result;
+            if (code == 0) {
+                result = _mm_setzero_si128();
+            } else if (code == 1) {
+                uint32_t packed = 0;
+                std::memcpy(&packed, src, sizeof(uint32_t));
+                const __m128i bits = _mm_cvtsi32_si128(static_cast<int>(packed));
+                const __m128i low = _mm_unpacklo_epi32(bits, _mm_srli_epi32(bits, 2));
+                const __m128i high = _mm_unpacklo_epi32(_mm_srli_epi32(bits, 4), _mm_srli_epi32(bits, 6));
+                result = _mm_and_si128(_mm_unpacklo_epi64(low, high), _mm_set1_epi8(0x03));
+            } else if (code == 2) {
+                const __m128i bits = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src));
+                result = _mm_and_si128(_mm_unpacklo_epi64(bits, _mm_srli_epi64(bits, 4)), _mm_set1_epi8(0x0F));
+            } else {
+                result = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), result);
+        #else
+            for (size_t i = 0; i < GROUP_SIZE; i++) {
+                if (code == 0)
+                    dst[i] = 0;
+                else if (code == 1)
+                    dst[i] = (static_cast<uint8_t>(src[i % 4]) >> ((i / 4) * 2)) & 0x03;
+                else if (code == 2)
+                    dst[i] = (static_cast<uint8_t>(src[i % 8]) >> ((i / 8) * 4)) & 0x0F;
+                else
+                    dst[i] = static_cast<uint8_t>(src[i]);
+            }
+        #endif
+    }
+
+    /**
+     * @brief Decode a lane written by encodeLane(): unpack its planes, rebuild the deltas, unzigzag and prefix sum them.
+     *
+     * @param dst Destination, must hold count rounded up to GROUP_SIZE values.
+     * @return The end of the lane in src.
+     */
+    const std::byte* decodeLane(const std::byte* src, const std::byte* end, size_t count, uint32_t* dst) {
+        const size_t groupCount = (count + GROUP_SIZE - 1) / GROUP_SIZE;
+        thread_local std::array<std::vector<uint8_t>, 4> planes;
+
+        for (std::vector<uint8_t>& plane : planes) {
+            plane.resize(LANE_CAPACITY);
+
+            const std::byte* headers = src;
+            if (static_cast<size_t>(end - src) < (groupCount + 3) / 4)
+                throw std::runtime_error("Corrupted mesh stream: truncated lane header");
+            src += (groupCount + 3) / 4;
+
+            for (size_t group = 0; group < groupCount; group++) {
+                const uint32_t code = (static_cast<uint32_t>(headers[group / 4]) >> ((group % 4) * 2)) & 0x03;
+                if (static_cast<size_t>(end - src) < GROUP_PAYLOAD_SIZES[code])
+                    throw std::runtime_error("Corrupted mesh stream: truncated lane");
+
+                decodeGroup(code, src, plane.data() + (group * GROUP_SIZE));
+                src += GROUP_PAYLOAD_SIZES[code];
+            }
+        }
+
+
+        // Planes interleaved back into 32-bit deltas, then accumulated
+        size_t i = 0;
+        uint32_t previous = 0;
+
+        #ifdef KELP_SSE2
+            __m128i carry = _mm_setzero_si128();
+            const __m128i one = _mm_set1_epi32(1);
+            const auto accumulate = [&](__m128i deltas, uint32_t* out) {
+                __m128i values = _mm_xor_si128(_mm_srli_epi32(deltas, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(deltas, one)));
+                values = _mm_add_epi32(values, _mm_slli_si128(values, 4));
+                values = _mm_add_epi32(values, _mm_slli_si128(values, 8));
+                values = _mm_add_epi32(values, carry);
+                carry = _mm_shuffle_epi32(values, _MM_SHUFFLE(3, 3, 3, 3));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), values);
+            };
+
+            for (; i < groupCount * GROUP_SIZE; i += GROUP_SIZE) {
+                const __m128i plane0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[0].data() + i));
+                const __m128i plane1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[1].data() + i));
+                const __m128i plane2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[2].data() + i));
+                const __m128i plane3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[3].data() + i));
+
+                const __m128i low01 = _mm_unpacklo_epi8(plane0, plane1);
+                const __m128i high01 = _mm_unpackhi_epi8(plane0, plane1);
+                const __m128i low23 = _mm_unpacklo_epi8(plane2, plane3);
+                const __m128i high23 = _mm_unpackhi_epi8(plane2, plane3);
+
+                accumulate(_mm_unpacklo_epi16(low01, low23), dst + i);
+                accumulate(_mm_unpackhi_epi16(low01, low23), dst + i + 4);
+                accumulate(_mm_unpacklo_epi16(high01, high23), dst + i + 8);
+                accumulate(_mm_unpackhi_epi16(high01, high23), dst + i + 12);
+            }
+        #endif
+
+        for (; i < count; i++) {
+            const uint32_t delta = planes[0][i] | (planes[1][i] << 8) | (planes[2][i] << 16) | (static_cast<uint32_t>(planes[3][i]) << 24);
+            previous += unzigzag(delta);
+            dst[i] = previous;
+        }
+
+        return src;
+    }
+
+
+    /**
+     * @brief Write the header and block table of a stream, followed by its blocks.
+     */
+    std::vector<std::byte> writeStream(const StreamHeader& header, const std::vector<std::vector<std::byte>>& blocks) {
+        std::vector<std::byte> stream(sizeof(StreamHeader) + ((blocks.size() + 1) * sizeof(uint32_t)));
+        std::memcpy(stream.data(), &header, sizeof(StreamHeader));
+
+        uint32_t blockOffset = 0;
+        for (size_t i = 0; i <= blocks.size(); i++) {
+            std::memcpy(stream.data() + sizeof(StreamHeader) + (i * sizeof(uint32_t)), &blockOffset, sizeof(uint32_t));
+            if (i < blocks.size()) {
+                blockOffset += static_cast<uint32_t>(blocks[i].size());
+                stream.insert(stream.end(), blocks[i].begin(), blocks[i].end());
+            }
+        }
+
+        return stream;
+    }
+
+    StreamHeader readStreamHeader(std::span<const std::byte> stream) {
+        StreamHeader header{};
+        if (stream.size() < sizeof(StreamHeader))
+            throw std::runtime_error("Corrupted mesh stream: truncated header");
+
+        std::memcpy(&header, stream.data(), sizeof(StreamHeader));
+        return header;
+    }
+
+    /**
+     * @brief Locate a block of a stream validated by MeshCodec::getBlockCount().
+     */
+    std::span<const std::byte> getBlock(std::span<const std::byte> stream, size_t block, size_t& elementOffset, size_t& elementCount) {
+        const StreamHeader header = readStreamHeader(stream);
+        if (block >= header.blockCount)
+            throw std::runtime_error("Corrupted mesh stream: block index out of bounds");
+
+        std::array<uint32_t, 2> blockOffsets{};
+        std::memcpy(blockOffsets.data(), stream.data() + sizeof(StreamHeader) + (block * sizeof(uint32_t)), sizeof(blockOffsets));
+
+        const size_t dataOffset = sizeof(StreamHeader) + ((static_cast<size_t>(header.blockCount) + 1) * sizeof(uint32_t));
+        elementOffset = block * MeshCodec::BLOCK_SIZE;
+        elementCount = std::min<size_t>(MeshCodec::BLOCK_SIZE, header.elementCount - elementOffset);
+        return stream.subspan(dataOffset + blockOffsets[0], blockOffsets[1] - blockOffsets[0]);
+    }
+}   // namespace
+
+std::vector<std::byte> MeshCodec::encodeVertices(std::span<const Vertex> vertices) {
+    const int32_t positionExponent = getPositionExponent(vertices);
+    const float positionScale = std::ldexp(1.0F, -positionExponent);
+
+    std::vector<std::vector<std::byte>> blocks((vertices.size() + BLOCK_SIZE - 1) / BLOCK_SIZE);
+    for (size_t block = 0; block < blocks.size(); block++) {
+        const size_t blockBegin = block * BLOCK_SIZE;
+        const size_t blockSize = std::min<size_t>(BLOCK_SIZE, vertices.size() - blockBegin);
+
+        // Quantization, one lane per component
+        std::array<std::vector<uint32_t>, VERTEX_LANE_COUNT> lanes;
+        for (std::vector<uint32_t>& lane : lanes)
+            lane.resize(blockSize);
+
+        for (size_t i = 0; i < blockSize; i++) {
+            const Vertex& vertex = vertices[blockBegin + i];
+            const std::array<int16_t, 2> normal = encodeOctahedral(vertex.normal);
+
+            lanes[0][i] = static_cast<uint32_t>(static_cast<int32_t>(std::lround(vertex.position.x * positionScale)));
+            lanes[1][i] = static_cast<uint32_t>(static_cast<int32_t>(std::lround(vertex.position.y * positionScale)));
+            lanes[2][i] = static_cast<uint32_t>(static_cast<int32_t>(std::lround(vertex.position.z * positionScale)));
+            lanes[3][i] = static_cast<uint32_t>(static_cast<int32_t>(normal[0]));
+            lanes[4][i] = static_cast<uint32_t>(static_cast<int32_t>(normal[1]));
+            lanes[5][i] = std::bit_cast<uint32_t>(vertex.uv.x);
+            lanes[6][i] = std::bit_cast<uint32_t>(vertex.uv.y);
+        }
+
+
+        // Delta coding against the previous vertex of the block, then packing
+        for (std::vector<uint32_t>& lane : lanes) {
+            uint32_t previous = 0;
+            for (uint32_t& value : lane) {
+                const uint32_t current = value;
+                value = zigzag(current - previous);
+                previous = current;
+            }
+            encodeLane(lane.data(), lane.size(), blocks[block]);
+        }
+    }
+
+    return writeStream(StreamHeader{ .elementCount = static_cast<uint32_t>(vertices.size()), .blockCount = static_cast<uint32_t>(blocks.size()), .laneCount = VERTEX_LANE_COUNT, .positionExponent = positionExponent }, blocks);
+}
+
+std::vector<std::byte> MeshCodec::encodeIndices(std::span<const uint32_t> indices) {
+    std::vector<std::vector<std::byte>> blocks((indices.size() + BLOCK_SIZE - 1) / BLOCK_SIZE);
+    for (size_t block = 0; block < blocks.size(); block++) {
+        const size_t blockBegin = block * BLOCK_SIZE;
+        const size_t blockSize = std::min<size_t>(BLOCK_SIZE, indices.size() - blockBegin);
+
+        std::vector<uint32_t> deltas(blockSize);
+        uint32_t previous = 0;
+        for (size_t i = 0; i < blockSize; i++) {
+            deltas[i] = zigzag(indices[blockBegin + i] - previous);
+            previous = indices[blockBegin + i];
+        }
+        encodeLane(deltas.data(), deltas.size(), blocks[block]);
+    }
+
+    return writeStream(StreamHeader{ .elementCount = static_cast<uint32_t>(indices.size()), .blockCount = static_cast<uint32_t>(blocks.size()), .laneCount = INDEX_LANE_COUNT, .positionExponent = 0 }, blocks);
+}
+
+size_t MeshCodec::getBlockCount(std::span<const std::byte> stream, size_t elementCount) {
+    const StreamHeader header = readStreamHeader(stream);
+    if (header.elementCount != elementCount || header.blockCount != (static_cast<size_t>(header.elementCount) + BLOCK_SIZE - 1) / BLOCK_SIZE || (header.laneCount != VERTEX_LANE_COUNT && header.laneCount != INDEX_LANE_COUNT))
+        throw std::runtime_error("Corrupted mesh stream: " + std::to_string(header.elementCount) + " elements in " + std::to_string(header.blockCount) + " blocks, " + std::to_string(elementCount) + " expected");
+
+    const size_t dataOffset = sizeof(StreamHeader) + ((static_cast<size_t>(header.blockCount) + 1) * sizeof(uint32_t));
+    if (stream.size() < dataOffset)
+        throw std::runtime_error("Corrupted mesh stream: truncated block table");
+
+    // Block offsets must be increasing and stay inside the stream
+    std::vector<uint32_t> blockOffsets(header.blockCount + 1);
+    std::memcpy(blockOffsets.data(), stream.data() + sizeof(StreamHeader), blockOffsets.size() * sizeof(uint32_t));
+    if (blockOffsets[0] != 0 || !std::ranges::is_sorted(blockOffsets) || blockOffsets.back() != stream.size() - dataOffset)
+        throw std::runtime_error("Corrupted mesh stream: invalid block table");
+
+    return header.blockCount;
+}
+
+void MeshCodec::decodeVertexBlock(std::span<const std::byte> stream, size_t block, std::span<Vertex> vertices) {
+    size_t blockBegin = 0;
+    size_t blockSize = 0;
+    const std::span<const std::byte> data = getBlock(stream, block, blockBegin, blockSize);
+    const StreamHeader header = readStreamHeader(stream);
+    if (header.laneCount != VERTEX_LANE_COUNT || blockBegin + blockSize > vertices.size())
+        throw std::runtime_error("Corrupted mesh stream: not a vertex stream of " + std::to_string(vertices.size()) + " vertices");
+
+    const float positionStep = std::ldexp(1.0F, header.positionExponent);
+    Vertex* dst = vertices.data() + blockBegin;
+
+
+    // Lanes decoded one after the other, each one is written to its component as soon as it is decoded
+    thread_local std::vector<uint32_t> lane;
+    thread_local std::vector<uint32_t> normalX;
+    lane.resize(LANE_CAPACITY);
+    normalX.resize(LANE_CAPACITY);
+
+    const std::byte* src = data.data();
+    const std::byte* end = data.data() + data.size();
+    for (uint32_t laneIndex = 0; laneIndex < VERTEX_LANE_COUNT; laneIndex++) {
+        src = decodeLane(src, end, blockSize, laneIndex == 3 ? normalX.data() : lane.data());
+
+        for (size_t i = 0; i < blockSize; i++) {
+            switch (laneIndex) {
+                case 0: dst[i].position.x = static_cast<float>(static_cast<int32_t>(lane[i])) * positionStep; break;
+                case 1: dst[i].position.y = static_cast<float>(static_cast<int32_t>(lane[i])) * positionStep; break;
+                case 2: dst[i].position.z = static_cast<float>(static_cast<int32_t>(lane[i])) * positionStep; break;
+                case 4: dst[i].normal = decodeOctahedral(static_cast<int16_t>(normalX[i]), static_cast<int16_t>(lane[i])); break;
+                case 5: dst[i].uv.x = std::bit_cast<float>(lane[i]); break;
+                case 6: dst[i].uv.y = std::bit_cast<float>(lane[i]); break;
+                default: break;
+            }
+        }
+    }
+}
+
+void MeshCodec::decodeIndexBlock(std::span<const std::byte> stream, size_t block, std::span<uint32_t> indices) {
+    size_t blockBegin = 0;
+    size_t blockSize = 0;
+    const std::span<const std::byte> data = getBlock(stream, block, blockBegin, blockSize);
+    if (readStreamHeader(stream).laneCount != INDEX_LANE_COUNT || blockBegin + blockSize > indices.size())
+        throw std::runtime_error("Corrupted mesh stream: not an index stream of " + std::to_string(indices.size()) + " indices");
+
+    // The lane is decoded in whole groups, only the valid part is copied out
+    thread_local std::vector<uint32_t> lane;
+    lane.resize(LANE_CAPACITY);
+    decodeLane(data.data(), data.data() + data.size(), blockSize, lane.data());
+    std::memcpy(indices.data() + blockBegin, lane.data(), blockSize * sizeof(uint32_t));
+}
@@ -0,0 +1,148 @@
+#include "Common/ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+ThreadPool::ThreadPool(uint32_t threadCount) {
+    threadCount = std::max(threadCount, 1U);
+
+    m_workers.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; i++)
+        m_workers.emplace_back([this]() { workerLoop(); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        const std::scoped_lock lock(m_mutex);
+        m_stopping = true;
+    }
+    m_taskAvailable.notify_all();
+
+    for (auto& worker : m_workers) {
+        if (worker.joinable())
+            worker.join();
+    }
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+
+        {
+            std::unique_lock lock(m_mutex);
+            m_taskAvailable.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+            if (m_stopping && m_tasks.empty())
+                return;
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+            m_activeTaskCount++;
+        }
+
+        try {
+            task();
+        } catch (...) {
+            const std::scoped_lock lock(m_mutex);
+            if (!m_firstException)
+                m_firstException = std::current_exception();
+        }
+
+        {
+            const std::scoped_lock lock(m_mutex);
+            m_activeTaskCount--;
+            if (m_activeTaskCount == 0 && m_tasks.empty())
+                m_idle.notify_all();
+        }
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        const std::scoped_lock lock(m_mutex);
+        m_tasks.emplace_back(std::move(task));
+    }
+    m_taskAvailable.notify_one();
+}
+
+void ThreadPool::waitIdle() {
+    std::unique_lock lock(m_mutex);
+    m_idle.wait(lock, [this]() { return m_activeTaskCount == 0 && m_tasks.empty(); });
+
+    if (m_firstException) {
+        const std::exception_ptr exception = std::exchange(m_firstException, nullptr);
+        std::rethrow_exception(exception);
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& func) {
+    if (count == 0)
+        return;
+
+    // Shared between the caller and the helpers, since late helpers can start after the caller returned
+    struct State {
+        std::function<void(size_t)> func;
+        std::atomic<size_t> nextIndex = 0;
+        size_t count = 0;
+        size_t doneCount = 0;
+        std::exception_ptr exception;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+
+    const auto state = std::make_shared<State>();
+    state->func = func;
+    state->count = count;
+
+    const auto work = [state]() {
+        size_t processed = 0;
+
+        for (size_t i = state->nextIndex++; i < state->count; i = state->nextIndex++) {
+            try {
+                // Skip the remaining indices as soon as one of them failed
+                bool failed = false;
+                {
+                    const std::scoped_lock lock(state->mutex);
+                    failed = static_cast<bool>(state->exception);
+                }
+                if (!failed)
+                    state->func(i);
+            } catch (...) {
+                const std::scoped_lock lock(state->mutex);
+                if (!state->exception)
+                    state->exception = std::current_exception();
+            }
+            processed++;
+        }
+
+        if (processed > 0) {
+            const std::scoped_lock lock(state->mutex);
+            state->doneCount += processed;
+            if (state->doneCount == state->count)
+                state->done.notify_all();
+        }
+    };
+
+
+    // Helpers only need to be spawned when there is more than one index, the caller always participates
+    const size_t helperCount = std::min(count - 1, m_workers.size());
+    for (size_t i = 0; i < helperCount; i++)
+        submit(work);
+
+    work();
+
+
+    // Wait for the indices claimed by the helpers
+    std::unique_lock lock(state->mutex);
+    state->done.wait(lock, [&state]() { return state->doneCount == state->count; });
+
+    if (state->exception)
+        std::rethrow_exception(state->exception);
+}
@@ -0,0 +1,126 @@
+#include "Common/Xxh64.hpp"
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+    constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+    constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+    constexpr uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+    constexpr uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+    constexpr uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+
+    uint64_t read64(const std::byte* src) noexcept {
+        uint64_t value = 0;
+        std::memcpy(&value, src, sizeof(uint64_t));
+        return value;
+    }
+
+    uint32_t read32(const std::byte* src) noexcept {
+        uint32_t value = 0;
+        std::memcpy(&value, src, sizeof(uint32_t));
+        return value;
+    }
+
+    uint64_t round(uint64_t lane, uint64_t input) noexcept {
+        return std::rotl(lane + (input * PRIME2), 31) * PRIME1;
+    }
+
+    uint64_t mergeRound(uint64_t hash, uint64_t lane) noexcept {
+        return ((hash ^ round(0, lane)) * PRIME1) + PRIME4;
+    }
+
+    /**
+     * @brief Consume every whole stripe of src, the lanes are independent so the loop runs four multiplications in flight.
+     * @return The number of bytes consumed.
+     */
+    size_t consumeStripes(std::array<uint64_t, 4>& lanes, const std::byte* src, size_t size) noexcept {
+        // Lanes kept in registers, the compiler can't assume src doesn't alias them
+        uint64_t lane0 = lanes[0];
+        uint64_t lane1 = lanes[1];
+        uint64_t lane2 = lanes[2];
+        uint64_t lane3 = lanes[3];
+
+        size_t offset = 0;
+        for (; offset + 32 <= size; offset += 32) {
+            lane0 = round(lane0, read64(src + offset));
+            lane1 = round(lane1, read64(src + offset + 8));
+            lane2 = round(lane2, read64(src + offset + 16));
+            lane3 = round(lane3, read64(src + offset + 24));
+        }
+
+        lanes = { lane0, lane1, lane2, lane3 };
+        return offset;
+    }
+}   // namespace
+
+Xxh64::Xxh64(uint64_t seed) noexcept : m_seed(seed), m_lanes{ seed + PRIME1 + PRIME2, seed + PRIME2, seed, seed - PRIME1 } {}
+
+uint64_t Xxh64::hash(const void* data, size_t size, uint64_t seed) noexcept {
+    Xxh64 hasher(seed);
+    hasher.update(data, size);
+    return hasher.digest();
+}
+
+void Xxh64::update(const void* data, size_t size) noexcept {
+    const auto* src = static_cast<const std::byte*>(data);
+    m_totalSize += size;
+
+    // Completion of the stripe left over by the previous update
+    if (m_bufferSize > 0) {
+        const size_t copySize = std::min(size, STRIPE_SIZE - m_bufferSize);
+        std::memcpy(m_buffer.data() + m_bufferSize, src, copySize);
+        m_bufferSize += copySize;
+        src += copySize;
+        size -= copySize;
+
+        if (m_bufferSize < STRIPE_SIZE)
+            return;
+        consumeStripes(m_lanes, m_buffer.data(), STRIPE_SIZE);
+        m_bufferSize = 0;
+    }
+
+    const size_t consumed = consumeStripes(m_lanes, src, size);
+    if (consumed < size) {
+        std::memcpy(m_buffer.data(), src + consumed, size - consumed);
+        m_bufferSize = size - consumed;
+    }
+}
+
+uint64_t Xxh64::digest() const noexcept {
+    uint64_t hash = 0;
+    if (m_totalSize >= STRIPE_SIZE) {
+        hash = std::rotl(m_lanes[0], 1) + std::rotl(m_lanes[1], 7) + std::rotl(m_lanes[2], 12) + std::rotl(m_lanes[3], 18);
+        for (const uint64_t lane : m_lanes)
+            hash = mergeRound(hash, lane);
+    } else {
+        hash = m_seed + PRIME5;
+    }
+    hash += m_totalSize;
+
+
+    // Tail, shorter than a stripe
+    const std::byte* src = m_buffer.data();
+    const std::byte* end = m_buffer.data() + m_bufferSize;
+    for (; src + 8 <= end; src += 8)
+        hash = (std::rotl(hash ^ round(0, read64(src)), 27) * PRIME1) + PRIME4;
+    if (src + 4 <= end) {
+        hash = (std::rotl(hash ^ (static_cast<uint64_t>(read32(src)) * PRIME1), 23) * PRIME2) + PRIME3;
+        src += 4;
+    }
+    for (; src < end; src++)
+        hash = std::rotl(hash ^ (static_cast<uint64_t>(*src) * PRIME5), 11) * PRIME1;
+
+
+    // Avalanche
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
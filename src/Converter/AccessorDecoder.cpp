@@ -0,0 +1,257 @@
+#include "Converter/AccessorDecoder.hpp"
+
+#include "fastgltf/tools.hpp"
+#include "fastgltf/types.hpp"
+#include "glm/ext/vector_float2.hpp"
+#include "glm/ext/vector_float3.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define KELP_SSE2
+#endif
+
+namespace {
+    /**
+     * @brief Convert count integer components to floats: value * scale, clamped to -1 for signed normalized data.
+     * The bulk of the array goes through SSE2, the tail is handled by the scalar loop.
+     */
+    template <typename T>
+    void convertComponents(const T* src, float* dst, size_t count, float scale, bool clampToMinusOne) {
+        size_t i = 0;
+
+        #ifdef KELP_SSE2
+            const __m128 scaleVector = _mm_set1_ps(scale);
+            const __m128 minusOne = _mm_set1_ps(-1.0F);
+
+            const auto store = [&](__m128i integers, size_t offset) {
+                __m128 floats = _mm_mul_ps(_mm_cvtepi32_ps(integers), scaleVector);
+                if (clampToMinusOne)
+                    floats = _mm_max_ps(floats, minusOne);
+                _mm_storeu_ps(dst + offset, floats);
+            };
+
+            if constexpr (sizeof(T) == 1) {
+                const __m128i zero = _mm_setzero_si128();
+                for (; i + 16 <= count; i += 16) {
+                    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                    __m128i lo16;
+                    __m128i hi16;
+                    if constexpr (std::is_signed_v<T>) {
+                        lo16 = _mm_srai_epi16(_mm_unpacklo_epi8(bytes, bytes), 8);
+                        hi16 = _mm_srai_epi16(_mm_unpackhi_epi8(bytes, bytes), 8);
+                        store(_mm_srai_epi32(_mm_unpacklo_epi16(lo16, lo16), 16), i);
+                        store(_mm_srai_epi32(_mm_unpackhi_epi16(lo16, lo16), 16), i + 4);
+                        store(_mm_srai_epi32(_mm_unpacklo_epi16(hi16, hi16), 16), i + 8);
+                        store(_mm_srai_epi32(_mm_unpackhi_epi16(hi16, hi16), 16), i + 12);
+                    } else {
+                        lo16 = _mm_unpacklo_epi8(bytes, zero);
+                        hi16 = _mm_unpackhi_epi8(bytes, zero);
+                        store(_mm_unpacklo_epi16(lo16, zero), i);
+                        store(_mm_unpackhi_epi16(lo16, zero), i + 4);
+                        store(_mm_unpacklo_epi16(hi16, zero), i + 8);
+                        store(_mm_unpackhi_epi16(hi16, zero), i + 12);
+                    }
+                }
+            } else if constexpr (sizeof(T) == 2) {
+                const __m128i zero = _mm_setzero_si128();
+                for (; i + 8 <= count; i += 8) {
+                    const __m128i shorts = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                    if constexpr (std::is_signed_v<T>) {
+                        store(_mm_srai_epi32(_mm_unpacklo_epi16(shorts, shorts), 16), i);
+                        store(_mm_srai_epi32(_mm_unpackhi_epi16(shorts, shorts), 16), i + 4);
+                    } else {
+                        store(_mm_unpacklo_epi16(shorts, zero), i);
+                        store(_mm_unpackhi_epi16(shorts, zero), i + 4);
+                    }
+                }
+            }
+        #endif
+
+        for (; i < count; i++) {
+            const float value = static_cast<float>(src[i]) * scale;
+            dst[i] = clampToMinusOne ? std::max(value, -1.0F) : value;
+        }
+    }
+
+    /**
+     * @brief Widen count unsigned indices to 32 bits.
+     */
+    template <typename T>
+    void widenIndices(const T* src, uint32_t* dst, size_t count) {
+        size_t i = 0;
+
+        #ifdef KELP_SSE2
+            const __m128i zero = _mm_setzero_si128();
+
+            if constexpr (sizeof(T) == 1) {
+                for (; i + 16 <= count; i += 16) {
+                    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                    const __m128i lo16 = _mm_unpacklo_epi8(bytes, zero);
+                    const __m128i hi16 = _mm_unpackhi_epi8(bytes, zero);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi16(lo16, zero));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 4), _mm_unpackhi_epi16(lo16, zero));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_unpacklo_epi16(hi16, zero));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 12), _mm_unpackhi_epi16(hi16, zero));
+                }
+            } else if constexpr (sizeof(T) == 2) {
+                for (; i + 8 <= count; i += 8) {
+                    const __m128i shorts = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi16(shorts, zero));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 4), _mm_unpackhi_epi16(shorts, zero));
+                }
+            }
+        #endif
+
+        for (; i < count; i++)
+            dst[i] = static_cast<uint32_t>(src[i]);
+    }
+
+    /**
+     * @brief Get a pointer to the first element of a non-sparse accessor and the distance between two elements.
+     *
+     * @return nullptr if the accessor data can't be read directly (sparse accessor or no buffer view).
+     */
+    const std::byte* getAccessorData(const fastgltf::Asset& asset, const fastgltf::Accessor& accessor, size_t& stride) {
+        if (!accessor.bufferViewIndex.has_value() || accessor.sparse.has_value())
+            return nullptr;
+
+        const fastgltf::BufferView& bufferView = asset.bufferViews[accessor.bufferViewIndex.value()];
+        const fastgltf::span<const std::byte> bytes = fastgltf::DefaultBufferDataAdapter{}(asset, accessor.bufferViewIndex.value());
+        if (bytes.data() == nullptr)
+            return nullptr;
+
+        stride = bufferView.byteStride.value_or(fastgltf::getElementByteSize(accessor.type, accessor.componentType));
+        return bytes.data() + accessor.byteOffset;
+    }
+
+    // Number of elements converted at once by the integer paths, small enough for the scratch buffers to stay in L1
+    constexpr size_t DECODE_BLOCK_SIZE = 256;
+}   // namespace
+
+template <typename T, size_t ComponentCount>
+void AccessorDecoder::decodeIntegerVector(const std::byte* src, size_t srcStride, size_t count, bool normalized, float* dst, size_t dstStride) {
+    // Normalized values are divided by the max value of their type, signed ones are clamped to -1 as the spec requires
+    const float scale = normalized ? 1.0F / static_cast<float>(std::numeric_limits<T>::max()) : 1.0F;
+    const bool clampToMinusOne = normalized && std::is_signed_v<T>;
+
+    std::array<T, DECODE_BLOCK_SIZE * ComponentCount> packed{};
+    std::array<float, DECODE_BLOCK_SIZE * ComponentCount> converted{};
+
+    for (size_t blockStart = 0; blockStart < count; blockStart += DECODE_BLOCK_SIZE) {
+        const size_t blockCount = std::min(DECODE_BLOCK_SIZE, count - blockStart);
+        const std::byte* blockSrc = src + (blockStart * srcStride);
+
+        // De-interleave the source into a tightly packed scratch buffer
+        if (srcStride == sizeof(T) * ComponentCount) {
+            std::memcpy(packed.data(), blockSrc, blockCount * srcStride);
+        } else {
+            for (size_t i = 0; i < blockCount; i++)
+                std::memcpy(&packed[i * ComponentCount], blockSrc + (i * srcStride), sizeof(T) * ComponentCount);
+        }
+
+        convertComponents(packed.data(), converted.data(), blockCount * ComponentCount, scale, clampToMinusOne);
+
+        // Scatter to the strided destination
+        auto* blockDst = reinterpret_cast<std::byte*>(dst) + (blockStart * dstStride);
+        for (size_t i = 0; i < blockCount; i++)
+            std::memcpy(blockDst + (i * dstStride), &converted[i * ComponentCount], sizeof(float) * ComponentCount);
+    }
+}
+
+template <size_t ComponentCount>
+void AccessorDecoder::decodeFloatVector(const fastgltf::Asset& asset, const fastgltf::Accessor& accessor, float* dst, size_t dstStride) {
+    using VectorType = std::conditional_t<ComponentCount == 3, fastgltf::math::fvec3, fastgltf::math::fvec2>;
+    constexpr fastgltf::AccessorType expectedType = ComponentCount == 3 ? fastgltf::AccessorType::Vec3 : fastgltf::AccessorType::Vec2;
+
+    if (accessor.type != expectedType)
+        throw std::runtime_error("Failed to decode accessor: expected " + std::to_string(ComponentCount) + " components, got " + std::to_string(fastgltf::getNumComponents(accessor.type)));
+
+    size_t srcStride = 0;
+    const std::byte* src = getAccessorData(asset, accessor, srcStride);
+
+
+    // Sparse or bufferless accessors are rare enough to go through the generic per-element path
+    if (src == nullptr) {
+        fastgltf::iterateAccessorWithIndex<VectorType>(asset, accessor, [&](const VectorType& value, size_t index) {
+            std::memcpy(reinterpret_cast<std::byte*>(dst) + (index * dstStride), value.data(), sizeof(float) * ComponentCount);
+        });
+        return;
+    }
+
+
+    // Bulk copy when the components already are floats
+    if (accessor.componentType == fastgltf::ComponentType::Float) {
+        constexpr size_t elementSize = sizeof(float) * ComponentCount;
+        if (srcStride == elementSize && dstStride == elementSize) {
+            std::memcpy(dst, src, accessor.count * elementSize);
+        } else {
+            for (size_t i = 0; i < accessor.count; i++)
+                std::memcpy(reinterpret_cast<std::byte*>(dst) + (i * dstStride), src + (i * srcStride), elementSize);
+        }
+        return;
+    }
+
+
+    // Normalized & quantized integer components
+    switch (accessor.componentType) {
+        case fastgltf::ComponentType::Byte:
+            decodeIntegerVector<int8_t, ComponentCount>(src, srcStride, accessor.count, accessor.normalized, dst, dstStride);
+            break;
+        case fastgltf::ComponentType::UnsignedByte:
+            decodeIntegerVector<uint8_t, ComponentCount>(src, srcStride, accessor.count, accessor.normalized, dst, dstStride);
+            break;
+        case fastgltf::ComponentType::Short:
+            decodeIntegerVector<int16_t, ComponentCount>(src, srcStride, accessor.count, accessor.normalized, dst, dstStride);
+            break;
+        case fastgltf::ComponentType::UnsignedShort:
+            decodeIntegerVector<uint16_t, ComponentCount>(src, srcStride, accessor.count, accessor.normalized, dst, dstStride);
+            break;
+        default:
+            fastgltf::iterateAccessorWithIndex<VectorType>(asset, accessor, [&](const VectorType& value, size_t index) {
+                std::memcpy(reinterpret_cast<std::byte*>(dst) + (index * dstStride), value.data(), sizeof(float) * ComponentCount);
+            });
+            break;
+    }
+}
+
+void AccessorDecoder::decodeVec3(const fastgltf::Asset& asset, const fastgltf::Accessor& accessor, glm::vec3* dst, size_t dstStride) {
+    decodeFloatVector<3>(asset, accessor, &dst->x, dstStride);
+}
+
+void AccessorDecoder::decodeVec2(const fastgltf::Asset& asset, const fastgltf::Accessor& accessor, glm::vec2* dst, size_t dstStride) {
+    decodeFloatVector<2>(asset, accessor, &dst->x, dstStride);
+}
+
+void AccessorDecoder::decodeIndices(const fastgltf::Asset& asset, const fastgltf::Accessor& accessor, uint32_t* dst) {
+    size_t srcStride = 0;
+    const std::byte* src = getAccessorData(asset, accessor, srcStride);
+    if (src == nullptr || srcStride != fastgltf::getComponentByteSize(accessor.componentType)) {
+        fastgltf::copyFromAccessor<uint32_t>(asset, accessor, dst);
+        return;
+    }
+
+    switch (accessor.componentType) {
+        case fastgltf::ComponentType::UnsignedByte:
+            widenIndices(reinterpret_cast<const uint8_t*>(src), dst, accessor.count);
+            break;
+        case fastgltf::ComponentType::UnsignedShort:
+            widenIndices(reinterpret_cast<const uint16_t*>(src), dst, accessor.count);
+            break;
+        case fastgltf::ComponentType::UnsignedInt:
+            std::memcpy(dst, src, accessor.count * sizeof(uint32_t));
+            break;
+        default:
+            fastgltf::copyFromAccessor<uint32_t>(asset, accessor, dst);
+            break;
+    }
+}
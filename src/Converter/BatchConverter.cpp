@@ -0,0 +1,231 @@
+#include "Converter/BatchConverter.hpp"
+#include "Converter/Converter.hpp"
+#include "Converter/MeshImporter.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+BatchConverter::BatchConverter(const BatchOptions& options) : m_options(options) {
+    m_options.conversion.verbose = false;
+}
+
+bool BatchConverter::isConvertible(const std::filesystem::path& path) {
+    return path.extension() == ".gltf" || path.extension() == ".glb" || MeshImporter::isSupported(path);
+}
+
+std::vector<std::filesystem::path> BatchConverter::collectInputs(const std::filesystem::path& source) {
+    std::vector<std::filesystem::path> inputs;
+    if (std::filesystem::is_directory(source)) {
+        for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(source)) {
+            if (entry.is_regular_file() && isConvertible(entry.path()))
+                inputs.push_back(entry.path());
+        }
+        std::ranges::sort(inputs);
+        return inputs;
+    }
+
+
+    // List file: one input per line, relative to the list, blank lines & lines starting with # ignored
+    std::ifstream list(source);
+    if (!list)
+        throw std::runtime_error("Failed to open input list \"" + source.string() + "\"");
+
+    std::string line;
+    while (std::getline(list, line)) {
+        const size_t begin = line.find_first_not_of(" \t\r");
+        const size_t end = line.find_last_not_of(" \t\r");
+        if (begin == std::string::npos || line[begin] == '#')
+            continue;
+
+        const std::filesystem::path input = source.parent_path() / line.substr(begin, end - begin + 1);
+        if (!isConvertible(input))
+            throw std::runtime_error("Unsupported input \"" + input.string() + "\" in \"" + source.string() + "\"");
+        inputs.push_back(input);
+    }
+    return inputs;
+}
+
+std::vector<std::filesystem::path> BatchConverter::getDependencies(const std::filesystem::path& input) {
+    // .gltf buffers & images and .obj libraries & textures are external files, usually next to the input or below it: every file of its
+    // directory is counted, which may overestimate the inputs sharing a directory but never misses a modified texture
+    std::vector<std::filesystem::path> dependencies = { input };
+    if (input.extension() != ".gltf" && input.extension() != ".obj")
+        return dependencies;
+
+    const std::filesystem::path directory = input.parent_path().empty() ? "." : input.parent_path();
+    for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(directory)) {
+        if (entry.is_regular_file() && entry.path() != input && !isConvertible(entry.path()) && entry.path().extension() != ".kelp")
+            dependencies.push_back(entry.path());
+    }
+    return dependencies;
+}
+
+bool BatchConverter::isUpToDate(const Job& job) {
+    std::error_code error;
+    const std::filesystem::file_time_type lastOutputWrite = std::filesystem::last_write_time(job.output, error);
+    return !error && lastOutputWrite >= job.lastInputWrite;
+}
+
+void BatchConverter::runJob(const Job& job, Result& result) {
+    // Written next to the output and renamed once complete, so that an interrupted conversion is never taken for an up to date output
+    const auto timeStart = std::chrono::high_resolution_clock::now();
+    std::filesystem::path temporaryOutput = job.output;
+    temporaryOutput += ".tmp";
+
+    try {
+        std::filesystem::create_directories(job.output.parent_path());
+        {
+            Converter converter(m_threadPool);
+            converter.convert(job.input, temporaryOutput, m_options.conversion);
+        }
+        std::filesystem::rename(temporaryOutput, job.output);
+
+        result.status = Status::Converted;
+        result.outputSize = std::filesystem::file_size(job.output);
+    } catch (const std::exception& e) {
+        std::error_code error;
+        std::filesystem::remove(temporaryOutput, error);
+
+        result.status = Status::Failed;
+        result.error = e.what();
+    }
+
+    result.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - timeStart).count();
+}
+
+std::vector<BatchConverter::Result> BatchConverter::convert(const std::filesystem::path& source, const std::filesystem::path& outputDirectory) {
+    const std::vector<std::filesystem::path> inputs = collectInputs(source);
+    const std::filesystem::path inputRoot = std::filesystem::is_directory(source) ? source : source.parent_path();
+
+    std::vector<Job> jobs;
+    std::vector<Result> results(inputs.size());
+    std::vector<size_t> order;
+    std::set<std::filesystem::path> outputs;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        // Inputs listed from outside the list directory are written at the root of the output directory
+        std::filesystem::path relativePath = inputs[i].lexically_relative(inputRoot);
+        if (relativePath.empty() || *relativePath.begin() == "..")
+            relativePath = inputs[i].filename();
+
+        Job job{
+            .input = inputs[i],
+            .output = (outputDirectory / relativePath).replace_extension(".kelp"),
+            .inputSize = 0,
+            .estimatedMemory = 0,
+            .lastInputWrite = std::filesystem::file_time_type::min(),
+        };
+        if (!outputs.insert(job.output.lexically_normal()).second)
+            throw std::runtime_error("Several inputs would be converted to \"" + job.output.string() + "\", rename one of them");
+
+        for (const std::filesystem::path& dependency : getDependencies(job.input)) {
+            job.inputSize += std::filesystem::file_size(dependency);
+            job.lastInputWrite = std::max(job.lastInputWrite, std::filesystem::last_write_time(dependency));
+        }
+        job.estimatedMemory = job.inputSize * ESTIMATED_MEMORY_PER_INPUT_BYTE;
+
+        results[i] = Result{ .input = job.input, .output = job.output, .status = Status::UpToDate, .seconds = 0, .inputSize = job.inputSize, .outputSize = 0, .error = {} };
+        if (!m_options.force && isUpToDate(job))
+            results[i].outputSize = std::filesystem::file_size(job.output);
+        else
+            order.push_back(i);
+        jobs.push_back(std::move(job));
+    }
+
+
+    // Largest first: the long conversions start early and the short ones balance the end of the batch
+    std::ranges::sort(order, [&](size_t a, size_t b) { return jobs[a].inputSize > jobs[b].inputSize; });
+
+
+    // A job waits for a free thread and for its estimated memory to fit in the budget, unless nothing else is in flight
+    std::mutex mutex;
+    std::condition_variable jobFinished;
+    size_t jobsInFlight = 0;
+    size_t finishedJobCount = 0;
+    uint64_t reservedMemory = 0;
+    const size_t maxJobsInFlight = m_threadPool.getThreadCount();
+
+    for (const size_t i : order) {
+        {
+            std::unique_lock lock(mutex);
+            jobFinished.wait(lock, [&]() {
+                const bool fitsInBudget = m_options.memoryBudget == 0 || reservedMemory + jobs[i].estimatedMemory <= m_options.memoryBudget;
+                return jobsInFlight == 0 || (jobsInFlight < maxJobsInFlight && fitsInBudget);
+            });
+            jobsInFlight++;
+            reservedMemory += jobs[i].estimatedMemory;
+        }
+
+        m_threadPool.submit([&, i]() {
+            runJob(jobs[i], results[i]);
+
+            {
+                const std::lock_guard<std::mutex> lock(mutex);
+                jobsInFlight--;
+                reservedMemory -= jobs[i].estimatedMemory;
+                finishedJobCount++;
+
+                std::cout << "[" << finishedJobCount << "/" << order.size() << "] " << jobs[i].input.string() << ": "
+                    << (results[i].status == Status::Converted ? "converted in " + std::to_string(static_cast<int>(results[i].seconds * 1000)) + " ms" : "failed: " + results[i].error) << std::endl;
+            }
+            jobFinished.notify_all();
+        });
+    }
+
+    std::unique_lock lock(mutex);
+    jobFinished.wait(lock, [&]() { return jobsInFlight == 0; });
+    return results;
+}
+
+void BatchConverter::printSummary(const std::vector<Result>& results, double seconds) {
+    constexpr double MEGABYTE = 1024.0 * 1024.0;
+    const auto statusName = [](Status status) {
+        switch (status) {
+            case Status::Converted: return "converted";
+            case Status::UpToDate: return "up to date";
+            case Status::Failed: return "failed";
+        }
+        return "";
+    };
+
+    size_t nameWidth = 5;
+    for (const Result& result : results)
+        nameWidth = std::max(nameWidth, result.input.string().size());
+
+    std::cout << std::endl << std::left << std::setw(static_cast<int>(nameWidth)) << "Asset" << "  " << std::setw(10) << "Status"
+        << std::right << std::setw(10) << "Time (s)" << std::setw(12) << "Input (MB)" << std::setw(13) << "Output (MB)" << std::endl;
+
+    std::cout << std::fixed;
+    for (const Result& result : results) {
+        std::cout << std::left << std::setw(static_cast<int>(nameWidth)) << result.input.string() << "  " << std::setw(10) << statusName(result.status)
+            << std::right << std::setprecision(2) << std::setw(10) << result.seconds
+            << std::setprecision(1) << std::setw(12) << static_cast<double>(result.inputSize) / MEGABYTE << std::setw(13) << static_cast<double>(result.outputSize) / MEGABYTE << std::endl;
+    }
+    std::cout << std::defaultfloat;
+
+
+    // Errors come after the table so that long messages don't break its columns
+    for (const Result& result : results) {
+        if (result.status == Status::Failed)
+            std::cerr << "Failed to convert \"" << result.input.string() << "\": " << result.error << std::endl;
+    }
+
+    const auto count = [&](Status status) { return std::ranges::count(results, status, &Result::status); };
+    const uint64_t outputSize = std::accumulate(results.begin(), results.end(), uint64_t{ 0 }, [](uint64_t sum, const Result& result) { return sum + result.outputSize; });
+    std::cout << "Converted " << count(Status::Converted) << " files, " << count(Status::UpToDate) << " up to date, " << count(Status::Failed) << " failed in "
+        << static_cast<int>(seconds * 1000) << " ms, " << outputSize / 1024 / 1024 << " MB of .kelp files" << std::endl;
+}
@@ -1,77 +1,374 @@
 #include "Converter/Converter.hpp"
+#include "Common/KelpFormat.hpp"
+#include "Common/Lz4.hpp"
+#include "Common/MappedFile.hpp"
+#include "Common/MeshCodec.hpp"
+#include "Common/Xxh64.hpp"
+#include "Converter/AccessorDecoder.hpp"
+#include "Converter/KelpWriter.hpp"
+#include "Converter/Ktx2.hpp"
+#include "Converter/MeshImporter.hpp"
+#include "Converter/MeshSimplifier.hpp"
+#include "Converter/MeshoptDecoder.hpp"
 #include "shared.hpp"
 
 #include "fastgltf/core.hpp"
 #include "fastgltf/tools.hpp"
 #include "fastgltf/types.hpp"
+#include "glm/common.hpp"
 #include "glm/ext/matrix_transform.hpp"
+#include "glm/ext/vector_float2.hpp"
+#include "glm/ext/vector_float3.hpp"
+#include "glm/ext/vector_float4.hpp"
 #include "glm/ext/vector_int2.hpp"
+#include "glm/ext/vector_int3.hpp"
+#include "glm/geometric.hpp"
 #include "glm/gtc/quaternion.hpp"
 #include "glm/gtc/type_ptr.hpp"
 #include "omm.hpp"
 #include "stb_image.h"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <functional>
 #include <iostream>
-#include <thread>
-
-void Converter::funcTime(const std::string& context, const std::function<void()>& func) {
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+Converter::Converter() : m_ownedThreadPool(std::make_unique<ThreadPool>()), m_threadPool(*m_ownedThreadPool) {}
+
+Converter::Converter(ThreadPool& threadPool) : m_threadPool(threadPool) {}
+
+void Converter::funcTime(const std::string& context, const std::function<void()>& func) const {
     const auto timeNow = std::chrono::high_resolution_clock::now();
     func();
     const auto timeEnd = std::chrono::high_resolution_clock::now();
     const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(timeEnd - timeNow).count();
-    std::cout << context << " in " << duration << " ms" << std::endl;
+    log() << context << " in " << duration << " ms" << std::endl;
+}
+
+std::ostream& Converter::log() const {
+    return m_options.verbose ? std::cout : m_discardedLog;
 }
 
 fastgltf::Asset Converter::parseFile(const std::filesystem::path& inputFile) {
     if (!std::filesystem::exists(inputFile))
         throw std::runtime_error("Input file does not exist: " + inputFile.string());
-
-    fastgltf::Expected<fastgltf::GltfDataBuffer> dataBuffer = fastgltf::GltfDataBuffer::FromPath(inputFile);
+    if (MeshImporter::isSupported(inputFile))
+        return importMeshFile(inputFile);
+    if (inputFile.extension() != ".gltf" && inputFile.extension() != ".glb")
+        throw std::runtime_error("Failed to load \"" + inputFile.string() + "\": unknown file extension");
+
+    #if FASTGLTF_HAS_MEMORY_MAPPED_FILE
+        fastgltf::Expected<fastgltf::MappedGltfFile> dataBuffer = fastgltf::MappedGltfFile::FromPath(inputFile);
+    #else
+        fastgltf::Expected<fastgltf::GltfDataBuffer> dataBuffer = fastgltf::GltfDataBuffer::FromPath(inputFile);
+    #endif
     if (dataBuffer.error() != fastgltf::Error::None)
         throw std::runtime_error("Failed to load \"" + inputFile.string() + "\": " + std::string(fastgltf::getErrorName(dataBuffer.error())) + ": " + std::string(fastgltf::getErrorMessage(dataBuffer.error())));
 
+    // External buffers & images are left as URIs: buffers are memory mapped below, images are only opened by their texture task
     constexpr fastgltf::Options options =
         fastgltf::Options::DontRequireValidAssetMember |
         fastgltf::Options::AllowDouble |
-        fastgltf::Options::LoadExternalImages |
-        fastgltf::Options::LoadExternalBuffers |
         fastgltf::Options::GenerateMeshIndices;
 
-    fastgltf::Parser parser;
-    if (inputFile.extension() == ".gltf") {
-        fastgltf::Expected<fastgltf::Asset> expectedAsset = parser.loadGltf(dataBuffer.get(), inputFile.parent_path(), options);
-        if (expectedAsset.error() != fastgltf::Error::None)
-            throw std::runtime_error("Failed to load \"" + inputFile.string() + "\": " + std::string(fastgltf::getErrorName(expectedAsset.error())) + ": " + std::string(fastgltf::getErrorMessage(expectedAsset.error())));
+    // KTX2 images may also be referenced through KHR_texture_basisu, see getImageSource(). Quantized attributes are handled by AccessorDecoder,
+    // the UV transforms dequantizing them are baked in the vertices (see loadPrimitive()) and meshopt compressed buffer views are decoded by decodeMeshoptBuffers()
+    constexpr fastgltf::Extensions extensions =
+        fastgltf::Extensions::KHR_texture_basisu |
+        fastgltf::Extensions::KHR_mesh_quantization |
+        fastgltf::Extensions::KHR_texture_transform |
+        fastgltf::Extensions::EXT_meshopt_compression;
+
+    fastgltf::Parser parser(extensions);
+    fastgltf::Expected<fastgltf::Asset> expectedAsset = inputFile.extension() == ".glb"
+        ? parser.loadGltfBinary(dataBuffer.get(), inputFile.parent_path(), options)
+        : parser.loadGltf(dataBuffer.get(), inputFile.parent_path(), options);
+
+    if (expectedAsset.error() != fastgltf::Error::None)
+        throw std::runtime_error("Failed to load \"" + inputFile.string() + "\": " + std::string(fastgltf::getErrorName(expectedAsset.error())) + ": " + std::string(fastgltf::getErrorMessage(expectedAsset.error())));
+
+    fastgltf::Asset asset = std::move(expectedAsset.get());
+    mapBuffers(asset, inputFile);
+    decodeMeshoptBuffers(asset);
+    return asset;
+}
+
+void Converter::mapBuffers(fastgltf::Asset& asset, const std::filesystem::path& inputFile) {
+    // GLB binary chunk: copied out of the input by the parser, it is pointed back into a mapping of the .glb and the copy is freed
+    if (inputFile.extension() == ".glb" && !asset.buffers.empty()) {
+        const auto* array = std::get_if<fastgltf::sources::Array>(&asset.buffers[0].data);
+        if (array != nullptr && array->mimeType == fastgltf::MimeType::GltfBuffer) {
+            const MappedFile& mapping = mapInputFile(inputFile);
+            const std::span<const std::byte> binaryChunk = getGlbBinaryChunk(mapping);
+            if (binaryChunk.size() < array->bytes.size())
+                throw std::runtime_error("Invalid GLB file \"" + inputFile.string() + "\": truncated binary chunk");
+
+            asset.buffers[0].data = fastgltf::sources::ByteView{
+                .bytes = fastgltf::span<const std::byte>(binaryChunk.data(), array->bytes.size()),
+                .mimeType = fastgltf::MimeType::GltfBuffer,
+            };
+        }
+    }
+
+
+    // External buffers, accessors are then decoded straight from the mappings
+    for (fastgltf::Buffer& buffer : asset.buffers) {
+        const auto* uri = std::get_if<fastgltf::sources::URI>(&buffer.data);
+        if (uri == nullptr || !uri->uri.isLocalPath())
+            continue;
+
+        const std::filesystem::path path = inputFile.parent_path() / uri->uri.fspath();
+        const MappedFile& mapping = mapInputFile(path);
+        if (uri->fileByteOffset + buffer.byteLength > mapping.getData().size())
+            throw std::runtime_error("Buffer file \"" + path.string() + "\" is smaller than declared in the glTF");
+
+        const std::span<const std::byte> bytes = mapping.getData().subspan(uri->fileByteOffset, buffer.byteLength);
+        buffer.data = fastgltf::sources::ByteView{
+            .bytes = fastgltf::span<const std::byte>(bytes.data(), bytes.size()),
+            .mimeType = uri->mimeType,
+        };
+    }
+}
+
+void Converter::decodeMeshoptBuffers(fastgltf::Asset& asset) {
+    std::vector<size_t> views;
+    for (size_t i = 0; i < asset.bufferViews.size(); i++) {
+        if (asset.bufferViews[i].meshoptCompression != nullptr)
+            views.push_back(i);
+    }
+    if (views.empty())
+        return;
+
+
+    // Every view is decoded into its own allocation, in parallel as the streams are independent
+    std::vector<std::unique_ptr<std::vector<std::byte>>> decodedViews(views.size());
+    m_threadPool.parallelFor(views.size(), [&](size_t i) {
+        const fastgltf::CompressedBufferView& view = *asset.bufferViews[views[i]].meshoptCompression;
+        const std::span<const std::byte> buffer = std::visit(fastgltf::visitor {
+            [](auto& /* UNUSED */) -> std::span<const std::byte> {
+                throw std::runtime_error("Failed to decode meshopt buffer view: compressed data is not loaded");
+            },
+            [](const fastgltf::sources::Array& array) -> std::span<const std::byte> {
+                return { array.bytes.data(), array.bytes.size() };
+            },
+            [](const fastgltf::sources::ByteView& byteView) -> std::span<const std::byte> {
+                return { byteView.bytes.data(), byteView.bytes.size() };
+            },
+        }, asset.buffers.at(view.bufferIndex).data);
+
+        if (view.byteOffset + view.byteLength > buffer.size())
+            throw std::runtime_error("Failed to decode meshopt buffer view " + std::to_string(views[i]) + ": compressed data is out of its buffer");
+
+        static_assert(static_cast<int>(fastgltf::MeshoptCompressionMode::Indices) == static_cast<int>(MeshoptDecoder::Mode::Indices));
+        static_assert(static_cast<int>(fastgltf::MeshoptCompressionFilter::Exponential) == static_cast<int>(MeshoptDecoder::Filter::Exponential));
+        const auto mode = static_cast<MeshoptDecoder::Mode>(view.mode);
+        const auto filter = static_cast<MeshoptDecoder::Filter>(view.filter);
+        decodedViews[i] = std::make_unique<std::vector<std::byte>>(view.count * view.byteStride);
+        MeshoptDecoder::decode(buffer.subspan(view.byteOffset, view.byteLength), *decodedViews[i], view.count, view.byteStride, mode, filter);
+    });
+
+
+    // Each view is pointed at its decoded data through a buffer of its own, the fallback buffers it referred to are never read
+    for (size_t i = 0; i < views.size(); i++) {
+        const std::vector<std::byte>& decoded = *decodedViews[i];
+        fastgltf::Buffer& buffer = asset.buffers.emplace_back();
+        buffer.byteLength = decoded.size();
+        buffer.data = fastgltf::sources::ByteView{
+            .bytes = fastgltf::span<const std::byte>(decoded.data(), decoded.size()),
+            .mimeType = fastgltf::MimeType::GltfBuffer,
+        };
+
+        fastgltf::BufferView& bufferView = asset.bufferViews[views[i]];
+        bufferView.bufferIndex = asset.buffers.size() - 1;
+        bufferView.byteOffset = 0;
+        bufferView.byteLength = decoded.size();
+        bufferView.meshoptCompression.reset();
+    }
+
+    const std::lock_guard<std::mutex> lock(m_inputMutex);
+    std::ranges::move(decodedViews, std::back_inserter(m_decodedBuffers));
+}
+
+fastgltf::Asset Converter::importMeshFile(const std::filesystem::path& inputFile) {
+    MeshImporter::Scene scene = MeshImporter::import(inputFile, m_threadPool);
+    fastgltf::Asset asset;
+
+
+    // Every texture path gets a texture & an image, opened from the input directory like the URIs of glTF images
+    std::map<std::string, size_t> textures;
+    const auto setTexture = [&](auto& textureInfo, const std::string& texturePath) {
+        if (texturePath.empty())
+            return;
+
+        const auto [it, inserted] = textures.try_emplace(texturePath, asset.textures.size());
+        if (inserted) {
+            fastgltf::sources::URI source;
+            source.fileByteOffset = 0;
+            source.uri = fastgltf::URI(texturePath);
+            source.mimeType = fastgltf::MimeType::None;
+            asset.images.emplace_back().data = std::move(source);
+            asset.textures.emplace_back().imageIndex = asset.images.size() - 1;
+        }
+
+        textureInfo.emplace();
+        textureInfo->textureIndex = it->second;
+        textureInfo->texCoordIndex = 0;
+    };
+
+    for (const MeshImporter::Material& importedMaterial : scene.materials) {
+        fastgltf::Material& material = asset.materials.emplace_back();
+        const glm::vec4& baseColor = importedMaterial.baseColorFactor;
+        material.pbrData.baseColorFactor = fastgltf::math::nvec4(baseColor.r, baseColor.g, baseColor.b, baseColor.a);
+        material.pbrData.metallicFactor = importedMaterial.metallicFactor;
+        material.pbrData.roughnessFactor = importedMaterial.roughnessFactor;
+        material.emissiveFactor = fastgltf::math::nvec3(importedMaterial.emissiveFactor.x, importedMaterial.emissiveFactor.y, importedMaterial.emissiveFactor.z);
+        material.alphaMode = importedMaterial.alphaMask ? fastgltf::AlphaMode::Mask : (baseColor.a < 1.0F ? fastgltf::AlphaMode::Blend : fastgltf::AlphaMode::Opaque);
+        material.alphaCutoff = 0.5F;
+        setTexture(material.pbrData.baseColorTexture, importedMaterial.baseColorTexture);
+        setTexture(material.normalTexture, importedMaterial.normalTexture);
+        setTexture(material.emissiveTexture, importedMaterial.emissiveTexture);
+    }
+
+
+    // A buffer per primitive pointing at its streams, all primitives belong to a single mesh instanced once at the origin
+    std::vector<std::unique_ptr<std::vector<std::byte>>> buffers;
+    fastgltf::Mesh& mesh = asset.meshes.emplace_back();
+    for (MeshImporter::Primitive& importedPrimitive : scene.primitives) {
+        const std::vector<std::byte>& data = *buffers.emplace_back(std::make_unique<std::vector<std::byte>>(std::move(importedPrimitive.data)));
+        fastgltf::Buffer& buffer = asset.buffers.emplace_back();
+        buffer.byteLength = data.size();
+        buffer.data = fastgltf::sources::ByteView{
+            .bytes = fastgltf::span<const std::byte>(data.data(), data.size()),
+            .mimeType = fastgltf::MimeType::GltfBuffer,
+        };
+
+        const auto addAccessor = [&](size_t byteOffset, size_t count, fastgltf::AccessorType type, fastgltf::ComponentType componentType, size_t elementSize) {
+            fastgltf::BufferView& bufferView = asset.bufferViews.emplace_back();
+            bufferView.bufferIndex = asset.buffers.size() - 1;
+            bufferView.byteOffset = byteOffset;
+            bufferView.byteLength = count * elementSize;
+
+            fastgltf::Accessor& accessor = asset.accessors.emplace_back();
+            accessor.bufferViewIndex = asset.bufferViews.size() - 1;
+            accessor.byteOffset = 0;
+            accessor.count = count;
+            accessor.type = type;
+            accessor.componentType = componentType;
+            accessor.normalized = false;
+            return asset.accessors.size() - 1;
+        };
 
-        return std::move(expectedAsset.get());
+        fastgltf::Primitive primitive;
+        primitive.type = fastgltf::PrimitiveType::Triangles;
+        primitive.materialIndex = importedPrimitive.materialIndex;
+        primitive.attributes.push_back({ "POSITION", addAccessor(MeshImporter::Primitive::positionsOffset(), importedPrimitive.vertexCount, fastgltf::AccessorType::Vec3, fastgltf::ComponentType::Float, sizeof(glm::vec3)) });
+        primitive.attributes.push_back({ "NORMAL", addAccessor(importedPrimitive.normalsOffset(), importedPrimitive.vertexCount, fastgltf::AccessorType::Vec3, fastgltf::ComponentType::Float, sizeof(glm::vec3)) });
+        primitive.attributes.push_back({ "TEXCOORD_0", addAccessor(importedPrimitive.uvsOffset(), importedPrimitive.vertexCount, fastgltf::AccessorType::Vec2, fastgltf::ComponentType::Float, sizeof(glm::vec2)) });
+        primitive.indicesAccessor = addAccessor(importedPrimitive.indicesOffset(), importedPrimitive.indexCount, fastgltf::AccessorType::Scalar, fastgltf::ComponentType::UnsignedInt, sizeof(uint32_t));
+        mesh.primitives.push_back(std::move(primitive));
     }
 
-    if (inputFile.extension() == ".glb") {
-        fastgltf::Expected<fastgltf::Asset> expectedAsset = parser.loadGltfBinary(dataBuffer.get(), inputFile.parent_path(), options);
-        if (expectedAsset.error() != fastgltf::Error::None)
-            throw std::runtime_error("Failed to load \"" + inputFile.string() + "\": " + std::string(fastgltf::getErrorName(expectedAsset.error())) + ": " + std::string(fastgltf::getErrorMessage(expectedAsset.error())));
+    fastgltf::TRS transform;
+    transform.translation = fastgltf::math::fvec3(0.0F, 0.0F, 0.0F);
+    transform.rotation = fastgltf::math::fquat(0.0F, 0.0F, 0.0F, 1.0F);
+    transform.scale = fastgltf::math::fvec3(1.0F, 1.0F, 1.0F);
+
+    fastgltf::Node& node = asset.nodes.emplace_back();
+    node.meshIndex = 0;
+    node.transform = transform;
+    asset.scenes.emplace_back().nodeIndices.push_back(0);
+
+    const std::lock_guard<std::mutex> lock(m_inputMutex);
+    std::ranges::move(buffers, std::back_inserter(m_decodedBuffers));
+    return asset;
+}
+
+const MappedFile& Converter::mapInputFile(const std::filesystem::path& path) {
+    auto mapping = std::make_unique<MappedFile>(path);
+
+    const std::lock_guard<std::mutex> lock(m_inputMutex);
+    return *m_inputMappings.emplace_back(std::move(mapping));
+}
 
-        return std::move(expectedAsset.get());
+std::span<const std::byte> Converter::getGlbBinaryChunk(const MappedFile& glbFile) {
+    // 12 bytes header, then chunks made of a length, a type and the chunk data: JSON first, then the optional binary chunk
+    constexpr size_t HEADER_SIZE = 12;
+    constexpr size_t CHUNK_HEADER_SIZE = 8;
+    constexpr uint32_t BINARY_CHUNK_TYPE = 0x004E4942;  // "BIN\0"
+
+    const std::span<const std::byte> data = glbFile.getData();
+    size_t offset = HEADER_SIZE;
+    while (offset + CHUNK_HEADER_SIZE <= data.size()) {
+        uint32_t chunkLength = 0;
+        uint32_t chunkType = 0;
+        std::memcpy(&chunkLength, data.data() + offset, sizeof(uint32_t));
+        std::memcpy(&chunkType, data.data() + offset + sizeof(uint32_t), sizeof(uint32_t));
+
+        offset += CHUNK_HEADER_SIZE;
+        if (chunkLength > data.size() - offset)
+            break;
+
+        if (chunkType == BINARY_CHUNK_TYPE)
+            return data.subspan(offset, chunkLength);
+        offset += chunkLength;
     }
 
-    throw std::runtime_error("Failed to load \"" + inputFile.string() + "\": unknown file extension");
+    throw std::runtime_error("Invalid GLB file \"" + glbFile.getPath().string() + "\": no binary chunk found");
+}
+
+void Converter::parseInputs(const std::vector<BundleInput>& inputs) {
+    m_inputs.resize(inputs.size());
+    m_threadPool.parallelFor(inputs.size(), [&](size_t i) {
+        m_inputs[i].path = inputs[i].path;
+        m_inputs[i].asset = parseFile(inputs[i].path);
+        m_inputs[i].transform = inputs[i].transform;
+    });
+
+
+    // Textures, materials & meshes are numbered across every input, in input order
+    int textureCount = 0;
+    int materialCount = 0;
+    int meshCount = 0;
+    for (Input& input : m_inputs) {
+        input.firstTexture = textureCount;
+        input.firstMaterial = materialCount;
+        input.firstMesh = meshCount;
+        textureCount += static_cast<int>(input.asset.textures.size());
+        materialCount += static_cast<int>(input.asset.materials.size());
+        meshCount += static_cast<int>(input.asset.meshes.size());
+    }
 }
 
-void Converter::loadMaterials(const fastgltf::Asset& asset) {
-    m_materials.reserve(asset.materials.size());
+void Converter::loadMaterials(const Input& input) {
+    const auto textureIndex = [&input](const auto& textureInfo) {
+        return textureInfo.has_value() ? input.firstTexture + static_cast<int>(textureInfo.value().textureIndex) : -1;
+    };
 
-    for (const auto& gltfMaterial : asset.materials) {
+    m_materials.reserve(m_materials.size() + input.asset.materials.size());
+    for (const auto& gltfMaterial : input.asset.materials) {
         const Material material{
-            .baseColorTexture = gltfMaterial.pbrData.baseColorTexture.has_value() ? static_cast<int>(gltfMaterial.pbrData.baseColorTexture.value().textureIndex) : -1,
+            .baseColorTexture = textureIndex(gltfMaterial.pbrData.baseColorTexture),
             .alphaTexture = -1,
-            .normalTexture = gltfMaterial.normalTexture.has_value() ? static_cast<int>(gltfMaterial.normalTexture.value().textureIndex) : -1,
-            .metallicRoughnessTexture = gltfMaterial.pbrData.metallicRoughnessTexture.has_value() ? static_cast<int>(gltfMaterial.pbrData.metallicRoughnessTexture.value().textureIndex) : -1,
-            .emissiveTexture = gltfMaterial.emissiveTexture.has_value() ? static_cast<int>(gltfMaterial.emissiveTexture.value().textureIndex) : -1,
+            .normalTexture = textureIndex(gltfMaterial.normalTexture),
+            .metallicRoughnessTexture = textureIndex(gltfMaterial.pbrData.metallicRoughnessTexture),
+            .emissiveTexture = textureIndex(gltfMaterial.emissiveTexture),
             .baseColorFactor = glm::vec4(gltfMaterial.pbrData.baseColorFactor.x(), gltfMaterial.pbrData.baseColorFactor.y(), gltfMaterial.pbrData.baseColorFactor.z(), gltfMaterial.pbrData.baseColorFactor.w()),
             .metallicFactor = gltfMaterial.pbrData.metallicFactor,
             .roughnessFactor = gltfMaterial.pbrData.roughnessFactor,
@@ -84,6 +381,118 @@ void Converter::loadMaterials(const fastgltf::Asset& asset) {
     }
 }
 
+std::pair<Converter::Input&, const fastgltf::Texture&> Converter::getSourceTexture(int gltfIndex) {
+    // Last input whose textures start at or before the index, inputs without textures share their offset with the next one
+    const auto it = std::ranges::upper_bound(m_inputs, gltfIndex, {}, &Input::firstTexture);
+    if (it == m_inputs.begin())
+        throw std::runtime_error("Invalid texture index " + std::to_string(gltfIndex));
+
+    Input& input = *std::prev(it);
+    return { input, input.asset.textures.at(gltfIndex - input.firstTexture) };
+}
+
+void Converter::deduplicateTextures() {
+    // Textures are identified by their encoded image, so that an image used by several inputs is only decoded & stored once
+    std::vector<int> textures;
+    for (const Material& material : m_materials) {
+        for (const int texture : { material.baseColorTexture, material.normalTexture, material.metallicRoughnessTexture, material.emissiveTexture }) {
+            if (texture != -1)
+                textures.push_back(texture);
+        }
+    }
+    std::ranges::sort(textures);
+    textures.erase(std::ranges::unique(textures).begin(), textures.end());
+
+    std::vector<std::pair<uint64_t, size_t>> imageKeys(textures.size());   // Hash & size of the encoded image
+    m_threadPool.parallelFor(textures.size(), [&](size_t i) {
+        const auto [input, gltfTexture] = getSourceTexture(textures[i]);
+        readImage(getImageSource(input.asset, input.path, gltfTexture), [&](std::span<const uint8_t> bytes) {
+            imageKeys[i] = { Xxh64::hash(bytes.data(), bytes.size()), bytes.size() };
+        });
+    });
+
+
+    // Every texture is replaced by the first one with the same image, compared byte for byte as different images may share a key
+    std::multimap<std::pair<uint64_t, size_t>, int> images;
+    std::map<int, int> duplicates;
+    for (size_t i = 0; i < textures.size(); i++) {
+        const auto [begin, end] = images.equal_range(imageKeys[i]);
+        const auto it = std::find_if(begin, end, [&](const auto& image) {
+            return hasSameImage(image.second, textures[i]);
+        });
+
+        if (it != end)
+            duplicates[textures[i]] = it->second;
+        else
+            images.emplace(imageKeys[i], textures[i]);
+    }
+
+    for (Material& material : m_materials) {
+        for (int* texture : { &material.baseColorTexture, &material.normalTexture, &material.metallicRoughnessTexture, &material.emissiveTexture }) {
+            const auto it = duplicates.find(*texture);
+            if (it != duplicates.end())
+                *texture = it->second;
+        }
+    }
+
+    if (!duplicates.empty())
+        log() << "Merged " << duplicates.size() << " duplicate textures" << std::endl;
+}
+
+bool Converter::hasSameImage(int gltfIndex, int otherGltfIndex) {
+    const auto [input, gltfTexture] = getSourceTexture(gltfIndex);
+    const auto [otherInput, otherGltfTexture] = getSourceTexture(otherGltfIndex);
+    const ImageSource source = getImageSource(input.asset, input.path, gltfTexture);
+    const ImageSource otherSource = getImageSource(otherInput.asset, otherInput.path, otherGltfTexture);
+
+    bool isSame = false;
+    readImage(source, [&](std::span<const uint8_t> bytes) {
+        readImage(otherSource, [&](std::span<const uint8_t> otherBytes) {
+            isSame = std::ranges::equal(bytes, otherBytes);
+        });
+    });
+    return isSame;
+}
+
+void Converter::deduplicateMaterials() {
+    // Runs after the textures deduplication, so that materials only differing by a duplicate texture are merged too
+    const auto fields = [](const Material& material) {
+        return std::tie(material.baseColorTexture, material.alphaTexture, material.normalTexture, material.metallicRoughnessTexture, material.emissiveTexture,
+            material.baseColorFactor, material.metallicFactor, material.roughnessFactor, material.emissiveFactor, material.alphaMode, material.alphaCutoff);
+    };
+
+    const auto hash = [&fields](const Material& material) {
+        Xxh64 hasher;
+        std::apply([&hasher](const auto&... field) { (hasher.update(&field, sizeof(field)), ...); }, fields(material));
+        return hasher.digest();
+    };
+
+    std::vector<Material> materials;
+    std::multimap<uint64_t, int> materialsByHash;
+    m_gltfMaterialIndices.resize(m_materials.size());
+    for (size_t i = 0; i < m_materials.size(); i++) {
+        const Material& material = m_materials[i];
+        const uint64_t materialHash = hash(material);
+
+        const auto [begin, end] = materialsByHash.equal_range(materialHash);
+        const auto it = std::find_if(begin, end, [&](const auto& entry) {
+            return fields(materials[entry.second]) == fields(material);
+        });
+
+        if (it != end) {
+            m_gltfMaterialIndices[i] = it->second;
+        } else {
+            m_gltfMaterialIndices[i] = static_cast<int>(materials.size());
+            materialsByHash.emplace(materialHash, static_cast<int>(materials.size()));
+            materials.push_back(material);
+        }
+    }
+
+    if (materials.size() < m_materials.size())
+        log() << "Merged " << m_materials.size() - materials.size() << " duplicate materials" << std::endl;
+    m_materials = std::move(materials);
+}
+
 int Converter::processTextureIndex(int originalIndex, std::vector<Texture>& textureCollection) {
     if (originalIndex == -1)
         return -1;
@@ -167,230 +576,656 @@ void Converter::initTextureCollections() {
     }
 }
 
-std::pair<glm::ivec2, uint8_t*> Converter::loadTexture(fastgltf::Asset& asset, const std::filesystem::path& inputFile, const fastgltf::Texture& gltfTexture, int desiredChannels) {
-    if (!gltfTexture.imageIndex.has_value())
+std::array<Converter::TextureCollectionInfo, static_cast<size_t>(KelpFormat::TextureCollection::Count)> Converter::getTextureCollections() {
+    // Each collection is stored contiguously in the texture directory, in material index order
+    return {{
+        { .textures = &m_albedoTextures, .channelCount = 4 },
+        { .textures = &m_alphaTextures, .channelCount = 1 },
+        { .textures = &m_normalTextures, .channelCount = 4 },
+        { .textures = &m_metallicRoughnessTextures, .channelCount = 2 },
+        { .textures = &m_emissiveTextures, .channelCount = 4 },
+    }};
+}
+
+Converter::ImageSource Converter::getImageSource(fastgltf::Asset& asset, const std::filesystem::path& inputFile, const fastgltf::Texture& gltfTexture) {
+    // Any source may be a KTX2 image, detected by its identifier. The KHR_texture_basisu one is only used without fallback, as Basis payloads can't be passed through
+    const auto imageIndex = gltfTexture.imageIndex.has_value() ? gltfTexture.imageIndex : gltfTexture.basisuImageIndex;
+    if (!imageIndex.has_value())
         throw std::runtime_error("Unsupported texture format: no image index found for texture");
 
-    fastgltf::Image& image = asset.images[gltfTexture.imageIndex.value()];
-    glm::ivec2 size;
+    fastgltf::Image& image = asset.images[imageIndex.value()];
 
-    uint8_t *data = std::visit(fastgltf::visitor {
-        [](auto& /* UNUSED */) -> uint8_t * {
+    return std::visit(fastgltf::visitor {
+        [](auto& /* UNUSED */) -> ImageSource {
             throw std::runtime_error("Failed to load image: unknown image type");
         },
-        [&](fastgltf::sources::BufferView& imageBufferView) -> uint8_t * {
+        [&](fastgltf::sources::BufferView& imageBufferView) -> ImageSource {
             const fastgltf::BufferView& bufferView = asset.bufferViews[imageBufferView.bufferViewIndex];
             fastgltf::Buffer& buffer = asset.buffers[bufferView.bufferIndex];
 
             return std::visit(fastgltf::visitor {
-                [](auto& /* UNUSED */) -> uint8_t * {
+                [](auto& /* UNUSED */) -> ImageSource {
                     throw std::runtime_error("Failed to load image buffer view: unknown buffer type");
                 },
-                [&](fastgltf::sources::Array& array) -> uint8_t * {
-                    return stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(array.bytes.data() + bufferView.byteOffset), static_cast<int>(bufferView.byteLength), &size.x, &size.y, nullptr, desiredChannels);
+                [&](fastgltf::sources::Array& array) -> ImageSource {
+                    return { .bytes = { reinterpret_cast<const uint8_t*>(array.bytes.data() + bufferView.byteOffset), bufferView.byteLength }, .path = {} };
+                },
+                [&](fastgltf::sources::ByteView& byteView) -> ImageSource {
+                    return { .bytes = { reinterpret_cast<const uint8_t*>(byteView.bytes.data() + bufferView.byteOffset), bufferView.byteLength }, .path = {} };
                 }
             }, buffer.data);
         },
-        [&](fastgltf::sources::Array& array) -> uint8_t * {
-            return stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(array.bytes.data()), static_cast<int>(array.bytes.size()), &size.x, &size.y, nullptr, desiredChannels);
+        [&](fastgltf::sources::Array& array) -> ImageSource {
+            return { .bytes = { reinterpret_cast<const uint8_t*>(array.bytes.data()), array.bytes.size() }, .path = {} };
         },
-        [&](fastgltf::sources::URI& texturePath) -> uint8_t * {
+        [&](fastgltf::sources::URI& texturePath) -> ImageSource {
             const std::filesystem::path path = std::filesystem::path(inputFile).parent_path().append(texturePath.uri.c_str());
             if (!std::filesystem::exists(path))
                 throw std::runtime_error("Error loading \"" + path.string() + "\": file not found");
 
-            return stbi_load(path.string().c_str(), &size.x, &size.y, nullptr, desiredChannels);
+            return { .bytes = {}, .path = path };
         },
     }, image.data);
+}
+
+MipLevel Converter::loadTexture(fastgltf::Asset& asset, const std::filesystem::path& inputFile, const fastgltf::Texture& gltfTexture, int desiredChannels) {
+    MipLevel mipLevel;
+    readImage(getImageSource(asset, inputFile, gltfTexture), [&](std::span<const uint8_t> bytes) {
+        // KTX2 images whose channels don't match their collection are decoded from their first level, keeping the first desiredChannels channels
+        if (Ktx2::isKtx2(bytes)) {
+            const Ktx2::Image image = Ktx2::parse(bytes);
+            const std::vector<uint8_t> texels = Ktx2::decode(image, 0);
+            const auto channels = static_cast<size_t>(desiredChannels);
+
+            mipLevel.size = { static_cast<int>(image.width), static_cast<int>(image.height) };
+            mipLevel.data.resize((texels.size() / 4) * channels);
+            for (size_t i = 0; i < texels.size() / 4; i++)
+                std::copy_n(texels.begin() + static_cast<ptrdiff_t>(i * 4), channels, mipLevel.data.begin() + static_cast<ptrdiff_t>(i * channels));
+            return;
+        }
+
+        uint8_t* data = stbi_load_from_memory(bytes.data(), static_cast<int>(bytes.size()), &mipLevel.size.x, &mipLevel.size.y, nullptr, desiredChannels);
+        if (data == nullptr)
+            throw std::runtime_error("Failed to load image: " + std::string(stbi_failure_reason()));
+
+        mipLevel.data.assign(data, data + (static_cast<ptrdiff_t>(mipLevel.size.x) * mipLevel.size.y * desiredChannels));
+        stbi_image_free(data);
+    });
+
+    return mipLevel;
+}
 
-    if (data == nullptr)
-        throw std::runtime_error("Failed to load image: " + std::string(stbi_failure_reason()));
+void Converter::readImage(const ImageSource& source, const std::function<void(std::span<const uint8_t>)>& read) {
+    if (!source.bytes.empty()) {
+        read(source.bytes);
+        return;
+    }
 
-    return { size, data };
+    // External images are memory mapped, so that reading a header only loads its pages
+    const MappedFile imageFile(source.path);
+    read({ reinterpret_cast<const uint8_t*>(imageFile.getData().data()), imageFile.getData().size() });
 }
 
-void Converter::loadTextures(fastgltf::Asset& asset, const std::filesystem::path& inputFile) {
-    std::vector<std::thread> threads;
-    threads.reserve(m_albedoTextures.size() + m_alphaTextures.size() + m_normalTextures.size() + m_metallicRoughnessTextures.size() + m_emissiveTextures.size());
+KelpFormat::TextureEntry Converter::readTextureHeader(fastgltf::Asset& asset, const std::filesystem::path& inputFile, const fastgltf::Texture& gltfTexture, KelpFormat::TextureCollection collection, uint32_t channelCount) {
+    KelpFormat::TextureEntry entry{
+        .collection = collection,
+        .channelCount = channelCount,
+        .width = 0,
+        .height = 0,
+        .mipCount = 0,
+        .firstChunk = 0,
+        .vkFormat = 0,
+        .blockSize = 0,
+        .mipChecksums = {},
+        .offset = 0,
+        .size = 0,
+        .checksum = 0,
+    };
 
-    // Process albedo textures (RGBA format)
-    for (Texture& albedoTexture : m_albedoTextures) {
-        threads.emplace_back([&]() {
-            const fastgltf::Texture& gltfTexture = asset.textures[albedoTexture.gltfIndex];
-            const auto [size, data] = loadTexture(asset, inputFile, gltfTexture, STBI_rgb_alpha);
+    readImage(getImageSource(asset, inputFile, gltfTexture), [&](std::span<const uint8_t> bytes) {
+        // KTX2 images keep their format & mips when they hold the channels of their collection, RGB ones being sampled with an opaque alpha.
+        // The others, and the alpha collection, are decoded like the other images
+        if (Ktx2::isKtx2(bytes)) {
+            const Ktx2::Image image = Ktx2::parse(bytes);
+            entry.width = image.width;
+            entry.height = image.height;
+            if (collection != KelpFormat::TextureCollection::Alpha && (image.channelCount == channelCount || (image.channelCount == 3 && channelCount == 4))) {
+                entry.channelCount = image.texelSize;
+                entry.mipCount = static_cast<uint32_t>(image.levels.size());
+                entry.vkFormat = image.vkFormat;
+                entry.blockSize = image.blockSize;
+                return;
+            }
+        } else {
+            glm::ivec2 size;
+            if (stbi_info_from_memory(bytes.data(), static_cast<int>(bytes.size()), &size.x, &size.y, nullptr) == 0 || size.x <= 0 || size.y <= 0)
+                throw std::runtime_error("Failed to read image header: " + std::string(stbi_failure_reason()));
 
-            // First mip level creation from loaded data
-            albedoTexture.mipLevels.emplace_back(MipLevel{
-                .size = size,
-                .data = std::vector<uint8_t>(static_cast<size_t>(size.x * size.y) * 4),
-            });
-            std::copy(data, data + static_cast<ptrdiff_t>(static_cast<size_t>(size.x * size.y) * 4), albedoTexture.mipLevels[0].data.begin());
+            entry.width = static_cast<uint32_t>(size.x);
+            entry.height = static_cast<uint32_t>(size.y);
+        }
 
-            // Generate mipmaps & clean up
-            generateMipmaps(albedoTexture, 4);
-            stbi_image_free(data);
-        });
+        entry.mipCount = static_cast<uint32_t>(std::bit_width(std::max(entry.width, entry.height)));  // Down to 1x1, see generateMipmaps()
+    });
+
+    if (entry.mipCount > KelpFormat::MAX_MIP_COUNT)
+        throw std::runtime_error("Texture of " + std::to_string(entry.width) + "x" + std::to_string(entry.height) + " has " + std::to_string(entry.mipCount) + " mip levels, more than the " + std::to_string(KelpFormat::MAX_MIP_COUNT) + " supported");
+
+    entry.size = KelpFormat::mipOffset(entry, entry.mipCount);
+    return entry;
+}
+
+void Converter::layoutTextures() {
+    // Only the image headers are read here, so that every texture gets its final offset before any of them is decoded
+    std::vector<std::pair<KelpFormat::TextureCollection, Texture*>> textures;
+    const auto collections = getTextureCollections();
+    for (size_t i = 0; i < collections.size(); i++) {
+        for (Texture& texture : *collections[i].textures) {
+            texture.entryIndex = textures.size();
+            textures.emplace_back(static_cast<KelpFormat::TextureCollection>(i), &texture);
+        }
+    }
+
+    m_textureEntries.resize(textures.size());
+    m_threadPool.parallelFor(textures.size(), [&](size_t i) {
+        const auto [collection, texture] = textures[i];
+        const auto [input, gltfTexture] = getSourceTexture(texture->gltfIndex);
+        m_textureEntries[i] = readTextureHeader(input.asset, input.path, gltfTexture, collection, collections[static_cast<size_t>(collection)].channelCount);
+    });
+
+
+    // Offsets, in directory order. Compressed sizes are only known once written, compressed payloads are placed by writePayload()
+    if (!m_options.compress) {
+        for (KelpFormat::TextureEntry& entry : m_textureEntries) {
+            entry.offset = m_fileCursor;
+            m_fileCursor = KelpFormat::alignUp(m_fileCursor + entry.size);
+        }
     }
+}
+
+void Converter::writeTexture(const Texture& texture) {
+    KelpFormat::TextureEntry& entry = m_textureEntries.at(texture.entryIndex);
+    if (texture.mipLevels.size() != entry.mipCount || texture.mipLevels[0].size != glm::ivec2(entry.width, entry.height))
+        throw std::runtime_error("Texture " + std::to_string(texture.gltfIndex) + " was decoded to a different size than announced by its header");
+
+    std::vector<std::span<const std::byte>> parts(entry.mipCount);
+    for (uint32_t i = 0; i < entry.mipCount; i++) {
+        const MipLevel& mipLevel = texture.mipLevels[i];
+        if (mipLevel.data.size() != KelpFormat::mipSize(entry, i))
+            throw std::runtime_error("Texture " + std::to_string(texture.gltfIndex) + " mip " + std::to_string(i) + " has an unexpected size");
+
+        parts[i] = std::as_bytes(std::span(mipLevel.data));
+    }
+
+    writeTexturePayload(entry, parts);
+}
+
+void Converter::writeTexturePayload(KelpFormat::TextureEntry& entry, const std::vector<std::span<const std::byte>>& mipLevels) {
+    // Every mip level gets its own checksum on top of the payload one, as the viewer reads the mip tails of the textures without the rest
+    for (size_t i = 0; i < mipLevels.size(); i++)
+        entry.mipChecksums[i] = Xxh64::hash(mipLevels[i].data(), mipLevels[i].size());
+
+    writePayload(KelpFormat::SectionType::TextureData, mipLevels, entry.offset, entry.firstChunk, entry.checksum);
+}
+
+void Converter::writePayload(KelpFormat::SectionType section, const std::vector<std::span<const std::byte>>& parts, uint64_t& offset, uint32_t& firstChunk, uint64_t& checksum) {
+    if (!m_options.compress) {
+        Xxh64 hasher;
+        uint64_t partOffset = offset;
+        for (const std::span<const std::byte>& part : parts) {
+            hasher.update(part.data(), part.size());
+            m_writer->write(partOffset, part.data(), part.size());
+            partOffset += part.size();
+        }
+        checksum = hasher.digest();
+        return;
+    }
+
+
+    // Contiguous copy of the payload, to be cut in chunks regardless of the part boundaries
+    std::vector<std::byte> payload;
+    for (const std::span<const std::byte>& part : parts)
+        payload.insert(payload.end(), part.begin(), part.end());
+
+
+    // Chunks compressed independently, so that they can be decompressed (and verified) in parallel on load. Those that don't shrink are stored as is
+    const size_t chunkCount = KelpFormat::chunkCount(payload.size());
+    std::vector<std::vector<std::byte>> chunks(chunkCount);
+    std::vector<uint64_t> chunkChecksums(chunkCount);
+    m_threadPool.parallelFor(chunkCount, [&](size_t i) {
+        const size_t chunkOffset = i * KelpFormat::COMPRESSION_CHUNK_SIZE;
+        const size_t chunkSize = std::min<size_t>(KelpFormat::COMPRESSION_CHUNK_SIZE, payload.size() - chunkOffset);
+
+        chunks[i].resize(chunkSize - 1);
+        const size_t compressedSize = Lz4::compress(payload.data() + chunkOffset, chunkSize, chunks[i].data(), chunks[i].size());
+        if (compressedSize == 0)
+            chunks[i].assign(payload.begin() + static_cast<ptrdiff_t>(chunkOffset), payload.begin() + static_cast<ptrdiff_t>(chunkOffset + chunkSize));
+        else
+            chunks[i].resize(compressedSize);
+
+        chunkChecksums[i] = Xxh64::hash(chunks[i].data(), chunks[i].size());
+    });
+
 
-    // Wait for albedo texture threads to finish before processing alpha textures since they depend on them
-    for (auto& thread : threads) {
-        if (thread.joinable())
-            thread.join();
+    // Placement, in completion order, chunks are stored back to back from the payload offset
+    uint64_t compressedSize = 0;
+    {
+        const std::lock_guard<std::mutex> lock(m_layoutMutex);
+        offset = m_fileCursor;
+        firstChunk = static_cast<uint32_t>(m_chunkEntries.size());
+
+        uint64_t chunkOffset = offset;
+        for (size_t i = 0; i < chunkCount; i++) {
+            const size_t chunkSize = std::min<size_t>(KelpFormat::COMPRESSION_CHUNK_SIZE, payload.size() - (i * KelpFormat::COMPRESSION_CHUNK_SIZE));
+            m_chunkEntries.push_back(KelpFormat::ChunkEntry{ .offset = chunkOffset, .compressedSize = static_cast<uint32_t>(chunks[i].size()), .size = static_cast<uint32_t>(chunkSize), .checksum = chunkChecksums[i] });
+            chunkOffset += chunks[i].size();
+        }
+
+        compressedSize = chunkOffset - offset;
+        m_fileCursor = KelpFormat::alignUp(chunkOffset);
+
+        CompressionStats& stats = m_compressionStats[section];
+        stats.size += payload.size();
+        stats.compressedSize += compressedSize;
+    }
+
+    Xxh64 hasher;
+    uint64_t chunkOffset = offset;
+    for (const std::vector<std::byte>& chunk : chunks) {
+        hasher.update(chunk.data(), chunk.size());
+        m_writer->write(chunkOffset, chunk.data(), chunk.size());
+        chunkOffset += chunk.size();
+    }
+    checksum = hasher.digest();
+}
+
+void Converter::addPayloadSection(KelpFormat::SectionType type, uint64_t offset, uint64_t elementCount, uint32_t flags) {
+    m_sections.push_back(KelpFormat::SectionEntry{
+        .type = type,
+        .flags = flags | (m_options.compress ? KelpFormat::SECTION_FLAG_COMPRESSED : 0),
+        .offset = offset,
+        .size = m_fileCursor - offset,
+        .alignment = KelpFormat::SECTION_ALIGNMENT,
+        .elementCount = elementCount,
+        .checksum = 0,
+    });
+
+    if (m_options.compress) {
+        const CompressionStats& stats = m_compressionStats[type];
+        log() << "Compressed " << KelpFormat::getSectionName(type) << ": " << stats.size / 1024 / 1024 << " MB -> " << stats.compressedSize / 1024 / 1024 << " MB ("
+            << (stats.compressedSize == 0 ? 1.0 : static_cast<double>(stats.size) / static_cast<double>(stats.compressedSize)) << "x)" << std::endl;
     }
+}
+
+void Converter::releaseTexture(Texture& texture) {
+    std::vector<MipLevel>().swap(texture.mipLevels);
+}
+
+bool Converter::isPassedThrough(const Texture& texture) const {
+    return m_textureEntries.at(texture.entryIndex).vkFormat != 0;
+}
+
+void Converter::passThroughTexture(const Texture& texture, Texture* alphaTexture) {
+    const auto [input, gltfTexture] = getSourceTexture(texture.gltfIndex);
+    readImage(getImageSource(input.asset, input.path, gltfTexture), [&](std::span<const uint8_t> bytes) {
+        const Ktx2::Image image = Ktx2::parse(bytes);
+        KelpFormat::TextureEntry& entry = m_textureEntries.at(texture.entryIndex);
+        if (image.levels.size() != entry.mipCount || image.width != entry.width || image.height != entry.height || image.vkFormat != entry.vkFormat)
+            throw std::runtime_error("Texture " + std::to_string(texture.gltfIndex) + " changed since its header was read");
+
+        std::vector<std::span<const std::byte>> parts(image.levels.size());
+        for (size_t i = 0; i < image.levels.size(); i++)
+            parts[i] = std::as_bytes(image.levels[i]);
+
+        writeTexturePayload(entry, parts);
+        if (alphaTexture == nullptr)
+            return;
+
+
+        // Alpha texture extraction from the decoded first level, opaque if the format has none. Its mips are generated like for the decoded albedo textures
+        MipLevel& alphaMipLevel = alphaTexture->mipLevels.emplace_back(MipLevel{
+            .size = { static_cast<int>(image.width), static_cast<int>(image.height) },
+            .data = std::vector<uint8_t>(static_cast<size_t>(image.width) * image.height, UINT8_MAX),
+        });
+
+        if (image.channelCount == 4) {
+            const std::vector<uint8_t> texels = Ktx2::decode(image, 0);
+            for (size_t j = 0; j < alphaMipLevel.data.size(); j++)
+                alphaMipLevel.data[j] = texels[(j * 4) + 3];
+        }
+
+        generateMipmaps(*alphaTexture, 1);
+        writeTexture(*alphaTexture);
+    });
+}
 
-    // Process alpha textures (extract alpha channel from albedo)
-    for (Texture& alphaTexture : m_alphaTextures) {
-        threads.emplace_back([&]() {
-            const auto it = std::ranges::find_if(m_albedoTextures,
-                [&alphaTexture](const Texture& texture) {
-                    return texture.gltfIndex == alphaTexture.gltfIndex;
-                });
+void Converter::loadTextures() {
+    // Every texture is written at its final offset and freed as soon as it is processed, so only the ones in flight are kept in memory
 
-            // Texture first mip level creation from albedo texture
-            const MipLevel& albedoTexture = it->mipLevels[0];
-            alphaTexture.mipLevels.emplace_back(MipLevel{
-                .size = albedoTexture.size,
-                .data = std::vector<uint8_t>(static_cast<size_t>(albedoTexture.size.x * albedoTexture.size.y)),
+    // Process albedo textures (RGBA format), the alpha textures are extracted from them before they are freed
+    m_threadPool.parallelFor(m_albedoTextures.size(), [&](size_t i) {
+        Texture& albedoTexture = m_albedoTextures[i];
+
+        // Alpha texture sharing the same glTF texture, kept in memory until the OMMs are baked
+        const auto it = std::ranges::find_if(m_alphaTextures,
+            [&albedoTexture](const Texture& texture) {
+                return texture.gltfIndex == albedoTexture.gltfIndex;
+            });
+        Texture* alphaTexture = it != m_alphaTextures.end() ? &*it : nullptr;
+
+        if (isPassedThrough(albedoTexture)) {
+            passThroughTexture(albedoTexture, alphaTexture);
+            return;
+        }
+
+        // First mip level creation from loaded data
+        const auto [input, gltfTexture] = getSourceTexture(albedoTexture.gltfIndex);
+        albedoTexture.mipLevels.push_back(loadTexture(input.asset, input.path, gltfTexture, STBI_rgb_alpha));
+
+
+        // Alpha texture extraction
+        if (alphaTexture != nullptr) {
+            const MipLevel& albedoMipLevel = albedoTexture.mipLevels[0];
+            alphaTexture->mipLevels.emplace_back(MipLevel{
+                .size = albedoMipLevel.size,
+                .data = std::vector<uint8_t>(static_cast<size_t>(albedoMipLevel.size.x * albedoMipLevel.size.y)),
             });
 
             // Extracting alpha channel from albedo texture
-            for (int y = 0; y < alphaTexture.mipLevels[0].size.y; ++y) {
-                for (int x = 0; x < alphaTexture.mipLevels[0].size.x; ++x) {
-                    const size_t index = (static_cast<size_t>(y) * alphaTexture.mipLevels[0].size.x) + x;
-                    alphaTexture.mipLevels[0].data[index] = albedoTexture.data[(index * 4) + 3];
+            for (int y = 0; y < alphaTexture->mipLevels[0].size.y; ++y) {
+                for (int x = 0; x < alphaTexture->mipLevels[0].size.x; ++x) {
+                    const size_t index = (static_cast<size_t>(y) * alphaTexture->mipLevels[0].size.x) + x;
+                    alphaTexture->mipLevels[0].data[index] = albedoMipLevel.data[(index * 4) + 3];
                 }
             }
 
-            // Generate mipmaps
-            generateMipmaps(alphaTexture, 1);
-        });
-    }
+            generateMipmaps(*alphaTexture, 1);
+            writeTexture(*alphaTexture);
+        }
+
+
+        // Generate mipmaps, write & clean up
+        generateMipmaps(albedoTexture, 4);
+        writeTexture(albedoTexture);
+        releaseTexture(albedoTexture);
+    });
 
     // Process normal textures
-    for (Texture& normalTexture : m_normalTextures) {
-        threads.emplace_back([&]() {
-            const fastgltf::Texture& gltfTexture = asset.textures[normalTexture.gltfIndex];
-            const auto [size, data] = loadTexture(asset, inputFile, gltfTexture, STBI_rgb_alpha);
-
-            // First mip level creation from loaded data
-            normalTexture.mipLevels.emplace_back(MipLevel{
-                .size = size,
-                .data = std::vector<uint8_t>(static_cast<size_t>(size.x * size.y) * 4),
-            });
-            std::copy(data, data + static_cast<ptrdiff_t>(static_cast<size_t>(size.x * size.y) * 4), normalTexture.mipLevels[0].data.begin());
+    m_threadPool.parallelFor(m_normalTextures.size(), [&](size_t i) {
+        Texture& normalTexture = m_normalTextures[i];
+        if (isPassedThrough(normalTexture)) {
+            passThroughTexture(normalTexture, nullptr);
+            return;
+        }
 
-            // Generate mipmaps & clean up
-            stbi_image_free(data);
-            generateMipmaps(normalTexture, 4);
-        });
-    }
+        // First mip level creation from loaded data
+        const auto [input, gltfTexture] = getSourceTexture(normalTexture.gltfIndex);
+        normalTexture.mipLevels.push_back(loadTexture(input.asset, input.path, gltfTexture, STBI_rgb_alpha));
+
+        // Generate mipmaps, write & clean up
+        generateMipmaps(normalTexture, 4);
+        writeTexture(normalTexture);
+        releaseTexture(normalTexture);
+    });
 
     // Process metallic-roughness textures (encode to 2-channel format)
-    for (Texture& metallicRoughnessTexture : m_metallicRoughnessTextures) {
-        threads.emplace_back([&]() {
-            const fastgltf::Texture& gltfTexture = asset.textures[metallicRoughnessTexture.gltfIndex];
-            const auto [size, data] = loadTexture(asset, inputFile, gltfTexture, STBI_rgb);
-
-            // Texture first mip level creation
-            metallicRoughnessTexture.mipLevels.emplace_back(MipLevel{
-                .size = size,
-                .data = std::vector<uint8_t>(static_cast<size_t>(size.x * size.y) * 2),
-            });
+    m_threadPool.parallelFor(m_metallicRoughnessTextures.size(), [&](size_t i) {
+        Texture& metallicRoughnessTexture = m_metallicRoughnessTextures[i];
+        if (isPassedThrough(metallicRoughnessTexture)) {
+            passThroughTexture(metallicRoughnessTexture, nullptr);
+            return;
+        }
 
-            // Extracting metallic and roughness channels from loaded data
-            for (int y = 0; y < size.y; ++y) {
-                for (int x = 0; x < size.x; ++x) {
-                    const size_t index = (static_cast<size_t>(y) * size.x) + x;
-                    const size_t srcIndex = index * 3;
-                    const size_t encodedIndex = index * 2;
+        const auto [input, gltfTexture] = getSourceTexture(metallicRoughnessTexture.gltfIndex);
+        const MipLevel loadedMipLevel = loadTexture(input.asset, input.path, gltfTexture, STBI_rgb);
+        const glm::ivec2 size = loadedMipLevel.size;
 
-                    metallicRoughnessTexture.mipLevels[0].data[encodedIndex] = data[srcIndex];
-                    metallicRoughnessTexture.mipLevels[0].data[encodedIndex + 1] = data[srcIndex + 1];
-                }
+        // Texture first mip level creation
+        metallicRoughnessTexture.mipLevels.emplace_back(MipLevel{
+            .size = size,
+            .data = std::vector<uint8_t>(static_cast<size_t>(size.x * size.y) * 2),
+        });
+
+        // Extracting metallic and roughness channels from loaded data
+        for (int y = 0; y < size.y; ++y) {
+            for (int x = 0; x < size.x; ++x) {
+                const size_t index = (static_cast<size_t>(y) * size.x) + x;
+                const size_t srcIndex = index * 3;
+                const size_t encodedIndex = index * 2;
+
+                metallicRoughnessTexture.mipLevels[0].data[encodedIndex] = loadedMipLevel.data[srcIndex];
+                metallicRoughnessTexture.mipLevels[0].data[encodedIndex + 1] = loadedMipLevel.data[srcIndex + 1];
             }
+        }
 
-            // Generate mipmaps & clean up
-            generateMipmaps(metallicRoughnessTexture, 2);
-            stbi_image_free(data);
-        });
-    }
+        // Generate mipmaps, write & clean up
+        generateMipmaps(metallicRoughnessTexture, 2);
+        writeTexture(metallicRoughnessTexture);
+        releaseTexture(metallicRoughnessTexture);
+    });
 
     // Process emissive textures
-    for (Texture& emissiveTexture : m_emissiveTextures) {
-        threads.emplace_back([&]() {
-            const fastgltf::Texture& gltfTexture = asset.textures[emissiveTexture.gltfIndex];
-            const auto [size, data] = loadTexture(asset, inputFile, gltfTexture, STBI_rgb_alpha);
-
-            // Texture first mip level creation
-            emissiveTexture.mipLevels.emplace_back(MipLevel{
-                .size = size,
-                .data = std::vector<uint8_t>(static_cast<size_t>(size.x * size.y) * 4),
-            });
-            std::copy(data, data + static_cast<ptrdiff_t>(static_cast<size_t>(size.x * size.y) * 4), emissiveTexture.mipLevels[0].data.begin());
+    m_threadPool.parallelFor(m_emissiveTextures.size(), [&](size_t i) {
+        Texture& emissiveTexture = m_emissiveTextures[i];
+        if (isPassedThrough(emissiveTexture)) {
+            passThroughTexture(emissiveTexture, nullptr);
+            return;
+        }
 
-            // Generate mipmaps & clean up
-            generateMipmaps(emissiveTexture, 4);
-            stbi_image_free(data);
-        });
+        // Texture first mip level creation
+        const auto [input, gltfTexture] = getSourceTexture(emissiveTexture.gltfIndex);
+        emissiveTexture.mipLevels.push_back(loadTexture(input.asset, input.path, gltfTexture, STBI_rgb_alpha));
+
+        // Generate mipmaps, write & clean up
+        generateMipmaps(emissiveTexture, 4);
+        writeTexture(emissiveTexture);
+        releaseTexture(emissiveTexture);
+    });
+}
+
+Mesh Converter::loadPrimitive(const fastgltf::Asset& asset, const fastgltf::Primitive& primitive) {
+    if (!primitive.materialIndex.has_value())
+        throw std::runtime_error("Failed to load primitive: missing material index");
+
+    if (primitive.findAttribute("POSITION") == nullptr)
+        throw std::runtime_error("Failed to load primitive: missing POSITION attribute");
+
+    if (primitive.findAttribute("TEXCOORD_0") == nullptr)
+        throw std::runtime_error("Failed to load primitive: missing TEXCOORD_0 attribute");
+
+    if (primitive.findAttribute("NORMAL") == nullptr)
+        throw std::runtime_error("Failed to load primitive: missing NORMAL attribute");
+
+    const fastgltf::Accessor& positionAccessor = asset.accessors.at(primitive.findAttribute("POSITION")->accessorIndex);
+    const fastgltf::Accessor& normalAccessor = asset.accessors.at(primitive.findAttribute("NORMAL")->accessorIndex);
+    const fastgltf::Accessor& uvAccessor = asset.accessors.at(primitive.findAttribute("TEXCOORD_0")->accessorIndex);
+    const fastgltf::Accessor& indicesAccessor = asset.accessors.at(primitive.indicesAccessor.value());
+
+    if (normalAccessor.count != positionAccessor.count || uvAccessor.count != positionAccessor.count)
+        throw std::runtime_error("Failed to load primitive: attribute counts do not match");
+
+    std::vector<Vertex> vertices(positionAccessor.count);
+    std::vector<uint32_t> indices(indicesAccessor.count);
+
+    // Attributes are written straight into the interleaved vertex array
+    AccessorDecoder::decodeVec3(asset, positionAccessor, &vertices.data()->position, sizeof(Vertex));
+    AccessorDecoder::decodeVec3(asset, normalAccessor, &vertices.data()->normal, sizeof(Vertex));
+    AccessorDecoder::decodeVec2(asset, uvAccessor, &vertices.data()->uv, sizeof(Vertex));
+    AccessorDecoder::decodeIndices(asset, indicesAccessor, indices.data());
+
+
+    // Quantized UVs come with a KHR_texture_transform on the material textures to dequantize them. There is a single UV set, so the transform is
+    // only baked in when every texture reads TEXCOORD_0 through the same one. Other transforms (tiling, atlases) can't be represented and are ignored
+    const fastgltf::Material& material = asset.materials.at(primitive.materialIndex.value());
+    std::vector<const fastgltf::TextureInfo*> textureInfos;
+    if (material.pbrData.baseColorTexture.has_value())
+        textureInfos.push_back(&material.pbrData.baseColorTexture.value());
+    if (material.normalTexture.has_value())
+        textureInfos.push_back(&material.normalTexture.value());
+    if (material.pbrData.metallicRoughnessTexture.has_value())
+        textureInfos.push_back(&material.pbrData.metallicRoughnessTexture.value());
+    if (material.emissiveTexture.has_value())
+        textureInfos.push_back(&material.emissiveTexture.value());
+
+    const auto texCoordIndex = [](const fastgltf::TextureInfo& textureInfo) {
+        return textureInfo.transform != nullptr && textureInfo.transform->texCoordIndex.has_value() ? textureInfo.transform->texCoordIndex.value() : textureInfo.texCoordIndex;
+    };
+    const auto hasSameTransform = [](const fastgltf::TextureInfo& a, const fastgltf::TextureInfo& b) {
+        if (a.transform == nullptr || b.transform == nullptr)
+            return a.transform == b.transform;
+        return a.transform->uvOffset.x() == b.transform->uvOffset.x() && a.transform->uvOffset.y() == b.transform->uvOffset.y()
+            && a.transform->uvScale.x() == b.transform->uvScale.x() && a.transform->uvScale.y() == b.transform->uvScale.y()
+            && a.transform->rotation == b.transform->rotation;
+    };
+
+    const bool hasTransform = std::ranges::any_of(textureInfos, [](const fastgltf::TextureInfo* textureInfo) { return textureInfo->transform != nullptr; });
+    const bool isQuantized = uvAccessor.componentType != fastgltf::ComponentType::Float;
+    const bool isShared = std::ranges::all_of(textureInfos, [&](const fastgltf::TextureInfo* textureInfo) {
+        return texCoordIndex(*textureInfo) == 0 && hasSameTransform(*textureInfo, *textureInfos[0]);
+    });
+
+    if (hasTransform && isQuantized && !isShared)
+        throw std::runtime_error("Failed to load primitive: the quantized UVs of material " + std::to_string(primitive.materialIndex.value()) + " are dequantized by different texture transforms");
+    if (hasTransform && !isQuantized)
+        m_ignoredTextureTransforms = true;
+
+    if (hasTransform && isQuantized) {
+        const fastgltf::TextureTransform& transform = *textureInfos[0]->transform;
+        const glm::vec2 offset(transform.uvOffset.x(), transform.uvOffset.y());
+        const glm::vec2 scale(transform.uvScale.x(), transform.uvScale.y());
+        const float cosine = std::cos(transform.rotation);
+        const float sine = std::sin(transform.rotation);
+
+        for (Vertex& vertex : vertices) {
+            const glm::vec2 uv = vertex.uv * scale;
+            vertex.uv = offset + glm::vec2((cosine * uv.x) + (sine * uv.y), (cosine * uv.y) - (sine * uv.x));
+        }
     }
 
-    // Wait for all threads to finish
-    for (auto& thread : threads) {
-        if (thread.joinable())
-            thread.join();
+    return Mesh{
+        .vertices = std::move(vertices),
+        .indices = std::move(indices),
+        .materialIndex = static_cast<int>(primitive.materialIndex.value()),
+        .ommIndex = -1,
+    };
+}
+
+void Converter::loadMeshes() {
+    // Flatten the primitives of every input so that each of them gets a fixed output slot, keeping the output order deterministic
+    struct PrimitiveRef {
+        const Input* input;
+        uint32_t meshIndex;
+        uint32_t primitiveIndex;
+    };
+
+    std::vector<PrimitiveRef> primitiveRefs;
+    std::vector<int> primitiveMeshes;   // glTF mesh of each primitive, among the meshes of every input
+    for (const Input& input : m_inputs) {
+        for (uint32_t i = 0; i < input.asset.meshes.size(); i++) {
+            for (uint32_t j = 0; j < input.asset.meshes[i].primitives.size(); j++) {
+                primitiveRefs.push_back(PrimitiveRef{ .input = &input, .meshIndex = i, .primitiveIndex = j });
+                primitiveMeshes.push_back(input.firstMesh + static_cast<int>(i));
+            }
+        }
     }
+
+
+    // Primitives extraction
+    m_meshes.resize(primitiveRefs.size());
+    m_threadPool.parallelFor(primitiveRefs.size(), [&](size_t i) {
+        const PrimitiveRef& ref = primitiveRefs[i];
+        Mesh mesh = loadPrimitive(ref.input->asset, ref.input->asset.meshes[ref.meshIndex].primitives[ref.primitiveIndex]);
+        mesh.materialIndex = m_gltfMaterialIndices.at(static_cast<size_t>(ref.input->firstMaterial + mesh.materialIndex));
+        m_meshes[i] = std::move(mesh);
+    });
+
+    if (m_ignoredTextureTransforms)
+        std::cerr << "Warning: texture transforms on float UVs are ignored, only those dequantizing UVs are baked in" << std::endl;
+
+    m_gltfMeshPrimitives.resize(static_cast<size_t>(m_inputs.back().firstMesh) + m_inputs.back().asset.meshes.size());
+    deduplicateMeshes(primitiveMeshes);
 }
 
-void Converter::loadMeshes(fastgltf::Asset& asset) {
-    for (uint32_t i = 0; i < asset.meshes.size(); i++) {
-        const fastgltf::Mesh& gltfMesh = asset.meshes[i];
+void Converter::deduplicateMeshes(const std::vector<int>& primitiveMeshes) {
+    // Primitives with the same geometry & material are kept once, the glTF meshes using them all instance the same output mesh
+    std::vector<uint64_t> hashes(m_meshes.size());
+    m_threadPool.parallelFor(m_meshes.size(), [&](size_t i) {
+        const Mesh& mesh = m_meshes[i];
+        Xxh64 hasher(static_cast<uint64_t>(mesh.materialIndex));
+        hasher.update(mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+        hasher.update(mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+        hashes[i] = hasher.digest();
+    });
 
-        for (const auto& primitive : gltfMesh.primitives) {
-            if (!primitive.materialIndex.has_value())
-                throw std::runtime_error("Failed to load primitive: missing material index");
+    const auto isSameMesh = [](const Mesh& a, const Mesh& b) {
+        return a.materialIndex == b.materialIndex
+            && a.indices == b.indices
+            && a.vertices.size() == b.vertices.size()
+            && std::memcmp(a.vertices.data(), b.vertices.data(), a.vertices.size() * sizeof(Vertex)) == 0;
+    };
 
-            if (primitive.findAttribute("POSITION") == nullptr)
-                throw std::runtime_error("Failed to load primitive: missing POSITION attribute");
+    std::vector<Mesh> meshes;
+    std::multimap<uint64_t, int> meshesByHash;
+    for (size_t i = 0; i < m_meshes.size(); i++) {
+        const auto [begin, end] = meshesByHash.equal_range(hashes[i]);
+        const auto it = std::find_if(begin, end, [&](const auto& entry) {
+            return isSameMesh(meshes[entry.second], m_meshes[i]);
+        });
 
-            if (primitive.findAttribute("TEXCOORD_0") == nullptr)
-                throw std::runtime_error("Failed to load primitive: missing TEXCOORD_0 attribute");
+        int meshIndex = 0;
+        if (it != end) {
+            meshIndex = it->second;
+        } else {
+            meshIndex = static_cast<int>(meshes.size());
+            meshesByHash.emplace(hashes[i], meshIndex);
+            meshes.push_back(std::move(m_meshes[i]));
+        }
+        m_gltfMeshPrimitives[primitiveMeshes[i]].push_back(meshIndex);
+    }
 
-            if (primitive.findAttribute("NORMAL") == nullptr)
-                throw std::runtime_error("Failed to load primitive: missing NORMAL attribute");
+    if (meshes.size() < m_meshes.size())
+        log() << "Merged " << m_meshes.size() - meshes.size() << " duplicate meshes" << std::endl;
+    m_meshes = std::move(meshes);
+}
 
-            const fastgltf::Accessor& positionAccessor = asset.accessors.at(primitive.findAttribute("POSITION")->accessorIndex);
-            const fastgltf::Accessor& normalAccessor = asset.accessors.at(primitive.findAttribute("NORMAL")->accessorIndex);
-            const fastgltf::Accessor& uvAccessor = asset.accessors.at(primitive.findAttribute("TEXCOORD_0")->accessorIndex);
-            const fastgltf::Accessor& indicesAccessor = asset.accessors.at(primitive.indicesAccessor.value());
+void Converter::generateLods(Mesh& mesh) {
+    // Each LOD is simplified from the previous one, halving the triangle count until the error budget or a minimal size is reached
+    constexpr size_t MIN_LOD_TRIANGLE_COUNT = 64;
+    constexpr float LOD_REDUCTION_RATIO = 0.5F;
+    constexpr float MIN_LOD_REDUCTION = 0.85F;      // A LOD must remove at least 15% of its parent triangles to be kept
+    constexpr float MAX_LOD_ERROR = 0.05F;          // Relative to the mesh extent
 
-            std::vector<Vertex> vertices(positionAccessor.count);
-            std::vector<uint32_t> indices(indicesAccessor.count);
+    mesh.lods.reserve(KelpFormat::MAX_LOD_COUNT);     // previousIndices points into the LOD array
+    const std::vector<uint32_t>* previousIndices = &mesh.indices;
+    float previousError = 0;
 
-            fastgltf::iterateAccessorWithIndex<fastgltf::math::fvec3>(asset, positionAccessor, [&](const fastgltf::math::fvec3& value, size_t index) {
-                vertices[index].position = {value.x(), value.y(), value.z()};
-            });
+    while (mesh.lods.size() < KelpFormat::MAX_LOD_COUNT && previousIndices->size() / 3 > MIN_LOD_TRIANGLE_COUNT) {
+        const size_t targetIndexCount = static_cast<size_t>(static_cast<float>(previousIndices->size() / 3) * LOD_REDUCTION_RATIO) * 3;
+        MeshSimplifier::Result result = MeshSimplifier::simplify(mesh.vertices, *previousIndices, targetIndexCount, MAX_LOD_ERROR);
 
-            fastgltf::iterateAccessorWithIndex<fastgltf::math::fvec3>(asset, normalAccessor, [&](const fastgltf::math::fvec3& value, size_t index) {
-                vertices[index].normal = {value.x(), value.y(), value.z()};
-            });
+        if (result.indices.empty() || static_cast<float>(result.indices.size()) > static_cast<float>(previousIndices->size()) * MIN_LOD_REDUCTION)
+            break;
 
-            fastgltf::iterateAccessorWithIndex<fastgltf::math::fvec2>(asset, uvAccessor, [&](const fastgltf::math::fvec2& value, size_t index) {
-                vertices[index].uv = {value.x(), value.y()};
-            });
+        previousError += result.error;
+        mesh.lods.push_back(MeshLod{ .indices = std::move(result.indices), .error = previousError });
+        previousIndices = &mesh.lods.back().indices;
+    }
+}
 
-            fastgltf::iterateAccessorWithIndex<uint32_t>(asset, indicesAccessor, [&](const uint32_t& value, size_t index) {
-                indices[index] = value;
-            });
+void Converter::generateMeshLods() {
+    m_threadPool.parallelFor(m_meshes.size(), [&](size_t i) {
+        generateLods(m_meshes[i]);
+    });
 
-            m_meshes.push_back(Mesh{
-                .vertices = std::move(vertices),
-                .indices = std::move(indices),
-                .materialIndex = static_cast<int>(primitive.materialIndex.value()),
-                .ommIndex = -1,
-                .gltfIndex = static_cast<int>(i),
-            });
-        }
+    size_t baseTriangleCount = 0;
+    size_t lodTriangleCount = 0;
+    for (const Mesh& mesh : m_meshes) {
+        baseTriangleCount += mesh.indices.size() / 3;
+        for (const MeshLod& lod : mesh.lods)
+            lodTriangleCount += lod.indices.size() / 3;
     }
+
+    log() << "Generated " << lodTriangleCount << " LOD triangles for " << baseTriangleCount << " base triangles" << std::endl;
 }
 
 void Converter::bakeOpacityMicromaps() {
@@ -513,9 +1348,14 @@ void Converter::bakeOpacityMicromaps() {
     res = omm::DestroyBaker(bakerHandle);
     if (res != omm::Result::SUCCESS)
         throw std::runtime_error("Failed to destroy OMM baker: " + std::to_string(static_cast<int>(res)));
+
+
+    // The alpha textures are already written, they were only kept for the baking
+    for (Texture& alphaTexture : m_alphaTextures)
+        releaseTexture(alphaTexture);
 }
 
-void Converter::loadGltfNode(const std::filesystem::path& filePath, const fastgltf::Asset& asset, const fastgltf::Node& node, const glm::mat4& parentTransform) {
+void Converter::loadGltfNode(const Input& input, const fastgltf::Node& node, const glm::mat4& parentTransform) {
     const glm::mat4 localTransform = std::visit(fastgltf::visitor {
         [&](const fastgltf::math::fmat4x4& matrix) -> glm::mat4 {
             return parentTransform * glm::make_mat4x4(matrix.data());
@@ -532,180 +1372,360 @@ void Converter::loadGltfNode(const std::filesystem::path& filePath, const fastgl
     }, node.transform);
 
     if (node.meshIndex.has_value()) {
-        for (int i = 0; i < m_meshes.size(); i++) {
-            if (node.meshIndex.value() == m_meshes[i].gltfIndex) {
-                m_meshInstances.push_back(KelpMeshInstance{
-                    .transform = localTransform,
-                    .meshIndex = i
-                });
-            }
+        for (const int meshIndex : m_gltfMeshPrimitives.at(static_cast<size_t>(input.firstMesh) + node.meshIndex.value())) {
+            m_meshInstances.push_back(KelpFormat::InstanceEntry{
+                .transform = localTransform,
+                .meshIndex = meshIndex
+            });
         }
     }
 
     for (const size_t childIndex : node.children) {
-        const fastgltf::Node& childNode = asset.nodes.at(childIndex);
-        loadGltfNode(filePath, asset, childNode, localTransform);
+        const fastgltf::Node& childNode = input.asset.nodes.at(childIndex);
+        loadGltfNode(input, childNode, localTransform);
     }
 }
 
-void Converter::loadGltfScene(const std::filesystem::path& filePath, const fastgltf::Asset& asset, const fastgltf::Scene& scene) {
-    for (const size_t nodeIndice : scene.nodeIndices) {
-        const fastgltf::Node& node = asset.nodes.at(nodeIndice);
-        loadGltfNode(filePath, asset, node);
+void Converter::loadGltfScene(const Input& input) {
+    if (input.asset.scenes.empty())
+        throw std::runtime_error("Failed to load \"" + input.path.string() + "\": no scene found");
+
+    for (const size_t nodeIndice : input.asset.scenes[0].nodeIndices) {
+        const fastgltf::Node& node = input.asset.nodes.at(nodeIndice);
+        loadGltfNode(input, node, input.transform);
     }
 }
 
-void Converter::convert(const std::filesystem::path& inputFile, const std::filesystem::path& outputFile) {
-    fastgltf::Asset asset;
+void Converter::partitionCells() {
+    if (m_meshInstances.empty())
+        return;
+
+    // World space bounds of every instance, from the bounding sphere of its mesh
+    std::vector<std::pair<glm::vec3, glm::vec3>> instanceBounds(m_meshInstances.size());
+    glm::vec3 sceneMin(std::numeric_limits<float>::max());
+    glm::vec3 sceneMax(std::numeric_limits<float>::lowest());
+    for (size_t i = 0; i < m_meshInstances.size(); i++) {
+        const KelpFormat::InstanceEntry& instance = m_meshInstances[i];
+        const KelpFormat::MeshEntry& mesh = m_meshEntries.at(static_cast<size_t>(instance.meshIndex));
+        const glm::vec3 center = glm::vec3(instance.transform * glm::vec4(mesh.boundsCenter, 1));
+        const float scale = std::max({ glm::length(glm::vec3(instance.transform[0])), glm::length(glm::vec3(instance.transform[1])), glm::length(glm::vec3(instance.transform[2])) });
+        const glm::vec3 extent(mesh.boundsRadius * scale);
+
+        instanceBounds[i] = { center - extent, center + extent };
+        sceneMin = glm::min(sceneMin, instanceBounds[i].first);
+        sceneMax = glm::max(sceneMax, instanceBounds[i].second);
+    }
 
-    funcTime("Converted file", [&]() {
-        funcTime("Parsed file", [&]() {
-            asset = parseFile(inputFile);
-        });
 
-        funcTime("Loaded materials", [&]() {
-            loadMaterials(asset);
-        });
+    // Every instance belongs to the grid cell holding the center of its bounds, so cells may overlap a bit but never split an instance
+    const glm::vec3 sceneExtent = sceneMax - sceneMin;
+    float cellSize = m_options.cellSize > 0 ? m_options.cellSize : std::max({ sceneExtent.x, sceneExtent.y, sceneExtent.z }) / DEFAULT_CELLS_PER_AXIS;
+    if (cellSize <= 0)
+        cellSize = 1;
 
-        funcTime("Loaded textures", [&]() {
-            initTextureCollections();
-            loadTextures(asset, inputFile);
-        });
+    std::map<std::array<int32_t, 3>, std::vector<uint32_t>> grid;
+    for (size_t i = 0; i < m_meshInstances.size(); i++) {
+        const glm::vec3 center = (instanceBounds[i].first + instanceBounds[i].second) * 0.5F;
+        const glm::ivec3 coordinates = glm::ivec3(glm::floor((center - sceneMin) / cellSize));
+        grid[{ coordinates.x, coordinates.y, coordinates.z }].push_back(static_cast<uint32_t>(i));
+    }
 
-        funcTime("Loaded meshes", [&]() {
-            loadMeshes(asset);
-        });
 
-        funcTime("Baked opacity micromaps", [&]() {
-            bakeOpacityMicromaps();
-        });
+    // Instances of a cell are made contiguous, followed in the resource list by the meshes & textures it needs
+    std::vector<KelpFormat::InstanceEntry> instances;
+    instances.reserve(m_meshInstances.size());
+    const auto collections = getTextureCollections();
+
+    for (const auto& [coordinates, cellInstances] : grid) {
+        KelpFormat::CellEntry cell{
+            .boundsMin = glm::vec3(std::numeric_limits<float>::max()),
+            .firstInstance = static_cast<uint32_t>(instances.size()),
+            .boundsMax = glm::vec3(std::numeric_limits<float>::lowest()),
+            .instanceCount = static_cast<uint32_t>(cellInstances.size()),
+            .firstResource = static_cast<uint32_t>(m_cellResources.size()),
+            .meshCount = 0,
+            .textureCount = 0,
+        };
 
-        funcTime("Loaded glTF scene", [&]() {
-            loadGltfScene(inputFile, asset, asset.scenes[0]);
-        });
-    });
+        std::vector<uint32_t> meshes;
+        for (const uint32_t instanceIndex : cellInstances) {
+            instances.push_back(m_meshInstances[instanceIndex]);
+            meshes.push_back(static_cast<uint32_t>(m_meshInstances[instanceIndex].meshIndex));
+            cell.boundsMin = glm::min(cell.boundsMin, instanceBounds[instanceIndex].first);
+            cell.boundsMax = glm::max(cell.boundsMax, instanceBounds[instanceIndex].second);
+        }
+        std::ranges::sort(meshes);
+        meshes.erase(std::ranges::unique(meshes).begin(), meshes.end());
+
+        std::vector<uint32_t> textures;
+        for (const uint32_t meshIndex : meshes) {
+            const Material& material = m_materials.at(m_meshEntries[meshIndex].materialIndex);
+            const std::array<int, static_cast<size_t>(KelpFormat::TextureCollection::Count)> materialTextures = {
+                material.baseColorTexture,
+                material.alphaTexture,
+                material.normalTexture,
+                material.metallicRoughnessTexture,
+                material.emissiveTexture,
+            };
+            for (size_t collection = 0; collection < materialTextures.size(); collection++) {
+                if (materialTextures[collection] != -1)
+                    textures.push_back(static_cast<uint32_t>(collections[collection].textures->at(static_cast<size_t>(materialTextures[collection])).entryIndex));
+            }
+        }
+        std::ranges::sort(textures);
+        textures.erase(std::ranges::unique(textures).begin(), textures.end());
+
+        cell.meshCount = static_cast<uint32_t>(meshes.size());
+        cell.textureCount = static_cast<uint32_t>(textures.size());
+        m_cellResources.insert(m_cellResources.end(), meshes.begin(), meshes.end());
+        m_cellResources.insert(m_cellResources.end(), textures.begin(), textures.end());
+        m_cells.push_back(cell);
+    }
+    m_meshInstances = std::move(instances);
 
+    log() << "Partitioned " << m_meshInstances.size() << " instances into " << m_cells.size() << " cells of " << cellSize << " units" << std::endl;
+}
+
+std::vector<std::byte> Converter::encodeMesh(Mesh& mesh) {
+    // Vertices reordered by first use, so that consecutive indices stay close and consecutive vertices are spatially coherent.
+    // Triangles keep their order, the opacity micromaps still match
+    std::vector<uint32_t> remap(mesh.vertices.size(), UINT32_MAX);
+    std::vector<Vertex> vertices;
+    vertices.reserve(mesh.vertices.size());
+    for (const uint32_t index : mesh.indices) {
+        if (remap[index] == UINT32_MAX) {
+            remap[index] = static_cast<uint32_t>(vertices.size());
+            vertices.push_back(mesh.vertices[index]);
+        }
+    }
+    for (size_t i = 0; i < mesh.vertices.size(); i++) {
+        if (remap[i] == UINT32_MAX) {
+            remap[i] = static_cast<uint32_t>(vertices.size());
+            vertices.push_back(mesh.vertices[i]);
+        }
+    }
 
-    // Opening file to write in
-    std::ofstream outFile(outputFile, std::ios::binary);
-    if (!outFile.is_open())
-        throw std::runtime_error("Failed to open output file: " + outputFile.string());
+    mesh.vertices = std::move(vertices);
+    for (uint32_t& index : mesh.indices)
+        index = remap[index];
+    for (MeshLod& lod : mesh.lods) {
+        for (uint32_t& index : lod.indices)
+            index = remap[index];
+    }
 
 
-    // Writing textures
-    const size_t albedoCount = m_albedoTextures.size();
-    outFile.write(reinterpret_cast<const char*>(&albedoCount), sizeof(size_t));
-    for (const Texture& albedoTexture : m_albedoTextures) {
-        const size_t mipLevelCount = albedoTexture.mipLevels.size();
-        outFile.write(reinterpret_cast<const char*>(&mipLevelCount), sizeof(size_t));
+    // Payload: header, then the vertex, index and LOD index streams
+    std::vector<std::vector<std::byte>> streams = { MeshCodec::encodeVertices(mesh.vertices), MeshCodec::encodeIndices(mesh.indices) };
+    for (const MeshLod& lod : mesh.lods)
+        streams.push_back(MeshCodec::encodeIndices(lod.indices));
 
-        for (size_t i = 0; i < mipLevelCount; ++i) {
-            const MipLevel& mipLevel = albedoTexture.mipLevels[i];
-            outFile.write(reinterpret_cast<const char*>(&mipLevel.size), sizeof(glm::ivec2));
-            outFile.write(reinterpret_cast<const char*>(mipLevel.data.data()), static_cast<std::streamsize>(sizeof(uint8_t) * mipLevel.data.size()));
-        }
+    KelpFormat::EncodedMeshHeader header{};
+    std::vector<std::byte> payload(sizeof(KelpFormat::EncodedMeshHeader));
+    for (size_t i = 0; i < streams.size(); i++) {
+        header.streamSizes[i] = streams[i].size();
+        payload.insert(payload.end(), streams[i].begin(), streams[i].end());
     }
+    std::memcpy(payload.data(), &header, sizeof(KelpFormat::EncodedMeshHeader));
 
-    const size_t alphaCount = m_alphaTextures.size();
-    outFile.write(reinterpret_cast<const char*>(&alphaCount), sizeof(size_t));
-    for (const Texture& alphaTexture : m_alphaTextures) {
-        const size_t mipLevelCount = alphaTexture.mipLevels.size();
-        outFile.write(reinterpret_cast<const char*>(&mipLevelCount), sizeof(size_t));
+    return payload;
+}
 
-        for (size_t i = 0; i < mipLevelCount; ++i) {
-            const MipLevel& mipLevel = alphaTexture.mipLevels[i];
-            outFile.write(reinterpret_cast<const char*>(&mipLevel.size), sizeof(glm::ivec2));
-            outFile.write(reinterpret_cast<const char*>(mipLevel.data.data()), static_cast<std::streamsize>(sizeof(uint8_t) * mipLevel.data.size()));
+void Converter::writeMeshes() {
+    // Bounds, and encoding of the payloads whose size must be known before they are laid out
+    m_meshEntries.resize(m_meshes.size());
+    std::vector<std::vector<std::byte>> encodedPayloads(m_options.encodeMeshes ? m_meshes.size() : 0);
+    std::atomic<uint64_t> encodedSize = 0;
+
+    m_threadPool.parallelFor(m_meshes.size(), [&](size_t i) {
+        Mesh& mesh = m_meshes[i];
+        KelpFormat::MeshEntry& entry = m_meshEntries[i];
+
+        // Bounding sphere, used by the viewer for LOD selection
+        glm::vec3 boundsMin = mesh.vertices.empty() ? glm::vec3(0) : mesh.vertices[0].position;
+        glm::vec3 boundsMax = boundsMin;
+        for (const Vertex& vertex : mesh.vertices) {
+            boundsMin = glm::min(boundsMin, vertex.position);
+            boundsMax = glm::max(boundsMax, vertex.position);
         }
-    }
 
-    const size_t normalCount = m_normalTextures.size();
-    outFile.write(reinterpret_cast<const char*>(&normalCount), sizeof(size_t));
-    for (const Texture& normalTexture : m_normalTextures) {
-        const size_t mipLevelCount = normalTexture.mipLevels.size();
-        outFile.write(reinterpret_cast<const char*>(&mipLevelCount), sizeof(size_t));
+        entry.boundsCenter = (boundsMin + boundsMax) * 0.5F;
+        for (const Vertex& vertex : mesh.vertices)
+            entry.boundsRadius = std::max(entry.boundsRadius, glm::length(vertex.position - entry.boundsCenter));
 
-        for (size_t i = 0; i < mipLevelCount; ++i) {
-            const MipLevel& mipLevel = normalTexture.mipLevels[i];
-            outFile.write(reinterpret_cast<const char*>(&mipLevel.size), sizeof(glm::ivec2));
-            outFile.write(reinterpret_cast<const char*>(mipLevel.data.data()), static_cast<std::streamsize>(sizeof(uint8_t) * mipLevel.data.size()));
+        if (m_options.encodeMeshes) {
+            encodedPayloads[i] = encodeMesh(mesh);
+            encodedSize += encodedPayloads[i].size();
         }
-    }
+    });
 
-    const size_t metallicRoughnessCount = m_metallicRoughnessTextures.size();
-    outFile.write(reinterpret_cast<const char*>(&metallicRoughnessCount), sizeof(size_t));
-    for (const Texture& metallicRoughnessTexture : m_metallicRoughnessTextures) {
-        const size_t mipLevelCount = metallicRoughnessTexture.mipLevels.size();
-        outFile.write(reinterpret_cast<const char*>(&mipLevelCount), sizeof(size_t));
 
-        for (size_t i = 0; i < mipLevelCount; ++i) {
-            const MipLevel& mipLevel = metallicRoughnessTexture.mipLevels[i];
-            outFile.write(reinterpret_cast<const char*>(&mipLevel.size), sizeof(glm::ivec2));
-            outFile.write(reinterpret_cast<const char*>(mipLevel.data.data()), static_cast<std::streamsize>(sizeof(uint8_t) * mipLevel.data.size()));
+    // Mesh directory, laid out once the LOD index counts and encoded sizes are known so the output stays deterministic
+    const uint64_t meshDataOffset = m_fileCursor;
+    uint64_t decodedSize = 0;
+    for (size_t i = 0; i < m_meshes.size(); i++) {
+        const Mesh& mesh = m_meshes[i];
+        KelpFormat::MeshEntry& entry = m_meshEntries[i];
+
+        entry.materialIndex = static_cast<uint32_t>(mesh.materialIndex);
+        entry.ommIndex = mesh.ommIndex;
+        entry.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+        entry.indexCount = static_cast<uint32_t>(mesh.indices.size());
+        entry.lodCount = static_cast<uint32_t>(mesh.lods.size());
+        for (size_t j = 0; j < mesh.lods.size(); j++)
+            entry.lods[j] = KelpFormat::MeshLodEntry{ .error = mesh.lods[j].error, .indexCount = static_cast<uint32_t>(mesh.lods[j].indices.size()) };
+
+        decodedSize += KelpFormat::meshPayloadSize(entry);
+        entry.size = m_options.encodeMeshes ? encodedPayloads[i].size() : KelpFormat::meshPayloadSize(entry);
+        if (!m_options.compress) {
+            entry.offset = m_fileCursor;
+            m_fileCursor = KelpFormat::alignUp(m_fileCursor + entry.size);
         }
     }
 
-    const size_t emissiveCount = m_emissiveTextures.size();
-    outFile.write(reinterpret_cast<const char*>(&emissiveCount), sizeof(size_t));
-    for (const Texture& emissiveTexture : m_emissiveTextures) {
-        const size_t mipLevelCount = emissiveTexture.mipLevels.size();
-        outFile.write(reinterpret_cast<const char*>(&mipLevelCount), sizeof(size_t));
-
-        for (size_t i = 0; i < mipLevelCount; ++i) {
-            const MipLevel& mipLevel = emissiveTexture.mipLevels[i];
-            outFile.write(reinterpret_cast<const char*>(&mipLevel.size), sizeof(glm::ivec2));
-            outFile.write(reinterpret_cast<const char*>(mipLevel.data.data()), static_cast<std::streamsize>(sizeof(uint8_t) * mipLevel.data.size()));
-        }
+    if (m_options.encodeMeshes) {
+        log() << "Encoded meshes: " << decodedSize / 1024 / 1024 << " MB -> " << encodedSize / 1024 / 1024 << " MB ("
+            << (encodedSize == 0 ? 1.0 : static_cast<double>(decodedSize) / static_cast<double>(encodedSize)) << "x)" << std::endl;
     }
 
 
-    // Writing materials
-    const size_t materialCount = m_materials.size();
-    outFile.write(reinterpret_cast<const char*>(&materialCount), sizeof(size_t));
-    outFile.write(reinterpret_cast<const char*>(m_materials.data()), static_cast<std::streamsize>(sizeof(Material) * materialCount));
+    // Payload writing & clean up, only the mesh metadata is kept afterwards
+    m_threadPool.parallelFor(m_meshes.size(), [&](size_t i) {
+        Mesh& mesh = m_meshes[i];
+        KelpFormat::MeshEntry& entry = m_meshEntries[i];
 
+        // Payload: vertices, indices, then every LOD index buffer, or their encoded streams
+        std::vector<std::span<const std::byte>> parts;
+        if (m_options.encodeMeshes) {
+            parts.push_back(std::as_bytes(std::span(encodedPayloads[i])));
+        } else {
+            parts = { std::as_bytes(std::span(mesh.vertices)), std::as_bytes(std::span(mesh.indices)) };
+            for (const MeshLod& lod : mesh.lods)
+                parts.push_back(std::as_bytes(std::span(lod.indices)));
+        }
+        writePayload(KelpFormat::SectionType::MeshData, parts, entry.offset, entry.firstChunk, entry.checksum);
 
-    // Writing OMMs
+        std::vector<Vertex>().swap(mesh.vertices);
+        std::vector<uint32_t>().swap(mesh.indices);
+        std::vector<MeshLod>().swap(mesh.lods);
+        if (m_options.encodeMeshes)
+            std::vector<std::byte>().swap(encodedPayloads[i]);
+    });
+
+    addPayloadSection(KelpFormat::SectionType::MeshData, meshDataOffset, m_meshEntries.size(), m_options.encodeMeshes ? KelpFormat::SECTION_FLAG_ENCODED_MESHES : 0);
+}
+
+void Converter::writeKelpFile() {
+    // OMM blob
     const omm::Cpu::BlobDesc* blobDesc = nullptr;
     omm::Result res = omm::Cpu::GetSerializedResultDesc(m_serializedOmms, &blobDesc);
     if (res != omm::Result::SUCCESS)
         throw std::runtime_error("Failed to get serialized OMM result desc: " + std::to_string(static_cast<int>(res)));
 
-    const size_t blobSize = blobDesc->size;
-    outFile.write(reinterpret_cast<const char*>(&blobSize), sizeof(size_t));
-    outFile.write(reinterpret_cast<const char*>(blobDesc->data), static_cast<std::streamsize>(sizeof(uint8_t) * blobSize));
 
+    // Metadata sections, after the payloads since their content is only final once everything else is processed
+    const auto writeSection = [&](KelpFormat::SectionType type, const void* data, uint64_t size, uint64_t elementCount) {
+        m_sections.push_back(KelpFormat::SectionEntry{ .type = type, .flags = 0, .offset = m_fileCursor, .size = size, .alignment = KelpFormat::SECTION_ALIGNMENT, .elementCount = elementCount, .checksum = Xxh64::hash(data, size) });
+        m_writer->write(m_fileCursor, data, size);
+        m_fileCursor = KelpFormat::alignUp(m_fileCursor + size);
+    };
+
+    writeSection(KelpFormat::SectionType::TextureDirectory, m_textureEntries.data(), m_textureEntries.size() * sizeof(KelpFormat::TextureEntry), m_textureEntries.size());
+    writeSection(KelpFormat::SectionType::Materials, m_materials.data(), m_materials.size() * sizeof(Material), m_materials.size());
+    writeSection(KelpFormat::SectionType::OpacityMicromaps, blobDesc->data, blobDesc->size, 1);
+    writeSection(KelpFormat::SectionType::MeshDirectory, m_meshEntries.data(), m_meshEntries.size() * sizeof(KelpFormat::MeshEntry), m_meshEntries.size());
+    writeSection(KelpFormat::SectionType::MeshInstances, m_meshInstances.data(), m_meshInstances.size() * sizeof(KelpFormat::InstanceEntry), m_meshInstances.size());
+    writeSection(KelpFormat::SectionType::ChunkDirectory, m_chunkEntries.data(), m_chunkEntries.size() * sizeof(KelpFormat::ChunkEntry), m_chunkEntries.size());
+    writeSection(KelpFormat::SectionType::Cells, m_cells.data(), m_cells.size() * sizeof(KelpFormat::CellEntry), m_cells.size());
+    writeSection(KelpFormat::SectionType::CellResources, m_cellResources.data(), m_cellResources.size() * sizeof(uint32_t), m_cellResources.size());
+
+    if (m_sections.size() != SECTION_COUNT)
+        throw std::runtime_error("Unexpected section count: " + std::to_string(m_sections.size()));
+
+
+    // Header & TOC, in the block reserved at the start of the file
+    const KelpFormat::FileHeader header{
+        .magic = KelpFormat::MAGIC,
+        .version = KelpFormat::VERSION,
+        .sectionCount = static_cast<uint32_t>(m_sections.size()),
+        .tocOffset = sizeof(KelpFormat::FileHeader),
+        .fileSize = m_fileCursor,
+        .tocChecksum = Xxh64::hash(m_sections.data(), m_sections.size() * sizeof(KelpFormat::SectionEntry)),
+    };
+
+    m_writer->write(0, &header, sizeof(KelpFormat::FileHeader));
+    m_writer->write(header.tocOffset, m_sections.data(), m_sections.size() * sizeof(KelpFormat::SectionEntry));
+    m_writer->finish(header.fileSize);
+    m_writer.reset();
+
+
+    // OMM cleanup
     res = omm::Cpu::DestroySerializedResult(m_serializedOmms);
     if (res != omm::Result::SUCCESS)
         throw std::runtime_error("Failed to destroy serialized OMM result: " + std::to_string(static_cast<int>(res)));
+}
 
+void Converter::convert(const std::filesystem::path& inputFile, const std::filesystem::path& outputFile, const ConversionOptions& options) {
+    convertBundle({ BundleInput{ .path = inputFile } }, outputFile, options);
+}
 
-    // Writing meshes
-    const size_t meshCount = m_meshes.size();
-    outFile.write(reinterpret_cast<const char*>(&meshCount), sizeof(size_t));
-    for (const Mesh& mesh : m_meshes) {
-        const size_t materialIndex = mesh.materialIndex;
-        outFile.write(reinterpret_cast<const char*>(&materialIndex), sizeof(size_t));
+void Converter::convertBundle(const std::vector<BundleInput>& inputs, const std::filesystem::path& outputFile, const ConversionOptions& options) {
+    if (inputs.empty())
+        throw std::runtime_error("No input file to convert");
+    m_options = options;
 
-        const int ommIndex = mesh.ommIndex;
-        outFile.write(reinterpret_cast<const char*>(&ommIndex), sizeof(int));
+    // Payloads are written as soon as they are processed, the first block is left for the header & TOC written last
+    m_writer = std::make_unique<KelpWriter>(outputFile);
+    m_fileCursor = KelpFormat::alignUp(sizeof(KelpFormat::FileHeader) + (SECTION_COUNT * sizeof(KelpFormat::SectionEntry)));
 
-        const size_t vertexCount = mesh.vertices.size();
-        outFile.write(reinterpret_cast<const char*>(&vertexCount), sizeof(size_t));
-        outFile.write(reinterpret_cast<const char*>(mesh.vertices.data()), static_cast<std::streamsize>(sizeof(Vertex) * vertexCount));
+    funcTime("Converted file", [&]() {
+        funcTime(inputs.size() == 1 ? "Parsed file" : "Parsed " + std::to_string(inputs.size()) + " files", [&]() {
+            parseInputs(inputs);
+        });
 
-        const size_t indexCount = mesh.indices.size();
-        outFile.write(reinterpret_cast<const char*>(&indexCount), sizeof(size_t));
-        outFile.write(reinterpret_cast<const char*>(mesh.indices.data()), static_cast<std::streamsize>(sizeof(uint32_t) * indexCount));
-    }
+        funcTime("Loaded materials", [&]() {
+            for (const Input& input : m_inputs)
+                loadMaterials(input);
+            deduplicateTextures();
+            deduplicateMaterials();
+        });
 
+        funcTime("Loaded & wrote textures", [&]() {
+            const uint64_t textureDataOffset = m_fileCursor;
+            initTextureCollections();
+            layoutTextures();
+            loadTextures();
+            addPayloadSection(KelpFormat::SectionType::TextureData, textureDataOffset, m_textureEntries.size());
+        });
 
-    // Write mesh instances
-    const size_t meshInstanceCount = m_meshInstances.size();
-    outFile.write(reinterpret_cast<const char*>(&meshInstanceCount), sizeof(size_t));
-    outFile.write(reinterpret_cast<const char*>(m_meshInstances.data()), static_cast<std::streamsize>(sizeof(KelpMeshInstance) * meshInstanceCount));
+        funcTime("Loaded meshes", [&]() {
+            loadMeshes();
+        });
 
+        funcTime("Baked opacity micromaps", [&]() {
+            bakeOpacityMicromaps();
+        });
+
+        funcTime("Generated mesh LODs", [&]() {
+            generateMeshLods();
+        });
+
+        funcTime("Wrote meshes", [&]() {
+            writeMeshes();
+        });
+
+        funcTime("Loaded glTF scene", [&]() {
+            for (const Input& input : m_inputs)
+                loadGltfScene(input);
+        });
+
+        funcTime("Partitioned scene", [&]() {
+            partitionCells();
+        });
+
+        funcTime("Wrote file", [&]() {
+            writeKelpFile();
+        });
+    });
 
-    outFile.close();
-    std::cout << "Conversion completed successfully!" << std::endl;
+    log() << "Conversion completed successfully!" << std::endl;
 }
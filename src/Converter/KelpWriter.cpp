@@ -0,0 +1,98 @@
+#include "Converter/KelpWriter.hpp"
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <cerrno>
+    #include <cstring>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+
+KelpWriter::KelpWriter(const std::filesystem::path& path) : m_path(path) {
+    #ifdef _WIN32
+        m_handle = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (m_handle == INVALID_HANDLE_VALUE) {
+            m_handle = nullptr;
+            throw std::runtime_error("Failed to open output file \"" + path.string() + "\": error " + std::to_string(GetLastError()));
+        }
+    #else
+        m_fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (m_fd == -1)
+            throw std::runtime_error("Failed to open output file \"" + path.string() + "\": " + std::strerror(errno));
+    #endif
+}
+
+KelpWriter::~KelpWriter() {
+    closeFile();
+}
+
+void KelpWriter::closeFile() noexcept {
+    #ifdef _WIN32
+        if (m_handle != nullptr)
+            CloseHandle(m_handle);
+        m_handle = nullptr;
+    #else
+        if (m_fd != -1)
+            close(m_fd);
+        m_fd = -1;
+    #endif
+}
+
+void KelpWriter::write(uint64_t offset, const void* data, size_t size) const {
+    const auto* cursor = static_cast<const std::byte*>(data);
+    while (size > 0) {
+        #ifdef _WIN32
+            OVERLAPPED overlapped{};
+            overlapped.Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+            overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+            DWORD bytesWritten = 0;
+            const DWORD chunkSize = static_cast<DWORD>(std::min<size_t>(size, 1U << 30));
+            if (WriteFile(m_handle, cursor, chunkSize, &bytesWritten, &overlapped) == FALSE)
+                throw std::runtime_error("Failed to write \"" + m_path.string() + "\": error " + std::to_string(GetLastError()));
+        #else
+            const ssize_t bytesWritten = pwrite(m_fd, cursor, size, static_cast<off_t>(offset));
+            if (bytesWritten == -1) {
+                if (errno == EINTR)
+                    continue;
+                throw std::runtime_error("Failed to write \"" + m_path.string() + "\": " + std::strerror(errno));
+            }
+        #endif
+
+        cursor += bytesWritten;
+        offset += static_cast<uint64_t>(bytesWritten);
+        size -= static_cast<size_t>(bytesWritten);
+    }
+}
+
+void KelpWriter::finish(uint64_t fileSize) {
+    #ifdef _WIN32
+        LARGE_INTEGER size{};
+        size.QuadPart = static_cast<LONGLONG>(fileSize);
+        if (SetFilePointerEx(m_handle, size, nullptr, FILE_BEGIN) == FALSE || SetEndOfFile(m_handle) == FALSE)
+            throw std::runtime_error("Failed to resize \"" + m_path.string() + "\": error " + std::to_string(GetLastError()));
+
+        const bool closed = CloseHandle(m_handle) != FALSE;
+        m_handle = nullptr;
+        if (!closed)
+            throw std::runtime_error("Failed to close \"" + m_path.string() + "\": error " + std::to_string(GetLastError()));
+    #else
+        if (ftruncate(m_fd, static_cast<off_t>(fileSize)) == -1)
+            throw std::runtime_error("Failed to resize \"" + m_path.string() + "\": " + std::strerror(errno));
+
+        const bool closed = close(m_fd) == 0;
+        m_fd = -1;
+        if (!closed)
+            throw std::runtime_error("Failed to close \"" + m_path.string() + "\": " + std::strerror(errno));
+    #endif
+}
@@ -0,0 +1,165 @@
+#include "Converter/Ktx2.hpp"
+
+#include "Common/BcDecoder.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace {
+    constexpr std::array<uint8_t, 12> IDENTIFIER = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+    constexpr size_t HEADER_SIZE = 80;      // Identifier, 9 uint32_t fields, then the index of the data format, key/value & supercompression data
+    constexpr size_t LEVEL_INDEX_ENTRY_SIZE = 24;
+
+    struct FormatInfo {
+        uint32_t vkFormat;
+        uint32_t sampledFormat;
+        uint32_t texelSize;
+        uint32_t blockSize;
+        uint32_t channelCount;
+    };
+
+    // VkFormat values, the converter doesn't depend on the Vulkan headers
+    constexpr std::array<FormatInfo, 24> FORMATS = {{
+        { .vkFormat = 9,   .sampledFormat = 9,   .texelSize = 1, .blockSize = 0,  .channelCount = 1 },  // R8_UNORM
+        { .vkFormat = 15,  .sampledFormat = 9,   .texelSize = 1, .blockSize = 0,  .channelCount = 1 },  // R8_SRGB
+        { .vkFormat = 16,  .sampledFormat = 16,  .texelSize = 2, .blockSize = 0,  .channelCount = 2 },  // R8G8_UNORM
+        { .vkFormat = 22,  .sampledFormat = 16,  .texelSize = 2, .blockSize = 0,  .channelCount = 2 },  // R8G8_SRGB
+        { .vkFormat = 37,  .sampledFormat = 37,  .texelSize = 4, .blockSize = 0,  .channelCount = 4 },  // R8G8B8A8_UNORM
+        { .vkFormat = 43,  .sampledFormat = 37,  .texelSize = 4, .blockSize = 0,  .channelCount = 4 },  // R8G8B8A8_SRGB
+        { .vkFormat = 44,  .sampledFormat = 44,  .texelSize = 4, .blockSize = 0,  .channelCount = 4 },  // B8G8R8A8_UNORM
+        { .vkFormat = 50,  .sampledFormat = 44,  .texelSize = 4, .blockSize = 0,  .channelCount = 4 },  // B8G8R8A8_SRGB
+        { .vkFormat = 131, .sampledFormat = 131, .texelSize = 0, .blockSize = 8,  .channelCount = 3 },  // BC1_RGB_UNORM
+        { .vkFormat = 132, .sampledFormat = 131, .texelSize = 0, .blockSize = 8,  .channelCount = 3 },  // BC1_RGB_SRGB
+        { .vkFormat = 133, .sampledFormat = 133, .texelSize = 0, .blockSize = 8,  .channelCount = 4 },  // BC1_RGBA_UNORM
+        { .vkFormat = 134, .sampledFormat = 133, .texelSize = 0, .blockSize = 8,  .channelCount = 4 },  // BC1_RGBA_SRGB
+        { .vkFormat = 135, .sampledFormat = 135, .texelSize = 0, .blockSize = 16, .channelCount = 4 },  // BC2_UNORM
+        { .vkFormat = 136, .sampledFormat = 135, .texelSize = 0, .blockSize = 16, .channelCount = 4 },  // BC2_SRGB
+        { .vkFormat = 137, .sampledFormat = 137, .texelSize = 0, .blockSize = 16, .channelCount = 4 },  // BC3_UNORM
+        { .vkFormat = 138, .sampledFormat = 137, .texelSize = 0, .blockSize = 16, .channelCount = 4 },  // BC3_SRGB
+        { .vkFormat = 139, .sampledFormat = 139, .texelSize = 0, .blockSize = 8,  .channelCount = 1 },  // BC4_UNORM
+        { .vkFormat = 140, .sampledFormat = 140, .texelSize = 0, .blockSize = 8,  .channelCount = 1 },  // BC4_SNORM
+        { .vkFormat = 141, .sampledFormat = 141, .texelSize = 0, .blockSize = 16, .channelCount = 2 },  // BC5_UNORM
+        { .vkFormat = 142, .sampledFormat = 142, .texelSize = 0, .blockSize = 16, .channelCount = 2 },  // BC5_SNORM
+        { .vkFormat = 143, .sampledFormat = 143, .texelSize = 0, .blockSize = 16, .channelCount = 3 },  // BC6H_UFLOAT
+        { .vkFormat = 144, .sampledFormat = 144, .texelSize = 0, .blockSize = 16, .channelCount = 3 },  // BC6H_SFLOAT
+        { .vkFormat = 145, .sampledFormat = 145, .texelSize = 0, .blockSize = 16, .channelCount = 4 },  // BC7_UNORM
+        { .vkFormat = 146, .sampledFormat = 145, .texelSize = 0, .blockSize = 16, .channelCount = 4 },  // BC7_SRGB
+    }};
+
+    template <typename T>
+    T read(std::span<const uint8_t> data, size_t offset) {
+        if (offset + sizeof(T) > data.size())
+            throw std::runtime_error("Corrupted KTX2 container: truncated header");
+
+        T value{};
+        std::memcpy(&value, data.data() + offset, sizeof(T));
+        return value;
+    }
+
+    uint64_t levelSize(const FormatInfo& format, uint32_t width, uint32_t height) {
+        if (format.blockSize != 0)
+            return static_cast<uint64_t>((width + 3) / 4) * ((height + 3) / 4) * format.blockSize;
+        return static_cast<uint64_t>(width) * height * format.texelSize;
+    }
+}
+
+bool Ktx2::isKtx2(std::span<const uint8_t> data) noexcept {
+    return data.size() >= IDENTIFIER.size() && std::equal(IDENTIFIER.begin(), IDENTIFIER.end(), data.begin());
+}
+
+Ktx2::Image Ktx2::parse(std::span<const uint8_t> data) {
+    if (!isKtx2(data) || data.size() < HEADER_SIZE)
+        throw std::runtime_error("Not a KTX2 container");
+
+    const auto vkFormat = read<uint32_t>(data, 12);
+    const auto width = read<uint32_t>(data, 20);
+    const auto height = read<uint32_t>(data, 24);
+    const auto depth = read<uint32_t>(data, 28);
+    const auto layerCount = read<uint32_t>(data, 32);
+    const auto faceCount = read<uint32_t>(data, 36);
+    const auto levelCount = read<uint32_t>(data, 40);
+    const auto supercompressionScheme = read<uint32_t>(data, 44);
+
+
+    // Only what the converter can store as is: one uncompressed or BCn 2D image
+    if (supercompressionScheme != 0)
+        throw std::runtime_error("Supercompressed KTX2 containers are not supported (scheme " + std::to_string(supercompressionScheme) + ")");
+    if (width == 0 || height == 0 || depth > 1 || layerCount > 1 || faceCount != 1)
+        throw std::runtime_error("Only single 2D KTX2 images are supported");
+
+    const auto format = std::ranges::find(FORMATS, vkFormat, &FormatInfo::vkFormat);
+    if (format == FORMATS.end())
+        throw std::runtime_error("Unsupported KTX2 format: VkFormat " + std::to_string(vkFormat));
+
+    const uint32_t maxLevelCount = std::bit_width(std::max(width, height));
+    if (levelCount > maxLevelCount)
+        throw std::runtime_error("KTX2 image has " + std::to_string(levelCount) + " levels, at most " + std::to_string(maxLevelCount) + " expected");
+
+
+    // Level index, level 0 being the biggest one. A level count of 0 asks the loader to generate the mips, the image is kept without any
+    Image image{
+        .width = width,
+        .height = height,
+        .vkFormat = format->sampledFormat,
+        .texelSize = format->texelSize,
+        .blockSize = format->blockSize,
+        .channelCount = format->channelCount,
+        .levels = std::vector<std::span<const uint8_t>>(std::max(levelCount, 1U)),
+    };
+
+    for (uint32_t i = 0; i < static_cast<uint32_t>(image.levels.size()); i++) {
+        const size_t entryOffset = HEADER_SIZE + (i * LEVEL_INDEX_ENTRY_SIZE);
+        const auto byteOffset = read<uint64_t>(data, entryOffset);
+        const auto byteLength = read<uint64_t>(data, entryOffset + 8);
+
+        const uint64_t expectedSize = levelSize(*format, std::max(1U, width >> i), std::max(1U, height >> i));
+        if (byteLength != expectedSize)
+            throw std::runtime_error("Corrupted KTX2 container: level " + std::to_string(i) + " is " + std::to_string(byteLength) + " bytes, " + std::to_string(expectedSize) + " expected");
+        if (byteOffset > data.size() || byteLength > data.size() - byteOffset)
+            throw std::runtime_error("Corrupted KTX2 container: level " + std::to_string(i) + " is out of the container bounds");
+
+        image.levels[i] = data.subspan(byteOffset, byteLength);
+    }
+
+    return image;
+}
+
+std::vector<uint8_t> Ktx2::decode(const Image& image, size_t level) {
+    const std::span<const uint8_t> data = image.levels.at(level);
+    const auto width = static_cast<uint32_t>(std::max(1U, image.width >> level));
+    const auto height = static_cast<uint32_t>(std::max(1U, image.height >> level));
+    std::vector<uint8_t> texels(static_cast<size_t>(width) * height * 4);
+
+    if (image.blockSize != 0) {
+        const std::optional<BcDecoder::Format> format = BcDecoder::getFormat(image.vkFormat);
+        if (!format)
+            throw std::runtime_error("KTX2 images of VkFormat " + std::to_string(image.vkFormat) + " can't be decoded to 8-bit texels");
+
+        BcDecoder::decode(data, texels, width, height, *format);
+        return texels;
+    }
+
+
+    // Uncompressed texels, expanded to RGBA with the missing channels as they are sampled
+    const bool isBgra = image.vkFormat == 44;
+    for (size_t i = 0; i < texels.size() / 4; i++) {
+        const uint8_t* src = data.data() + (i * image.texelSize);
+        uint8_t* dst = texels.data() + (i * 4);
+        dst[0] = src[0];
+        dst[1] = image.channelCount > 1 ? src[1] : 0;
+        dst[2] = image.channelCount > 2 ? src[2] : 0;
+        dst[3] = image.channelCount > 3 ? src[3] : UINT8_MAX;
+        if (isBgra)
+            std::swap(dst[0], dst[2]);
+    }
+
+    return texels;
+}
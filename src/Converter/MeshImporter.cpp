@@ -0,0 +1,1112 @@
+#include "Converter/MeshImporter.hpp"
+#include "Common/MappedFile.hpp"
+#include "Common/ThreadPool.hpp"
+
+#include "glm/ext/vector_float2.hpp"
+#include "glm/ext/vector_float3.hpp"
+#include "glm/geometric.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <initializer_list>
+#include <iostream>
+#include <limits>
+#include <set>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace {
+    constexpr size_t CHUNK_SIZE = 8ULL * 1024 * 1024;  // Bytes of text parsed per task, chunks end on a line boundary
+    constexpr size_t PLY_BLOCK_SIZE = 64ULL * 1024;     // Binary PLY elements decoded per task
+    constexpr uint32_t MISSING = std::numeric_limits<uint32_t>::max();
+
+    constexpr std::array<uint64_t, 9> INTEGER_POWERS_OF_TEN = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+    constexpr std::array<double, 23> POWERS_OF_TEN = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+
+
+    /* Text parsing */
+
+    bool isDigit(char c) {
+        return static_cast<unsigned char>(c - '0') < 10;
+    }
+
+    bool isBlank(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    void skipBlanks(const char*& cursor, const char* end) {
+        while (cursor < end && isBlank(*cursor))
+            cursor++;
+    }
+
+    const char* findLineEnd(const char* cursor, const char* end) {
+        const void* newline = std::memchr(cursor, '\n', static_cast<size_t>(end - cursor));
+        return newline != nullptr ? static_cast<const char*>(newline) : end;
+    }
+
+    std::string_view trim(std::string_view text) {
+        while (!text.empty() && (isBlank(text.front()) || text.front() == '\n'))
+            text.remove_prefix(1);
+        while (!text.empty() && (isBlank(text.back()) || text.back() == '\n'))
+            text.remove_suffix(1);
+        return text;
+    }
+
+    std::string_view nextToken(std::string_view& text) {
+        text = trim(text);
+        const size_t end = std::min(text.find_first_of(" \t"), text.size());
+        const std::string_view token = text.substr(0, end);
+        text.remove_prefix(end);
+        return token;
+    }
+
+    /**
+     * @brief Number of leading digits of the 8 characters loaded little endian.
+     * A byte gets its high bit set when below '0' or above '9', carries & borrows only reaching the bytes after the first non digit.
+     */
+    int countLeadingDigits(uint64_t chunk) {
+        const uint64_t nonDigits = ((chunk + 0x4646464646464646) | (chunk - 0x3030303030303030)) & 0x8080808080808080;
+        return nonDigits == 0 ? 8 : std::countr_zero(nonDigits) / 8;
+    }
+
+    /**
+     * @brief Value of 8 digits loaded little endian, the pairs, then quads of digits being combined in parallel within the register.
+     * Shorter numbers are first shifted to the end of the register behind leading zeros.
+     */
+    uint32_t parseEightDigits(uint64_t chunk) {
+        chunk -= 0x3030303030303030;
+        chunk = (chunk * 10) + (chunk >> 8);
+        chunk = (((chunk & 0x000000FF000000FF) * (100 + (1000000ULL << 32))) + (((chunk >> 16) & 0x000000FF000000FF) * (1 + (10000ULL << 32)))) >> 32;
+        return static_cast<uint32_t>(chunk);
+    }
+
+    /**
+     * @brief Parse a decimal number after optional blanks, advancing the cursor past it.
+     * Up to 19 significant digits with a small exponent are exactly representable before a single scaling by a power of ten,
+     * other numbers (long mantissas, big exponents, inf & nan) go through std::from_chars.
+     */
+    bool parseDouble(const char*& cursor, const char* end, double& value) {
+        skipBlanks(cursor, end);
+        const char* p = cursor;
+        const bool negative = p < end && *p == '-';
+        if (p < end && (*p == '-' || *p == '+'))
+            p++;
+
+        uint64_t mantissa = 0;
+        int digitCount = 0;
+        int exponent = 0;
+        const auto readDigits = [&](int exponentStep) {
+            if constexpr (std::endian::native == std::endian::little) {
+                while (end - p >= 8) {
+                    uint64_t chunk = 0;
+                    std::memcpy(&chunk, p, sizeof(chunk));
+                    const int count = countLeadingDigits(chunk);
+                    if (count == 0 || digitCount + count > 19)
+                        break;
+
+                    const uint64_t digits = count == 8 ? chunk : (chunk << (8 * (8 - count))) | (0x3030303030303030ULL >> (8 * count));
+                    mantissa = (mantissa * INTEGER_POWERS_OF_TEN[count]) + parseEightDigits(digits);
+                    digitCount += count;
+                    exponent += count * exponentStep;
+                    p += count;
+                    if (count < 8)
+                        return;
+                }
+            }
+
+            for (; p < end && isDigit(*p); p++) {
+                mantissa = (mantissa * 10) + static_cast<uint64_t>(*p - '0');
+                digitCount++;
+                exponent += exponentStep;
+            }
+        };
+
+        readDigits(0);
+        if (p < end && *p == '.') {
+            p++;
+            readDigits(-1);
+        }
+
+        if (digitCount > 0 && p < end && (*p == 'e' || *p == 'E')) {
+            const char* e = p + 1;
+            const bool negativeExponent = e < end && *e == '-';
+            if (e < end && (*e == '-' || *e == '+'))
+                e++;
+
+            if (e < end && isDigit(*e)) {
+                int exponentValue = 0;
+                for (; e < end && isDigit(*e); e++)
+                    exponentValue = std::min((exponentValue * 10) + (*e - '0'), 100000);
+                exponent += negativeExponent ? -exponentValue : exponentValue;
+                p = e;
+            }
+        }
+
+        if (digitCount > 0 && digitCount <= 19 && mantissa <= (1ULL << 53) && std::abs(exponent) < static_cast<int>(POWERS_OF_TEN.size())) {
+            const auto magnitude = static_cast<double>(mantissa);
+            const double result = exponent < 0 ? magnitude / POWERS_OF_TEN[-exponent] : magnitude * POWERS_OF_TEN[exponent];
+            value = negative ? -result : result;
+            cursor = p;
+            return true;
+        }
+
+
+        // std::from_chars doesn't accept a leading plus sign, results out of range are returned as 0 or infinity
+        const char* start = cursor < end && *cursor == '+' ? cursor + 1 : cursor;
+        const auto [next, error] = std::from_chars(start, end, value);
+        if (error == std::errc::invalid_argument)
+            return false;
+        if (error == std::errc::result_out_of_range)
+            value = exponent < 0 ? 0.0 : (negative ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity());
+
+        cursor = next;
+        return true;
+    }
+
+    bool parseFloat(const char*& cursor, const char* end, float& value) {
+        double result = 0;
+        if (!parseDouble(cursor, end, result))
+            return false;
+
+        value = static_cast<float>(result);
+        return true;
+    }
+
+    bool parseInteger(const char*& cursor, const char* end, int64_t& value) {
+        const char* p = cursor;
+        const bool negative = p < end && *p == '-';
+        if (p < end && (*p == '-' || *p == '+'))
+            p++;
+        if (p == end || !isDigit(*p))
+            return false;
+
+        int64_t magnitude = 0;
+        if constexpr (std::endian::native == std::endian::little) {
+            if (end - p >= 8) {
+                uint64_t chunk = 0;
+                std::memcpy(&chunk, p, sizeof(chunk));
+                const int count = countLeadingDigits(chunk);
+                if (count < 8) {
+                    value = parseEightDigits((chunk << (8 * (8 - count))) | (0x3030303030303030ULL >> (8 * count)));
+                    value = negative ? -value : value;
+                    cursor = p + count;
+                    return true;
+                }
+            }
+        }
+
+        for (; p < end && isDigit(*p); p++)
+            magnitude = std::min((magnitude * 10) + (*p - '0'), int64_t{ 1 } << 40);
+
+        value = negative ? -magnitude : magnitude;
+        cursor = p;
+        return true;
+    }
+
+    /**
+     * @brief Split a text into chunks of about CHUNK_SIZE bytes, each of them ending after a newline or at the end of the text.
+     */
+    std::vector<std::string_view> splitChunks(std::string_view text) {
+        std::vector<std::string_view> chunks;
+        size_t begin = 0;
+        while (begin < text.size()) {
+            size_t end = std::min(begin + CHUNK_SIZE, text.size());
+            if (end < text.size())
+                end = static_cast<size_t>(findLineEnd(text.data() + end, text.data() + text.size()) - text.data()) + 1;
+
+            end = std::min(end, text.size());
+            chunks.push_back(text.substr(begin, end - begin));
+            begin = end;
+        }
+
+        return chunks;
+    }
+
+
+    /* Geometry */
+
+    /**
+     * @brief Area weighted normals of the triangles around each vertex, only written to the vertices flagged as missing one.
+     */
+    void generateNormals(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, std::vector<glm::vec3>& normals, const std::vector<bool>& missingNormals) {
+        std::vector<glm::vec3> accumulated(positions.size(), glm::vec3(0.0F));
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            const glm::vec3& a = positions[indices[i]];
+            const glm::vec3 faceNormal = glm::cross(positions[indices[i + 1]] - a, positions[indices[i + 2]] - a);
+            accumulated[indices[i]] += faceNormal;
+            accumulated[indices[i + 1]] += faceNormal;
+            accumulated[indices[i + 2]] += faceNormal;
+        }
+
+        for (size_t i = 0; i < normals.size(); i++) {
+            if (!missingNormals[i])
+                continue;
+
+            const float length = glm::length(accumulated[i]);
+            normals[i] = length > 0.0F ? accumulated[i] / length : glm::vec3(0.0F, 0.0F, 1.0F);
+        }
+    }
+
+    MeshImporter::Primitive packPrimitive(uint32_t materialIndex, const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals, const std::vector<glm::vec2>& uvs, const std::vector<uint32_t>& indices) {
+        MeshImporter::Primitive primitive{
+            .materialIndex = materialIndex,
+            .vertexCount = static_cast<uint32_t>(positions.size()),
+            .indexCount = static_cast<uint32_t>(indices.size()),
+            .data = {},
+        };
+
+        primitive.data.resize(primitive.indicesOffset() + (indices.size() * sizeof(uint32_t)));
+        std::memcpy(primitive.data.data() + MeshImporter::Primitive::positionsOffset(), positions.data(), positions.size() * sizeof(glm::vec3));
+        std::memcpy(primitive.data.data() + primitive.normalsOffset(), normals.data(), normals.size() * sizeof(glm::vec3));
+        std::memcpy(primitive.data.data() + primitive.uvsOffset(), uvs.data(), uvs.size() * sizeof(glm::vec2));
+        std::memcpy(primitive.data.data() + primitive.indicesOffset(), indices.data(), indices.size() * sizeof(uint32_t));
+        return primitive;
+    }
+
+
+    /* OBJ */
+
+    using ObjCorner = std::array<uint32_t, 3>;     // Position, UV & normal indices, MISSING when not given
+
+    struct ObjChunk {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec2> uvs;
+        std::vector<glm::vec3> normals;
+        std::vector<ObjCorner> corners;                                 // Triangle list, polygons are fanned
+        std::vector<size_t> relativeIndices;                            // corner * 3 + attribute of the negative indices, counted from the chunk start until resolved
+        std::vector<std::pair<size_t, std::string>> materialSwitches;   // First corner & material name of every usemtl
+        std::vector<std::string> libraries;                             // Arguments of every mtllib
+    };
+
+    ObjChunk parseObjChunk(std::string_view text, size_t chunkOffset) {
+        // Face lines take a dozen bytes per corner or more, reserving avoids most of the copies while the pages are only committed once written
+        ObjChunk chunk;
+        chunk.corners.reserve(text.size() / 12);
+        std::vector<ObjCorner> polygon;
+        std::vector<uint8_t> polygonRelative;     // Bit per attribute given as a negative index
+
+        const char* p = text.data();
+        const char* const end = text.data() + text.size();
+        const auto fail = [&](const std::string& element) {
+            throw std::runtime_error("Corrupted OBJ file: invalid " + element + " at byte " + std::to_string(chunkOffset + static_cast<size_t>(p - text.data())));
+        };
+
+        while (p < end) {
+            skipBlanks(p, end);
+            const char* const keywordStart = p;
+            while (p < end && !isBlank(*p) && *p != '\n')
+                p++;
+            const std::string_view keyword(keywordStart, static_cast<size_t>(p - keywordStart));
+
+            if (keyword == "v") {
+                glm::vec3& position = chunk.positions.emplace_back();
+                if (!parseFloat(p, end, position.x) || !parseFloat(p, end, position.y) || !parseFloat(p, end, position.z))
+                    fail("vertex");
+            } else if (keyword == "vt") {
+                glm::vec2& uv = chunk.uvs.emplace_back(0.0F);
+                if (!parseFloat(p, end, uv.x))
+                    fail("texture coordinate");
+                skipBlanks(p, end);
+                if (p < end && *p != '\n' && !parseFloat(p, end, uv.y))
+                    fail("texture coordinate");
+            } else if (keyword == "vn") {
+                glm::vec3& normal = chunk.normals.emplace_back();
+                if (!parseFloat(p, end, normal.x) || !parseFloat(p, end, normal.y) || !parseFloat(p, end, normal.z))
+                    fail("normal");
+            } else if (keyword == "f") {
+                polygon.clear();
+                polygonRelative.clear();
+                const std::array<size_t, 3> counts = { chunk.positions.size(), chunk.uvs.size(), chunk.normals.size() };
+
+                // Corners are v, v/vt, v//vn or v/vt/vn, negative indices count back from the last element read
+                while (true) {
+                    skipBlanks(p, end);
+                    if (p >= end || *p == '\n')
+                        break;
+
+                    ObjCorner corner = { MISSING, MISSING, MISSING };
+                    uint8_t relative = 0;
+                    for (size_t attribute = 0; attribute < 3; attribute++) {
+                        if (attribute > 0) {
+                            if (p >= end || *p != '/')
+                                break;
+                            p++;
+                            if (p < end && *p == '/')
+                                continue;
+                        }
+
+                        int64_t index = 0;
+                        if (!parseInteger(p, end, index) || index == 0 || index >= MISSING)
+                            fail("face");
+
+                        if (index > 0) {
+                            corner[attribute] = static_cast<uint32_t>(index - 1);
+                        } else {
+                            corner[attribute] = static_cast<uint32_t>(static_cast<int64_t>(counts[attribute]) + index);
+                            relative |= 1U << attribute;
+                        }
+                    }
+
+                    if (p < end && !isBlank(*p) && *p != '\n')
+                        fail("face");
+                    polygon.push_back(corner);
+                    polygonRelative.push_back(relative);
+                }
+
+                const auto emitCorner = [&](size_t i) {
+                    for (size_t attribute = 0; attribute < 3; attribute++) {
+                        if ((polygonRelative[i] & (1U << attribute)) != 0)
+                            chunk.relativeIndices.push_back((chunk.corners.size() * 3) + attribute);
+                    }
+                    chunk.corners.push_back(polygon[i]);
+                };
+
+                for (size_t i = 1; i + 1 < polygon.size(); i++) {
+                    emitCorner(0);
+                    emitCorner(i);
+                    emitCorner(i + 1);
+                }
+            } else if (keyword == "usemtl") {
+                chunk.materialSwitches.emplace_back(chunk.corners.size(), std::string(trim(std::string_view(p, static_cast<size_t>(findLineEnd(p, end) - p)))));
+            } else if (keyword == "mtllib") {
+                chunk.libraries.emplace_back(trim(std::string_view(p, static_cast<size_t>(findLineEnd(p, end) - p))));
+            }
+
+            // Parsed lines are usually done but for their newline, the others (comments, groups, ...) are skipped at once
+            const char* const lineEnd = keyword.size() <= 2 ? std::find(p, end, '\n') : findLineEnd(p, end);
+            p = lineEnd < end ? lineEnd + 1 : end;
+        }
+
+        return chunk;
+    }
+
+    uint64_t hashCorner(const ObjCorner& corner) {
+        uint64_t hash = (corner[0] * 0x9E3779B97F4A7C15ULL) ^ (corner[1] * 0xC2B2AE3D27D4EB4FULL) ^ (corner[2] * 0x165667B19E3779F9ULL);
+        hash ^= hash >> 29;
+        return hash;
+    }
+
+
+    /* PLY */
+
+    enum class PlyType : uint8_t {
+        Int8,
+        UInt8,
+        Int16,
+        UInt16,
+        Int32,
+        UInt32,
+        Float32,
+        Float64,
+    };
+
+    struct PlyProperty {
+        std::string name;
+        PlyType type;           // Type of the list items for lists
+        PlyType countType;
+        bool isList;
+    };
+
+    struct PlyElement {
+        std::string name;
+        size_t count;
+        std::vector<PlyProperty> properties;
+    };
+
+    struct PlyHeader {
+        enum class Format : uint8_t {
+            Ascii,
+            BinaryLittleEndian,
+            BinaryBigEndian,
+        };
+
+        Format format;
+        std::vector<PlyElement> elements;
+        std::string textureFile;    // "comment TextureFile" written by MeshLab & most photogrammetry tools
+        size_t dataOffset;
+    };
+
+    PlyType parsePlyType(std::string_view name) {
+        constexpr std::array<std::pair<std::string_view, PlyType>, 16> TYPES = {{
+            { "char", PlyType::Int8 }, { "int8", PlyType::Int8 },
+            { "uchar", PlyType::UInt8 }, { "uint8", PlyType::UInt8 },
+            { "short", PlyType::Int16 }, { "int16", PlyType::Int16 },
+            { "ushort", PlyType::UInt16 }, { "uint16", PlyType::UInt16 },
+            { "int", PlyType::Int32 }, { "int32", PlyType::Int32 },
+            { "uint", PlyType::UInt32 }, { "uint32", PlyType::UInt32 },
+            { "float", PlyType::Float32 }, { "float32", PlyType::Float32 },
+            { "double", PlyType::Float64 }, { "float64", PlyType::Float64 },
+        }};
+
+        const auto type = std::ranges::find(TYPES, name, &std::pair<std::string_view, PlyType>::first);
+        if (type == TYPES.end())
+            throw std::runtime_error("Corrupted PLY file: unknown property type \"" + std::string(name) + "\"");
+        return type->second;
+    }
+
+    size_t getPlyTypeSize(PlyType type) {
+        switch (type) {
+            case PlyType::Int8:
+            case PlyType::UInt8:
+                return 1;
+            case PlyType::Int16:
+            case PlyType::UInt16:
+                return 2;
+            case PlyType::Int32:
+            case PlyType::UInt32:
+            case PlyType::Float32:
+                return 4;
+            case PlyType::Float64:
+                return 8;
+        }
+        return 0;
+    }
+
+    template <typename T>
+    double loadPlyValue(const std::array<std::byte, 8>& bytes) {
+        T value{};
+        std::memcpy(&value, bytes.data(), sizeof(T));
+        return static_cast<double>(value);
+    }
+
+    double readPlyValue(const std::byte* data, PlyType type, bool swapBytes) {
+        std::array<std::byte, 8> bytes{};
+        const size_t size = getPlyTypeSize(type);
+        std::memcpy(bytes.data(), data, size);
+        if (swapBytes)
+            std::reverse(bytes.begin(), bytes.begin() + static_cast<std::ptrdiff_t>(size));
+
+        switch (type) {
+            case PlyType::Int8: return loadPlyValue<int8_t>(bytes);
+            case PlyType::UInt8: return loadPlyValue<uint8_t>(bytes);
+            case PlyType::Int16: return loadPlyValue<int16_t>(bytes);
+            case PlyType::UInt16: return loadPlyValue<uint16_t>(bytes);
+            case PlyType::Int32: return loadPlyValue<int32_t>(bytes);
+            case PlyType::UInt32: return loadPlyValue<uint32_t>(bytes);
+            case PlyType::Float32: return loadPlyValue<float>(bytes);
+            case PlyType::Float64: return loadPlyValue<double>(bytes);
+        }
+        return 0;
+    }
+
+    PlyHeader parsePlyHeader(std::string_view text) {
+        if (!text.starts_with("ply"))
+            throw std::runtime_error("Corrupted PLY file: missing \"ply\" magic");
+
+        PlyHeader header{ .format = PlyHeader::Format::Ascii, .elements = {}, .textureFile = {}, .dataOffset = 0 };
+        bool hasFormat = false;
+        size_t lineStart = 0;
+        while (true) {
+            const size_t lineEnd = text.find('\n', lineStart);
+            if (lineEnd == std::string_view::npos)
+                throw std::runtime_error("Corrupted PLY file: missing end_header");
+
+            std::string_view line = text.substr(lineStart, lineEnd - lineStart);
+            lineStart = lineEnd + 1;
+
+            const std::string_view keyword = nextToken(line);
+            if (keyword == "end_header") {
+                header.dataOffset = lineStart;
+                break;
+            }
+
+            if (keyword == "format") {
+                const std::string_view format = nextToken(line);
+                if (format == "ascii")
+                    header.format = PlyHeader::Format::Ascii;
+                else if (format == "binary_little_endian")
+                    header.format = PlyHeader::Format::BinaryLittleEndian;
+                else if (format == "binary_big_endian")
+                    header.format = PlyHeader::Format::BinaryBigEndian;
+                else
+                    throw std::runtime_error("Corrupted PLY file: unknown format \"" + std::string(format) + "\"");
+                hasFormat = true;
+            } else if (keyword == "element") {
+                const std::string_view name = nextToken(line);
+                const std::string_view count = nextToken(line);
+                size_t elementCount = 0;
+                if (std::from_chars(count.data(), count.data() + count.size(), elementCount).ec != std::errc())
+                    throw std::runtime_error("Corrupted PLY file: invalid count for element \"" + std::string(name) + "\"");
+                header.elements.push_back({ .name = std::string(name), .count = elementCount, .properties = {} });
+            } else if (keyword == "property") {
+                if (header.elements.empty())
+                    throw std::runtime_error("Corrupted PLY file: property declared before any element");
+
+                PlyProperty property{ .name = {}, .type = PlyType::UInt8, .countType = PlyType::UInt8, .isList = false };
+                const std::string_view type = nextToken(line);
+                if (type == "list") {
+                    property.isList = true;
+                    property.countType = parsePlyType(nextToken(line));
+                    property.type = parsePlyType(nextToken(line));
+                } else {
+                    property.type = parsePlyType(type);
+                }
+                property.name = nextToken(line);
+                header.elements.back().properties.push_back(std::move(property));
+            } else if (keyword == "comment" && nextToken(line) == "TextureFile") {
+                header.textureFile = trim(line);
+            }
+        }
+
+        if (!hasFormat)
+            throw std::runtime_error("Corrupted PLY file: missing format");
+        return header;
+    }
+
+    /**
+     * @brief Index of the named property of an element, -1 if there is none.
+     */
+    int findPlyProperty(const PlyElement& element, std::initializer_list<std::string_view> names) {
+        for (size_t i = 0; i < element.properties.size(); i++) {
+            if (std::ranges::find(names, element.properties[i].name) != names.end())
+                return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    constexpr size_t PLY_ATTRIBUTE_COUNT = 8;  // x, y, z, nx, ny, nz, u, v
+
+    std::array<int, PLY_ATTRIBUTE_COUNT> findPlyVertexAttributes(const PlyElement& vertices) {
+        return {
+            findPlyProperty(vertices, { "x" }),
+            findPlyProperty(vertices, { "y" }),
+            findPlyProperty(vertices, { "z" }),
+            findPlyProperty(vertices, { "nx" }),
+            findPlyProperty(vertices, { "ny" }),
+            findPlyProperty(vertices, { "nz" }),
+            findPlyProperty(vertices, { "u", "s", "texture_u", "texture_s" }),
+            findPlyProperty(vertices, { "v", "t", "texture_v", "texture_t" }),
+        };
+    }
+}
+
+bool MeshImporter::isSupported(const std::filesystem::path& path) {
+    std::string extension = path.extension().string();
+    std::ranges::transform(extension, extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension == ".obj" || extension == ".ply";
+}
+
+MeshImporter::Scene MeshImporter::import(const std::filesystem::path& path, ThreadPool& threadPool) {
+    std::string extension = path.extension().string();
+    std::ranges::transform(extension, extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+    Scene scene = extension == ".ply" ? importPly(path, threadPool) : importObj(path, threadPool);
+    if (scene.primitives.empty())
+        throw std::runtime_error("Failed to import \"" + path.string() + "\": no faces found");
+    return scene;
+}
+
+MeshImporter::Scene MeshImporter::importObj(const std::filesystem::path& path, ThreadPool& threadPool) {
+    const MappedFile file(path);
+    const std::string_view text(reinterpret_cast<const char*>(file.getData().data()), file.getData().size());
+    const std::vector<std::string_view> chunkTexts = splitChunks(text);
+
+    std::vector<ObjChunk> chunks(chunkTexts.size());
+    threadPool.parallelFor(chunks.size(), [&](size_t i) {
+        chunks[i] = parseObjChunk(chunkTexts[i], static_cast<size_t>(chunkTexts[i].data() - text.data()));
+    });
+
+
+    // Chunks only know their own elements: they are concatenated, and the negative indices offset by the elements of the previous chunks
+    std::vector<std::array<size_t, 3>> chunkBases(chunks.size());
+    std::array<size_t, 3> totals{};
+    for (size_t i = 0; i < chunks.size(); i++) {
+        chunkBases[i] = totals;
+        totals[0] += chunks[i].positions.size();
+        totals[1] += chunks[i].uvs.size();
+        totals[2] += chunks[i].normals.size();
+    }
+    if (totals[0] >= MISSING)
+        throw std::runtime_error("Failed to import \"" + path.string() + "\": too many vertices");
+
+    std::vector<glm::vec3> positions(totals[0]);
+    std::vector<glm::vec2> uvs(totals[1]);
+    std::vector<glm::vec3> normals(totals[2]);
+    threadPool.parallelFor(chunks.size(), [&](size_t i) {
+        ObjChunk& chunk = chunks[i];
+        std::ranges::copy(chunk.positions, positions.begin() + static_cast<std::ptrdiff_t>(chunkBases[i][0]));
+        std::ranges::copy(chunk.uvs, uvs.begin() + static_cast<std::ptrdiff_t>(chunkBases[i][1]));
+        std::ranges::copy(chunk.normals, normals.begin() + static_cast<std::ptrdiff_t>(chunkBases[i][2]));
+
+        for (const size_t index : chunk.relativeIndices)
+            chunk.corners[index / 3][index % 3] += static_cast<uint32_t>(chunkBases[i][index % 3]);
+
+        chunk.positions = {};
+        chunk.uvs = {};
+        chunk.normals = {};
+    });
+
+
+    // Material libraries are resolved from the OBJ directory, a line naming a missing file is retried as a list of files
+    const std::filesystem::path directory = path.parent_path();
+    std::vector<Material> materials;
+    std::vector<std::string> names;
+    std::set<std::filesystem::path> libraries;
+    for (const ObjChunk& chunk : chunks) {
+        for (const std::string& library : chunk.libraries) {
+            std::vector<std::filesystem::path> files = { directory / library };
+            if (!std::filesystem::exists(files[0])) {
+                files.clear();
+                std::string_view arguments = library;
+                for (std::string_view token = nextToken(arguments); !token.empty(); token = nextToken(arguments))
+                    files.push_back(directory / token);
+            }
+
+            for (const std::filesystem::path& file : files) {
+                if (!libraries.insert(file).second)
+                    continue;
+                if (!std::filesystem::exists(file)) {
+                    std::cout << "Material library \"" << file.string() << "\" not found, its materials are replaced by a default one" << std::endl;
+                    continue;
+                }
+                parseMtl(file, directory, materials, names);
+            }
+        }
+    }
+
+
+    // Triangles are grouped by material, faces before any usemtl or naming an unknown material get the default one, placed last
+    struct Run {
+        size_t chunk;
+        size_t begin;
+        size_t end;
+    };
+
+    std::vector<std::vector<Run>> materialRuns(materials.size() + 1);
+    size_t currentMaterial = materials.size();
+    for (size_t i = 0; i < chunks.size(); i++) {
+        size_t begin = 0;
+        for (const auto& [corner, name] : chunks[i].materialSwitches) {
+            if (corner > begin)
+                materialRuns[currentMaterial].push_back({ .chunk = i, .begin = begin, .end = corner });
+            begin = corner;
+            currentMaterial = static_cast<size_t>(std::ranges::find(names, name) - names.begin());
+        }
+
+        if (chunks[i].corners.size() > begin)
+            materialRuns[currentMaterial].push_back({ .chunk = i, .begin = begin, .end = chunks[i].corners.size() });
+    }
+    materials.emplace_back();
+
+    Scene scene;
+    std::vector<size_t> usedMaterials;
+    for (size_t i = 0; i < materials.size(); i++) {
+        if (!materialRuns[i].empty()) {
+            usedMaterials.push_back(i);
+            scene.materials.push_back(std::move(materials[i]));
+        }
+    }
+
+
+    // A vertex per distinct corner of each material, found with an open addressing table of vertex indices kept at most half full.
+    // Exporters often give every attribute the index of the position, the table is then indexed by position directly
+    scene.primitives.resize(usedMaterials.size());
+    threadPool.parallelFor(usedMaterials.size(), [&](size_t i) {
+        const std::vector<Run>& runs = materialRuns[usedMaterials[i]];
+        const ObjCorner& firstCorner = chunks[runs[0].chunk].corners[runs[0].begin];
+        size_t cornerCount = 0;
+        bool sharedIndices = true;
+        for (const Run& run : runs) {
+            cornerCount += run.end - run.begin;
+            sharedIndices = sharedIndices && std::all_of(chunks[run.chunk].corners.begin() + static_cast<std::ptrdiff_t>(run.begin), chunks[run.chunk].corners.begin() + static_cast<std::ptrdiff_t>(run.end), [&](const ObjCorner& corner) {
+                return corner[1] == (firstCorner[1] == MISSING ? MISSING : corner[0]) && corner[2] == (firstCorner[2] == MISSING ? MISSING : corner[0]);
+            });
+        }
+        if (cornerCount >= MISSING)
+            throw std::runtime_error("Failed to import \"" + path.string() + "\": too many triangles in a single material");
+
+        std::vector<ObjCorner> vertices;
+        std::vector<uint32_t> indices;
+        std::vector<uint32_t> table(sharedIndices ? positions.size() : std::bit_ceil(std::max<size_t>(cornerCount / 2, 64)), MISSING);
+        indices.reserve(cornerCount);
+
+        for (const Run& run : runs) {
+            for (size_t c = run.begin; c < run.end; c++) {
+                const ObjCorner& corner = chunks[run.chunk].corners[c];
+                if (corner[0] >= positions.size() || (corner[1] != MISSING && corner[1] >= uvs.size()) || (corner[2] != MISSING && corner[2] >= normals.size()))
+                    throw std::runtime_error("Corrupted OBJ file \"" + path.string() + "\": face index out of range");
+
+                if (sharedIndices) {
+                    if (table[corner[0]] == MISSING) {
+                        table[corner[0]] = static_cast<uint32_t>(vertices.size());
+                        vertices.push_back(corner);
+                    }
+                    indices.push_back(table[corner[0]]);
+                    continue;
+                }
+
+                size_t slot = hashCorner(corner) & (table.size() - 1);
+                while (table[slot] != MISSING && vertices[table[slot]] != corner)
+                    slot = (slot + 1) & (table.size() - 1);
+
+                if (table[slot] != MISSING) {
+                    indices.push_back(table[slot]);
+                    continue;
+                }
+
+                table[slot] = static_cast<uint32_t>(vertices.size());
+                indices.push_back(table[slot]);
+                vertices.push_back(corner);
+                if (vertices.size() * 2 > table.size()) {
+                    std::ranges::fill(table, MISSING);
+                    table.resize(table.size() * 2, MISSING);
+                    for (size_t v = 0; v < vertices.size(); v++) {
+                        size_t newSlot = hashCorner(vertices[v]) & (table.size() - 1);
+                        while (table[newSlot] != MISSING)
+                            newSlot = (newSlot + 1) & (table.size() - 1);
+                        table[newSlot] = static_cast<uint32_t>(v);
+                    }
+                }
+            }
+        }
+        table = {};
+
+
+        // OBJ UVs have their origin at the bottom left, glTF ones at the top left
+        std::vector<glm::vec3> vertexPositions(vertices.size());
+        std::vector<glm::vec3> vertexNormals(vertices.size());
+        std::vector<glm::vec2> vertexUvs(vertices.size(), glm::vec2(0.0F));
+        std::vector<bool> missingNormals(vertices.size());
+        bool anyMissingNormal = false;
+        for (size_t v = 0; v < vertices.size(); v++) {
+            vertexPositions[v] = positions[vertices[v][0]];
+            if (vertices[v][1] != MISSING)
+                vertexUvs[v] = glm::vec2(uvs[vertices[v][1]].x, 1.0F - uvs[vertices[v][1]].y);
+            if (vertices[v][2] != MISSING)
+                vertexNormals[v] = normals[vertices[v][2]];
+
+            missingNormals[v] = vertices[v][2] == MISSING;
+            anyMissingNormal |= missingNormals[v];
+        }
+
+        if (anyMissingNormal)
+            generateNormals(vertexPositions, indices, vertexNormals, missingNormals);
+        scene.primitives[i] = packPrimitive(static_cast<uint32_t>(i), vertexPositions, vertexNormals, vertexUvs, indices);
+    });
+
+    return scene;
+}
+
+void MeshImporter::parseMtl(const std::filesystem::path& path, const std::filesystem::path& inputDirectory, std::vector<Material>& materials, std::vector<std::string>& names) {
+    const MappedFile file(path);
+    const std::string_view text(reinterpret_cast<const char*>(file.getData().data()), file.getData().size());
+
+    // Texture options (-bm 1, -clamp on, ...) come before the file name, taken as the last argument. Paths are made relative to the input directory
+    const auto texturePath = [&](std::string_view arguments) {
+        std::string_view name;
+        for (std::string_view token = nextToken(arguments); !token.empty(); token = nextToken(arguments))
+            name = token;
+
+        std::string fileName(name);
+        std::ranges::replace(fileName, '\\', '/');
+        const std::filesystem::path relativePath = (path.parent_path() / fileName).lexically_relative(inputDirectory);
+        return relativePath.empty() ? (path.parent_path() / fileName).generic_string() : relativePath.generic_string();
+    };
+
+    const size_t firstMaterial = materials.size();
+    std::vector<bool> explicitRoughness;
+    const char* p = text.data();
+    const char* const end = text.data() + text.size();
+    while (p < end) {
+        const char* const lineEnd = findLineEnd(p, end);
+        std::string_view line(p, static_cast<size_t>(lineEnd - p));
+        p = lineEnd < end ? lineEnd + 1 : end;
+
+        std::string keyword(nextToken(line));
+        std::ranges::transform(keyword, keyword.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (keyword == "newmtl") {
+            materials.emplace_back();
+            names.emplace_back(trim(line));
+            explicitRoughness.push_back(false);
+            continue;
+        }
+        if (materials.size() == firstMaterial)
+            continue;
+
+        Material& material = materials.back();
+        const char* cursor = line.data();
+        const char* const argumentsEnd = line.data() + line.size();
+        glm::vec3 color(0.0F);
+        float value = 0.0F;
+        if (keyword == "kd" && parseFloat(cursor, argumentsEnd, color.x) && parseFloat(cursor, argumentsEnd, color.y) && parseFloat(cursor, argumentsEnd, color.z)) {
+            material.baseColorFactor = glm::vec4(color, material.baseColorFactor.a);
+        } else if (keyword == "ke" && parseFloat(cursor, argumentsEnd, color.x) && parseFloat(cursor, argumentsEnd, color.y) && parseFloat(cursor, argumentsEnd, color.z)) {
+            material.emissiveFactor = color;
+        } else if (keyword == "d" && parseFloat(cursor, argumentsEnd, value)) {
+            material.baseColorFactor.a = std::clamp(value, 0.0F, 1.0F);
+        } else if (keyword == "tr" && parseFloat(cursor, argumentsEnd, value)) {
+            material.baseColorFactor.a = std::clamp(1.0F - value, 0.0F, 1.0F);
+        } else if (keyword == "ns" && parseFloat(cursor, argumentsEnd, value) && !explicitRoughness.back()) {
+            material.roughnessFactor = std::sqrt(2.0F / (std::max(value, 0.0F) + 2.0F));   // Blinn-Phong exponent to Beckmann roughness
+        } else if (keyword == "pr" && parseFloat(cursor, argumentsEnd, value)) {
+            material.roughnessFactor = std::clamp(value, 0.0F, 1.0F);
+            explicitRoughness.back() = true;
+        } else if (keyword == "pm" && parseFloat(cursor, argumentsEnd, value)) {
+            material.metallicFactor = std::clamp(value, 0.0F, 1.0F);
+        } else if (keyword == "map_kd") {
+            material.baseColorTexture = texturePath(line);
+        } else if (keyword == "map_d") {
+            material.alphaMask = true;
+        } else if (keyword == "map_bump" || keyword == "bump" || keyword == "norm") {
+            material.normalTexture = texturePath(line);
+        } else if (keyword == "map_ke") {
+            material.emissiveTexture = texturePath(line);
+        }
+    }
+
+
+    // Kd is the color of untextured materials, exporters write a grey one next to their textures. Textures are multiplied by the factors in glTF
+    for (size_t i = firstMaterial; i < materials.size(); i++) {
+        Material& material = materials[i];
+        if (!material.baseColorTexture.empty())
+            material.baseColorFactor = glm::vec4(1.0F, 1.0F, 1.0F, material.baseColorFactor.a);
+        if (!material.emissiveTexture.empty() && material.emissiveFactor == glm::vec3(0.0F))
+            material.emissiveFactor = glm::vec3(1.0F);
+    }
+}
+
+MeshImporter::Scene MeshImporter::importPly(const std::filesystem::path& path, ThreadPool& threadPool) {
+    const MappedFile file(path);
+    const std::span<const std::byte> data = file.getData();
+    const std::string_view text(reinterpret_cast<const char*>(data.data()), data.size());
+    const PlyHeader header = parsePlyHeader(text);
+
+    const auto vertexElement = std::ranges::find(header.elements, "vertex", &PlyElement::name);
+    const auto faceElement = std::ranges::find(header.elements, "face", &PlyElement::name);
+    if (vertexElement == header.elements.end() || faceElement == header.elements.end())
+        throw std::runtime_error("Failed to import \"" + path.string() + "\": vertex or face element missing");
+    if (vertexElement->count >= MISSING)
+        throw std::runtime_error("Failed to import \"" + path.string() + "\": too many vertices");
+
+    const std::array<int, PLY_ATTRIBUTE_COUNT> attributes = findPlyVertexAttributes(*vertexElement);
+    const int faceIndices = findPlyProperty(*faceElement, { "vertex_indices", "vertex_index" });
+    if (attributes[0] == -1 || attributes[1] == -1 || attributes[2] == -1 || faceIndices == -1 || !faceElement->properties[faceIndices].isList)
+        throw std::runtime_error("Failed to import \"" + path.string() + "\": vertex positions or face indices missing");
+
+    const bool hasNormals = attributes[3] != -1 && attributes[4] != -1 && attributes[5] != -1;
+    const bool hasUvs = attributes[6] != -1 && attributes[7] != -1;
+    const size_t vertexCount = vertexElement->count;
+    std::vector<glm::vec3> positions(vertexCount);
+    std::vector<glm::vec3> normals(vertexCount, glm::vec3(0.0F));
+    std::vector<glm::vec2> uvs(vertexCount, glm::vec2(0.0F));
+    std::vector<uint32_t> indices;
+
+    const auto storeVertex = [&](size_t vertex, const std::array<double, PLY_ATTRIBUTE_COUNT>& values) {
+        positions[vertex] = glm::vec3(values[0], values[1], values[2]);
+        if (hasNormals)
+            normals[vertex] = glm::vec3(values[3], values[4], values[5]);
+        if (hasUvs)
+            uvs[vertex] = glm::vec2(values[6], 1.0 - values[7]);   // Bottom left origin like OBJ
+    };
+
+    const auto storeFace = [&](std::span<const uint32_t> polygon, uint32_t* output) {
+        for (const uint32_t index : polygon) {
+            if (index >= vertexCount)
+                throw std::runtime_error("Corrupted PLY file \"" + path.string() + "\": face index out of range");
+        }
+        for (size_t i = 1; i + 1 < polygon.size(); i++) {
+            *output++ = polygon[0];
+            *output++ = polygon[i];
+            *output++ = polygon[i + 1];
+        }
+    };
+
+
+    if (header.format == PlyHeader::Format::Ascii) {
+        // Whitespace separated values, elements in header order. Read sequentially as the line of each element isn't known in advance
+        const char* p = text.data() + header.dataOffset;
+        const char* const end = text.data() + text.size();
+        const auto readValue = [&]() {
+            while (p < end && (isBlank(*p) || *p == '\n'))
+                p++;
+            double value = 0;
+            if (!parseDouble(p, end, value))
+                throw std::runtime_error("Corrupted PLY file \"" + path.string() + "\": invalid value at byte " + std::to_string(p - text.data()));
+            return value;
+        };
+
+        std::vector<uint32_t> polygon;
+        for (const PlyElement& element : header.elements) {
+            for (size_t i = 0; i < element.count; i++) {
+                std::array<double, PLY_ATTRIBUTE_COUNT> values{};
+                for (size_t property = 0; property < element.properties.size(); property++) {
+                    if (!element.properties[property].isList) {
+                        const double value = readValue();
+                        const auto attribute = std::ranges::find(attributes, static_cast<int>(property));
+                        if (&element == &*vertexElement && attribute != attributes.end())
+                            values[static_cast<size_t>(attribute - attributes.begin())] = value;
+                        continue;
+                    }
+
+                    const double count = readValue();
+                    if (count < 0)
+                        throw std::runtime_error("Corrupted PLY file \"" + path.string() + "\": negative list size");
+                    polygon.resize(static_cast<size_t>(count));
+                    for (uint32_t& index : polygon)
+                        index = static_cast<uint32_t>(readValue());
+                    if (&element == &*faceElement && static_cast<int>(property) == faceIndices && polygon.size() >= 3) {
+                        const size_t first = indices.size();
+                        indices.resize(first + ((polygon.size() - 2) * 3));
+                        storeFace(polygon, indices.data() + first);
+                    }
+                }
+
+                if (&element == &*vertexElement)
+                    storeVertex(i, values);
+            }
+        }
+    } else {
+        // Elements are laid out one after the other: fixed size ones are skipped at once, the others by reading their list counts.
+        // The faces are indexed by blocks of PLY_BLOCK_SIZE on the way, so that both vertices and faces can then be decoded in parallel
+        const bool swapBytes = (header.format == PlyHeader::Format::BinaryBigEndian) != (std::endian::native == std::endian::big);
+        const auto truncated = [&]() {
+            return std::runtime_error("Corrupted PLY file \"" + path.string() + "\": truncated data");
+        };
+
+        size_t vertexOffset = 0;
+        std::vector<size_t> faceBlockOffsets;
+        std::vector<size_t> faceBlockTriangles;     // Triangle offset of every block, then the total
+        size_t offset = header.dataOffset;
+        for (const PlyElement& element : header.elements) {
+            const bool hasLists = std::ranges::any_of(element.properties, &PlyProperty::isList);
+            if (&element == &*vertexElement) {
+                if (hasLists)
+                    throw std::runtime_error("Failed to import \"" + path.string() + "\": list properties in vertices are not supported");
+                vertexOffset = offset;
+            }
+
+            if (!hasLists) {
+                size_t stride = 0;
+                for (const PlyProperty& property : element.properties)
+                    stride += getPlyTypeSize(property.type);
+                if (stride != 0 && element.count > (data.size() - offset) / stride)
+                    throw truncated();
+                offset += element.count * stride;
+                continue;
+            }
+
+            size_t triangleCount = 0;
+            for (size_t i = 0; i < element.count; i++) {
+                if (&element == &*faceElement && i % PLY_BLOCK_SIZE == 0) {
+                    faceBlockOffsets.push_back(offset);
+                    faceBlockTriangles.push_back(triangleCount);
+                }
+
+                for (size_t property = 0; property < element.properties.size(); property++) {
+                    const PlyProperty& plyProperty = element.properties[property];
+                    size_t size = getPlyTypeSize(plyProperty.type);
+                    if (plyProperty.isList) {
+                        const size_t countSize = getPlyTypeSize(plyProperty.countType);
+                        if (countSize > data.size() - offset)
+                            throw truncated();
+
+                        const auto count = static_cast<size_t>(readPlyValue(data.data() + offset, plyProperty.countType, swapBytes));
+                        if (static_cast<int>(property) == faceIndices && count >= 3)
+                            triangleCount += count - 2;
+                        offset += countSize;
+                        size *= count;
+                    }
+
+                    if (size > data.size() - offset)
+                        throw truncated();
+                    offset += size;
+                }
+            }
+            if (&element == &*faceElement)
+                faceBlockTriangles.push_back(triangleCount);
+        }
+
+
+        std::array<size_t, PLY_ATTRIBUTE_COUNT> vertexOffsets{};
+        std::array<PlyType, PLY_ATTRIBUTE_COUNT> vertexTypes{};
+        size_t vertexStride = 0;
+        for (size_t property = 0; property < vertexElement->properties.size(); property++) {
+            const auto attribute = std::ranges::find(attributes, static_cast<int>(property));
+            if (attribute != attributes.end()) {
+                vertexOffsets[static_cast<size_t>(attribute - attributes.begin())] = vertexStride;
+                vertexTypes[static_cast<size_t>(attribute - attributes.begin())] = vertexElement->properties[property].type;
+            }
+            vertexStride += getPlyTypeSize(vertexElement->properties[property].type);
+        }
+
+        threadPool.parallelFor((vertexCount + PLY_BLOCK_SIZE - 1) / PLY_BLOCK_SIZE, [&](size_t block) {
+            const size_t last = std::min(vertexCount, (block + 1) * PLY_BLOCK_SIZE);
+            for (size_t vertex = block * PLY_BLOCK_SIZE; vertex < last; vertex++) {
+                const std::byte* record = data.data() + vertexOffset + (vertex * vertexStride);
+                std::array<double, PLY_ATTRIBUTE_COUNT> values{};
+                for (size_t attribute = 0; attribute < PLY_ATTRIBUTE_COUNT; attribute++) {
+                    if (attributes[attribute] != -1)
+                        values[attribute] = readPlyValue(record + vertexOffsets[attribute], vertexTypes[attribute], swapBytes);
+                }
+                storeVertex(vertex, values);
+            }
+        });
+
+        indices.resize(faceBlockTriangles.empty() ? 0 : faceBlockTriangles.back() * 3);
+        threadPool.parallelFor(faceBlockOffsets.size(), [&](size_t block) {
+            const size_t last = std::min(faceElement->count, (block + 1) * PLY_BLOCK_SIZE);
+            size_t faceOffset = faceBlockOffsets[block];
+            uint32_t* output = indices.data() + (faceBlockTriangles[block] * 3);
+            std::vector<uint32_t> polygon;
+
+            for (size_t face = block * PLY_BLOCK_SIZE; face < last; face++) {
+                for (size_t property = 0; property < faceElement->properties.size(); property++) {
+                    const PlyProperty& plyProperty = faceElement->properties[property];
+                    const size_t size = getPlyTypeSize(plyProperty.type);
+                    if (!plyProperty.isList) {
+                        faceOffset += size;
+                        continue;
+                    }
+
+                    const auto count = static_cast<size_t>(readPlyValue(data.data() + faceOffset, plyProperty.countType, swapBytes));
+                    faceOffset += getPlyTypeSize(plyProperty.countType);
+                    if (static_cast<int>(property) == faceIndices) {
+                        polygon.resize(count);
+                        for (size_t i = 0; i < count; i++)
+                            polygon[i] = static_cast<uint32_t>(readPlyValue(data.data() + faceOffset + (i * size), plyProperty.type, swapBytes));
+                        if (count >= 3) {
+                            storeFace(polygon, output);
+                            output += (count - 2) * 3;
+                        }
+                    }
+                    faceOffset += count * size;
+                }
+            }
+        });
+    }
+
+    if (indices.size() / 3 >= MISSING / 3)
+        throw std::runtime_error("Failed to import \"" + path.string() + "\": too many triangles");
+    if (indices.empty())
+        return {};
+
+
+    // A single material, textured by the file named in the header if any
+    Scene scene;
+    Material& material = scene.materials.emplace_back();
+    if (!header.textureFile.empty()) {
+        material.baseColorTexture = header.textureFile;
+        std::ranges::replace(material.baseColorTexture, '\\', '/');
+    }
+
+    if (!hasNormals)
+        generateNormals(positions, indices, normals, std::vector<bool>(vertexCount, true));
+    scene.primitives.push_back(packPrimitive(0, positions, normals, uvs, indices));
+    return scene;
+}
@@ -0,0 +1,290 @@
+#include "Converter/MeshSimplifier.hpp"
+
+#include "shared.hpp"
+
+#include "glm/geometric.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace {
+    // Weights of the attribute differences in the collapse cost, relative to the squared mesh extent
+    constexpr double NORMAL_WEIGHT = 0.0025;
+    constexpr double UV_WEIGHT = 0.01;
+
+    struct Quadric {
+        double a2 = 0, b2 = 0, c2 = 0, d2 = 0;
+        double ab = 0, ac = 0, ad = 0;
+        double bc = 0, bd = 0, cd = 0;
+        double weight = 0;
+
+        void addPlane(const glm::dvec3& normal, double d, double planeWeight) {
+            a2 += normal.x * normal.x * planeWeight;
+            b2 += normal.y * normal.y * planeWeight;
+            c2 += normal.z * normal.z * planeWeight;
+            d2 += d * d * planeWeight;
+            ab += normal.x * normal.y * planeWeight;
+            ac += normal.x * normal.z * planeWeight;
+            ad += normal.x * d * planeWeight;
+            bc += normal.y * normal.z * planeWeight;
+            bd += normal.y * d * planeWeight;
+            cd += normal.z * d * planeWeight;
+            weight += planeWeight;
+        }
+
+        void add(const Quadric& other) {
+            a2 += other.a2; b2 += other.b2; c2 += other.c2; d2 += other.d2;
+            ab += other.ab; ac += other.ac; ad += other.ad;
+            bc += other.bc; bd += other.bd; cd += other.cd;
+            weight += other.weight;
+        }
+
+        // Area weighted mean of the squared distances from p to the accumulated planes
+        [[nodiscard]] double evaluate(const glm::dvec3& p) const {
+            const double error = (a2 * p.x * p.x) + (b2 * p.y * p.y) + (c2 * p.z * p.z) + d2
+                + 2 * ((ab * p.x * p.y) + (ac * p.x * p.z) + (bc * p.y * p.z))
+                + 2 * ((ad * p.x) + (bd * p.y) + (cd * p.z));
+            return weight > 0 ? std::abs(error) / weight : 0;
+        }
+    };
+
+    struct Collapse {
+        uint32_t from;
+        uint32_t to;
+        double cost;            // Geometric & attribute cost, used to order and bound the collapses
+        double geometricCost;   // Squared distance to the original planes only, the deviation reported for the LOD
+    };
+
+    // Vertex -> triangles adjacency, in compressed rows
+    struct Adjacency {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> triangles;
+
+        void build(const std::vector<uint32_t>& indices, size_t vertexCount) {
+            offsets.assign(vertexCount + 1, 0);
+            for (const uint32_t index : indices)
+                offsets[index + 1]++;
+            for (size_t i = 0; i < vertexCount; i++)
+                offsets[i + 1] += offsets[i];
+
+            triangles.resize(indices.size());
+            std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); i++)
+                triangles[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    };
+
+    glm::dvec3 position(const std::vector<Vertex>& vertices, uint32_t index) {
+        return glm::dvec3(vertices[index].position);
+    }
+
+    /**
+     * @brief Lock the vertices that belong to a border or non-manifold edge.
+     * Since glTF vertices are split on UV and normal seams, this also locks every attribute seam.
+     */
+    std::vector<bool> findLockedVertices(const std::vector<uint32_t>& indices, size_t vertexCount) {
+        std::vector<uint64_t> edges;
+        edges.reserve(indices.size());
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            for (size_t e = 0; e < 3; e++) {
+                const uint64_t a = indices[i + e];
+                const uint64_t b = indices[i + ((e + 1) % 3)];
+                edges.push_back((std::min(a, b) << 32) | std::max(a, b));
+            }
+        }
+        std::ranges::sort(edges);
+
+        std::vector<bool> locked(vertexCount, false);
+        for (size_t i = 0; i < edges.size();) {
+            size_t j = i;
+            while (j < edges.size() && edges[j] == edges[i])
+                j++;
+
+            if (j - i != 2) {
+                locked[edges[i] >> 32] = true;
+                locked[edges[i] & 0xFFFFFFFF] = true;
+            }
+            i = j;
+        }
+
+        return locked;
+    }
+
+    /**
+     * @brief Check that moving "from" onto "to" doesn't flip or collapse any of the remaining triangles around "from".
+     */
+    bool collapseFlipsTriangles(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const Adjacency& adjacency, uint32_t from, uint32_t to) {
+        const glm::dvec3 target = position(vertices, to);
+
+        for (uint32_t i = adjacency.offsets[from]; i < adjacency.offsets[from + 1]; i++) {
+            const uint32_t* triangle = &indices[static_cast<size_t>(adjacency.triangles[i]) * 3];
+            if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+                continue;   // Removed by the collapse
+
+            const glm::dvec3 p0 = position(vertices, triangle[0]);
+            const glm::dvec3 p1 = position(vertices, triangle[1]);
+            const glm::dvec3 p2 = position(vertices, triangle[2]);
+            const glm::dvec3 oldNormal = glm::cross(p1 - p0, p2 - p0);
+
+            const glm::dvec3 q0 = triangle[0] == from ? target : p0;
+            const glm::dvec3 q1 = triangle[1] == from ? target : p1;
+            const glm::dvec3 q2 = triangle[2] == from ? target : p2;
+            const glm::dvec3 newNormal = glm::cross(q1 - q0, q2 - q0);
+
+            if (glm::dot(oldNormal, newNormal) <= 0.25 * glm::length(oldNormal) * glm::length(newNormal))
+                return true;
+        }
+
+        return false;
+    }
+}   // namespace
+
+MeshSimplifier::Result MeshSimplifier::simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, size_t targetIndexCount, float maxError) {
+    Result result{ .indices = indices, .error = 0 };
+    if (indices.size() <= targetIndexCount || vertices.empty())
+        return result;
+
+
+    // Mesh extent, used to make the errors scale independent
+    glm::dvec3 boundsMin = position(vertices, 0);
+    glm::dvec3 boundsMax = boundsMin;
+    for (const Vertex& vertex : vertices) {
+        boundsMin = glm::min(boundsMin, glm::dvec3(vertex.position));
+        boundsMax = glm::max(boundsMax, glm::dvec3(vertex.position));
+    }
+    const double extent = std::max(glm::length(boundsMax - boundsMin), 1e-12);
+    const double maxCost = static_cast<double>(maxError) * maxError * extent * extent;
+
+
+    // Per vertex quadrics, accumulated from the planes of their triangles weighted by area
+    std::vector<Quadric> quadrics(vertices.size());
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        const glm::dvec3 p0 = position(vertices, indices[i]);
+        const glm::dvec3 normal = glm::cross(position(vertices, indices[i + 1]) - p0, position(vertices, indices[i + 2]) - p0);
+        const double doubleArea = glm::length(normal);
+        if (doubleArea <= 0)
+            continue;
+
+        const glm::dvec3 unitNormal = normal / doubleArea;
+        for (size_t j = 0; j < 3; j++)
+            quadrics[indices[i + j]].addPlane(unitNormal, -glm::dot(unitNormal, p0), doubleArea * 0.5);
+    }
+
+    const std::vector<bool> locked = findLockedVertices(indices, vertices.size());
+
+    const auto evaluateCollapse = [&](uint32_t from, uint32_t to) {
+        if (locked[from])
+            return Collapse{ from, to, std::numeric_limits<double>::max(), std::numeric_limits<double>::max() };
+
+        Quadric quadric = quadrics[from];
+        quadric.add(quadrics[to]);
+
+        const glm::dvec3 normalDelta = glm::dvec3(vertices[from].normal - vertices[to].normal);
+        const glm::dvec2 uvDelta = glm::dvec2(vertices[from].uv - vertices[to].uv);
+        const double attributeCost = ((NORMAL_WEIGHT * glm::dot(normalDelta, normalDelta)) + (UV_WEIGHT * glm::dot(uvDelta, uvDelta))) * extent * extent;
+        const double geometricCost = quadric.evaluate(position(vertices, to));
+
+        return Collapse{ from, to, geometricCost + attributeCost, geometricCost };
+    };
+
+
+    // Collapse passes: each pass collapses the cheapest independent edges, then compacts the index buffer
+    std::vector<uint32_t> remap(vertices.size());
+    std::vector<bool> touched(vertices.size());
+    std::vector<Collapse> collapses;
+    std::vector<uint64_t> edges;
+    Adjacency adjacency;
+    double resultGeometricCost = 0;
+
+    while (result.indices.size() > targetIndexCount) {
+        adjacency.build(result.indices, vertices.size());
+
+        // Unique edges of the current triangle list
+        edges.clear();
+        for (size_t i = 0; i < result.indices.size(); i += 3) {
+            for (size_t e = 0; e < 3; e++) {
+                const uint64_t a = result.indices[i + e];
+                const uint64_t b = result.indices[i + ((e + 1) % 3)];
+                edges.push_back((std::min(a, b) << 32) | std::max(a, b));
+            }
+        }
+        std::ranges::sort(edges);
+        edges.erase(std::ranges::unique(edges).begin(), edges.end());
+
+
+        // Best direction of each edge, locked vertices can only be collapse targets
+        collapses.clear();
+        for (const uint64_t edge : edges) {
+            const auto a = static_cast<uint32_t>(edge >> 32);
+            const auto b = static_cast<uint32_t>(edge & 0xFFFFFFFF);
+
+            const Collapse collapseAB = evaluateCollapse(a, b);
+            const Collapse collapseBA = evaluateCollapse(b, a);
+            const Collapse& collapse = collapseAB.cost <= collapseBA.cost ? collapseAB : collapseBA;
+
+            if (collapse.cost <= maxCost)
+                collapses.push_back(collapse);
+        }
+        std::ranges::sort(collapses, {}, &Collapse::cost);
+
+
+        // Apply collapses, a vertex can only be involved in one collapse per pass so that flip checks stay valid
+        for (size_t i = 0; i < remap.size(); i++)
+            remap[i] = static_cast<uint32_t>(i);
+        std::fill(touched.begin(), touched.end(), false);
+
+        const size_t trianglesToRemove = (result.indices.size() - targetIndexCount) / 3;
+        size_t removedTriangles = 0;
+        size_t collapseCount = 0;
+
+        for (const Collapse& collapse : collapses) {
+            if (touched[collapse.from] || touched[collapse.to])
+                continue;
+            if (collapseFlipsTriangles(vertices, result.indices, adjacency, collapse.from, collapse.to))
+                continue;
+
+            for (uint32_t i = adjacency.offsets[collapse.from]; i < adjacency.offsets[collapse.from + 1]; i++) {
+                const uint32_t* triangle = &result.indices[static_cast<size_t>(adjacency.triangles[i]) * 3];
+                touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+                    removedTriangles++;
+            }
+
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            resultGeometricCost = std::max(resultGeometricCost, collapse.geometricCost);
+            collapseCount++;
+
+            if (removedTriangles >= trianglesToRemove)
+                break;
+        }
+
+        if (collapseCount == 0)
+            break;
+
+
+        // Remap & drop degenerate triangles
+        size_t writeIndex = 0;
+        for (size_t i = 0; i < result.indices.size(); i += 3) {
+            const uint32_t a = remap[result.indices[i]];
+            const uint32_t b = remap[result.indices[i + 1]];
+            const uint32_t c = remap[result.indices[i + 2]];
+            if (a == b || b == c || a == c)
+                continue;
+
+            result.indices[writeIndex++] = a;
+            result.indices[writeIndex++] = b;
+            result.indices[writeIndex++] = c;
+        }
+        result.indices.resize(writeIndex);
+    }
+
+    // The attribute costs only steer the collapses, the reported error is the geometric deviation the LOD selection compares to the screen
+    result.error = static_cast<float>(std::sqrt(resultGeometricCost));
+    return result;
+}
@@ -0,0 +1,475 @@
+#include "Converter/MeshoptDecoder.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define KELP_SSE2
+#endif
+
+namespace {
+    constexpr uint8_t VERTEX_HEADER = 0xA0;
+    constexpr uint8_t INDEX_HEADER = 0xE0;
+    constexpr uint8_t SEQUENCE_HEADER = 0xD0;
+
+    constexpr size_t BYTE_GROUP_SIZE = 16;
+    constexpr size_t BYTE_GROUP_DECODE_LIMIT = 24;  // Biggest group: 8 bytes of 4-bit values & 16 escaped bytes
+    constexpr size_t VERTEX_BLOCK_SIZE_BYTES = 8192;
+    constexpr size_t VERTEX_BLOCK_MAX_SIZE = 256;
+    constexpr size_t VERTEX_MAX_STRIDE = 256;
+    constexpr size_t TAIL_MIN_SIZE = 32;            // The last vertex, padded so that the groups can always be read at once
+    constexpr size_t INDEX_CODE_AUX_TABLE_SIZE = 16;
+
+    size_t getVertexBlockSize(size_t stride) {
+        const size_t size = (VERTEX_BLOCK_SIZE_BYTES / stride) & ~(BYTE_GROUP_SIZE - 1);
+        return std::min(size, VERTEX_BLOCK_MAX_SIZE);
+    }
+
+    [[maybe_unused]] uint8_t unzigzag8(uint8_t value) {
+        return static_cast<uint8_t>(-(value & 1) ^ (value >> 1));
+    }
+
+    uint32_t unzigzag32(uint32_t value) {
+        return (0U - (value & 1)) ^ (value >> 1);
+    }
+
+    /**
+     * @brief Unpack a group of 16 values of 2^bitsLog2 bits, most significant first.
+     * With 2 or 4 bits, the all ones value escapes to a full byte stored after the group.
+     */
+    const uint8_t* decodeBytesGroup(const uint8_t* data, uint8_t* dst, uint32_t bitsLog2) {
+        switch (bitsLog2) {
+            case 0:
+                std::memset(dst, 0, BYTE_GROUP_SIZE);
+                return data;
+
+            case 1:
+            case 2: {
+                const uint32_t bits = 1U << bitsLog2;
+                const auto escape = static_cast<uint8_t>((1U << bits) - 1);
+                const uint8_t* escaped = data + (BYTE_GROUP_SIZE * bits / 8);
+                for (size_t i = 0; i < BYTE_GROUP_SIZE; i++) {
+                    const size_t bit = i * bits;
+                    const auto value = static_cast<uint8_t>((data[bit / 8] >> (8 - bits - (bit % 8))) & escape);
+                    dst[i] = value == escape ? *escaped++ : value;
+                }
+                return escaped;
+            }
+
+            default:
+                std::memcpy(dst, data, BYTE_GROUP_SIZE);
+                return data + BYTE_GROUP_SIZE;
+        }
+    }
+
+    /**
+     * @brief Unpack a byte plane of size values (a multiple of 16), preceded by the 2-bit sizes of its groups.
+     */
+    const uint8_t* decodeBytes(const uint8_t* data, const uint8_t* end, uint8_t* dst, size_t size) {
+        const uint8_t* header = data;
+        const size_t headerSize = ((size / BYTE_GROUP_SIZE) + 3) / 4;
+        if (static_cast<size_t>(end - data) < headerSize)
+            throw std::runtime_error("Corrupted meshopt vertex stream: truncated group header");
+        data += headerSize;
+
+        for (size_t i = 0; i < size; i += BYTE_GROUP_SIZE) {
+            if (static_cast<size_t>(end - data) < BYTE_GROUP_DECODE_LIMIT)
+                throw std::runtime_error("Corrupted meshopt vertex stream: truncated byte group");
+
+            const size_t group = i / BYTE_GROUP_SIZE;
+            const uint32_t bitsLog2 = (header[group / 4] >> ((group % 4) * 2)) & 3;
+            data = decodeBytesGroup(data, dst + i, bitsLog2);
+        }
+
+        return data;
+    }
+
+    /**
+     * @brief Turn 4 byte planes of zigzagged deltas into 4 bytes of count vertices, starting from the previous vertex.
+     * Planes are VERTEX_BLOCK_MAX_SIZE apart and padded to a multiple of 16 values.
+     */
+    void decodeDeltas(const uint8_t* planes, uint8_t* dst, size_t count, size_t stride, const uint8_t* previous) {
+        #ifdef KELP_SSE2
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i one = _mm_set1_epi8(1);
+            const __m128i lowBits = _mm_set1_epi8(0x7F);
+
+            uint32_t previousVertex = 0;
+            std::memcpy(&previousVertex, previous, sizeof(uint32_t));
+            __m128i carry = _mm_set1_epi32(static_cast<int>(previousVertex));
+
+            for (size_t i = 0; i < count; i += BYTE_GROUP_SIZE) {
+                const __m128i plane0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes + i));
+                const __m128i plane1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes + VERTEX_BLOCK_MAX_SIZE + i));
+                const __m128i plane2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes + (2 * VERTEX_BLOCK_MAX_SIZE) + i));
+                const __m128i plane3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes + (3 * VERTEX_BLOCK_MAX_SIZE) + i));
+
+                // Transposition to 4 vectors of 4 vertices
+                const __m128i pairs01Lo = _mm_unpacklo_epi8(plane0, plane1);
+                const __m128i pairs01Hi = _mm_unpackhi_epi8(plane0, plane1);
+                const __m128i pairs23Lo = _mm_unpacklo_epi8(plane2, plane3);
+                const __m128i pairs23Hi = _mm_unpackhi_epi8(plane2, plane3);
+                const __m128i deltas[4] = {     // Not an std::array, which would drop the vector type attributes
+                    _mm_unpacklo_epi16(pairs01Lo, pairs23Lo),
+                    _mm_unpackhi_epi16(pairs01Lo, pairs23Lo),
+                    _mm_unpacklo_epi16(pairs01Hi, pairs23Hi),
+                    _mm_unpackhi_epi16(pairs01Hi, pairs23Hi),
+                };
+
+                for (size_t j = 0; j < 4; j++) {
+                    // Unzigzag, then prefix sum of the 4 vertices on top of the previous one
+                    __m128i vertices = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(deltas[j], 1), lowBits), _mm_sub_epi8(zero, _mm_and_si128(deltas[j], one)));
+                    vertices = _mm_add_epi8(vertices, _mm_slli_si128(vertices, 4));
+                    vertices = _mm_add_epi8(vertices, _mm_slli_si128(vertices, 8));
+                    vertices = _mm_add_epi8(vertices, carry);
+                    carry = _mm_shuffle_epi32(vertices, 0xFF);
+
+                    for (size_t vertex = i + (j * 4); vertex < std::min(count, i + (j * 4) + 4); vertex++) {
+                        const auto value = static_cast<uint32_t>(_mm_cvtsi128_si32(vertices));
+                        std::memcpy(dst + (vertex * stride), &value, sizeof(uint32_t));
+                        vertices = _mm_srli_si128(vertices, 4);
+                    }
+                }
+            }
+        #else
+            for (size_t j = 0; j < 4; j++) {
+                uint8_t value = previous[j];
+                for (size_t i = 0; i < count; i++) {
+                    value = static_cast<uint8_t>(value + unzigzag8(planes[(j * VERTEX_BLOCK_MAX_SIZE) + i]));
+                    dst[(i * stride) + j] = value;
+                }
+            }
+        #endif
+    }
+
+    void decodeVertexBlock(const uint8_t*& data, const uint8_t* end, uint8_t* dst, size_t count, size_t stride, uint8_t* lastVertex) {
+        std::array<uint8_t, 4 * VERTEX_BLOCK_MAX_SIZE> planes{};
+        const size_t alignedCount = (count + BYTE_GROUP_SIZE - 1) & ~(BYTE_GROUP_SIZE - 1);
+
+        // The byte planes are stored one after the other, the strides being multiples of 4 they are decoded 4 at a time
+        for (size_t k = 0; k < stride; k += 4) {
+            for (size_t j = 0; j < 4; j++)
+                data = decodeBytes(data, end, planes.data() + (j * VERTEX_BLOCK_MAX_SIZE), alignedCount);
+
+            decodeDeltas(planes.data(), dst + k, count, stride, lastVertex + k);
+        }
+
+        std::memcpy(lastVertex, dst + (stride * (count - 1)), stride);
+    }
+
+    uint32_t decodeVByte(const uint8_t*& data) {
+        const uint8_t lead = *data++;
+        if (lead < 128)
+            return lead;
+
+        uint32_t result = lead & 127U;
+        uint32_t shift = 7;
+        for (int i = 0; i < 4; i++) {
+            const uint8_t group = *data++;
+            result |= static_cast<uint32_t>(group & 127U) << shift;
+            shift += 7;
+            if (group < 128)
+                break;
+        }
+        return result;
+    }
+
+    void writeIndex(std::byte* dst, size_t index, size_t stride, uint32_t value) {
+        if (stride == 2) {
+            const auto shortValue = static_cast<uint16_t>(value);
+            std::memcpy(dst + (index * 2), &shortValue, sizeof(uint16_t));
+        } else {
+            std::memcpy(dst + (index * 4), &value, sizeof(uint32_t));
+        }
+    }
+
+    template <typename T>
+    T roundToInteger(float value) {
+        return static_cast<T>(static_cast<int>(value + (value >= 0.0F ? 0.5F : -0.5F)));
+    }
+
+    template <typename T>
+    void decodeOctahedralFilter(T* data, size_t count) {
+        const auto max = static_cast<float>((1 << ((sizeof(T) * 8) - 1)) - 1);
+
+        for (size_t i = 0; i < count; i++) {
+            // z encodes 1 at the same scale as x & y, the octahedron is unfolded for the lower hemisphere
+            float x = static_cast<float>(data[(i * 4) + 0]);
+            float y = static_cast<float>(data[(i * 4) + 1]);
+            const float z = static_cast<float>(data[(i * 4) + 2]) - std::abs(x) - std::abs(y);
+
+            const float t = std::min(z, 0.0F);
+            x += x >= 0.0F ? t : -t;
+            y += y >= 0.0F ? t : -t;
+
+            const float scale = max / std::sqrt((x * x) + (y * y) + (z * z));
+            data[(i * 4) + 0] = roundToInteger<T>(x * scale);
+            data[(i * 4) + 1] = roundToInteger<T>(y * scale);
+            data[(i * 4) + 2] = roundToInteger<T>(z * scale);
+        }
+    }
+
+    void decodeQuaternionFilter(int16_t* data, size_t count) {
+        const float scale = 1.0F / std::sqrt(2.0F);
+
+        for (size_t i = 0; i < count; i++) {
+            // The 4th component holds the index of the biggest component in its 2 low bits, and the scale of the other ones
+            const int16_t packed = data[(i * 4) + 3];
+            const float componentScale = scale / static_cast<float>(packed | 3);
+
+            const float x = static_cast<float>(data[(i * 4) + 0]) * componentScale;
+            const float y = static_cast<float>(data[(i * 4) + 1]) * componentScale;
+            const float z = static_cast<float>(data[(i * 4) + 2]) * componentScale;
+            const float w = std::sqrt(std::max(1.0F - (x * x) - (y * y) - (z * z), 0.0F));
+
+            const auto biggest = static_cast<size_t>(packed & 3);
+            data[(i * 4) + ((biggest + 1) & 3)] = roundToInteger<int16_t>(x * 32767.0F);
+            data[(i * 4) + ((biggest + 2) & 3)] = roundToInteger<int16_t>(y * 32767.0F);
+            data[(i * 4) + ((biggest + 3) & 3)] = roundToInteger<int16_t>(z * 32767.0F);
+            data[(i * 4) + biggest] = roundToInteger<int16_t>(w * 32767.0F);
+        }
+    }
+
+    /**
+     * @brief Expand count values of a signed 24-bit mantissa & a signed 8-bit exponent to floats, in place.
+     */
+    void decodeExponentialFilter(uint32_t* data, size_t count) {
+        size_t i = 0;
+
+        #ifdef KELP_SSE2
+            const __m128i bias = _mm_set1_epi32(127);
+            for (; i + 4 <= count; i += 4) {
+                const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+                const __m128i mantissas = _mm_srai_epi32(_mm_slli_epi32(values, 8), 8);
+                const __m128i exponents = _mm_srai_epi32(values, 24);
+                const __m128 powers = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(exponents, bias), 23));
+                _mm_storeu_ps(reinterpret_cast<float*>(data + i), _mm_mul_ps(powers, _mm_cvtepi32_ps(mantissas)));
+            }
+        #endif
+
+        for (; i < count; i++) {
+            const int32_t mantissa = static_cast<int32_t>(data[i] << 8) >> 8;
+            const int32_t exponent = static_cast<int32_t>(data[i]) >> 24;
+            const float value = std::bit_cast<float>(static_cast<uint32_t>(exponent + 127) << 23) * static_cast<float>(mantissa);
+            data[i] = std::bit_cast<uint32_t>(value);
+        }
+    }
+}   // namespace
+
+void MeshoptDecoder::decode(std::span<const std::byte> src, std::span<std::byte> dst, size_t count, size_t stride, Mode mode, Filter filter) {
+    if (dst.size() != count * stride)
+        throw std::runtime_error("Failed to decode meshopt buffer: destination is " + std::to_string(dst.size()) + " bytes instead of " + std::to_string(count * stride));
+    if (mode != Mode::Attributes && (stride != 2 && stride != 4))
+        throw std::runtime_error("Failed to decode meshopt buffer: invalid index stride " + std::to_string(stride));
+    if (mode != Mode::Attributes && filter != Filter::None)
+        throw std::runtime_error("Failed to decode meshopt buffer: filters only apply to attributes");
+    if (count == 0)
+        return;
+
+    const std::span<const uint8_t> data(reinterpret_cast<const uint8_t*>(src.data()), src.size());
+    switch (mode) {
+        case Mode::Attributes:
+            decodeVertexBuffer(data, reinterpret_cast<uint8_t*>(dst.data()), count, stride);
+            applyFilter(dst.data(), count, stride, filter);
+            break;
+        case Mode::Triangles:
+            decodeIndexBuffer(data, dst.data(), count, stride);
+            break;
+        case Mode::Indices:
+            decodeIndexSequence(data, dst.data(), count, stride);
+            break;
+    }
+}
+
+void MeshoptDecoder::decodeVertexBuffer(std::span<const uint8_t> src, uint8_t* dst, size_t count, size_t stride) {
+    if (stride == 0 || stride > VERTEX_MAX_STRIDE || stride % 4 != 0)
+        throw std::runtime_error("Failed to decode meshopt vertex stream: invalid stride " + std::to_string(stride));
+    if (src.size() < 1 + stride)
+        throw std::runtime_error("Corrupted meshopt vertex stream: truncated header");
+    if ((src[0] & 0xF0) != VERTEX_HEADER || (src[0] & 0x0F) != 0)
+        throw std::runtime_error("Unsupported meshopt vertex stream: header " + std::to_string(src[0]));
+
+    const uint8_t* data = src.data() + 1;
+    const uint8_t* end = src.data() + src.size();
+
+
+    // The first vertex of the buffer is predicted from the one stored at the end, then each block from the last vertex of the previous one
+    std::array<uint8_t, VERTEX_MAX_STRIDE> lastVertex{};
+    std::memcpy(lastVertex.data(), end - stride, stride);
+
+    const size_t blockSize = getVertexBlockSize(stride);
+    for (size_t offset = 0; offset < count; offset += blockSize)
+        decodeVertexBlock(data, end, dst + (offset * stride), std::min(blockSize, count - offset), stride, lastVertex.data());
+
+    if (static_cast<size_t>(end - data) != std::max(stride, TAIL_MIN_SIZE))
+        throw std::runtime_error("Corrupted meshopt vertex stream: unexpected data after the last block");
+}
+
+void MeshoptDecoder::decodeIndexBuffer(std::span<const uint8_t> src, std::byte* dst, size_t count, size_t stride) {
+    if (count % 3 != 0)
+        throw std::runtime_error("Failed to decode meshopt index stream: " + std::to_string(count) + " indices is not a triangle list");
+    if (src.size() < 1 + (count / 3) + INDEX_CODE_AUX_TABLE_SIZE)
+        throw std::runtime_error("Corrupted meshopt index stream: truncated");
+    if ((src[0] & 0xF0) != INDEX_HEADER || (src[0] & 0x0F) > 1)
+        throw std::runtime_error("Unsupported meshopt index stream: header " + std::to_string(src[0]));
+
+    // Each triangle is a code byte referring to the last 16 edges & vertices, or to new and explicitly encoded vertices
+    std::array<std::array<uint32_t, 2>, 16> edgeFifo{};
+    std::array<uint32_t, 16> vertexFifo{};
+    edgeFifo.fill({ UINT32_MAX, UINT32_MAX });
+    vertexFifo.fill(UINT32_MAX);
+    size_t edgeFifoOffset = 0;
+    size_t vertexFifoOffset = 0;
+
+    const auto pushEdge = [&](uint32_t a, uint32_t b) {
+        edgeFifo[edgeFifoOffset] = { a, b };
+        edgeFifoOffset = (edgeFifoOffset + 1) & 15;
+    };
+    const auto pushVertex = [&](uint32_t vertex, bool condition = true) {
+        vertexFifo[vertexFifoOffset] = vertex;
+        vertexFifoOffset = (vertexFifoOffset + static_cast<size_t>(condition)) & 15;
+    };
+    const auto decodeIndex = [](const uint8_t*& data, uint32_t last) {
+        return last + unzigzag32(decodeVByte(data));
+    };
+
+    uint32_t next = 0;
+    uint32_t last = 0;
+    const uint32_t maxFifoVertex = (src[0] & 0x0F) >= 1 ? 13 : 15;  // Version 1 uses 13 & 14 for the free indices next to the last one
+
+    const uint8_t* code = src.data() + 1;
+    const uint8_t* data = code + (count / 3);
+    const uint8_t* dataSafeEnd = src.data() + src.size() - INDEX_CODE_AUX_TABLE_SIZE;  // A triangle reads at most 16 bytes, covered by the table
+    const uint8_t* codeAuxTable = dataSafeEnd;
+
+    for (size_t i = 0; i < count; i += 3) {
+        if (data > dataSafeEnd)
+            throw std::runtime_error("Corrupted meshopt index stream: truncated triangle data");
+
+        const uint8_t codeTriangle = *code++;
+        uint32_t a = 0;
+        uint32_t b = 0;
+        uint32_t c = 0;
+
+        if (codeTriangle < 0xF0) {
+            // Edge from the FIFO, third vertex new, from the FIFO or free
+            const size_t edge = codeTriangle >> 4;
+            a = edgeFifo[(edgeFifoOffset - 1 - edge) & 15][0];
+            b = edgeFifo[(edgeFifoOffset - 1 - edge) & 15][1];
+
+            const uint32_t fec = codeTriangle & 15U;
+            if (fec < maxFifoVertex) {
+                c = fec == 0 ? next : vertexFifo[(vertexFifoOffset - 1 - fec) & 15];
+                next += static_cast<uint32_t>(fec == 0);
+                pushVertex(c, fec == 0);
+            } else {
+                last = c = fec != 15 ? last + (fec - (fec ^ 3)) : decodeIndex(data, last);
+                pushVertex(c);
+            }
+
+            pushEdge(c, b);
+            pushEdge(a, c);
+        } else {
+            // Three vertices without a shared edge, described by the table or by an explicit byte
+            const bool fromTable = codeTriangle < 0xFE;
+            const uint8_t codeAux = fromTable ? codeAuxTable[codeTriangle & 15] : *data++;
+            const uint32_t feb = codeAux >> 4;
+            const uint32_t fec = codeAux & 15U;
+
+            if (!fromTable && codeAux == 0)
+                next = 0;
+
+            const bool freeA = !fromTable && codeTriangle == 0xFF;
+            a = freeA ? 0 : next++;
+            b = feb == 0 ? next++ : vertexFifo[(vertexFifoOffset - feb) & 15];
+            c = fec == 0 ? next++ : vertexFifo[(vertexFifoOffset - fec) & 15];
+
+            if (!fromTable) {
+                if (freeA)
+                    last = a = decodeIndex(data, last);
+                if (feb == 15)
+                    last = b = decodeIndex(data, last);
+                if (fec == 15)
+                    last = c = decodeIndex(data, last);
+            }
+
+            pushVertex(a);
+            pushVertex(b, feb == 0 || (!fromTable && feb == 15));
+            pushVertex(c, fec == 0 || (!fromTable && fec == 15));
+
+            pushEdge(b, a);
+            pushEdge(c, b);
+            pushEdge(a, c);
+        }
+
+        writeIndex(dst, i + 0, stride, a);
+        writeIndex(dst, i + 1, stride, b);
+        writeIndex(dst, i + 2, stride, c);
+    }
+
+    if (data != dataSafeEnd)
+        throw std::runtime_error("Corrupted meshopt index stream: unexpected data after the last triangle");
+}
+
+void MeshoptDecoder::decodeIndexSequence(std::span<const uint8_t> src, std::byte* dst, size_t count, size_t stride) {
+    constexpr size_t TAIL_SIZE = 4;     // An index reads at most 5 bytes
+
+    if (src.size() < 1 + count + TAIL_SIZE)
+        throw std::runtime_error("Corrupted meshopt index sequence: truncated");
+    if ((src[0] & 0xF0) != SEQUENCE_HEADER || (src[0] & 0x0F) > 1)
+        throw std::runtime_error("Unsupported meshopt index sequence: header " + std::to_string(src[0]));
+
+    // Every index is a delta against one of two baselines, selected by its low bit
+    const uint8_t* data = src.data() + 1;
+    const uint8_t* dataSafeEnd = src.data() + src.size() - TAIL_SIZE;
+    std::array<uint32_t, 2> last{};
+
+    for (size_t i = 0; i < count; i++) {
+        if (data >= dataSafeEnd)
+            throw std::runtime_error("Corrupted meshopt index sequence: truncated index data");
+
+        const uint32_t value = decodeVByte(data);
+        const uint32_t baseline = value & 1;
+        const uint32_t index = last[baseline] + unzigzag32(value >> 1);
+        last[baseline] = index;
+        writeIndex(dst, i, stride, index);
+    }
+
+    if (data != dataSafeEnd)
+        throw std::runtime_error("Corrupted meshopt index sequence: unexpected data after the last index");
+}
+
+void MeshoptDecoder::applyFilter(std::byte* data, size_t count, size_t stride, Filter filter) {
+    switch (filter) {
+        case Filter::None:
+            break;
+
+        case Filter::Octahedral:
+            if (stride == 4)
+                decodeOctahedralFilter(reinterpret_cast<int8_t*>(data), count);
+            else if (stride == 8)
+                decodeOctahedralFilter(reinterpret_cast<int16_t*>(data), count);
+            else
+                throw std::runtime_error("Failed to decode meshopt buffer: octahedral filter with a stride of " + std::to_string(stride));
+            break;
+
+        case Filter::Quaternion:
+            if (stride != 8)
+                throw std::runtime_error("Failed to decode meshopt buffer: quaternion filter with a stride of " + std::to_string(stride));
+            decodeQuaternionFilter(reinterpret_cast<int16_t*>(data), count);
+            break;
+
+        case Filter::Exponential:
+            decodeExponentialFilter(reinterpret_cast<uint32_t*>(data), count * (stride / 4));
+            break;
+    }
+}
@@ -1,7 +1,16 @@
 #include "Viewer/Viewer.hpp"
 
+#include "Common/AsyncFileReader.hpp"
+#include "Common/BcDecoder.hpp"
+#include "Common/KelpFile.hpp"
+#include "Common/KelpFormat.hpp"
+#include "Common/Lz4.hpp"
+#include "Common/MeshCodec.hpp"
+#include "Common/Xxh64.hpp"
+#include "Viewer/Config.hpp"
 #include "Viewer/Vulkan/Buffer.hpp"
 #include "Viewer/Vulkan/Device.hpp"
+#include "Viewer/Vulkan/HostPointerBuffer.hpp"
 #include "Viewer/Vulkan/Image.hpp"
 #include "Viewer/Vulkan/Utils.hpp"
 #include "shared.hpp"
@@ -9,35 +18,31 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include "fastgltf/types.hpp"
 #include "glm/ext/vector_int2.hpp"
+#include "glm/geometric.hpp"
 #include "glm/gtx/string_cast.hpp"
 #include "omm.hpp"
 #include "stb_image.h"
 #include "vk_mem_alloc.h"
 #include <vulkan/vulkan_core.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <exception>
 #include <filesystem>
-#include <fstream>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <mutex>
+#include <span>
 #include <stdexcept>
-#include <thread>
+#include <utility>
 #include <vector>
 
-struct TextureMetaData {
-    size_t offset;
-    size_t mipLevelCount;
-};
-
-struct KelpMeshInstance {
-    glm::mat4 transform;
-    int meshIndex;
-};
-
 void Viewer::funcTime(const std::string& context, const std::function<void()>& func) {
     const auto timeNow = std::chrono::high_resolution_clock::now();
     func();
@@ -46,562 +51,1108 @@ void Viewer::funcTime(const std::string& context, const std::function<void()>& f
     std::cout << context << " in " << duration << " ms" << std::endl;
 }
 
-void Viewer::loadAndUploadTextureCollection(const std::filesystem::path& filePath, std::ifstream& file, std::vector<Texture>& targetCollection, VkFormat textureFormat, int channelCount) {
-    // Read texture count
-    size_t count = 0;
-    file.read(reinterpret_cast<char*>(&count), sizeof(count));
-    targetCollection.resize(count);
+void Viewer::loadTextureDirectory() {
+    m_textureEntries = m_file->readSection<KelpFormat::TextureEntry>(KelpFormat::SectionType::TextureDirectory);
+    m_textures.resize(m_textureEntries.size());
+    m_decodedTextures.assign(m_textureEntries.size(), false);
+
+    // Validation before anything is allocated, the textures themselves are loaded with the cells using them
+    for (size_t i = 0; i < m_textureEntries.size(); ++i) {
+        const KelpFormat::TextureEntry& entry = m_textureEntries[i];
+        const auto collection = static_cast<size_t>(entry.collection);
+        if (collection >= static_cast<size_t>(KelpFormat::TextureCollection::Count))
+            throw std::runtime_error("Error: Invalid texture collection: " + std::to_string(collection));
+        if (entry.width == 0 || entry.height == 0 || entry.mipCount == 0 || entry.mipCount > KelpFormat::MAX_MIP_COUNT || (entry.channelCount == 0) == (entry.blockSize == 0) || entry.size != KelpFormat::mipOffset(entry, entry.mipCount))
+            throw std::runtime_error("Error: Texture entry is invalid: " + std::to_string(entry.width) + "x" + std::to_string(entry.height) + ", " + std::to_string(entry.mipCount) + " mips");
+
+
+        // Textures passed through from KTX2 are uploaded in their own format, which may be block compressed. The block compressed formats
+        // the device can't sample are decoded on load instead
+        if (entry.vkFormat != VK_FORMAT_UNDEFINED) {
+            VkFormatProperties formatProperties;
+            vkGetPhysicalDeviceFormatProperties(m_device->getPhysicalDevice(), static_cast<VkFormat>(entry.vkFormat), &formatProperties);
+            constexpr VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+            if ((formatProperties.optimalTilingFeatures & requiredFeatures) == requiredFeatures)
+                continue;
+            if (entry.blockSize == 0 || !BcDecoder::getFormat(entry.vkFormat))
+                throw std::runtime_error("Error: Texture format is not supported by the device: VkFormat " + std::to_string(entry.vkFormat));
+            m_decodedTextures[i] = true;
+        }
+    }
+}
+
+uint32_t Viewer::getMipTail(const KelpFormat::TextureEntry& entry) {
+    uint32_t mip = 0;
+    while (mip + 1 < entry.mipCount && std::max(KelpFormat::mipDimension(entry.width, mip), KelpFormat::mipDimension(entry.height, mip)) > Config::TEXTURE_MIP_TAIL_SIZE)
+        mip++;
+    return mip;
+}
 
+void Viewer::createPlaceholderTexture() {
+    // Opaque white, so that a material whose textures aren't resident yet shows its factors
+    m_placeholderTexture = std::make_unique<Image>(m_device, Image::CreateInfo{
+        .extent = VkExtent3D{1, 1, 1},
+        .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+        .format = VK_FORMAT_R8G8B8A8_UNORM,
+        .type = VK_IMAGE_TYPE_2D,
+        .mipLevels = 1,
+    });
 
-    // Read texture metadata (size and offset in the file) to allow for concurrent reading instead
-    std::vector<TextureMetaData> textureMetadata(count);
+    // Every texture of the directory starts at the placeholder slot, the shaders sample textures through this buffer
+    m_textureSlotBuffer = std::make_unique<Buffer>(m_device, std::max<size_t>(m_textureEntries.size(), 1) * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
 
-    for (size_t i = 0; i < count; ++i) {
-        TextureMetaData& tex = textureMetadata[i];
-        file.read(reinterpret_cast<char*>(&tex.mipLevelCount), sizeof(size_t));
-        tex.offset = static_cast<size_t>(file.tellg());
+    VkCommandBuffer commandBuffer = m_device->beginSingleTimeCommands(Device::QueueType::Graphics); {
+        m_placeholderTexture->cmdTransitionLayout(commandBuffer,
+            Image::Layout{ .layout = VK_IMAGE_LAYOUT_UNDEFINED,             .accessMask = 0,                            .stageFlags = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT },
+            Image::Layout{ .layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,  .accessMask = VK_ACCESS_TRANSFER_WRITE_BIT, .stageFlags = VK_PIPELINE_STAGE_TRANSFER_BIT }
+        );
 
-        // Skip the mip levels data
-        for (int j = 0; j < tex.mipLevelCount; j++) {
-            glm::ivec2 mipSize;
-            file.read(reinterpret_cast<char*>(&mipSize), sizeof(glm::ivec2));
-            if (mipSize.x <= 0 || mipSize.y <= 0)
-                throw std::runtime_error("Error: Mip level size is invalid: " + glm::to_string(mipSize));
+        const VkClearColorValue white = { .float32 = {1, 1, 1, 1} };
+        const VkImageSubresourceRange range{ .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 0, .levelCount = 1, .baseArrayLayer = 0, .layerCount = 1 };
+        vkCmdClearColorImage(commandBuffer, m_placeholderTexture->getHandle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &white, 1, &range);
 
-            file.seekg(static_cast<std::streamsize>(static_cast<size_t>(mipSize.x) * mipSize.y * channelCount), std::ios::cur);
-        }
+        m_placeholderTexture->cmdTransitionLayout(commandBuffer,
+            Image::Layout{ .layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,      .accessMask = VK_ACCESS_TRANSFER_WRITE_BIT, .stageFlags = VK_PIPELINE_STAGE_TRANSFER_BIT },
+            Image::Layout{ .layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,  .accessMask = VK_ACCESS_SHADER_READ_BIT,    .stageFlags = VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR }
+        );
+
+        vkCmdFillBuffer(commandBuffer, m_textureSlotBuffer->getHandle(), 0, VK_WHOLE_SIZE, PLACEHOLDER_TEXTURE_SLOT);
+    } m_device->endSingleTimeCommands(Device::QueueType::Graphics, commandBuffer);
+
+    m_descriptorManager.storeSampledImage(m_placeholderTexture->getImageView(), m_defaultSampler, PLACEHOLDER_TEXTURE_SLOT);
+}
+
+void Viewer::createTextureFeedbackBuffers() {
+    // The hit shaders atomically write device local memory, each frame copies it to host memory to be read back once complete & clears it
+    const size_t feedbackSize = std::max<size_t>(m_textureEntries.size(), 1) * sizeof(uint32_t);
+    m_textureFeedbackWindow.assign(m_textureEntries.size(), 0);
+    for (size_t i = 0; i < Config::MAX_FRAMES_IN_FLIGHT; ++i) {
+        m_textureFeedbackBuffers[i] = std::make_unique<Buffer>(m_device, feedbackSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
+        m_textureFeedbackReadbackBuffers[i] = std::make_unique<Buffer>(m_device, feedbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT);
+        std::memset(m_textureFeedbackReadbackBuffers[i]->getMappedData(), 0, feedbackSize);
+        m_textureFeedbackReadbackBuffers[i]->flush();
     }
 
+    VkCommandBuffer commandBuffer = m_device->beginSingleTimeCommands(Device::QueueType::Graphics); {
+        for (const std::unique_ptr<Buffer>& feedbackBuffer : m_textureFeedbackBuffers)
+            vkCmdFillBuffer(commandBuffer, feedbackBuffer->getHandle(), 0, VK_WHOLE_SIZE, 0);
+    } m_device->endSingleTimeCommands(Device::QueueType::Graphics, commandBuffer);
+}
 
-    // Threads & mutex to avoid using the same command buffer at the same time
-    std::vector<std::thread> threads(count);
-    std::mutex commandMutex;
+std::vector<Viewer::Texture> Viewer::loadTextures(const std::vector<uint32_t>& textureIndices, const std::vector<uint32_t>& firstMips) {
+    constexpr std::array<VkFormat, static_cast<size_t>(KelpFormat::TextureCollection::Count)> formats = {
+        VK_FORMAT_R8G8B8A8_UNORM,
+        VK_FORMAT_R8_UNORM,
+        VK_FORMAT_R8G8B8A8_UNORM,
+        VK_FORMAT_R8G8_UNORM,
+        VK_FORMAT_R8G8B8A8_UNORM,
+    };
 
+    // Descriptor slots of the textures, given back by the render thread once no frame in flight samples what they held
+    std::vector<uint32_t> slots;
+    {
+        const std::lock_guard<std::mutex> lock(m_streamingMutex);
+        if (m_freeTextureSlots.size() < textureIndices.size())
+            throw std::runtime_error("Error: Out of texture descriptor slots: " + std::to_string(textureIndices.size()) + " textures to load, " + std::to_string(m_freeTextureSlots.size()) + " free slots");
+        slots.assign(m_freeTextureSlots.end() - static_cast<std::ptrdiff_t>(textureIndices.size()), m_freeTextureSlots.end());
+        m_freeTextureSlots.resize(m_freeTextureSlots.size() - textureIndices.size());
+    }
 
-    // Iterate through all of the textures of the file and load them
-    for (int i = 0; i < textureMetadata.size(); i++) {
-        const TextureMetaData& tex = textureMetadata[i];
 
-        threads.emplace_back([&, i]() {
-            // Open a new stream to allow for concurrent reading
-            std::ifstream file(filePath, std::ios::binary);
-            file.seekg(static_cast<std::streamsize>(tex.offset), std::ios::beg);
+    // Textures whose format supports host image copies are read into host memory and written straight into the image, the others are staged.
+    // The mips are stored from the finest to the coarsest, so only the end of a payload is read from an uncompressed section, and verified
+    // mip by mip. A compressed payload is decoded whole, and its finer mips skipped. The textures decoded on load are read into host memory too
+    const bool partialRanges = (m_file->getSection(KelpFormat::SectionType::TextureData).flags & KelpFormat::SECTION_FLAG_COMPRESSED) == 0;
+    std::vector<Texture> textures(textureIndices.size());
+    std::vector<VkFormat> textureFormats(textureIndices.size());
+    std::vector<bool> hostCopies(textureIndices.size());
+    std::vector<uint64_t> rangeStarts(textureIndices.size());     // In the payload
+    std::vector<FileRange> ranges(textureIndices.size());
+    for (size_t i = 0; i < textureIndices.size(); ++i) {
+        const KelpFormat::TextureEntry& entry = m_textureEntries.at(textureIndices[i]);
+        if (firstMips[i] >= entry.mipCount)
+            throw std::runtime_error("Error: Texture has no mip " + std::to_string(firstMips[i]) + ", only " + std::to_string(entry.mipCount));
+        if (m_decodedTextures[textureIndices[i]])
+            textureFormats[i] = VK_FORMAT_R8G8B8A8_UNORM;
+        else
+            textureFormats[i] = entry.vkFormat != VK_FORMAT_UNDEFINED ? static_cast<VkFormat>(entry.vkFormat) : formats[static_cast<size_t>(entry.collection)];
+        hostCopies[i] = m_device->supportsHostImageCopy(textureFormats[i], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        rangeStarts[i] = partialRanges ? KelpFormat::mipOffset(entry, firstMips[i]) : 0;
+
+        ranges[i] = FileRange{
+            .offset = entry.offset + rangeStarts[i],
+            .size = entry.size - rangeStarts[i],
+            .firstChunk = entry.firstChunk,
+            .checksum = entry.checksum,
+            .hostMemory = hostCopies[i] || m_decodedTextures[textureIndices[i]],
+            .texture = &entry,
+            .firstMip = firstMips[i],
+        };
+    }
 
 
-            // Read first mip level size
-            glm::ivec2 size;
-            file.read(reinterpret_cast<char*>(&size), sizeof(size));
-            if (size.x <= 0 || size.y <= 0)
-                throw std::runtime_error("Error: Texture size is invalid: " + glm::to_string(size));
+    // Upload of every mip level at once, recorded in a batch with the other uploads queued meanwhile
+    const auto stageTexture = [&](size_t i, const KelpFormat::TextureEntry& layout, uint64_t rangeStart, VkBuffer buffer, VkDeviceSize offset) {
+        const std::shared_ptr<Image> image = textures[i].image;
+        const uint32_t firstMip = firstMips[i];
+        const uint32_t mipCount = layout.mipCount - firstMip;
+        return m_stagingUploader.enqueue([image, &layout, firstMip, mipCount, rangeStart, buffer, offset](const StagingUploader::Commands& commands) {
+            image->cmdTransitionLayout(commands.transfer, Image::Layout{
+                .layout = VK_IMAGE_LAYOUT_UNDEFINED,
+                .accessMask = 0,
+                .stageFlags = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+            }, Image::Layout{
+                .layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                .accessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                .stageFlags = VK_PIPELINE_STAGE_TRANSFER_BIT,
+            });
+
+            for (uint32_t j = 0; j < mipCount; ++j) {
+                image->cmdCopyFromBuffer(commands.transfer, buffer, {
+                    .width = KelpFormat::mipDimension(layout.width, firstMip + j),
+                    .height = KelpFormat::mipDimension(layout.height, firstMip + j),
+                    .depth = 1,
+                }, j, offset + (KelpFormat::mipOffset(layout, firstMip + j) - rangeStart));
+            }
 
+            StagingUploader::cmdHandOver(commands, *image, Image::Layout{
+                .layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                .accessMask = VK_ACCESS_SHADER_READ_BIT,
+                .stageFlags = VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR,
+            });
+        });
+    };
 
-            // Read first mip level data
-            std::vector<uint8_t> textureData(static_cast<size_t>(size.x) * size.y * channelCount);
-            file.read(reinterpret_cast<char*>(textureData.data()), static_cast<std::streamsize>(textureData.size()));
-            if (file.gcount() != static_cast<std::streamsize>(textureData.size()))
-                throw std::runtime_error("Error: Texture data read failed");
 
+    // Every texture is uploaded as soon as its memory is filled, while the next ones are still being read
+    std::vector<KelpFormat::TextureEntry> decodedLayouts(textureIndices.size());   // Of the RGBA8 mips of the decoded textures
+    std::vector<std::vector<uint8_t>> decodedPayloads(textureIndices.size());
+    uploadFileRanges(KelpFormat::SectionType::TextureData, ranges, [&](size_t i, const UploadSource& source) {
+        const KelpFormat::TextureEntry& entry = m_textureEntries[textureIndices[i]];
+        const bool hostCopy = hostCopies[i];
+        const uint32_t firstMip = firstMips[i];
+        const uint32_t mipCount = entry.mipCount - firstMip;
+
+
+        // Image creation
+        const Image::CreateInfo imageCreateInfo{
+            .extent = VkExtent3D{KelpFormat::mipDimension(entry.width, firstMip), KelpFormat::mipDimension(entry.height, firstMip), 1},
+            .usage = static_cast<VkImageUsageFlags>(VK_IMAGE_USAGE_SAMPLED_BIT | (hostCopy ? VK_IMAGE_USAGE_HOST_TRANSFER_BIT : VK_IMAGE_USAGE_TRANSFER_DST_BIT)),
+            .format = textureFormats[i],
+            .type = VK_IMAGE_TYPE_2D,
+            .mipLevels = static_cast<uint8_t>(mipCount),
+        };
+        const std::shared_ptr<Image> image = std::make_shared<Image>(m_device, imageCreateInfo);
+        textures[i] = Texture{
+            .image = image,
+            .bindlessId = slots[i],
+        };
+
+
+        // Blocks the device can't sample are decoded by this thread, the texels replace the payload as the source of the upload
+        const KelpFormat::TextureEntry* layout = &entry;
+        const std::byte* data = source.data;
+        uint64_t rangeStart = rangeStarts[i];
+        if (m_decodedTextures[textureIndices[i]]) {
+            KelpFormat::TextureEntry& decodedLayout = decodedLayouts[i];
+            decodedLayout = entry;
+            decodedLayout.channelCount = 4;
+            decodedLayout.vkFormat = VK_FORMAT_UNDEFINED;
+            decodedLayout.blockSize = 0;
+
+            const BcDecoder::Format format = *BcDecoder::getFormat(entry.vkFormat);
+            decodedPayloads[i].resize(KelpFormat::mipOffset(decodedLayout, entry.mipCount) - KelpFormat::mipOffset(decodedLayout, firstMip));
+            for (uint32_t j = firstMip; j < entry.mipCount; ++j) {
+                const auto* blocks = reinterpret_cast<const uint8_t*>(source.data + (KelpFormat::mipOffset(entry, j) - rangeStart));
+                BcDecoder::decode(std::span(blocks, KelpFormat::mipSize(entry, j)), std::span(decodedPayloads[i]).subspan(KelpFormat::mipOffset(decodedLayout, j) - KelpFormat::mipOffset(decodedLayout, firstMip), KelpFormat::mipSize(decodedLayout, j)), KelpFormat::mipDimension(entry.width, j), KelpFormat::mipDimension(entry.height, j), format);
+            }
+
+            layout = &decodedLayout;
+            data = reinterpret_cast<const std::byte*>(decodedPayloads[i].data());
+            rangeStart = KelpFormat::mipOffset(decodedLayout, firstMip);
+        }
 
-            // Image creation
-            const Image::CreateInfo imageCreateInfo{
-                .extent = VkExtent3D{static_cast<uint32_t>(size.x), static_cast<uint32_t>(size.y), 1},
-                .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
-                .format = textureFormat,
-                .type = VK_IMAGE_TYPE_2D,
-                .mipLevels = static_cast<uint8_t>(tex.mipLevelCount),
-            };
-            const std::shared_ptr<Image> image = std::make_shared<Image>(m_device, imageCreateInfo);
-
-
-            // First mip level staging buffer creation & mapping
-            Buffer stagingBuffer = Buffer(m_device, static_cast<size_t>(size.x * size.y * channelCount), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
-            void *mappedData = nullptr;
-            stagingBuffer.map(&mappedData);
-            memcpy(mappedData, textureData.data(), static_cast<size_t>(size.x) * size.y * channelCount);
-            stagingBuffer.unmap();
-
-
-            // Transitionning the whole image to transfer dst and copying the first mip level
-            commandMutex.lock();
-            VkCommandBuffer commandBuffer = m_device->beginSingleTimeCommands(Device::QueueType::Graphics); {
-                image->cmdTransitionLayout(commandBuffer, Image::Layout{
-                    .layout = VK_IMAGE_LAYOUT_UNDEFINED,
-                    .accessMask = 0,
-                    .stageFlags = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                }, Image::Layout{
-                    .layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                    .accessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-                    .stageFlags = VK_PIPELINE_STAGE_TRANSFER_BIT,
-                });
 
-                image->cmdCopyFromBuffer(commandBuffer, stagingBuffer.getHandle(), {
-                    .width = static_cast<uint32_t>(size.x),
-                    .height = static_cast<uint32_t>(size.y),
+        // Host copy of every mip level by this thread, without command buffer: the image is ready once it returns
+        if (hostCopy) {
+            image->transitionLayoutOnHost(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            for (uint32_t j = 0; j < mipCount; ++j) {
+                image->copyFromMemory(data + (KelpFormat::mipOffset(*layout, firstMip + j) - rangeStart), {
+                    .width = KelpFormat::mipDimension(entry.width, firstMip + j),
+                    .height = KelpFormat::mipDimension(entry.height, firstMip + j),
                     .depth = 1,
-                }, 0);
-            } m_device->endSingleTimeCommands(Device::QueueType::Graphics, commandBuffer);
-            commandMutex.unlock();
-
-
-            // Reading the rest of the mip levels
-            for (size_t j = 1; j < tex.mipLevelCount; j++) {
-                // Read mip level size
-                file.read(reinterpret_cast<char*>(&size), sizeof(size));
-                if (size.x <= 0 || size.y <= 0)
-                    throw std::runtime_error("Error: Texture size is invalid: " + glm::to_string(size));
-
-                // Read mip level data
-                file.read(reinterpret_cast<char*>(textureData.data()), static_cast<int>(size.x * size.y * channelCount));
-                if (file.gcount() != static_cast<int>(size.x * size.y * channelCount))
-                    throw std::runtime_error("Error: Texture data read failed");
-
-                // Staging buffer creation & mapping
-                stagingBuffer.map(&mappedData);
-                memcpy(mappedData, textureData.data(), static_cast<size_t>(size.x) * size.y * channelCount);
-                stagingBuffer.unmap();
-
-                // Data upload to gpu
-                commandMutex.lock();
-                commandBuffer = m_device->beginSingleTimeCommands(Device::QueueType::Graphics); {
-                    image->cmdCopyFromBuffer(commandBuffer, stagingBuffer.getHandle(), {
-                        .width = static_cast<uint32_t>(size.x),
-                        .height = static_cast<uint32_t>(size.y),
-                        .depth = 1,
-                    }, j);
-                } m_device->endSingleTimeCommands(Device::QueueType::Graphics, commandBuffer);
-                commandMutex.unlock();
+                }, j, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
             }
+            decodedPayloads[i] = {};
+            return;
+        }
 
+        // Decoded texels are staged once the file ranges no longer hold staging memory
+        if (m_decodedTextures[textureIndices[i]])
+            return;
 
-            // Transitionning the whole image to shader read only
-            commandMutex.lock();
-            commandBuffer = m_device->beginSingleTimeCommands(Device::QueueType::Graphics); {
-                image->cmdTransitionLayout(commandBuffer, Image::Layout{
-                    .layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                    .accessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-                    .stageFlags = VK_PIPELINE_STAGE_TRANSFER_BIT,
-                }, Image::Layout{
-                    .layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                    .accessMask = VK_ACCESS_SHADER_READ_BIT,
-                    .stageFlags = VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR,
-                });
-            } m_device->endSingleTimeCommands(Device::QueueType::Graphics, commandBuffer);
-            commandMutex.unlock();
+        stageTexture(i, entry, rangeStart, source.buffer, source.offset);
+    });
 
+    for (size_t i = 0; i < textureIndices.size(); ++i) {
+        if (decodedPayloads[i].empty())
+            continue;
 
-            // Adding image to the collection
-            targetCollection[i] = Texture{
-                .image = image,
-                .bindlessId = m_descriptorManager.storeSampledImage(image->getImageView(), m_defaultSampler),
-            };
-        });
+        StagingUploader::Allocation allocation = m_stagingUploader.allocate(decodedPayloads[i].size());
+        std::memcpy(allocation.data, decodedPayloads[i].data(), decodedPayloads[i].size());
+        const uint64_t ticket = stageTexture(i, decodedLayouts[i], KelpFormat::mipOffset(decodedLayouts[i], firstMips[i]), allocation.buffer, allocation.offset);
+        m_stagingUploader.release(std::move(allocation), ticket);
     }
 
 
-    // Wait for all threads to finish
-    for (auto& thread : threads) {
-        if (thread.joinable()) {
-            thread.join();
-        }
-    }
+    // Stored in their slots once uploaded, the render thread points their directory entries at them when it handles their event
+    m_stagingUploader.wait(m_stagingUploader.getLastTicket());
+    for (const Texture& texture : textures)
+        m_descriptorManager.storeSampledImage(texture.image->getImageView(), m_defaultSampler, texture.bindlessId);
+
+    return textures;
 }
 
-void Viewer::loadMaterials(std::ifstream& file) {
-    // Read material count
-    size_t count = 0;
-    file.read(reinterpret_cast<char*>(&count), sizeof(count));
-    m_materials.resize(count);
+void Viewer::uploadFileRanges(KelpFormat::SectionType section, const std::vector<FileRange>& ranges, const std::function<void(size_t, const UploadSource&)>& upload) {
+    const bool compressed = (m_file->getSection(section).flags & KelpFormat::SECTION_FLAG_COMPRESSED) != 0;
+    const std::vector<KelpFormat::ChunkEntry> chunks = compressed ? m_file->readSection<KelpFormat::ChunkEntry>(KelpFormat::SectionType::ChunkDirectory) : std::vector<KelpFormat::ChunkEntry>();
 
 
-    // Read material data
-    file.read(reinterpret_cast<char*>(m_materials.data()), static_cast<std::streamsize>(sizeof(Material) * count));
+    // Bytes to read for every range, the chunks of a compressed range are validated before anything is allocated
+    std::vector<uint64_t> readSizes(ranges.size());
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        if (!compressed) {
+            readSizes[i] = ranges[i].size;
+            continue;
+        }
 
+        const uint64_t chunkCount = KelpFormat::chunkCount(ranges[i].size);
+        if (ranges[i].firstChunk + chunkCount > chunks.size())
+            throw std::runtime_error("Error: Chunk index out of bounds: " + std::to_string(ranges[i].firstChunk + chunkCount) + " > " + std::to_string(chunks.size()));
 
-    // Transition from material index to bindless index
-    for (auto& material : m_materials) {
-        if (material.baseColorTexture != -1)
-            material.baseColorTexture = static_cast<int>(m_albedoTextures[material.baseColorTexture].bindlessId);
-        if (material.alphaTexture != -1)
-            material.alphaTexture = static_cast<int>(m_alphaTextures[material.alphaTexture].bindlessId);
-        if (material.metallicRoughnessTexture != -1)
-            material.metallicRoughnessTexture = static_cast<int>(m_metallicRoughnessTextures[material.metallicRoughnessTexture].bindlessId);
-        if (material.normalTexture != -1)
-            material.normalTexture = static_cast<int>(m_normalTextures[material.normalTexture].bindlessId);
-        if (material.emissiveTexture != -1)
-            material.emissiveTexture = static_cast<int>(m_emissiveTextures[material.emissiveTexture].bindlessId);
+        uint64_t chunkOffset = ranges[i].offset;
+        for (uint64_t j = 0; j < chunkCount; ++j) {
+            const KelpFormat::ChunkEntry& chunk = chunks[ranges[i].firstChunk + j];
+            if (chunk.offset != chunkOffset || chunk.size != std::min(KelpFormat::COMPRESSION_CHUNK_SIZE, ranges[i].size - (j * KelpFormat::COMPRESSION_CHUNK_SIZE)) || chunk.compressedSize > chunk.size)
+                throw std::runtime_error("Error: Chunk entry is invalid: " + std::to_string(chunk.compressedSize) + " bytes at " + std::to_string(chunk.offset) + " for " + std::to_string(chunk.size) + " bytes");
+            chunkOffset += chunk.compressedSize;
+        }
+        readSizes[i] = chunkOffset - ranges[i].offset;
     }
 
 
-    // Create material buffer
-    const Buffer materialStagingBuffer = Buffer(m_device, m_materials.size() * sizeof(Material), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
-    void *mappedData = nullptr;
-    materialStagingBuffer.map(&mappedData);
-    memcpy(mappedData, m_materials.data(), m_materials.size() * sizeof(Material));
-    materialStagingBuffer.unmap();
+    std::atomic<uint64_t> decompressionNanoseconds = 0;
+    uint64_t compressedSize = 0;
+    uint64_t decompressedSize = 0;
 
+    for (size_t batchBegin = 0; batchBegin < ranges.size();) {
+        // Batches are bounded in staging and read memory, a range bigger than the bound gets a batch of its own
+        size_t batchEnd = batchBegin;
+        uint64_t batchSize = 0;
+        while (batchEnd < ranges.size() && (batchEnd == batchBegin || batchSize + ranges[batchEnd].size + (compressed ? readSizes[batchEnd] : 0) <= Config::MAX_STAGING_BATCH_SIZE)) {
+            batchSize += ranges[batchEnd].size + (compressed ? readSizes[batchEnd] : 0);
+            batchEnd++;
+        }
 
-    // Buffer creation
-    m_materialBuffer = std::make_unique<Buffer>(m_device, m_materials.size() * sizeof(Material), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
-    VkCommandBuffer commandBuffer = m_device->beginSingleTimeCommands(Device::Graphics); {
-        m_materialBuffer->copyFrom(commandBuffer, materialStagingBuffer.getHandle(), m_materials.size() * sizeof(Material));
-    } m_device->endSingleTimeCommands(Device::Graphics, commandBuffer);
-}
 
-void Viewer::loadMeshes(std::ifstream& file) {
-    // Read mesh count
-    size_t count = 0;
-    file.read(reinterpret_cast<char*>(&count), sizeof(count));
-    m_meshes.resize(count);
+        // Sources of the uploads: staging or host memory filled by the reader (or by the decompression of what it read), or the pages
+        // of the mapped file imported as a buffer. Every range is handed off to the thread pool for upload once filled
+        std::vector<UploadSource> sources(batchEnd - batchBegin);
+        std::vector<std::byte*> destinations(batchEnd - batchBegin);
+        std::vector<StagingUploader::Allocation> stagingAllocations(batchEnd - batchBegin);
+        std::vector<std::unique_ptr<std::byte[]>> hostMemory(batchEnd - batchBegin);
+        std::vector<std::shared_ptr<HostPointerBuffer>> importedBuffers;
+        std::vector<size_t> importedRanges;
+        std::vector<std::vector<std::byte>> compressedData(compressed ? batchEnd - batchBegin : 0);
+        std::vector<std::atomic<uint64_t>> remainingChunks(batchEnd - batchBegin);
+        std::vector<AsyncFileReader::Request> requests;
+        requests.reserve(batchEnd - batchBegin);
+
+        for (size_t i = batchBegin; i < batchEnd; ++i) {
+            UploadSource& source = sources[i - batchBegin];
+            if (ranges[i].hostMemory) {
+                hostMemory[i - batchBegin] = std::make_unique_for_overwrite<std::byte[]>(ranges[i].size);
+                destinations[i - batchBegin] = hostMemory[i - batchBegin].get();
+                source = UploadSource{ .data = destinations[i - batchBegin], .buffer = VK_NULL_HANDLE, .offset = 0 };
+            } else if (std::shared_ptr<HostPointerBuffer> importedBuffer = compressed ? nullptr : importMappedRange(ranges[i].offset, ranges[i].size)) {
+                const VkDeviceSize alignment = m_device->getMinImportedHostPointerAlignment();
+                source = UploadSource{ .data = m_file->view(ranges[i].offset, ranges[i].size).data(), .buffer = importedBuffer->getHandle(), .offset = ranges[i].offset % alignment };
+                importedBuffers.push_back(std::move(importedBuffer));
+                importedRanges.push_back(i);
+                continue;
+            } else {
+                stagingAllocations[i - batchBegin] = m_stagingUploader.allocate(ranges[i].size);
+                destinations[i - batchBegin] = stagingAllocations[i - batchBegin].data;
+                source = UploadSource{ .data = destinations[i - batchBegin], .buffer = stagingAllocations[i - batchBegin].buffer, .offset = stagingAllocations[i - batchBegin].offset };
+            }
 
+            if (!compressed) {
+                requests.push_back(AsyncFileReader::Request{
+                    .offset = ranges[i].offset,
+                    .size = ranges[i].size,
+                    .dst = destinations[i - batchBegin],
+                    .onComplete = [&, i]() {
+                        m_threadPool.submit([&, i]() {
+                            verifyFileRange(section, ranges[i], sources[i - batchBegin].data);
+                            upload(i, sources[i - batchBegin]);
+                        });
+                    },
+                });
+                continue;
+            }
 
-    // Read mesh data
-    for (size_t i = 0; i < count; ++i) {
-        // Read material index
-        size_t materialIndex = 0;
-        file.read(reinterpret_cast<char*>(&materialIndex), sizeof(size_t));
-        if (materialIndex >= m_materials.size())
-            throw std::runtime_error("Error: Material index out of bounds: " + std::to_string(materialIndex) + " >= " + std::to_string(m_materials.size()));
+            // Every chunk is verified and decompressed by its own task, the last one to finish uploads the range
+            compressedData[i - batchBegin].resize(readSizes[i]);
+            requests.push_back(AsyncFileReader::Request{
+                .offset = ranges[i].offset,
+                .size = readSizes[i],
+                .dst = compressedData[i - batchBegin].data(),
+                .onComplete = [&, i]() {
+                    const uint64_t chunkCount = KelpFormat::chunkCount(ranges[i].size);
+                    remainingChunks[i - batchBegin] = chunkCount;
+                    if (chunkCount == 0) {
+                        m_threadPool.submit([&, i]() { upload(i, sources[i - batchBegin]); });
+                        return;
+                    }
+
+                    for (uint64_t j = 0; j < chunkCount; ++j) {
+                        m_threadPool.submit([&, i, j]() {
+                            const KelpFormat::ChunkEntry& chunk = chunks[ranges[i].firstChunk + j];
+                            const std::byte* src = compressedData[i - batchBegin].data() + (chunk.offset - ranges[i].offset);
+                            std::byte* dst = destinations[i - batchBegin] + (j * KelpFormat::COMPRESSION_CHUNK_SIZE);
+
+                            verifyChecksum(section, chunk.offset, src, chunk.compressedSize, chunk.checksum);
+
+                            const auto timeStart = std::chrono::high_resolution_clock::now();
+                            if (chunk.compressedSize == chunk.size)
+                                std::memcpy(dst, src, chunk.size);
+                            else
+                                Lz4::decompress(src, chunk.compressedSize, dst, chunk.size);
+                            decompressionNanoseconds += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - timeStart).count());
+
+                            if (--remainingChunks[i - batchBegin] == 0)
+                                upload(i, sources[i - batchBegin]);
+                        });
+                    }
+                },
+            });
 
+            compressedSize += readSizes[i];
+            decompressedSize += ranges[i].size;
+        }
 
-        // Read omm index
-        int ommIndex = -1;
-        VkMicromapEXT micromap = VK_NULL_HANDLE;
 
-        std::unique_ptr<Buffer> micromapBuffer;
-        std::unique_ptr<Buffer> ommIndexBuffer;
+        // The imported ranges are already in memory, they are verified and uploaded while the others are read
+        // The uploads already handed off must be queued before the staging memory is released, even if a read failed
+        std::exception_ptr exception;
+        try {
+            for (const size_t i : importedRanges) {
+                m_threadPool.submit([&, i]() {
+                    verifyFileRange(section, ranges[i], sources[i - batchBegin].data);
+                    upload(i, sources[i - batchBegin]);
+                });
+            }
+            m_reader->read(requests);
+        } catch (...) {
+            exception = std::current_exception();
+        }
 
-        std::vector<VkMicromapUsageEXT> blasOmmUsageCounts;
-        VkAccelerationStructureTrianglesOpacityMicromapEXT ommLinkInfo{};
+        try {
+            m_threadPool.waitIdle();
+        } catch (...) {
+            if (!exception)
+                exception = std::current_exception();
+        }
 
-        file.read(reinterpret_cast<char*>(&ommIndex), sizeof(int));
-        if (ommIndex != -1) {
-            const omm::Cpu::BakeResultDesc& bakeResultDesc = m_ommBakeResults.at(ommIndex);
 
+        // Reused once every copy queued so far is complete, without waiting for them here
+        const uint64_t ticket = m_stagingUploader.getLastTicket();
+        for (StagingUploader::Allocation& stagingAllocation : stagingAllocations) {
+            if (stagingAllocation.buffer != VK_NULL_HANDLE)
+                m_stagingUploader.release(std::move(stagingAllocation), ticket);
+        }
+        for (std::shared_ptr<HostPointerBuffer>& importedBuffer : importedBuffers)
+            m_stagingUploader.retain(std::move(importedBuffer), ticket);
+        if (exception)
+            std::rethrow_exception(exception);
 
-            // Get micromap build size
-            std::vector<VkMicromapUsageEXT> usages(bakeResultDesc.descArrayHistogramCount);
-            for (uint32_t i = 0; i < bakeResultDesc.descArrayHistogramCount; ++i) {
-                usages[i] = VkMicromapUsageEXT{
-                    .count = bakeResultDesc.descArrayHistogram[i].count,
-                    .subdivisionLevel = bakeResultDesc.descArrayHistogram[i].subdivisionLevel,
-                    .format = bakeResultDesc.descArrayHistogram[i].format,
-                };
-            }
+        batchBegin = batchEnd;
+    }
 
-            VkMicromapBuildInfoEXT micromapBuildInfo = {
-                .sType = VK_STRUCTURE_TYPE_MICROMAP_BUILD_INFO_EXT,
-                .type = VK_MICROMAP_TYPE_OPACITY_MICROMAP_EXT,
-                .flags = VK_BUILD_MICROMAP_PREFER_FAST_TRACE_BIT_EXT,
-                .mode = VK_BUILD_MICROMAP_MODE_BUILD_EXT,
-                .usageCountsCount = static_cast<uint32_t>(usages.size()),
-                .pUsageCounts = usages.data(),
-            };
+    if (compressed && decompressionNanoseconds > 0) {
+        std::cout << "Decompressed " << decompressedSize / 1024 / 1024 << " MB of " << KelpFormat::getSectionName(section) << " from " << compressedSize / 1024 / 1024 << " MB ("
+            << static_cast<double>(decompressedSize) / static_cast<double>(std::max<uint64_t>(compressedSize, 1)) << "x) at " << static_cast<double>(decompressedSize) / static_cast<double>(decompressionNanoseconds) << " GB/s per thread, "
+            << m_threadPool.getThreadCount() << " threads" << std::endl;
+    }
+}
 
-            VkMicromapBuildSizesInfoEXT buildSizes = { .sType = VK_STRUCTURE_TYPE_MICROMAP_BUILD_SIZES_INFO_EXT };
-            vkGetMicromapBuildSizesEXT(m_device->getHandle(), VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &micromapBuildInfo, &buildSizes);
-
-
-            // Creating buffers
-            micromapBuffer = std::make_unique<Buffer>(m_device, buildSizes.micromapSize, VK_BUFFER_USAGE_MICROMAP_STORAGE_BIT_EXT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
-            Buffer scratchBuffer = Buffer(m_device, buildSizes.buildScratchSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
-
-            Buffer ommArrayDataBuffer = Buffer(m_device, bakeResultDesc.arrayDataSize, VK_BUFFER_USAGE_MICROMAP_BUILD_INPUT_READ_ONLY_BIT_EXT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, 0, 256);
-            Buffer arrayDataStagingBuffer = Buffer(m_device, bakeResultDesc.arrayDataSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
-            void *mapped = nullptr;
-            arrayDataStagingBuffer.map(&mapped);
-            memcpy(mapped, bakeResultDesc.arrayData, bakeResultDesc.arrayDataSize);
-            arrayDataStagingBuffer.unmap();
-
-            Buffer ommDescArrayBuffer = Buffer(m_device, bakeResultDesc.descArrayCount * sizeof(VkMicromapTriangleEXT), VK_BUFFER_USAGE_MICROMAP_BUILD_INPUT_READ_ONLY_BIT_EXT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, 0, 256);
-            Buffer triangleDataStagingBuffer = Buffer(m_device, bakeResultDesc.descArrayCount * sizeof(VkMicromapTriangleEXT), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
-            triangleDataStagingBuffer.map(&mapped);
-            memcpy(mapped, bakeResultDesc.descArray, bakeResultDesc.descArrayCount * sizeof(VkMicromapTriangleEXT));
-            triangleDataStagingBuffer.unmap();
-
-
-            // Micromap creation
-            const VkMicromapCreateInfoEXT micromapCreateInfo = {
-                .sType = VK_STRUCTURE_TYPE_MICROMAP_CREATE_INFO_EXT,
-                .createFlags = 0,
-                .buffer = micromapBuffer->getHandle(),
-                .offset = 0,
-                .size = buildSizes.micromapSize,
-                .type = VK_MICROMAP_TYPE_OPACITY_MICROMAP_EXT,
-                .deviceAddress = 0,
-            };
+uint64_t Viewer::uploadToBuffer(const Buffer& buffer, const void* data, VkDeviceSize size, VkDeviceSize offset, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask) {
+    // Staged in the ring and copied on the transfer queue with the other uploads, the buffer must outlive the copy
+    StagingUploader::Allocation allocation = m_stagingUploader.allocate(size);
+    std::memcpy(allocation.data, data, size);
 
-            VK_CHECK(vkCreateMicromapEXT(m_device->getHandle(), &micromapCreateInfo, nullptr, &micromap));
+    const uint64_t ticket = m_stagingUploader.enqueue([&buffer, stagingBuffer = allocation.buffer, stagingOffset = allocation.offset, size, offset, dstAccessMask, dstStageMask](const StagingUploader::Commands& commands) {
+        buffer.copyFrom(commands.transfer, stagingBuffer, size, stagingOffset, offset);
+        StagingUploader::cmdHandOver(commands, buffer, dstAccessMask, dstStageMask, offset, size);
+    });
+    m_stagingUploader.release(std::move(allocation), ticket);
+    return ticket;
+}
 
+std::unique_ptr<HostPointerBuffer> Viewer::importMappedRange(uint64_t offset, uint64_t size) const {
+    if (!m_importPayloads || size < Config::MIN_IMPORTED_PAYLOAD_SIZE || offset + size > m_file->getHeader().fileSize)
+        return nullptr;
 
-            // Uploading data to gpu
-            VkCommandBuffer commandBuffer = m_device->beginSingleTimeCommands(Device::QueueType::Graphics); {
-                const VkBufferCopy copyRegionArray = { .srcOffset = 0, .dstOffset = 0, .size = bakeResultDesc.arrayDataSize };
-                vkCmdCopyBuffer(commandBuffer, arrayDataStagingBuffer.getHandle(), ommArrayDataBuffer.getHandle(), 1, &copyRegionArray);
+    // Whole pages around the range. The import alignment can be coarser than the mapping pages, so the end of a payload at the end of
+    // the file may be rounded past the mapping, in which case it is read instead
+    const VkDeviceSize alignment = m_device->getMinImportedHostPointerAlignment();
+    const uint64_t begin = offset - (offset % alignment);
+    const uint64_t end = (offset + size + alignment - 1) / alignment * alignment;
+    if (end > m_file->getMappedSize())
+        return nullptr;
 
-                const VkBufferCopy copyRegionTriangle = { .srcOffset = 0, .dstOffset = 0, .size = bakeResultDesc.descArrayCount * sizeof(VkMicromapTriangleEXT) };
-                vkCmdCopyBuffer(commandBuffer, triangleDataStagingBuffer.getHandle(), ommDescArrayBuffer.getHandle(), 1, &copyRegionTriangle);
-            }   m_device->endSingleTimeCommands(Device::QueueType::Graphics, commandBuffer);
+    return HostPointerBuffer::tryImport(m_device, m_file, m_file->view(offset, size).data() - (offset - begin), end - begin);
+}
 
+void Viewer::verifyChecksum(KelpFormat::SectionType section, uint64_t offset, const void* data, uint64_t size, uint64_t checksum) {
+    if (Xxh64::hash(data, size) != checksum)
+        throw std::runtime_error("Error: Corrupted " + std::string(KelpFormat::getSectionName(section)) + " at offset " + std::to_string(offset) + ", run --verify on the file");
+}
 
-            // Micromap build
-            commandBuffer = m_device->beginSingleTimeCommands(Device::QueueType::Graphics); {
-                micromapBuildInfo.flags = VK_BUILD_MICROMAP_PREFER_FAST_TRACE_BIT_EXT;
-                micromapBuildInfo.dstMicromap = micromap;
-                micromapBuildInfo.data = { .deviceAddress = ommArrayDataBuffer.getDeviceAddress() };
-                micromapBuildInfo.scratchData = { .deviceAddress = scratchBuffer.getDeviceAddress() };
-                micromapBuildInfo.triangleArray = { .deviceAddress = ommDescArrayBuffer.getDeviceAddress() };
-                micromapBuildInfo.triangleArrayStride = sizeof(VkMicromapTriangleEXT);
+void Viewer::verifyFileRange(KelpFormat::SectionType section, const FileRange& range, const std::byte* data) {
+    if (range.texture == nullptr) {
+        verifyChecksum(section, range.offset, data, range.size, range.checksum);
+        return;
+    }
 
-                vkCmdBuildMicromapsEXT(commandBuffer, 1, &micromapBuildInfo);
-            }   m_device->endSingleTimeCommands(Device::QueueType::Graphics, commandBuffer);
+    uint64_t mipOffset = 0;
+    for (uint32_t level = range.firstMip; level < range.texture->mipCount; ++level) {
+        const uint64_t mipSize = KelpFormat::mipSize(*range.texture, level);
+        verifyChecksum(section, range.offset + mipOffset, data + mipOffset, mipSize, range.texture->mipChecksums[level]);
+        mipOffset += mipSize;
+    }
+}
 
+StagingUploader::Allocation Viewer::decodeMeshPayload(const KelpFormat::MeshEntry& entry, const std::byte* payload) {
+    KelpFormat::EncodedMeshHeader header{};
+    std::memcpy(&header, payload, sizeof(KelpFormat::EncodedMeshHeader));
 
-            // OMM index buffer
-            const VkIndexType indexType = bakeResultDesc.indexFormat == omm::IndexFormat::UINT_16 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
-            ommIndexBuffer = std::make_unique<Buffer>(m_device, bakeResultDesc.indexCount * (bakeResultDesc.indexFormat == omm::IndexFormat::UINT_16 ? sizeof(uint16_t) : sizeof(uint32_t)), VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
 
-            Buffer ommIndexStagingBuffer(m_device, bakeResultDesc.indexFormat == omm::IndexFormat::UINT_16 ? bakeResultDesc.indexCount * sizeof(uint16_t) : bakeResultDesc.indexCount * sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
-            ommIndexStagingBuffer.map(&mapped);
-            memcpy(mapped, bakeResultDesc.indexBuffer, bakeResultDesc.indexCount * (bakeResultDesc.indexFormat == omm::IndexFormat::UINT_16 ? sizeof(uint16_t) : sizeof(uint32_t)));
-            ommIndexStagingBuffer.unmap();
+    // Streams, validated against the entry: vertices, indices, then the indices of every LOD
+    std::vector<std::span<const std::byte>> streams(2 + entry.lodCount);
+    uint64_t streamOffset = sizeof(KelpFormat::EncodedMeshHeader);
+    for (size_t j = 0; j < streams.size(); ++j) {
+        if (header.streamSizes[j] > entry.size - streamOffset)
+            throw std::runtime_error("Error: Encoded mesh stream out of bounds: " + std::to_string(header.streamSizes[j]) + " bytes at " + std::to_string(streamOffset) + " in a " + std::to_string(entry.size) + " bytes payload");
 
-            commandBuffer = m_device->beginSingleTimeCommands(Device::QueueType::Graphics); {
-                ommIndexBuffer->copyFrom(commandBuffer, ommIndexStagingBuffer.getHandle(), bakeResultDesc.indexCount * (bakeResultDesc.indexFormat == omm::IndexFormat::UINT_16 ? sizeof(uint16_t) : sizeof(uint32_t)));
-            } m_device->endSingleTimeCommands(Device::QueueType::Graphics, commandBuffer);
+        streams[j] = std::span(payload + streamOffset, header.streamSizes[j]);
+        streamOffset += header.streamSizes[j];
+    }
 
-            blasOmmUsageCounts.resize(bakeResultDesc.indexHistogramCount);
-            for (uint32_t i = 0; i < bakeResultDesc.indexHistogramCount; ++i) {
-                blasOmmUsageCounts[i] = VkMicromapUsageEXT{
-                    .count = bakeResultDesc.indexHistogram[i].count,
-                    .subdivisionLevel = bakeResultDesc.indexHistogram[i].subdivisionLevel,
-                    .format = bakeResultDesc.indexHistogram[i].format,
-                };
-            }
+    std::vector<size_t> streamBlockCounts(streams.size());
+    streamBlockCounts[0] = MeshCodec::getBlockCount(streams[0], entry.vertexCount);
+    streamBlockCounts[1] = MeshCodec::getBlockCount(streams[1], entry.indexCount);
+    for (uint32_t j = 0; j < entry.lodCount; ++j)
+        streamBlockCounts[j + 2] = MeshCodec::getBlockCount(streams[j + 2], entry.lods[j].indexCount);
 
 
-            ommLinkInfo = {
-                .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_TRIANGLES_OPACITY_MICROMAP_EXT,
-                .pNext = nullptr,
-                .indexType = indexType,
-                .indexBuffer = { .deviceAddress = ommIndexBuffer->getDeviceAddress() },
-                .indexStride = bakeResultDesc.indexFormat == omm::IndexFormat::UINT_16 ? sizeof(uint16_t) : sizeof(uint32_t),
-                .baseTriangle = 0,
-                .usageCountsCount = static_cast<uint32_t>(blasOmmUsageCounts.size()),
-                .pUsageCounts = blasOmmUsageCounts.data(),
-                .micromap = micromap,
-            };
-        }
+    std::vector<std::pair<size_t, size_t>> blocks;
+    for (size_t j = 0; j < streams.size(); ++j) {
+        for (size_t block = 0; block < streamBlockCounts[j]; ++block)
+            blocks.emplace_back(j, block);
+    }
 
 
-        // Read vertices
-        size_t vertexCount = 0;
-        file.read(reinterpret_cast<char*>(&vertexCount), sizeof(size_t));
-        std::vector<Vertex> vertices(vertexCount);
-        file.read(reinterpret_cast<char*>(vertices.data()), static_cast<std::streamsize>(sizeof(Vertex) * vertexCount));
-        if (file.gcount() != static_cast<std::streamsize>(sizeof(Vertex) * vertexCount))
-            throw std::runtime_error("Error: Vertex data read failed");
+    // Every block of every stream is decoded by its own task, straight into the staging ring, which is cached: vertices are written one component at a time
+    StagingUploader::Allocation allocation = m_stagingUploader.allocate(KelpFormat::meshPayloadSize(entry));
+    std::byte* decoded = allocation.data;
 
+    try {
+        m_threadPool.parallelFor(blocks.size(), [&](size_t k) {
+            const auto [stream, block] = blocks[k];
+            if (stream == 0) {
+                MeshCodec::decodeVertexBlock(streams[0], block, std::span(reinterpret_cast<Vertex*>(decoded), entry.vertexCount));
+                return;
+            }
 
-        // Read indices
-        size_t indexCount = 0;
-        file.read(reinterpret_cast<char*>(&indexCount), sizeof(size_t));
-        std::vector<uint32_t> indices(indexCount);
-        file.read(reinterpret_cast<char*>(indices.data()), static_cast<std::streamsize>(sizeof(uint32_t) * indexCount));
-        if (file.gcount() != static_cast<std::streamsize>(sizeof(uint32_t) * indexCount))
-            throw std::runtime_error("Error: Index data read failed");
+            const uint32_t lod = static_cast<uint32_t>(stream) - 1;
+            const uint32_t indexCount = lod == 0 ? entry.indexCount : entry.lods[lod - 1].indexCount;
+            MeshCodec::decodeIndexBlock(streams[stream], block, std::span(reinterpret_cast<uint32_t*>(decoded + KelpFormat::meshLodIndicesOffset(entry, lod)), indexCount));
+        });
+    } catch (...) {
+        // Nothing reads it, but the ring can't reuse what follows it until it is released
+        m_stagingUploader.release(std::move(allocation), m_stagingUploader.getLastTicket());
+        throw;
+    }
 
+    return allocation;
+}
 
-        // Buffers creation
-        Buffer vertexBuffer = Buffer(m_device, vertices.size() * sizeof(Vertex), VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
-        Buffer indexBuffer = Buffer(m_device, indices.size() * sizeof(uint32_t), VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+void Viewer::loadMaterials() {
+    // Read material data
+    m_materials = m_file->readSection<Material>(KelpFormat::SectionType::Materials);
 
 
-        // Staging buffers creation
-        const Buffer vertexStagingBuffer = Buffer(m_device, vertices.size() * sizeof(Vertex), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT);
-        const Buffer indexStagingBuffer = Buffer(m_device, indices.size() * sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT);
+    // Each collection is stored contiguously, so the index of a texture in its collection is its rank among the entries of that collection.
+    // Materials refer to the directory entries, mapped to the descriptor of the texture or to the placeholder by the texture slot buffer
+    std::array<std::vector<uint32_t>, static_cast<size_t>(KelpFormat::TextureCollection::Count)> collectionEntries;
+    for (uint32_t i = 0; i < m_textureEntries.size(); ++i)
+        collectionEntries[static_cast<size_t>(m_textureEntries[i].collection)].push_back(i);
 
+    const auto toBindlessId = [&](int& texture, KelpFormat::TextureCollection collection) {
+        if (texture != -1)
+            texture = static_cast<int>(collectionEntries[static_cast<size_t>(collection)].at(static_cast<size_t>(texture)));
+    };
 
-        // Transfers to staging buffers
-        void *data = nullptr;
-        vertexStagingBuffer.map(&data);
-        memcpy(data, vertices.data(), static_cast<size_t>(vertices.size()) * sizeof(Vertex));
-        vertexStagingBuffer.unmap();
+    // Transition from material index to bindless index
+    for (auto& material : m_materials) {
+        toBindlessId(material.baseColorTexture, KelpFormat::TextureCollection::Albedo);
+        toBindlessId(material.alphaTexture, KelpFormat::TextureCollection::Alpha);
+        toBindlessId(material.metallicRoughnessTexture, KelpFormat::TextureCollection::MetallicRoughness);
+        toBindlessId(material.normalTexture, KelpFormat::TextureCollection::Normal);
+        toBindlessId(material.emissiveTexture, KelpFormat::TextureCollection::Emissive);
+    }
 
-        indexStagingBuffer.map(&data);
-        memcpy(data, indices.data(), static_cast<size_t>(indices.size()) * sizeof(uint32_t));
-        indexStagingBuffer.unmap();
 
+    // Create material buffer
+    const Buffer materialStagingBuffer = Buffer(m_device, m_materials.size() * sizeof(Material), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+    void *mappedData = nullptr;
+    materialStagingBuffer.map(&mappedData);
+    memcpy(mappedData, m_materials.data(), m_materials.size() * sizeof(Material));
+    materialStagingBuffer.unmap();
 
-        // Transfers to gpu buffers
-        VkCommandBuffer commandBuffer = m_device->beginSingleTimeCommands(Device::Graphics); {
-            vertexBuffer.copyFrom(commandBuffer, vertexStagingBuffer.getHandle(), vertices.size() * sizeof(Vertex));
-            indexBuffer.copyFrom(commandBuffer, indexStagingBuffer.getHandle(), indices.size() * sizeof(uint32_t));
-        } m_device->endSingleTimeCommands(Device::Graphics, commandBuffer);
 
+    // Buffer creation
+    m_materialBuffer = std::make_unique<Buffer>(m_device, m_materials.size() * sizeof(Material), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
+    VkCommandBuffer commandBuffer = m_device->beginSingleTimeCommands(Device::Graphics); {
+        m_materialBuffer->copyFrom(commandBuffer, materialStagingBuffer.getHandle(), m_materials.size() * sizeof(Material));
+    } m_device->endSingleTimeCommands(Device::Graphics, commandBuffer);
+}
 
-        // Acceleration structure get sizes
-        const VkAccelerationStructureGeometryKHR accelerationStructureGeometry{
-            .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
-            .geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR,
-            .geometry = {
-                .triangles = {
-                    .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR,
-                    .pNext = ommIndex != -1 ? &ommLinkInfo : nullptr,
-                    .vertexFormat = VK_FORMAT_R32G32B32_SFLOAT,
-                    .vertexData = {
-                        .deviceAddress = vertexBuffer.getDeviceAddress(),
-                    },
-                    .vertexStride = sizeof(Vertex),
-                    .maxVertex = static_cast<uint32_t>(vertices.size()),
-                    .indexType = VK_INDEX_TYPE_UINT32,
-                    .indexData = {
-                        .deviceAddress = indexBuffer.getDeviceAddress(),
-                    },
-                },
-            },
-            .flags = static_cast<VkGeometryFlagsKHR>(static_cast<fastgltf::AlphaMode>(m_materials[materialIndex].alphaMode) == fastgltf::AlphaMode::Opaque ? VK_GEOMETRY_OPAQUE_BIT_KHR : VK_GEOMETRY_NO_DUPLICATE_ANY_HIT_INVOCATION_BIT_KHR),
-        };
+VkBuildAccelerationStructureFlagsKHR Viewer::getBottomLevelBuildFlags(uint32_t triangleCount) {
+    if (triangleCount >= Config::BLAS_LOW_MEMORY_TRIANGLE_COUNT)
+        return VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_BUILD_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_LOW_MEMORY_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR;
+    if (triangleCount >= Config::BLAS_FAST_BUILD_TRIANGLE_COUNT)
+        return VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_BUILD_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR;
+    return VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR;
+}
 
-        VkAccelerationStructureBuildGeometryInfoKHR accelerationBuildGeometryInfo{
+std::vector<Viewer::AccelerationStructure> Viewer::buildBottomLevelAccelerationStructures(std::vector<BottomLevelBuild>& builds, const std::vector<MicromapBuild>& micromapBuilds) {
+    std::vector<AccelerationStructure> accelerationStructures;
+    if (builds.empty())
+        return accelerationStructures;
+
+    const VkDeviceSize scratchAlignment = m_accelerationStructureProperties.minAccelerationStructureScratchOffsetAlignment;
+    const auto buildCount = static_cast<uint32_t>(builds.size());
+
+
+    // Acceleration structures get sizes & creation, the pointers into the builds are only set now that they no longer move
+    std::vector<VkAccelerationStructureBuildGeometryInfoKHR> buildGeometryInfos(buildCount);
+    std::vector<VkAccelerationStructureBuildRangeInfoKHR> buildRangeInfos(buildCount);
+    std::vector<VkDeviceSize> scratchSizes(buildCount);
+    std::vector<VkAccelerationStructureKHR> originAccelerationStructures(buildCount);
+    std::vector<Buffer> originAccelerationStructureBuffers;
+    originAccelerationStructureBuffers.reserve(buildCount);
+
+    for (uint32_t i = 0; i < buildCount; ++i) {
+        BottomLevelBuild& build = builds[i];
+        if (build.ommLinkInfo.micromap != VK_NULL_HANDLE) {
+            build.ommLinkInfo.usageCountsCount = static_cast<uint32_t>(build.ommUsageCounts.size());
+            build.ommLinkInfo.pUsageCounts = build.ommUsageCounts.data();
+            build.geometry.geometry.triangles.pNext = &build.ommLinkInfo;
+        }
+
+        buildGeometryInfos[i] = VkAccelerationStructureBuildGeometryInfoKHR{
             .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
             .type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
-            .flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR,
+            .flags = getBottomLevelBuildFlags(build.triangleCount),
+            .mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR,
             .geometryCount = 1,
-            .pGeometries = &accelerationStructureGeometry,
+            .pGeometries = &build.geometry,
         };
 
-        const uint32_t numTriangles = static_cast<uint32_t>(indices.size()) / 3;
         VkAccelerationStructureBuildSizesInfoKHR accelerationStructureBuildSizesInfo{
             .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR,
         };
+        vkGetAccelerationStructureBuildSizesKHR(m_device->getHandle(), VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &buildGeometryInfos[i], &build.triangleCount, &accelerationStructureBuildSizesInfo);
 
-        vkGetAccelerationStructureBuildSizesKHR(m_device->getHandle(), VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &accelerationBuildGeometryInfo, &numTriangles, &accelerationStructureBuildSizesInfo);
-
-
-        // Acceleration structure creation
-        Buffer accelerationStructureBuffer = Buffer(m_device, accelerationStructureBuildSizesInfo.accelerationStructureSize, VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
-        VkAccelerationStructureKHR originAccelerationStructure = VK_NULL_HANDLE;
-
+        originAccelerationStructureBuffers.emplace_back(m_device, accelerationStructureBuildSizesInfo.accelerationStructureSize, VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, 0, 0, m_device->getAccelerationStructurePool());
         const VkAccelerationStructureCreateInfoKHR accelerationStructureCreateInfo{
             .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR,
-            .buffer = accelerationStructureBuffer.getHandle(),
+            .buffer = originAccelerationStructureBuffers.back().getHandle(),
             .size = accelerationStructureBuildSizesInfo.accelerationStructureSize,
             .type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
         };
-        VK_CHECK(vkCreateAccelerationStructureKHR(m_device->getHandle(), &accelerationStructureCreateInfo, nullptr, &originAccelerationStructure));
-
-
-        // Acceleration structure build
-        const Buffer scratchBuffer = Buffer(m_device, accelerationStructureBuildSizesInfo.buildScratchSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
+        VK_CHECK(vkCreateAccelerationStructureKHR(m_device->getHandle(), &accelerationStructureCreateInfo, nullptr, &originAccelerationStructures[i]));
 
-        VkAccelerationStructureBuildRangeInfoKHR accelerationStructureBuildRangeInfo{
-            .primitiveCount = numTriangles,
+        buildGeometryInfos[i].dstAccelerationStructure = originAccelerationStructures[i];
+        buildRangeInfos[i] = VkAccelerationStructureBuildRangeInfoKHR{
+            .primitiveCount = build.triangleCount,
             .primitiveOffset = 0,
             .firstVertex = 0,
             .transformOffset = 0,
         };
-        std::vector<VkAccelerationStructureBuildRangeInfoKHR*> accelerationBuildStructureRangeInfos = { &accelerationStructureBuildRangeInfo };
+        scratchSizes[i] = KelpFormat::alignUp(accelerationStructureBuildSizesInfo.buildScratchSize, scratchAlignment);
+    }
+
+
+    // Batches of builds with disjoint ranges of one scratch buffer, sized for the largest batch
+    std::vector<uint32_t> batchEnds;
+    std::vector<VkDeviceSize> scratchOffsets(buildCount);
+    VkDeviceSize scratchSize = 0;
+    VkDeviceSize batchScratchSize = 0;
+    for (uint32_t i = 0; i < buildCount; ++i) {
+        if (batchScratchSize > 0 && batchScratchSize + scratchSizes[i] > Config::BLAS_SCRATCH_BUDGET) {
+            batchEnds.push_back(i);
+            batchScratchSize = 0;
+        }
+        scratchOffsets[i] = batchScratchSize;
+        batchScratchSize += scratchSizes[i];
+        scratchSize = std::max(scratchSize, batchScratchSize);
+    }
+    batchEnds.push_back(buildCount);
+
+    // The micromaps are built at once before the first batch, from the start of the same scratch buffer
+    const auto micromapBuildCount = static_cast<uint32_t>(micromapBuilds.size());
+    std::vector<VkDeviceSize> micromapScratchOffsets(micromapBuildCount);
+    VkDeviceSize micromapScratchSize = 0;
+    for (uint32_t i = 0; i < micromapBuildCount; ++i) {
+        micromapScratchOffsets[i] = micromapScratchSize;
+        micromapScratchSize += KelpFormat::alignUp(micromapBuilds[i].scratchSize, scratchAlignment);
+    }
+    scratchSize = std::max(scratchSize, micromapScratchSize);
+
+    const Buffer scratchBuffer = Buffer(m_device, scratchSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, 0, scratchAlignment, m_device->getAccelerationStructurePool());
+    std::vector<const VkAccelerationStructureBuildRangeInfoKHR*> buildRangeInfoPointers(buildCount);
+    for (uint32_t i = 0; i < buildCount; ++i) {
+        buildGeometryInfos[i].scratchData = { .deviceAddress = scratchBuffer.getDeviceAddress() + scratchOffsets[i] };
+        buildRangeInfoPointers[i] = &buildRangeInfos[i];
+    }
+
+    std::vector<VkMicromapBuildInfoEXT> micromapBuildInfos(micromapBuildCount);
+    for (uint32_t i = 0; i < micromapBuildCount; ++i) {
+        micromapBuildInfos[i] = micromapBuilds[i].buildInfo;
+        micromapBuildInfos[i].usageCountsCount = static_cast<uint32_t>(micromapBuilds[i].usageCounts.size());
+        micromapBuildInfos[i].pUsageCounts = micromapBuilds[i].usageCounts.data();
+        micromapBuildInfos[i].scratchData = { .deviceAddress = scratchBuffer.getDeviceAddress() + micromapScratchOffsets[i] };
+    }
 
-        commandBuffer = m_device->beginSingleTimeCommands(Device::QueueType::Graphics); {
-            accelerationBuildGeometryInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR,
-            accelerationBuildGeometryInfo.dstAccelerationStructure = originAccelerationStructure,
-            accelerationBuildGeometryInfo.scratchData = { .deviceAddress = scratchBuffer.getDeviceAddress() };
 
-            vkCmdBuildAccelerationStructuresKHR(commandBuffer, 1, &accelerationBuildGeometryInfo, accelerationBuildStructureRangeInfos.data());
-        } m_device->endSingleTimeCommands(Device::QueueType::Graphics, commandBuffer);
+    // Micromap builds, acceleration structure builds & compacted sizes query, in one submission
+    const VkQueryPoolCreateInfo queryPoolCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR,
+        .queryCount = buildCount,
+    };
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    VK_CHECK(vkCreateQueryPool(m_device->getHandle(), &queryPoolCreateInfo, nullptr, &queryPool));
 
+    VkCommandBuffer commandBuffer = m_device->beginSingleTimeCommands(Device::QueueType::Graphics); {
+        vkCmdResetQueryPool(commandBuffer, queryPool, 0, buildCount);
+
+        // The BLASes read the micromaps they link and reuse their scratch memory. The micromap build stage has no synchronization 1 flag
+        if (micromapBuildCount > 0) {
+            const VkMemoryBarrier micromapBarrier{
+                .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                .srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT,
+                .dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR | VK_ACCESS_MEMORY_READ_BIT,
+            };
+            vkCmdBuildMicromapsEXT(commandBuffer, micromapBuildCount, micromapBuildInfos.data());
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0, 1, &micromapBarrier, 0, nullptr, 0, nullptr);
+        }
 
-        // Query compacted size
-        const VkQueryPoolCreateInfo queryPoolCreateInfo = {
-            .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
-            .queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR,
-            .queryCount = 1,
+        // Each batch reuses the scratch memory of the previous one, and the query reads the structures built
+        const VkMemoryBarrier buildBarrier{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+            .dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
         };
-        VkQueryPool queryPool = VK_NULL_HANDLE;
-        VK_CHECK(vkCreateQueryPool(m_device->getHandle(), &queryPoolCreateInfo, nullptr, &queryPool));
+        uint32_t batchBegin = 0;
+        for (const uint32_t batchEnd : batchEnds) {
+            vkCmdBuildAccelerationStructuresKHR(commandBuffer, batchEnd - batchBegin, &buildGeometryInfos[batchBegin], &buildRangeInfoPointers[batchBegin]);
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0, 1, &buildBarrier, 0, nullptr, 0, nullptr);
+            batchBegin = batchEnd;
+        }
 
-        commandBuffer = m_device->beginSingleTimeCommands(Device::QueueType::Graphics); {
-            vkCmdResetQueryPool(commandBuffer, queryPool, 0, 1);
-            vkCmdWriteAccelerationStructuresPropertiesKHR(commandBuffer, 1, &originAccelerationStructure, VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR, queryPool, 0);
-        } m_device->endSingleTimeCommands(Device::QueueType::Graphics, commandBuffer);
+        vkCmdWriteAccelerationStructuresPropertiesKHR(commandBuffer, buildCount, originAccelerationStructures.data(), VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR, queryPool, 0);
+    } m_device->endSingleTimeCommands(Device::QueueType::Graphics, commandBuffer);
 
-        VkDeviceSize compactedSize = 0;
-        VK_CHECK(vkGetQueryPoolResults(m_device->getHandle(), queryPool, 0, 1, sizeof(VkDeviceSize), &compactedSize, sizeof(VkDeviceSize), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
-        vkDestroyQueryPool(m_device->getHandle(), queryPool, nullptr);
+    std::vector<VkDeviceSize> compactedSizes(buildCount);
+    VK_CHECK(vkGetQueryPoolResults(m_device->getHandle(), queryPool, 0, buildCount, compactedSizes.size() * sizeof(VkDeviceSize), compactedSizes.data(), sizeof(VkDeviceSize), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+    vkDestroyQueryPool(m_device->getHandle(), queryPool, nullptr);
 
 
-        // Compacted acceleration structure creation
-        Buffer compactedAccelerationStructureBuffer = Buffer(m_device, compactedSize, VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
+    // Compacted acceleration structures creation & copies, in one submission
+    accelerationStructures.reserve(buildCount);
+    for (uint32_t i = 0; i < buildCount; ++i) {
+        Buffer compactedAccelerationStructureBuffer = Buffer(m_device, compactedSizes[i], VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, 0, 0, m_device->getAccelerationStructurePool());
         VkAccelerationStructureKHR compactedAccelerationStructure = VK_NULL_HANDLE;
         const VkAccelerationStructureCreateInfoKHR compactedAccelerationStructureCreateInfo{
             .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR,
             .buffer = compactedAccelerationStructureBuffer.getHandle(),
-            .size = compactedSize,
+            .size = compactedSizes[i],
             .type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
         };
         VK_CHECK(vkCreateAccelerationStructureKHR(m_device->getHandle(), &compactedAccelerationStructureCreateInfo, nullptr, &compactedAccelerationStructure));
 
-        commandBuffer = m_device->beginSingleTimeCommands(Device::QueueType::Graphics); {
+        const VkAccelerationStructureDeviceAddressInfoKHR compactedAccelerationDeviceAddressInfo{
+            .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR,
+            .accelerationStructure = compactedAccelerationStructure,
+        };
+        accelerationStructures.push_back(AccelerationStructure{
+            .handle = compactedAccelerationStructure,
+            .deviceAddress = vkGetAccelerationStructureDeviceAddressKHR(m_device->getHandle(), &compactedAccelerationDeviceAddressInfo),
+            .size = compactedSizes[i],
+            .buffer = std::move(compactedAccelerationStructureBuffer),
+            .micromapBuffer = nullptr,
+            .micromap = VK_NULL_HANDLE,
+        });
+    }
+
+    commandBuffer = m_device->beginSingleTimeCommands(Device::QueueType::Graphics); {
+        for (uint32_t i = 0; i < buildCount; ++i) {
             const VkCopyAccelerationStructureInfoKHR copyAccelerationStructureInfo{
                 .sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR,
-                .src = originAccelerationStructure,
-                .dst = compactedAccelerationStructure,
+                .src = originAccelerationStructures[i],
+                .dst = accelerationStructures[i].handle,
                 .mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR,
             };
-
             vkCmdCopyAccelerationStructureKHR(commandBuffer, &copyAccelerationStructureInfo);
-        } m_device->endSingleTimeCommands(Device::QueueType::Graphics, commandBuffer);
+        }
+    } m_device->endSingleTimeCommands(Device::QueueType::Graphics, commandBuffer);
 
 
-        // Original acceleration structure cleanup
+    // Original acceleration structures cleanup, their buffers are freed on return
+    for (const VkAccelerationStructureKHR originAccelerationStructure : originAccelerationStructures)
         vkDestroyAccelerationStructureKHR(m_device->getHandle(), originAccelerationStructure, nullptr);
 
+    return accelerationStructures;
+}
 
-        // Get acceleration structure device address
-        const VkAccelerationStructureDeviceAddressInfoKHR compactedAccelerationDeviceAddressInfo{
-            .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR,
-            .accelerationStructure = compactedAccelerationStructure,
+void Viewer::loadMeshDirectory() {
+    m_meshEntries = m_file->readSection<KelpFormat::MeshEntry>(KelpFormat::SectionType::MeshDirectory);
+    const bool encoded = (m_file->getSection(KelpFormat::SectionType::MeshData).flags & KelpFormat::SECTION_FLAG_ENCODED_MESHES) != 0;
+    m_meshes.resize(m_meshEntries.size());
+
+    // Validation before anything is allocated, the meshes themselves are loaded with the cells using them
+    for (const KelpFormat::MeshEntry& entry : m_meshEntries) {
+        if (entry.materialIndex >= m_materials.size())
+            throw std::runtime_error("Error: Material index out of bounds: " + std::to_string(entry.materialIndex) + " >= " + std::to_string(m_materials.size()));
+        if (entry.vertexCount == 0 || entry.indexCount == 0 || entry.lodCount > KelpFormat::MAX_LOD_COUNT || (encoded ? entry.size < sizeof(KelpFormat::EncodedMeshHeader) : entry.size != KelpFormat::meshPayloadSize(entry)))
+            throw std::runtime_error("Error: Mesh entry is invalid: " + std::to_string(entry.vertexCount) + " vertices, " + std::to_string(entry.lodCount) + " LODs, " + std::to_string(entry.size) + " bytes");
+    }
+}
+
+std::vector<std::shared_ptr<Viewer::Mesh>> Viewer::loadMeshes(const std::vector<uint32_t>& meshIndices) {
+    const bool encoded = (m_file->getSection(KelpFormat::SectionType::MeshData).flags & KelpFormat::SECTION_FLAG_ENCODED_MESHES) != 0;
+
+    std::vector<FileRange> ranges(meshIndices.size());
+    for (size_t i = 0; i < meshIndices.size(); ++i) {
+        const KelpFormat::MeshEntry& entry = m_meshEntries.at(meshIndices[i]);
+        ranges[i] = FileRange{ .offset = entry.offset, .size = entry.size, .firstChunk = entry.firstChunk, .checksum = entry.checksum, .hostMemory = encoded };
+    }
+
+
+    // Resources of a mesh until its acceleration structures are built
+    struct PendingMesh {
+        GeometryBuffer::Allocation geometry;
+        std::unique_ptr<Buffer> micromapBuffer;
+        VkMicromapEXT micromap;
+        std::unique_ptr<Buffer> ommArrayDataBuffer;     // Only read by the builds
+        std::unique_ptr<Buffer> ommDescArrayBuffer;
+        std::unique_ptr<Buffer> ommIndexBuffer;
+        size_t firstBuild;                              // Of the full resolution mesh, the ones of its LODs follow
+    };
+    std::vector<std::unique_ptr<PendingMesh>> pendingMeshes(meshIndices.size());
+    std::vector<BottomLevelBuild> builds;
+    std::vector<MicromapBuild> micromapBuilds;
+
+
+    // Every payload (vertices, indices and LOD indices) lands in a single staging allocation and is queued as soon as it is read, the BLAS
+    // builds are only described, to be built all together once every copy is complete
+    std::mutex buildMutex;
+
+    uploadFileRanges(KelpFormat::SectionType::MeshData, ranges, [&](size_t i, const UploadSource& source) {
+        const KelpFormat::MeshEntry& entry = m_meshEntries[meshIndices[i]];
+
+        // The payload is copied as is into the geometry buffer: vertices, indices then LOD indices
+        const VkDeviceSize payloadSize = KelpFormat::meshPayloadSize(entry);
+        std::unique_ptr<PendingMesh> pending = std::make_unique<PendingMesh>(PendingMesh{
+            .geometry = m_geometryBuffer->allocate(payloadSize),
+            .micromapBuffer = nullptr,
+            .micromap = VK_NULL_HANDLE,
+            .ommArrayDataBuffer = nullptr,
+            .ommDescArrayBuffer = nullptr,
+            .ommIndexBuffer = nullptr,
+            .firstBuild = 0,
+        });
+
+
+        // Encoded payloads are read into host memory and decoded into staging memory, so that decoding overlaps the uploads
+        StagingUploader::Allocation decoded = encoded ? decodeMeshPayload(entry, source.data) : StagingUploader::Allocation{};
+        const VkBuffer stagingBuffer = encoded ? decoded.buffer : source.buffer;
+        const VkDeviceSize stagingOffset = encoded ? decoded.offset : source.offset;
+
+
+        // Transfer to the gpu, one copy batched with the other meshes and textures
+        // The range is read by the acceleration structure builds and by the ray tracing shaders, through its device address
+        const GeometryBuffer::Allocation geometry = pending->geometry;
+        const uint64_t ticket = m_stagingUploader.enqueue([geometry, payloadSize, stagingBuffer, stagingOffset](const StagingUploader::Commands& commands) {
+            geometry.buffer->copyFrom(commands.transfer, stagingBuffer, payloadSize, stagingOffset, geometry.offset);
+            StagingUploader::cmdHandOver(commands, *geometry.buffer, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR | VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, geometry.offset, payloadSize);
+        });
+        if (encoded)
+            m_stagingUploader.release(std::move(decoded), ticket);
+
+        // Acceleration structure builds, of the full resolution mesh then of its LODs sharing its vertex buffer
+        // The micromaps are baked per triangle of the full resolution mesh, so LODs fall back to any-hit alpha testing
+        const VkGeometryFlagsKHR geometryFlags = static_cast<fastgltf::AlphaMode>(m_materials[entry.materialIndex].alphaMode) == fastgltf::AlphaMode::Opaque ? VK_GEOMETRY_OPAQUE_BIT_KHR : VK_GEOMETRY_NO_DUPLICATE_ANY_HIT_INVOCATION_BIT_KHR;
+        const auto triangleGeometry = [&](VkDeviceAddress indexAddress) {
+            return VkAccelerationStructureGeometryKHR{
+                .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
+                .geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR,
+                .geometry = {
+                    .triangles = {
+                        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR,
+                        .pNext = nullptr,
+                        .vertexFormat = VK_FORMAT_R32G32B32_SFLOAT,
+                        .vertexData = {
+                            .deviceAddress = pending->geometry.deviceAddress,
+                        },
+                        .vertexStride = sizeof(Vertex),
+                        .maxVertex = entry.vertexCount - 1,     // Highest vertex index
+                        .indexType = VK_INDEX_TYPE_UINT32,
+                        .indexData = {
+                            .deviceAddress = indexAddress,
+                        },
+                    },
+                },
+                .flags = geometryFlags,
+            };
         };
-        const VkDeviceAddress compactedAccelerationStructureAddress = vkGetAccelerationStructureDeviceAddressKHR(m_device->getHandle(), &compactedAccelerationDeviceAddressInfo);
-
-
-        // New mesh creation
-        m_meshes[i] = std::make_shared<Mesh>(Mesh{
-            .vertexBuffer = std::move(vertexBuffer),
-            .indexBuffer = std::move(indexBuffer),
-            .indexCount = static_cast<uint32_t>(indices.size()),
-            .accelerationStructure = AccelerationStructure{
-                .handle = compactedAccelerationStructure,
-                .deviceAddress = compactedAccelerationStructureAddress,
-                .buffer = std::move(compactedAccelerationStructureBuffer),
-                .micromapBuffer = std::move(micromapBuffer),
-                .micromap = micromap,
-            },
-            .materialIndex = static_cast<int>(materialIndex),
+
+        const std::lock_guard<std::mutex> lock(buildMutex);
+        pending->firstBuild = builds.size();
+        builds.push_back(BottomLevelBuild{
+            .geometry = triangleGeometry(pending->geometry.deviceAddress + KelpFormat::meshIndicesOffset(entry)),
+            .triangleCount = entry.indexCount / 3,
+            .ommUsageCounts = {},
+            .ommLinkInfo = {},
+        });
+        const uint32_t lodCount = m_streamingOptions.meshLods ? entry.lodCount : 0;
+        for (uint32_t j = 0; j < lodCount; ++j) {
+            builds.push_back(BottomLevelBuild{
+                .geometry = triangleGeometry(pending->geometry.deviceAddress + KelpFormat::meshLodIndicesOffset(entry, j + 1)),
+                .triangleCount = entry.lods[j].indexCount / 3,
+                .ommUsageCounts = {},
+                .ommLinkInfo = {},
+            });
+        }
+        pendingMeshes[i] = std::move(pending);
+    });
+
+
+    // Micromaps of the meshes with opacity micromaps, their inputs are staged once the payloads no longer hold staging memory and their builds
+    // are only described, to be built ahead of the BLASes linking them
+    for (size_t i = 0; i < meshIndices.size(); ++i) {
+        const KelpFormat::MeshEntry& entry = m_meshEntries[meshIndices[i]];
+        if (entry.ommIndex == -1)
+            continue;
+
+        PendingMesh& pending = *pendingMeshes[i];
+        BottomLevelBuild& build = builds[pending.firstBuild];
+        const omm::Cpu::BakeResultDesc& bakeResultDesc = m_ommBakeResults.at(entry.ommIndex);
+
+
+        // Get micromap build size
+        MicromapBuild& micromapBuild = micromapBuilds.emplace_back();
+        micromapBuild.usageCounts.resize(bakeResultDesc.descArrayHistogramCount);
+        for (uint32_t j = 0; j < bakeResultDesc.descArrayHistogramCount; ++j) {
+            micromapBuild.usageCounts[j] = VkMicromapUsageEXT{
+                .count = bakeResultDesc.descArrayHistogram[j].count,
+                .subdivisionLevel = bakeResultDesc.descArrayHistogram[j].subdivisionLevel,
+                .format = bakeResultDesc.descArrayHistogram[j].format,
+            };
+        }
+
+        micromapBuild.buildInfo = VkMicromapBuildInfoEXT{
+            .sType = VK_STRUCTURE_TYPE_MICROMAP_BUILD_INFO_EXT,
+            .type = VK_MICROMAP_TYPE_OPACITY_MICROMAP_EXT,
+            .flags = VK_BUILD_MICROMAP_PREFER_FAST_TRACE_BIT_EXT,
+            .mode = VK_BUILD_MICROMAP_MODE_BUILD_EXT,
+            .usageCountsCount = static_cast<uint32_t>(micromapBuild.usageCounts.size()),
+            .pUsageCounts = micromapBuild.usageCounts.data(),
+        };
+
+        VkMicromapBuildSizesInfoEXT buildSizes = { .sType = VK_STRUCTURE_TYPE_MICROMAP_BUILD_SIZES_INFO_EXT };
+        vkGetMicromapBuildSizesEXT(m_device->getHandle(), VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &micromapBuild.buildInfo, &buildSizes);
+        micromapBuild.scratchSize = buildSizes.buildScratchSize;
+
+
+        // Creating buffers
+        pending.micromapBuffer = std::make_unique<Buffer>(m_device, buildSizes.micromapSize, VK_BUFFER_USAGE_MICROMAP_STORAGE_BIT_EXT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, 0, 0, m_device->getAccelerationStructurePool());
+        pending.ommArrayDataBuffer = std::make_unique<Buffer>(m_device, bakeResultDesc.arrayDataSize, VK_BUFFER_USAGE_MICROMAP_BUILD_INPUT_READ_ONLY_BIT_EXT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, 0, 256);
+        pending.ommDescArrayBuffer = std::make_unique<Buffer>(m_device, bakeResultDesc.descArrayCount * sizeof(VkMicromapTriangleEXT), VK_BUFFER_USAGE_MICROMAP_BUILD_INPUT_READ_ONLY_BIT_EXT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, 0, 256);
+
+        const VkDeviceSize ommIndexSize = bakeResultDesc.indexCount * (bakeResultDesc.indexFormat == omm::IndexFormat::UINT_16 ? sizeof(uint16_t) : sizeof(uint32_t));
+        pending.ommIndexBuffer = std::make_unique<Buffer>(m_device, ommIndexSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
+
+
+        // Uploading data to gpu, on the transfer queue like the mesh payloads. The micromap build stage has no synchronization 1 flag
+        uploadToBuffer(*pending.ommArrayDataBuffer, bakeResultDesc.arrayData, bakeResultDesc.arrayDataSize, 0, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+        uploadToBuffer(*pending.ommDescArrayBuffer, bakeResultDesc.descArray, bakeResultDesc.descArrayCount * sizeof(VkMicromapTriangleEXT), 0, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+        uploadToBuffer(*pending.ommIndexBuffer, bakeResultDesc.indexBuffer, ommIndexSize, 0, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR);
+
+
+        // Micromap creation
+        const VkMicromapCreateInfoEXT micromapCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_MICROMAP_CREATE_INFO_EXT,
+            .createFlags = 0,
+            .buffer = pending.micromapBuffer->getHandle(),
+            .offset = 0,
+            .size = buildSizes.micromapSize,
+            .type = VK_MICROMAP_TYPE_OPACITY_MICROMAP_EXT,
+            .deviceAddress = 0,
+        };
+
+        VK_CHECK(vkCreateMicromapEXT(m_device->getHandle(), &micromapCreateInfo, nullptr, &pending.micromap));
+
+        micromapBuild.buildInfo.dstMicromap = pending.micromap;
+        micromapBuild.buildInfo.data = { .deviceAddress = pending.ommArrayDataBuffer->getDeviceAddress() };
+        micromapBuild.buildInfo.triangleArray = { .deviceAddress = pending.ommDescArrayBuffer->getDeviceAddress() };
+        micromapBuild.buildInfo.triangleArrayStride = sizeof(VkMicromapTriangleEXT);
+
+
+        // Link to the build of the full resolution mesh
+        const VkIndexType indexType = bakeResultDesc.indexFormat == omm::IndexFormat::UINT_16 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+        build.ommUsageCounts.resize(bakeResultDesc.indexHistogramCount);
+        for (uint32_t j = 0; j < bakeResultDesc.indexHistogramCount; ++j) {
+            build.ommUsageCounts[j] = VkMicromapUsageEXT{
+                .count = bakeResultDesc.indexHistogram[j].count,
+                .subdivisionLevel = bakeResultDesc.indexHistogram[j].subdivisionLevel,
+                .format = bakeResultDesc.indexHistogram[j].format,
+            };
+        }
+
+
+        build.ommLinkInfo = {
+            .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_TRIANGLES_OPACITY_MICROMAP_EXT,
+            .pNext = nullptr,
+            .indexType = indexType,
+            .indexBuffer = { .deviceAddress = pending.ommIndexBuffer->getDeviceAddress() },
+            .indexStride = bakeResultDesc.indexFormat == omm::IndexFormat::UINT_16 ? sizeof(uint16_t) : sizeof(uint32_t),
+            .baseTriangle = 0,
+            .usageCountsCount = 0,
+            .pUsageCounts = nullptr,
+            .micromap = pending.micromap,
+        };
+    }
+
+
+    // Every micromap then every BLAS at once, their inputs are read once the copies are complete
+    m_stagingUploader.wait(m_stagingUploader.getLastTicket());
+    std::vector<AccelerationStructure> accelerationStructures = buildBottomLevelAccelerationStructures(builds, micromapBuilds);
+
+    std::vector<std::shared_ptr<Mesh>> meshes(meshIndices.size());
+    for (size_t i = 0; i < meshIndices.size(); ++i) {
+        const KelpFormat::MeshEntry& entry = m_meshEntries[meshIndices[i]];
+        PendingMesh& pending = *pendingMeshes[i];
+
+        AccelerationStructure& accelerationStructure = accelerationStructures[pending.firstBuild];
+        accelerationStructure.micromapBuffer = std::move(pending.micromapBuffer);
+        accelerationStructure.micromap = pending.micromap;
+
+        const uint32_t lodCount = m_streamingOptions.meshLods ? entry.lodCount : 0;
+        std::vector<MeshLod> lods;
+        lods.reserve(lodCount);
+        for (uint32_t j = 0; j < lodCount; ++j) {
+            AccelerationStructure& lodAccelerationStructure = accelerationStructures[pending.firstBuild + 1 + j];
+            lods.push_back(MeshLod{
+                .indexAddress = pending.geometry.deviceAddress + KelpFormat::meshLodIndicesOffset(entry, j + 1),
+                .indexCount = entry.lods[j].indexCount,
+                .error = entry.lods[j].error,
+                .accelerationStructure = std::move(lodAccelerationStructure),
+            });
+        }
+
+
+        // New mesh creation, its acceleration structures are destroyed with the last reference to it
+        meshes[i] = std::shared_ptr<Mesh>(new Mesh{
+            .geometry = pending.geometry,
+            .vertexAddress = pending.geometry.deviceAddress,
+            .indexAddress = pending.geometry.deviceAddress + KelpFormat::meshIndicesOffset(entry),
+            .indexCount = entry.indexCount,
+            .accelerationStructure = std::move(accelerationStructure),
+            .materialIndex = static_cast<int>(entry.materialIndex),
+            .lods = std::move(lods),
+            .boundsCenter = entry.boundsCenter,
+            .boundsRadius = entry.boundsRadius,
+        }, [device = m_device, geometryBuffer = m_geometryBuffer](Mesh* mesh) {
+            vkDestroyAccelerationStructureKHR(device->getHandle(), mesh->accelerationStructure.handle, nullptr);
+            if (mesh->accelerationStructure.micromap != VK_NULL_HANDLE)
+                vkDestroyMicromapEXT(device->getHandle(), mesh->accelerationStructure.micromap, nullptr);
+            for (const MeshLod& lod : mesh->lods)
+                vkDestroyAccelerationStructureKHR(device->getHandle(), lod.accelerationStructure.handle, nullptr);
+            geometryBuffer->free(mesh->geometry);
+            delete mesh;
         });
     }
 
-    omm::Cpu::DestroyDeserializedResult(m_ommDeserializedResult);
+    return meshes;
 }
 
-void Viewer::loadMeshInstances(std::ifstream& file) {
-    std::vector<KelpMeshInstance> kelpMeshInstances;
-    std::vector<MeshInstance> meshInstances;
+void Viewer::cmdBuildTopLevelAccelerationStructure(VkCommandBuffer commandBuffer, const Buffer& instancesBuffer, uint32_t instanceCount) const {
+    const VkAccelerationStructureGeometryKHR accelerationStructureGeometry{
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
+        .geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR,
+        .geometry = {
+            .instances = {
+                .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR,
+                .arrayOfPointers = VK_FALSE,
+                .data = {
+                    .deviceAddress = instancesBuffer.getDeviceAddress(),
+                },
+            },
+        },
+    };
+
+    const VkAccelerationStructureBuildGeometryInfoKHR accelerationBuildGeometryInfo{
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
+        .type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR,
+        .flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR,
+        .mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR,
+        .dstAccelerationStructure = m_topLevelAccelerationStructure,
+        .geometryCount = 1,
+        .pGeometries = &accelerationStructureGeometry,
+        .scratchData {
+            .deviceAddress = m_topLevelScratchBuffer->getDeviceAddress(),
+        },
+    };
 
-    // Read mesh instance count
-    size_t count = 0;
-    file.read(reinterpret_cast<char*>(&count), sizeof(count));
-    meshInstances.reserve(count);
-    m_accelerationStructureInstances.reserve(count);
-    kelpMeshInstances.resize(count);
+    const VkAccelerationStructureBuildRangeInfoKHR accelerationStructureBuildRangeInfo{
+        .primitiveCount = instanceCount,
+        .primitiveOffset = 0,
+        .firstVertex = 0,
+        .transformOffset = 0,
+    };
 
+    const VkAccelerationStructureBuildRangeInfoKHR* accelerationBuildStructureRangeInfo = &accelerationStructureBuildRangeInfo;
+    vkCmdBuildAccelerationStructuresKHR(commandBuffer, 1, &accelerationBuildGeometryInfo, &accelerationBuildStructureRangeInfo);
+}
 
+void Viewer::loadMeshInstances() {
     // Read mesh instance data
-    file.read(reinterpret_cast<char*>(kelpMeshInstances.data()), static_cast<std::streamsize>(sizeof(KelpMeshInstance) * count));
+    const std::vector<KelpFormat::InstanceEntry> kelpMeshInstances = m_file->readSection<KelpFormat::InstanceEntry>(KelpFormat::SectionType::MeshInstances);
+    uint32_t meshInstanceCount = 0;
+
+    m_accelerationStructureInstances.reserve(kelpMeshInstances.size());
+    m_sceneInstances.reserve(kelpMeshInstances.size());
 
 
-    // Convert to acceleration structure instances
+    // Convert to acceleration structure instances, their BLAS reference is set once the cell of the instance is resident
     for (const auto& meshInstance : kelpMeshInstances) {
+        const KelpFormat::MeshEntry& mesh = m_meshEntries.at(meshInstance.meshIndex);
+
         const VkTransformMatrixKHR transformMatrix = {
             .matrix = {
                 {meshInstance.transform[0][0], meshInstance.transform[1][0], meshInstance.transform[2][0], meshInstance.transform[3][0]},
@@ -612,41 +1163,42 @@ void Viewer::loadMeshInstances(std::ifstream& file) {
 
         const VkAccelerationStructureInstanceKHR instance{
             .transform = transformMatrix,
-            .instanceCustomIndex = static_cast<uint32_t>(meshInstances.size()),
+            .instanceCustomIndex = meshInstanceCount,
             .mask = 0xFF,
             .instanceShaderBindingTableRecordOffset = 0,
             .flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR,
-            .accelerationStructureReference = m_meshes[meshInstance.meshIndex]->accelerationStructure.deviceAddress,
+            .accelerationStructureReference = 0,
         };
         m_accelerationStructureInstances.push_back(instance);
 
-        meshInstances.push_back(MeshInstance{
-            .vertexBuffer = m_meshes[meshInstance.meshIndex]->vertexBuffer.getDeviceAddress(),
-            .indexBuffer = m_meshes[meshInstance.meshIndex]->indexBuffer.getDeviceAddress(),
-            .materialIndex = m_meshes[meshInstance.meshIndex]->materialIndex,
+        const float scale = std::max({
+            glm::length(glm::vec3(meshInstance.transform[0])),
+            glm::length(glm::vec3(meshInstance.transform[1])),
+            glm::length(glm::vec3(meshInstance.transform[2]))
         });
-    }
 
+        m_sceneInstances.push_back(SceneInstance{
+            .center = glm::vec3(meshInstance.transform * glm::vec4(mesh.boundsCenter, 1)),
+            .radius = mesh.boundsRadius * scale,
+            .scale = scale,
+            .meshIndex = meshInstance.meshIndex,
+            .firstMeshInstance = meshInstanceCount,
+            .lod = 0,
+        });
 
-    // Primitive instances buffer creation
-    const Buffer primitiveInstancesStagingBuffer = Buffer(m_device, meshInstances.size() * sizeof(MeshInstance), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT);
-    void *data = nullptr;
-    primitiveInstancesStagingBuffer.map(&data);
-    memcpy(data, meshInstances.data(), meshInstances.size() * sizeof(MeshInstance));
-    primitiveInstancesStagingBuffer.unmap();
+        // One entry per LOD, switching LOD only changes the custom index and BLAS reference of the TLAS instance.
+        // The entries are written when the cell of the instance is streamed in
+        meshInstanceCount += 1 + mesh.lodCount;
+    }
 
-    m_meshInstanceBuffer = std::make_unique<Buffer>(m_device, meshInstances.size() * sizeof(MeshInstance), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
-    VkCommandBuffer commandBuffer = m_device->beginSingleTimeCommands(Device::QueueType::Graphics); {
-        m_meshInstanceBuffer->copyFrom(commandBuffer, primitiveInstancesStagingBuffer.getHandle(), meshInstances.size() * sizeof(MeshInstance));
-    } m_device->endSingleTimeCommands(Device::QueueType::Graphics, commandBuffer);
+    m_meshInstanceBuffer = std::make_unique<Buffer>(m_device, meshInstanceCount * sizeof(MeshInstance), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
 
 
-    // BLAS instance array creation
-    const Buffer instancesBuffer = Buffer(m_device, m_accelerationStructureInstances.size() * sizeof(VkAccelerationStructureInstanceKHR), VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR, VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT);
-    data = nullptr;
-    instancesBuffer.map(&data);
-    memcpy(data, m_accelerationStructureInstances.data(), m_accelerationStructureInstances.size() * sizeof(VkAccelerationStructureInstanceKHR));
-    instancesBuffer.unmap();
+    // BLAS instance arrays creation, one per frame in flight since they are rewritten when LODs or resident cells change
+    for (size_t i = 0; i < Config::MAX_FRAMES_IN_FLIGHT; ++i) {
+        m_accelerationStructureInstanceBuffers[i] = std::make_unique<Buffer>(m_device, m_accelerationStructureInstances.size() * sizeof(VkAccelerationStructureInstanceKHR), VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR, VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT);
+        m_accelerationStructureInstanceBuffers[i]->map(&m_mappedAccelerationStructureInstanceBuffers[i]);
+    }
 
 
     // TLAS get sizes
@@ -657,9 +1209,6 @@ void Viewer::loadMeshInstances(std::ifstream& file) {
             .instances = {
                 .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR,
                 .arrayOfPointers = VK_FALSE,
-                .data = {
-                    .deviceAddress = instancesBuffer.getDeviceAddress(),
-                },
             },
         },
     };
@@ -680,8 +1229,9 @@ void Viewer::loadMeshInstances(std::ifstream& file) {
     vkGetAccelerationStructureBuildSizesKHR(m_device->getHandle(), VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &accelerationStructureBuildGeometryInfo, &numInstances, &accelerationStructureBuildSizesInfo);
 
 
-    // TLAS creation
-    m_topLevelAccelerationStructureBuffer = std::make_unique<Buffer>(m_device, accelerationStructureBuildSizesInfo.accelerationStructureSize, VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
+    // TLAS creation, sized for every instance so that the TLAS and its scratch buffer are reused by every rebuild whatever the resident cells
+    m_topLevelAccelerationStructureBuffer = std::make_unique<Buffer>(m_device, accelerationStructureBuildSizesInfo.accelerationStructureSize, VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, 0, 0, m_device->getAccelerationStructurePool());
+    m_topLevelScratchBuffer = std::make_unique<Buffer>(m_device, accelerationStructureBuildSizesInfo.buildScratchSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, 0, m_accelerationStructureProperties.minAccelerationStructureScratchOffsetAlignment, m_device->getAccelerationStructurePool());
 
     const VkAccelerationStructureCreateInfoKHR accelerationStructureCreateInfo{
         .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR,
@@ -692,42 +1242,45 @@ void Viewer::loadMeshInstances(std::ifstream& file) {
     VK_CHECK(vkCreateAccelerationStructureKHR(m_device->getHandle(), &accelerationStructureCreateInfo, nullptr, &m_topLevelAccelerationStructure));
 
 
-    // TLAS build
-    const Buffer scratchBuffer = Buffer(m_device, accelerationStructureBuildSizesInfo.buildScratchSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
+    // TLAS build, empty until the first cells are streamed in
+    VkCommandBuffer commandBuffer = m_device->beginSingleTimeCommands(Device::QueueType::Graphics); {
+        cmdBuildTopLevelAccelerationStructure(commandBuffer, *m_accelerationStructureInstanceBuffers[0], 0);
+    } m_device->endSingleTimeCommands(Device::QueueType::Graphics, commandBuffer);
 
-    const VkAccelerationStructureBuildGeometryInfoKHR accelerationBuildGeometryInfo{
-        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
-        .type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR,
-        .flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR,
-        .mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR,
-        .dstAccelerationStructure = m_topLevelAccelerationStructure,
-        .geometryCount = 1,
-        .pGeometries = &accelerationStructureGeometry,
-        .scratchData {
-            .deviceAddress = scratchBuffer.getDeviceAddress(),
-        },
-    };
+    m_descriptorManager.storeAccelerationStructure(m_topLevelAccelerationStructure);
+}
 
-    VkAccelerationStructureBuildRangeInfoKHR accelerationStructureBuildRangeInfo{
-        .primitiveCount = numInstances,
-        .primitiveOffset = 0,
-        .firstVertex = 0,
-        .transformOffset = 0,
-    };
+void Viewer::loadCells() {
+    m_cells = m_file->readSection<KelpFormat::CellEntry>(KelpFormat::SectionType::Cells);
+    m_cellResources = m_file->readSection<uint32_t>(KelpFormat::SectionType::CellResources);
 
-    commandBuffer = m_device->beginSingleTimeCommands(Device::QueueType::Graphics); {
-        const std::vector<VkAccelerationStructureBuildRangeInfoKHR*> accelerationBuildStructureRangeInfos = { &accelerationStructureBuildRangeInfo };
-        vkCmdBuildAccelerationStructuresKHR(
-            commandBuffer,
-            1,
-            &accelerationBuildGeometryInfo,
-            accelerationBuildStructureRangeInfos.data());
-    } m_device->endSingleTimeCommands(Device::QueueType::Graphics, commandBuffer);
 
-    m_descriptorManager.storeAccelerationStructure(m_topLevelAccelerationStructure);
+    // Validation, every instance must belong to exactly one cell and every cell must list the meshes of its instances
+    uint32_t nextInstance = 0;
+    for (const KelpFormat::CellEntry& cell : m_cells) {
+        if (cell.firstInstance != nextInstance || cell.instanceCount > m_sceneInstances.size() - cell.firstInstance)
+            throw std::runtime_error("Error: Cell instances are invalid: " + std::to_string(cell.instanceCount) + " instances at " + std::to_string(cell.firstInstance));
+        if (static_cast<uint64_t>(cell.firstResource) + cell.meshCount + cell.textureCount > m_cellResources.size())
+            throw std::runtime_error("Error: Cell resources out of bounds: " + std::to_string(cell.meshCount + cell.textureCount) + " resources at " + std::to_string(cell.firstResource));
+
+        const std::span<const uint32_t> meshes = getCellMeshes(cell);
+        const std::span<const uint32_t> textures = getCellTextures(cell);
+        if (std::ranges::any_of(meshes, [&](uint32_t index) { return index >= m_meshEntries.size(); }) || std::ranges::any_of(textures, [&](uint32_t index) { return index >= m_textureEntries.size(); }))
+            throw std::runtime_error("Error: Cell resource index out of bounds");
+
+        for (uint32_t i = cell.firstInstance; i < cell.firstInstance + cell.instanceCount; ++i) {
+            if (std::ranges::find(meshes, static_cast<uint32_t>(m_sceneInstances[i].meshIndex)) == meshes.end())
+                throw std::runtime_error("Error: Mesh " + std::to_string(m_sceneInstances[i].meshIndex) + " of instance " + std::to_string(i) + " is missing from its cell");
+        }
+
+        nextInstance += cell.instanceCount;
+    }
+
+    if (nextInstance != m_sceneInstances.size())
+        throw std::runtime_error("Error: " + std::to_string(m_sceneInstances.size() - nextInstance) + " instances belong to no cell");
 }
 
-void Viewer::loadOMMs(std::ifstream& file) {
+void Viewer::loadOMMs() {
     // Baker creation
     const omm::BakerCreationDesc desc {
         .type = omm::BakerType::CPU,
@@ -740,17 +1293,13 @@ void Viewer::loadOMMs(std::ifstream& file) {
 
 
     // Reading serialized blob
-    size_t blobSize = 0;
-    file.read(reinterpret_cast<char*>(&blobSize), sizeof(size_t));
-    if (blobSize == 0)
+    const std::vector<uint8_t> blobData = m_file->readSection<uint8_t>(KelpFormat::SectionType::OpacityMicromaps);
+    if (blobData.empty())
         throw std::runtime_error("Error: OMM blob size is zero");
 
-    std::vector<uint8_t> blobData(blobSize);
-    file.read(reinterpret_cast<char*>(blobData.data()), static_cast<std::streamsize>(blobSize));
-
     const omm::Cpu::BlobDesc blobDesc{
         .data = blobData.data(),
-        .size = blobSize,
+        .size = blobData.size(),
     };
 
 
@@ -793,38 +1342,33 @@ void Viewer::loadAssetsFromFile(const std::filesystem::path& filePath) {
     };
     VK_CHECK(vkCreateSampler(m_device->getHandle(), &samplerInfo, nullptr, &m_defaultSampler));
 
-    std::ifstream file(filePath, std::ios::binary);
-    if (!file.is_open())
-        throw std::runtime_error("Error opening \"" + filePath.string() + "\": file not found");
-
-    funcTime("Loaded model", [&]{
-        // Read textures
-        funcTime("Loaded textures", [&]{
-            loadAndUploadTextureCollection(filePath, file, m_albedoTextures, VK_FORMAT_R8G8B8A8_UNORM, 4);
-            loadAndUploadTextureCollection(filePath, file, m_alphaTextures, VK_FORMAT_R8_UNORM, 1);
-            loadAndUploadTextureCollection(filePath, file, m_normalTextures, VK_FORMAT_R8G8B8A8_UNORM, 4);
-            loadAndUploadTextureCollection(filePath, file, m_metallicRoughnessTextures, VK_FORMAT_R8G8_UNORM, 2);
-            loadAndUploadTextureCollection(filePath, file, m_emissiveTextures, VK_FORMAT_R8G8B8A8_UNORM, 4);
-        });
+    m_file = std::make_shared<KelpFile>(filePath);
+    m_reader = std::make_unique<AsyncFileReader>(*m_file, m_threadPool);
+
+    // The payloads start on SECTION_ALIGNMENT boundaries, which is enough for every known import alignment
+    const VkDeviceSize importAlignment = m_device->getMinImportedHostPointerAlignment();
+    m_importPayloads = importAlignment != 0 && KelpFormat::SECTION_ALIGNMENT % importAlignment == 0;
+
+    // Only the metadata is loaded before the first frame, the OMMs are deserialized by the streaming thread and the textures and meshes are
+    // streamed in with the cells using them
+    funcTime("Loaded scene metadata", [&]{
+        // Read texture directory
+        loadTextureDirectory();
+        createPlaceholderTexture();
+        createTextureFeedbackBuffers();
 
         // Read materials
         funcTime("Loaded materials", [&]{
-            loadMaterials(file);
-        });
-
-        // Read OMMs
-        funcTime("Loaded OMMs", [&]{
-            loadOMMs(file);
+            loadMaterials();
         });
 
-        // Read meshes
-        funcTime("Loaded meshes", [&]{
-            loadMeshes(file);
-        });
+        // Read mesh directory
+        loadMeshDirectory();
 
         // Read mesh instances
         funcTime("Loaded scene graph", [&]{
-            loadMeshInstances(file);
+            loadMeshInstances();
+            loadCells();
         });
     });
 }
@@ -0,0 +1,536 @@
+#include "Viewer/Viewer.hpp"
+
+#include "Common/KelpFormat.hpp"
+#include "Viewer/Config.hpp"
+#include "Viewer/Vulkan/Buffer.hpp"
+#include "Viewer/Vulkan/DescriptorManager.hpp"
+#include "Viewer/Vulkan/Device.hpp"
+#include "shared.hpp"
+
+#include "glm/common.hpp"
+#include "glm/geometric.hpp"
+#include "vk_mem_alloc.h"
+#include <vulkan/vulkan_core.h>
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+std::span<const uint32_t> Viewer::getCellMeshes(const KelpFormat::CellEntry& cell) const {
+    return std::span(m_cellResources).subspan(cell.firstResource, cell.meshCount);
+}
+
+std::span<const uint32_t> Viewer::getCellTextures(const KelpFormat::CellEntry& cell) const {
+    return std::span(m_cellResources).subspan(cell.firstResource + cell.meshCount, cell.textureCount);
+}
+
+float Viewer::getCellDistance(const KelpFormat::CellEntry& cell, const glm::vec3& position) {
+    return glm::length(glm::max(glm::max(cell.boundsMin - position, position - cell.boundsMax), glm::vec3(0)));
+}
+
+uint64_t Viewer::getMeshSize(const KelpFormat::MeshEntry& entry, const Mesh& mesh) {
+    uint64_t size = KelpFormat::meshPayloadSize(entry) + mesh.accelerationStructure.size;
+    for (const MeshLod& lod : mesh.lods)
+        size += lod.accelerationStructure.size;
+    return size;
+}
+
+uint64_t Viewer::getTextureSize(const KelpFormat::TextureEntry& entry, uint32_t firstMip) {
+    return entry.size - KelpFormat::mipOffset(entry, firstMip);
+}
+
+void Viewer::printMemoryReport() const {
+    uint64_t baseSize = 0;
+    uint64_t lodSize = 0;
+    for (size_t i = 0; i < m_streamedMeshes.size(); ++i) {
+        if (m_streamedMeshes[i] == nullptr)
+            continue;
+
+        const KelpFormat::MeshEntry& entry = m_meshEntries[i];
+        const Mesh& mesh = *m_streamedMeshes[i];
+        baseSize += (entry.vertexCount * sizeof(Vertex)) + (entry.indexCount * sizeof(uint32_t)) + mesh.accelerationStructure.size;
+        for (size_t j = 0; j < mesh.lods.size(); ++j)
+            lodSize += (entry.lods[j].indexCount * sizeof(uint32_t)) + mesh.lods[j].accelerationStructure.size;
+    }
+
+    std::cout << "Mesh LODs: " << lodSize / 1024 / 1024 << " MB of index buffers and BLASes on top of " << baseSize / 1024 / 1024 << " MB of full resolution geometry" << std::endl;
+
+    // Blocks count as one device memory allocation each, like the dedicated allocations
+    VmaStatistics poolStatistics{};
+    vmaGetPoolStatistics(m_device->getAllocator(), m_device->getAccelerationStructurePool(), &poolStatistics);
+    VmaTotalStatistics totalStatistics{};
+    vmaCalculateStatistics(m_device->getAllocator(), &totalStatistics);
+    std::cout << "Acceleration structures: " << poolStatistics.allocationCount << " buffers in " << poolStatistics.blockCount << " memory blocks (" << poolStatistics.allocationBytes / 1024 / 1024 << " MB used of "
+        << poolStatistics.blockBytes / 1024 / 1024 << " MB), geometry in " << m_geometryBuffer->getBufferCount() << " buffers, " << totalStatistics.total.statistics.blockCount << " device memory allocations in total, at most " << m_device->getProperties().limits.maxMemoryAllocationCount << std::endl;
+}
+
+void Viewer::startStreaming(const StreamingOptions& options) {
+    m_streamingOptions = options;
+    if (m_streamingOptions.memoryBudget == 0) {
+        const auto [usage, budget] = getVramUsage();
+        m_streamingOptions.memoryBudget = static_cast<uint64_t>(static_cast<double>(budget > usage ? budget - usage : 0) * Config::STREAMING_VRAM_BUDGET_SHARE);
+    }
+
+    m_cellStreamed.assign(m_cells.size(), false);
+    m_meshReferences.assign(m_meshEntries.size(), 0);
+    m_textureReferences.assign(m_textureEntries.size(), 0);
+    m_meshResidency.assign(m_meshEntries.size(), Residency::Absent);
+    m_textureResidency.assign(m_textureEntries.size(), Residency::Absent);
+    m_streamedMeshes.resize(m_meshEntries.size());
+    m_meshSizes.assign(m_meshEntries.size(), 0);
+    m_textureFirstMips.assign(m_textureEntries.size(), 0);
+    m_streamingCameraPosition = m_camera.getPosition();
+    for (uint32_t slot = DescriptorManager::ARRAY_DESCRIPTOR_COUNT - 1; slot > PLACEHOLDER_TEXTURE_SLOT; --slot)
+        m_freeTextureSlots.push_back(slot);
+
+    std::cout << "Streaming " << m_cells.size() << " cells " << (m_streamingOptions.prefetchRadius == std::numeric_limits<float>::max() ? std::string("at any distance") : "within " + std::to_string(m_streamingOptions.prefetchRadius) + " units")
+        << " of the camera, in a " << m_streamingOptions.memoryBudget / 1024 / 1024 << " MB budget" << std::endl;
+
+    m_streamingThread = std::thread(&Viewer::streamCells, this);
+}
+
+void Viewer::stopStreaming() {
+    if (!m_streamingThread.joinable())
+        return;
+
+    {
+        const std::lock_guard<std::mutex> lock(m_streamingMutex);
+        m_stopStreaming = true;
+    }
+    m_streamingCondition.notify_one();
+    m_streamingThread.join();
+}
+
+void Viewer::streamCells() {
+    try {
+        // Only needed by the meshes, deserialized here so that the render loop starts without waiting for them
+        funcTime("Loaded OMMs", [&]{
+            loadOMMs();
+        });
+
+        std::vector<uint32_t> textureFeedback;
+        bool reportedMemory = false;    // Once the cells around the initial camera are resident, not for every cell streamed afterwards
+        while (true) {
+            glm::vec3 cameraPosition;
+            {
+                const std::lock_guard<std::mutex> lock(m_streamingMutex);
+                if (m_stopStreaming)
+                    return;
+
+                // Resources destroyed by the render thread can be streamed in again
+                for (const uint32_t index : m_retiredMeshIndices)
+                    m_meshResidency[index] = Residency::Absent;
+                for (const uint32_t index : m_retiredTextureIndices)
+                    m_textureResidency[index] = Residency::Absent;
+                m_retiredMeshIndices.clear();
+                m_retiredTextureIndices.clear();
+                cameraPosition = m_streamingCameraPosition;
+
+                // A newer feedback window replaces the one kept while cells were streamed
+                if (!m_textureFeedback.empty())
+                    textureFeedback = std::exchange(m_textureFeedback, {});
+            }
+
+            // Cells come first, the mips of the resident textures follow the feedback once they are all in
+            if (streamNextCell(cameraPosition))
+                continue;
+            if (!reportedMemory) {
+                printMemoryReport();
+                reportedMemory = true;
+            }
+            if (!textureFeedback.empty() && streamTextureMips(std::exchange(textureFeedback, {})))
+                continue;
+
+            std::unique_lock<std::mutex> lock(m_streamingMutex);
+            m_streamingCondition.wait_for(lock, std::chrono::milliseconds(Config::STREAMING_POLL_INTERVAL_MS), [&] {
+                return m_stopStreaming || !m_retiredMeshIndices.empty() || !m_retiredTextureIndices.empty() || !m_textureFeedback.empty();
+            });
+        }
+    } catch (...) {
+        const std::lock_guard<std::mutex> lock(m_streamingMutex);
+        m_streamingException = std::current_exception();
+    }
+}
+
+bool Viewer::streamNextCell(const glm::vec3& cameraPosition) {
+    std::vector<float> distances(m_cells.size());
+    for (size_t i = 0; i < m_cells.size(); ++i)
+        distances[i] = getCellDistance(m_cells[i], cameraPosition);
+
+
+    // Cells left far behind are evicted even within the budget
+    for (uint32_t i = 0; i < m_cells.size(); ++i) {
+        if (m_cellStreamed[i] && distances[i] > m_streamingOptions.prefetchRadius * Config::STREAMING_EVICTION_FACTOR) {
+            evictCell(i);
+            return true;
+        }
+    }
+
+
+    // Nearest cell within the prefetch radius, skipping the ones needing a resource the render thread is still releasing
+    const auto isRetiring = [&](const KelpFormat::CellEntry& cell) {
+        return std::ranges::any_of(getCellMeshes(cell), [&](uint32_t index) { return m_meshResidency[index] == Residency::Retiring; })
+            || std::ranges::any_of(getCellTextures(cell), [&](uint32_t index) { return m_textureResidency[index] == Residency::Retiring; });
+    };
+
+    std::optional<uint32_t> next;
+    for (uint32_t i = 0; i < m_cells.size(); ++i) {
+        if (m_cellStreamed[i] || distances[i] > m_streamingOptions.prefetchRadius || (next.has_value() && distances[i] >= distances[*next]) || isRetiring(m_cells[i]))
+            continue;
+        next = i;
+    }
+    if (!next.has_value())
+        return false;
+
+
+    // The farthest streamed cells are evicted until the next one fits in the budget, never ones closer than it.
+    // Evictions are planned on copies of the reference counts first, so that nothing is evicted for a cell that wouldn't fit anyway
+    const KelpFormat::CellEntry& cell = m_cells[*next];
+    std::vector<uint32_t> meshReferences = m_meshReferences;
+    std::vector<uint32_t> textureReferences = m_textureReferences;
+
+    uint64_t size = 0;
+    for (const uint32_t index : getCellMeshes(cell)) {
+        if (meshReferences[index]++ == 0)
+            size += KelpFormat::meshPayloadSize(m_meshEntries[index]) * 2;     // The BLASes are about the size of the geometry
+    }
+    for (const uint32_t index : getCellTextures(cell)) {
+        if (textureReferences[index]++ == 0)
+            size += getTextureSize(m_textureEntries[index], getMipTail(m_textureEntries[index]));
+    }
+
+    std::vector<uint32_t> candidates;
+    for (uint32_t i = 0; i < m_cells.size(); ++i) {
+        if (m_cellStreamed[i] && distances[i] > distances[*next])
+            candidates.push_back(i);
+    }
+    std::ranges::sort(candidates, [&](uint32_t a, uint32_t b) { return distances[a] > distances[b]; });
+
+    uint64_t remainingSize = m_streamedSize;
+    size_t evictionCount = 0;
+    while (remainingSize + size > m_streamingOptions.memoryBudget && evictionCount < candidates.size()) {
+        const KelpFormat::CellEntry& evictedCell = m_cells[candidates[evictionCount++]];
+        for (const uint32_t index : getCellMeshes(evictedCell)) {
+            if (--meshReferences[index] == 0)
+                remainingSize -= m_meshSizes[index];
+        }
+        for (const uint32_t index : getCellTextures(evictedCell)) {
+            if (--textureReferences[index] == 0)
+                remainingSize -= getTextureSize(m_textureEntries[index], m_textureFirstMips[index]);
+        }
+    }
+
+    // A cell bigger than the whole budget is still streamed in when nothing else is resident
+    if (remainingSize + size > m_streamingOptions.memoryBudget && remainingSize > 0)
+        return false;
+
+
+    // The resources of the next cell are referenced before the evictions, so that the ones it shares with them are kept
+    for (const uint32_t index : getCellMeshes(cell))
+        m_meshReferences[index]++;
+    for (const uint32_t index : getCellTextures(cell))
+        m_textureReferences[index]++;
+
+    for (size_t i = 0; i < evictionCount; ++i)
+        evictCell(candidates[i]);
+
+    streamInCell(*next);
+    return true;
+}
+
+void Viewer::streamInCell(uint32_t cellIndex) {
+    const auto timeStart = std::chrono::high_resolution_clock::now();
+    const KelpFormat::CellEntry& cell = m_cells[cellIndex];
+    StreamingEvent event{ .cell = cellIndex, .type = StreamingEventType::StreamedIn };
+
+
+    // Only the resources no other streamed cell brought in are loaded, the cell already holds a reference to all of them
+    std::vector<uint32_t> textureIndices;
+    for (const uint32_t index : getCellTextures(cell)) {
+        if (m_textureResidency[index] == Residency::Absent)
+            textureIndices.push_back(index);
+    }
+
+    std::vector<uint32_t> meshIndices;
+    for (const uint32_t index : getCellMeshes(cell)) {
+        if (m_meshResidency[index] == Residency::Absent)
+            meshIndices.push_back(index);
+    }
+
+    // The mip tails of the textures are enough to show the cell, their finer mips are loaded once the hit shaders sample them
+    std::vector<uint32_t> firstMips;
+    for (const uint32_t index : textureIndices)
+        firstMips.push_back(getMipTail(m_textureEntries[index]));
+
+    const std::vector<Texture> textures = loadTextures(textureIndices, firstMips);
+    for (size_t i = 0; i < textureIndices.size(); ++i) {
+        m_textureResidency[textureIndices[i]] = Residency::Resident;
+        m_textureFirstMips[textureIndices[i]] = firstMips[i];
+        m_streamedSize += getTextureSize(m_textureEntries[textureIndices[i]], firstMips[i]);
+        event.textures.emplace_back(textureIndices[i], textures[i]);
+    }
+
+    const std::vector<std::shared_ptr<Mesh>> meshes = loadMeshes(meshIndices);
+    for (size_t i = 0; i < meshIndices.size(); ++i) {
+        m_meshResidency[meshIndices[i]] = Residency::Resident;
+        m_meshSizes[meshIndices[i]] = getMeshSize(m_meshEntries[meshIndices[i]], *meshes[i]);
+        m_streamedSize += m_meshSizes[meshIndices[i]];
+        m_streamedMeshes[meshIndices[i]] = meshes[i];
+        event.meshes.emplace_back(meshIndices[i], meshes[i]);
+    }
+
+
+    // The instances of the cell only reach the TLAS once the render thread handles the event
+    writeMeshInstances(cell);
+    m_cellStreamed[cellIndex] = true;
+    pushStreamingEvent(std::move(event));
+
+    const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - timeStart).count();
+    std::cout << "Streamed in cell " << cellIndex << " (" << cell.instanceCount << " instances, " << meshIndices.size() << " new meshes, " << textureIndices.size() << " new textures) in " << duration << " ms, "
+        << m_streamedSize / 1024 / 1024 << " / " << m_streamingOptions.memoryBudget / 1024 / 1024 << " MB resident" << std::endl;
+}
+
+bool Viewer::streamTextureMips(const std::vector<uint32_t>& textureFeedback) {
+    // Finest mip each resident texture needs: the first one with at least the sampled resolution, down to the mip tail for the unsampled ones
+    std::vector<std::pair<uint32_t, uint32_t>> coarsened;      // Texture index & first mip
+    std::vector<std::pair<uint32_t, uint32_t>> refined;
+    for (uint32_t i = 0; i < m_textureEntries.size(); ++i) {
+        if (m_textureResidency[i] != Residency::Resident)
+            continue;
+
+        const KelpFormat::TextureEntry& entry = m_textureEntries[i];
+        const uint32_t tail = getMipTail(entry);
+        const auto levels = static_cast<uint32_t>(std::bit_width(std::max(entry.width, entry.height)) - 1);    // log2 of the mip 0 size
+        const uint32_t wantedMip = textureFeedback[i] == 0 ? tail : std::min(tail, levels - std::min(levels, textureFeedback[i] - 1));
+
+        if (wantedMip < m_textureFirstMips[i])
+            refined.emplace_back(i, wantedMip);
+        else if (wantedMip > m_textureFirstMips[i] + Config::TEXTURE_MIP_EVICTION_SLACK)
+            coarsened.emplace_back(i, wantedMip);
+    }
+
+
+    // Dropping finer mips frees memory for the textures missing the most mips, refined while they fit in the budget.
+    // A pass reads at most a staging batch so that the cells streamed in next don't wait for the whole scene
+    uint64_t size = m_streamedSize;
+    for (const auto& [index, firstMip] : coarsened)
+        size -= getTextureSize(m_textureEntries[index], m_textureFirstMips[index]) - getTextureSize(m_textureEntries[index], firstMip);
+
+    std::ranges::sort(refined, [&](const auto& a, const auto& b) { return m_textureFirstMips[a.first] - a.second > m_textureFirstMips[b.first] - b.second; });
+
+    std::vector<std::pair<uint32_t, uint32_t>> changes = coarsened;
+    uint64_t readSize = 0;
+    for (const auto& [index, firstMip] : refined) {
+        const uint64_t newSize = getTextureSize(m_textureEntries[index], firstMip);
+        const uint64_t addedSize = newSize - getTextureSize(m_textureEntries[index], m_textureFirstMips[index]);
+        if (size + addedSize > m_streamingOptions.memoryBudget || (readSize > 0 && readSize + newSize > Config::MAX_STAGING_BATCH_SIZE))
+            continue;
+
+        size += addedSize;
+        readSize += newSize;
+        changes.emplace_back(index, firstMip);
+    }
+    if (changes.empty())
+        return false;
+
+
+    // The textures are reloaded with their new mips into other slots, the render thread swaps them in and retires the previous ones
+    const auto timeStart = std::chrono::high_resolution_clock::now();
+    std::vector<uint32_t> textureIndices;
+    std::vector<uint32_t> firstMips;
+    for (const auto& [index, firstMip] : changes) {
+        textureIndices.push_back(index);
+        firstMips.push_back(firstMip);
+    }
+
+    StreamingEvent event{ .cell = 0, .type = StreamingEventType::MipsChanged };
+    const std::vector<Texture> textures = loadTextures(textureIndices, firstMips);
+    for (size_t i = 0; i < textureIndices.size(); ++i) {
+        const KelpFormat::TextureEntry& entry = m_textureEntries[textureIndices[i]];
+        m_streamedSize = m_streamedSize - getTextureSize(entry, m_textureFirstMips[textureIndices[i]]) + getTextureSize(entry, firstMips[i]);
+        m_textureFirstMips[textureIndices[i]] = firstMips[i];
+        event.textures.emplace_back(textureIndices[i], textures[i]);
+    }
+    pushStreamingEvent(std::move(event));
+
+    const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - timeStart).count();
+    std::cout << "Streamed texture mips (" << changes.size() - coarsened.size() << " textures refined, " << coarsened.size() << " coarsened) in " << duration << " ms, "
+        << m_streamedSize / 1024 / 1024 << " / " << m_streamingOptions.memoryBudget / 1024 / 1024 << " MB resident" << std::endl;
+    return true;
+}
+
+void Viewer::evictCell(uint32_t cellIndex) {
+    const KelpFormat::CellEntry& cell = m_cells[cellIndex];
+    StreamingEvent event{ .cell = cellIndex, .type = StreamingEventType::Evicted };
+
+    // Resources no other streamed cell uses are released, they can't be streamed in again until the render thread destroyed them
+    for (const uint32_t index : getCellMeshes(cell)) {
+        if (--m_meshReferences[index] != 0)
+            continue;
+
+        m_meshResidency[index] = Residency::Retiring;
+        m_streamedSize -= m_meshSizes[index];
+        m_streamedMeshes[index].reset();
+        event.releasedMeshes.push_back(index);
+    }
+
+    for (const uint32_t index : getCellTextures(cell)) {
+        if (--m_textureReferences[index] != 0)
+            continue;
+
+        m_textureResidency[index] = Residency::Retiring;
+        m_streamedSize -= getTextureSize(m_textureEntries[index], m_textureFirstMips[index]);
+        event.releasedTextures.push_back(index);
+    }
+
+    m_cellStreamed[cellIndex] = false;
+    pushStreamingEvent(std::move(event));
+}
+
+void Viewer::writeMeshInstances(const KelpFormat::CellEntry& cell) {
+    // The mesh instance entries of a cell are contiguous, like its instances
+    std::vector<MeshInstance> meshInstances;
+    for (uint32_t i = cell.firstInstance; i < cell.firstInstance + cell.instanceCount; ++i) {
+        const Mesh& mesh = *m_streamedMeshes[m_sceneInstances[i].meshIndex];
+
+        meshInstances.push_back(MeshInstance{
+            .vertexBuffer = mesh.vertexAddress,
+            .indexBuffer = mesh.indexAddress,
+            .materialIndex = mesh.materialIndex,
+        });
+
+        // Every LOD of the entry has its slot, even the ones without BLAS under --no-lods, their indices are uploaded with the mesh anyway
+        const KelpFormat::MeshEntry& entry = m_meshEntries[m_sceneInstances[i].meshIndex];
+        for (uint32_t j = 0; j < entry.lodCount; ++j) {
+            meshInstances.push_back(MeshInstance{
+                .vertexBuffer = mesh.vertexAddress,
+                .indexBuffer = mesh.geometry.deviceAddress + KelpFormat::meshLodIndicesOffset(entry, j + 1),
+                .materialIndex = mesh.materialIndex,
+            });
+        }
+    }
+    if (meshInstances.empty())
+        return;
+
+    // Copied on the transfer queue, the cell only enters the TLAS once the copy is complete
+    const uint64_t ticket = uploadToBuffer(*m_meshInstanceBuffer, meshInstances.data(), meshInstances.size() * sizeof(MeshInstance), m_sceneInstances[cell.firstInstance].firstMeshInstance * sizeof(MeshInstance),
+        VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR);
+    m_stagingUploader.wait(ticket);
+}
+
+void Viewer::pushStreamingEvent(StreamingEvent&& event) {
+    const std::lock_guard<std::mutex> lock(m_streamingMutex);
+    m_streamingEvents.push_back(std::move(event));
+}
+
+bool Viewer::updateResidency(VkCommandBuffer commandBuffer) {
+    m_frameNumber++;
+
+    // Resources retired MAX_FRAMES_IN_FLIGHT frames ago are no longer used by any frame in flight, they are destroyed here
+    std::vector<uint32_t> retiredMeshIndices;
+    std::vector<uint32_t> retiredTextureIndices;
+    std::vector<uint32_t> freedTextureSlots;
+    while (!m_retiredResources.empty() && m_retiredResources.front().frame + Config::MAX_FRAMES_IN_FLIGHT <= m_frameNumber) {
+        for (const auto& [index, mesh] : m_retiredResources.front().meshes)
+            retiredMeshIndices.push_back(index);
+        for (const auto& [index, texture] : m_retiredResources.front().textures) {
+            retiredTextureIndices.push_back(index);
+            freedTextureSlots.push_back(texture.bindlessId);
+        }
+        for (const Texture& texture : m_retiredResources.front().replacedTextures)
+            freedTextureSlots.push_back(texture.bindlessId);
+        m_retiredResources.pop_front();
+    }
+
+
+    // Camera position for the streaming thread, events from it
+    std::deque<StreamingEvent> events;
+    {
+        const std::lock_guard<std::mutex> lock(m_streamingMutex);
+        if (m_streamingException)
+            std::rethrow_exception(m_streamingException);
+
+        m_streamingCameraPosition = m_camera.getPosition();
+        m_retiredMeshIndices.insert(m_retiredMeshIndices.end(), retiredMeshIndices.begin(), retiredMeshIndices.end());
+        m_retiredTextureIndices.insert(m_retiredTextureIndices.end(), retiredTextureIndices.begin(), retiredTextureIndices.end());
+        m_freeTextureSlots.insert(m_freeTextureSlots.end(), freedTextureSlots.begin(), freedTextureSlots.end());
+        events.swap(m_streamingEvents);
+    }
+    if (!retiredMeshIndices.empty() || !retiredTextureIndices.empty())
+        m_streamingCondition.notify_one();
+
+
+    // Streamed in cells enter the TLAS at LOD 0, evicted ones leave it and their released resources wait for the frames in flight,
+    // like the textures replaced by the same ones with other mips. Directory entries of textures are pointed at their new slot from this frame on
+    RetiredResources retired{ .frame = m_frameNumber };
+    std::vector<std::pair<uint32_t, uint32_t>> textureSlotUpdates;
+    for (StreamingEvent& event : events) {
+        if (event.type == StreamingEventType::Evicted) {
+            std::erase(m_residentCells, event.cell);
+            for (const uint32_t index : event.releasedMeshes)
+                retired.meshes.emplace_back(index, std::move(m_meshes[index]));
+            for (const uint32_t index : event.releasedTextures) {
+                retired.textures.emplace_back(index, std::exchange(m_textures[index], Texture{}));
+                textureSlotUpdates.emplace_back(index, PLACEHOLDER_TEXTURE_SLOT);
+            }
+            continue;
+        }
+
+        if (event.type == StreamingEventType::MipsChanged) {
+            for (auto& [index, texture] : event.textures) {
+                textureSlotUpdates.emplace_back(index, texture.bindlessId);
+                retired.replacedTextures.push_back(std::exchange(m_textures[index], std::move(texture)));
+            }
+            continue;
+        }
+
+        for (auto& [index, mesh] : event.meshes)
+            m_meshes[index] = std::move(mesh);
+        for (auto& [index, texture] : event.textures) {
+            textureSlotUpdates.emplace_back(index, texture.bindlessId);
+            m_textures[index] = std::move(texture);
+        }
+
+        const KelpFormat::CellEntry& cell = m_cells[event.cell];
+        for (uint32_t i = cell.firstInstance; i < cell.firstInstance + cell.instanceCount; ++i) {
+            SceneInstance& instance = m_sceneInstances[i];
+            instance.lod = 0;
+            m_accelerationStructureInstances[i].accelerationStructureReference = m_meshes[instance.meshIndex]->accelerationStructure.deviceAddress;
+            m_accelerationStructureInstances[i].instanceCustomIndex = instance.firstMeshInstance;
+        }
+        m_residentCells.push_back(event.cell);
+    }
+
+    if (!retired.meshes.empty() || !retired.textures.empty() || !retired.replacedTextures.empty())
+        m_retiredResources.push_back(std::move(retired));
+
+
+    // The texture slot buffer is updated once the previous frames are done sampling through it, and before this frame does
+    if (!textureSlotUpdates.empty()) {
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+        for (const auto& [index, slot] : textureSlotUpdates)
+            vkCmdUpdateBuffer(commandBuffer, m_textureSlotBuffer->getHandle(), index * sizeof(uint32_t), sizeof(uint32_t), &slot);
+
+        const VkMemoryBarrier afterUpdateBarrier{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+        };
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, 0, 1, &afterUpdateBarrier, 0, nullptr, 0, nullptr);
+    }
+
+    return !events.empty();
+}
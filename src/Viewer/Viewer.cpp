@@ -1,5 +1,6 @@
 #include "Viewer/Viewer.hpp"
 
+#include "Common/KelpFormat.hpp"
 #include "Viewer/ShaderCompiler.hpp"
 #include "Viewer/Vulkan/Device.hpp"
 #include "Viewer/Vulkan/Image.hpp"
@@ -8,19 +9,26 @@
 
 #include "GLFW/glfw3.h"
 #include "glm/ext/vector_int2.hpp"
+#include "glm/geometric.hpp"
 #include "glm/matrix.hpp"
 #include "glslang/Public/ShaderLang.h"
+#include "omm.hpp"
 #include "shared.hpp"
 #include <vulkan/vulkan_core.h>
 
+#include <algorithm>
 #include <array>
 #include <chrono>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 
 Viewer::Viewer() {
@@ -41,13 +49,20 @@ Viewer::Viewer() {
 }
 
 Viewer::~Viewer() {
+    stopStreaming();
     m_device->waitIdle();
 
-    for (const auto& mesh : m_meshes) {
-        if (mesh->accelerationStructure.handle != VK_NULL_HANDLE)
-           vkDestroyAccelerationStructureKHR(m_device->getHandle(), mesh->accelerationStructure.handle, nullptr);
-        if (mesh->accelerationStructure.micromap != VK_NULL_HANDLE)
-            vkDestroyMicromapEXT(m_device->getHandle(), mesh->accelerationStructure.micromap, nullptr);
+    // Meshes destroy their acceleration structures with their last reference
+    m_retiredResources.clear();
+    m_streamingEvents.clear();
+    m_streamedMeshes.clear();
+    m_meshes.clear();
+    if (m_ommDeserializedResult != nullptr)
+        omm::Cpu::DestroyDeserializedResult(m_ommDeserializedResult);
+
+    for (const auto& instanceBuffer : m_accelerationStructureInstanceBuffers) {
+        if (instanceBuffer != nullptr)
+            instanceBuffer->unmap();
     }
     if (m_topLevelAccelerationStructure != VK_NULL_HANDLE)
         vkDestroyAccelerationStructureKHR(m_device->getHandle(), m_topLevelAccelerationStructure, VK_NULL_HANDLE);
@@ -69,8 +84,12 @@ Viewer::~Viewer() {
 }
 
 void Viewer::getRaytracingProperties() {
+    VkPhysicalDeviceAccelerationStructurePropertiesKHR accelerationStructureProperties{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR,
+    };
     VkPhysicalDeviceRayTracingPipelinePropertiesKHR rayTracingPipelineProperties{
         .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_PROPERTIES_KHR,
+        .pNext = &accelerationStructureProperties,
     };
     VkPhysicalDeviceProperties2 physicalDeviceProperties2{
         .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
@@ -78,6 +97,7 @@ void Viewer::getRaytracingProperties() {
     };
     vkGetPhysicalDeviceProperties2(m_device->getPhysicalDevice(), &physicalDeviceProperties2);
     m_raytracingProperties = rayTracingPipelineProperties;
+    m_accelerationStructureProperties = accelerationStructureProperties;
 }
 
 void Viewer::prepareOutputImage() {
@@ -256,6 +276,31 @@ void Viewer::traceRays(VkCommandBuffer commandBuffer) {
     const VkStridedDeviceAddressRegionKHR callableShaderSbtEntry{};
     vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_raytracingPipeline);
     vkCmdTraceRaysKHR(commandBuffer, &raygenShaderSbtEntry, &missShaderSbtEntry, &hitShaderSbtEntry, &callableShaderSbtEntry, m_swapchain.getExtent().width, m_swapchain.getExtent().height, 1);
+
+    // The texture feedback is copied to host memory, read back once the fence of the frame is signaled, and cleared for the next frame using it
+    const Buffer& feedbackBuffer = *m_textureFeedbackBuffers[m_swapchain.getCurrentFrameIndex()];
+    const VkMemoryBarrier feedbackBarrier{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+    };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &feedbackBarrier, 0, nullptr, 0, nullptr);
+    m_textureFeedbackReadbackBuffers[m_swapchain.getCurrentFrameIndex()]->copyFrom(commandBuffer, feedbackBuffer.getHandle(), std::max<size_t>(m_textureEntries.size(), 1) * sizeof(uint32_t));
+
+    const VkMemoryBarrier clearBarrier{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+        .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+    };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+    vkCmdFillBuffer(commandBuffer, feedbackBuffer.getHandle(), 0, VK_WHOLE_SIZE, 0);
+
+    const VkMemoryBarrier readbackBarrier{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_HOST_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+    };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, 0, 1, &readbackBarrier, 0, nullptr, 0, nullptr);
 }
 
 void Viewer::transferOutputImageToSwapchain(VkCommandBuffer commandBuffer) {
@@ -290,11 +335,13 @@ void Viewer::bindDescriptors(VkCommandBuffer commandBuffer) {
         .inverseProjection = glm::inverse(m_camera.getProjectionMatrix()),
         .meshInstanceBuffer = m_meshInstanceBuffer->getDeviceAddress(),
         .materialsBuffer = m_materialBuffer->getDeviceAddress(),
+        .textureSlotBuffer = m_textureSlotBuffer->getDeviceAddress(),
+        .textureFeedbackBuffer = m_textureFeedbackBuffers[m_swapchain.getCurrentFrameIndex()]->getDeviceAddress(),
     };
     vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_ALL, 0, sizeof(PushConstant), &pc);
 }
 
-void Viewer::updateWindowTitle(float deltaTime) {
+std::pair<uint64_t, uint64_t> Viewer::getVramUsage() const {
     VkPhysicalDeviceMemoryBudgetPropertiesEXT memoryBudget{
         .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT,
     };
@@ -306,27 +353,139 @@ void Viewer::updateWindowTitle(float deltaTime) {
 
     vkGetPhysicalDeviceMemoryProperties2(m_device->getPhysicalDevice(), &memoryProperties);
 
-    uint32_t vramBudget = 0;
-    uint32_t vramUsage = 0;
+    uint64_t vramUsage = 0;
+    uint64_t vramBudget = 0;
 
     for (uint32_t i = 0; i < memoryProperties.memoryProperties.memoryHeapCount; i++) {
         if (static_cast<bool>(memoryProperties.memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)) {
-            vramBudget += memoryBudget.heapBudget[i] / 1024 / 1024;
-            vramUsage += memoryBudget.heapUsage[i] / 1024 / 1024;
+            vramUsage += memoryBudget.heapUsage[i];
+            vramBudget += memoryBudget.heapBudget[i];
+        }
+    }
+
+    return { vramUsage, vramBudget };
+}
+
+void Viewer::updateWindowTitle(float deltaTime) {
+    const auto [vramUsage, vramBudget] = getVramUsage();
+
+    m_window->setTitle(std::string("Kelp Engine | " + std::to_string(vramUsage / 1024 / 1024) + " MB / " + std::to_string(vramBudget / 1024 / 1024) + " MB | " + std::to_string(m_residentCells.size()) + " / " + std::to_string(m_cells.size()) + " cells | "
+        + std::to_string(m_selectedTriangleCount / 1000) + "K triangles | " + std::to_string(static_cast<int>(1.0F / deltaTime)) + " FPS").c_str());
+}
+
+bool Viewer::selectMeshLods() {
+    // Projected size in pixels of one world space unit at a distance of one unit
+    const float pixelsPerUnit = std::abs(m_camera.getProjectionMatrix()[1][1]) * static_cast<float>(m_swapchain.getExtent().height) * 0.5F;
+    const glm::vec3& cameraPosition = m_camera.getPosition();
+
+    bool changed = false;
+    m_selectedTriangleCount = 0;
+
+    // Only the instances of the resident cells are in the TLAS
+    for (const uint32_t cellIndex : m_residentCells) {
+        const KelpFormat::CellEntry& cell = m_cells[cellIndex];
+
+        for (size_t i = cell.firstInstance; i < cell.firstInstance + cell.instanceCount; i++) {
+            SceneInstance& instance = m_sceneInstances[i];
+            const Mesh& mesh = *m_meshes[instance.meshIndex];
+
+            // Distance to the bounding sphere, an inside camera always gets the full resolution mesh
+            const float distance = glm::length(instance.center - cameraPosition) - instance.radius;
+            const auto projectedError = [&](uint32_t lod) {
+                if (lod == 0)
+                    return 0.0F;
+                return distance <= 0 ? std::numeric_limits<float>::max() : mesh.lods[lod - 1].error * instance.scale / distance * pixelsPerUnit;
+            };
+
+            uint32_t lod = instance.lod;
+            while (lod > 0 && projectedError(lod) > Config::LOD_PIXEL_ERROR_THRESHOLD)
+                lod--;
+            while (lod < mesh.lods.size() && projectedError(lod + 1) <= Config::LOD_PIXEL_ERROR_THRESHOLD * Config::LOD_HYSTERESIS)
+                lod++;
+
+            m_selectedTriangleCount += (lod == 0 ? mesh.indexCount : mesh.lods[lod - 1].indexCount) / 3;
+            if (lod == instance.lod)
+                continue;
+
+            const AccelerationStructure& accelerationStructure = lod == 0 ? mesh.accelerationStructure : mesh.lods[lod - 1].accelerationStructure;
+            m_accelerationStructureInstances[i].accelerationStructureReference = accelerationStructure.deviceAddress;
+            m_accelerationStructureInstances[i].instanceCustomIndex = instance.firstMeshInstance + lod;
+
+            instance.lod = lod;
+            changed = true;
         }
     }
 
-    m_window->setTitle(std::string("Kelp Engine | " + std::to_string(vramUsage) + " MB / " + std::to_string(vramBudget) + " MB | " + std::to_string(static_cast<int>(1.0F / deltaTime)) + " FPS").c_str());
+    return changed;
 }
 
-void Viewer::run(const std::filesystem::path& filePath) {
+void Viewer::updateTopLevelAccelerationStructure(VkCommandBuffer commandBuffer) {
+    const bool residencyChanged = updateResidency(commandBuffer);
+    const bool lodsChanged = selectMeshLods();
+    if (!residencyChanged && !lodsChanged)
+        return;
+
+    // The instances of the resident cells are packed in the instance buffer of this frame, free since its fence was waited for by beginFrame()
+    const uint32_t frameIndex = m_swapchain.getCurrentFrameIndex();
+    auto* instances = static_cast<VkAccelerationStructureInstanceKHR*>(m_mappedAccelerationStructureInstanceBuffers[frameIndex]);
+    m_residentInstanceCount = 0;
+    for (const uint32_t cellIndex : m_residentCells) {
+        const KelpFormat::CellEntry& cell = m_cells[cellIndex];
+        std::memcpy(instances + m_residentInstanceCount, &m_accelerationStructureInstances[cell.firstInstance], cell.instanceCount * sizeof(VkAccelerationStructureInstanceKHR));
+        m_residentInstanceCount += cell.instanceCount;
+    }
+
+
+    // Rebuild the TLAS in place once the previous frames stopped tracing it and their builds released the scratch buffer
+    const VkMemoryBarrier beforeBuildBarrier{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+        .dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+    };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0, 1, &beforeBuildBarrier, 0, nullptr, 0, nullptr);
+
+    cmdBuildTopLevelAccelerationStructure(commandBuffer, *m_accelerationStructureInstanceBuffers[frameIndex], m_residentInstanceCount);
+
+    const VkMemoryBarrier afterBuildBarrier{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+        .dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR,
+    };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, 0, 1, &afterBuildBarrier, 0, nullptr, 0, nullptr);
+}
+
+void Viewer::readTextureFeedback() {
+    // Copied by the frame that last used this frame index, complete since beginFrame() waited for its fence
+    const Buffer& readbackBuffer = *m_textureFeedbackReadbackBuffers[m_swapchain.getCurrentFrameIndex()];
+    readbackBuffer.invalidate();
+    const auto* resolutions = static_cast<const uint32_t*>(readbackBuffer.getMappedData());
+    for (size_t i = 0; i < m_textureFeedbackWindow.size(); ++i)
+        m_textureFeedbackWindow[i] = std::max(m_textureFeedbackWindow[i], resolutions[i]);
+
+    if (++m_textureFeedbackFrames < Config::TEXTURE_FEEDBACK_FRAMES)
+        return;
+
+
+    // The finest resolutions of the window go to the streaming thread, replacing a window it didn't take yet
+    m_textureFeedbackFrames = 0;
+    {
+        const std::lock_guard<std::mutex> lock(m_streamingMutex);
+        m_textureFeedback = std::exchange(m_textureFeedbackWindow, std::vector<uint32_t>(m_textureEntries.size(), 0));
+    }
+    m_streamingCondition.notify_one();
+}
+
+void Viewer::run(const std::filesystem::path& filePath, const StreamingOptions& options) {
     std::chrono::high_resolution_clock::time_point loopStart = std::chrono::high_resolution_clock::now();
     std::chrono::high_resolution_clock::time_point loopEnd = std::chrono::high_resolution_clock::now();
     float deltaTime = 0;
     float accum = 0;
     uint32_t frameCount = 0;
+    std::vector<float> frameTimes;      // Streaming shows up in the slowest frames rather than in the average
+    uint64_t tracedTriangles = 0;       // Selected by the LODs, summed over the frames
 
     loadAssetsFromFile(filePath);
+    startStreaming(options);
 
     while (m_window->isOpen()) {
         loopStart = std::chrono::high_resolution_clock::now();
@@ -336,6 +495,8 @@ void Viewer::run(const std::filesystem::path& filePath) {
 
         VkCommandBuffer commandBuffer = m_swapchain.beginFrame();
         {   // Render
+            readTextureFeedback();
+            updateTopLevelAccelerationStructure(commandBuffer);
             bindDescriptors(commandBuffer);
             traceRays(commandBuffer);
             transferOutputImageToSwapchain(commandBuffer);
@@ -346,9 +507,20 @@ void Viewer::run(const std::filesystem::path& filePath) {
         deltaTime = std::chrono::duration<float>(loopEnd - loopStart).count();
         accum += deltaTime;
         frameCount++;
+        frameTimes.push_back(deltaTime);
+        tracedTriangles += m_selectedTriangleCount;
     }
 
+    stopStreaming();
+    std::cout << "Streamed " << m_reader->getBytesRead() / 1024 / 1024 << " MB of textures and meshes at " << static_cast<double>(m_reader->getBytesRead()) / m_reader->getReadSeconds() / 1e9 << " GB/s (" << m_reader->getBackendName() << ", " << m_reader->getBytesCopied() / 1024 / 1024 << " MB copied out of read buffers)" << std::endl;
+
     // avg frame time
     std::cout << "Average frame time: " << accum / static_cast<float>(frameCount) * 1000.0F << " ms" << std::endl;
     std::cout << "Average FPS: " << static_cast<float>(frameCount) / accum << std::endl;
+    std::cout << "Average traced triangles: " << tracedTriangles / std::max<uint64_t>(frameCount, 1) / 1000 << "K (mesh LODs " << (options.meshLods ? "on" : "off") << ")" << std::endl;
+    if (!frameTimes.empty()) {
+        const auto percentile = frameTimes.begin() + static_cast<std::ptrdiff_t>(frameTimes.size() * 99 / 100);
+        std::ranges::nth_element(frameTimes, percentile);
+        std::cout << "99th percentile frame time: " << *percentile * 1000.0F << " ms, worst: " << *std::ranges::max_element(frameTimes) * 1000.0F << " ms" << std::endl;
+    }
 }
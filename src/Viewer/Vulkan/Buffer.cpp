@@ -10,7 +10,7 @@
 #include <memory>
 #include <utility>
 
-Buffer::Buffer(const std::shared_ptr<Device>& device, size_t size, VkBufferUsageFlags bufferUsage, VmaAllocationCreateFlags allocationFlags, VkDeviceSize alignment) : m_device(device) {
+Buffer::Buffer(const std::shared_ptr<Device>& device, size_t size, VkBufferUsageFlags bufferUsage, VmaAllocationCreateFlags allocationFlags, VkDeviceSize alignment, VmaPool pool) : m_device(device) {
     // Buffer creation
     const VkBufferCreateInfo bufferCreateInfo = {
         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
@@ -22,9 +22,12 @@ Buffer::Buffer(const std::shared_ptr<Device>& device, size_t size, VkBufferUsage
     const VmaAllocationCreateInfo allocationInfo = {
         .flags = allocationFlags,
         .usage = VMA_MEMORY_USAGE_AUTO,
+        .pool = pool,
     };
 
-    VK_CHECK(vmaCreateBufferWithAlignment(m_device->getAllocator(), &bufferCreateInfo, &allocationInfo, alignment, &m_buffer, &m_allocation, nullptr));
+    VmaAllocationInfo allocationResultInfo{};
+    VK_CHECK(vmaCreateBufferWithAlignment(m_device->getAllocator(), &bufferCreateInfo, &allocationInfo, alignment, &m_buffer, &m_allocation, &allocationResultInfo));
+    m_mappedData = allocationResultInfo.pMappedData;
 
 
     // Device address
@@ -42,10 +45,11 @@ Buffer::~Buffer() {
     cleanup();
 }
 
-Buffer::Buffer(Buffer&& other) noexcept : m_device(std::move(other.m_device)), m_deviceAddress(other.m_deviceAddress), m_allocation(other.m_allocation), m_buffer(other.m_buffer) {
+Buffer::Buffer(Buffer&& other) noexcept : m_device(std::move(other.m_device)), m_deviceAddress(other.m_deviceAddress), m_allocation(other.m_allocation), m_buffer(other.m_buffer), m_mappedData(other.m_mappedData) {
     other.m_deviceAddress = 0;
     other.m_allocation = VK_NULL_HANDLE;
     other.m_buffer = VK_NULL_HANDLE;
+    other.m_mappedData = nullptr;
 }
 
 Buffer& Buffer::operator=(Buffer&& other) noexcept {
@@ -56,10 +60,12 @@ Buffer& Buffer::operator=(Buffer&& other) noexcept {
         m_deviceAddress = other.m_deviceAddress;
         m_allocation = other.m_allocation;
         m_buffer = other.m_buffer;
+        m_mappedData = other.m_mappedData;
 
         other.m_deviceAddress = 0;
         other.m_allocation = VK_NULL_HANDLE;
         other.m_buffer = VK_NULL_HANDLE;
+        other.m_mappedData = nullptr;
     }
 
     return *this;
@@ -78,12 +84,35 @@ void Buffer::unmap() const noexcept {
     vmaUnmapMemory(m_device->getAllocator(), m_allocation);
 }
 
-void Buffer::copyFrom(VkCommandBuffer commandBuffer, VkBuffer srcBuffer, VkDeviceSize size) const {
+void Buffer::flush(VkDeviceSize offset, VkDeviceSize size) const {
+    VK_CHECK(vmaFlushAllocation(m_device->getAllocator(), m_allocation, offset, size));
+}
+
+void Buffer::invalidate(VkDeviceSize offset, VkDeviceSize size) const {
+    VK_CHECK(vmaInvalidateAllocation(m_device->getAllocator(), m_allocation, offset, size));
+}
+
+void Buffer::copyFrom(VkCommandBuffer commandBuffer, VkBuffer srcBuffer, VkDeviceSize size, VkDeviceSize srcOffset, VkDeviceSize dstOffset) const {
     const VkBufferCopy bufferCopy = {
-        .srcOffset = 0,
-        .dstOffset = 0,
+        .srcOffset = srcOffset,
+        .dstOffset = dstOffset,
         .size = size
     };
 
     vkCmdCopyBuffer(commandBuffer, srcBuffer, m_buffer, 1, &bufferCopy);
 }
+
+void Buffer::cmdTransferOwnership(VkCommandBuffer commandBuffer, VkAccessFlags srcAccessMask, VkPipelineStageFlags srcStageMask, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask, uint32_t srcQueueFamilyIndex, uint32_t dstQueueFamilyIndex, VkDeviceSize offset, VkDeviceSize size) const {
+    const VkBufferMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .srcAccessMask = srcAccessMask,
+        .dstAccessMask = dstAccessMask,
+        .srcQueueFamilyIndex = srcQueueFamilyIndex,
+        .dstQueueFamilyIndex = dstQueueFamilyIndex,
+        .buffer = m_buffer,
+        .offset = offset,
+        .size = size
+    };
+
+    vkCmdPipelineBarrier(commandBuffer, srcStageMask, dstStageMask, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
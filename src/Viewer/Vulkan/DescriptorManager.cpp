@@ -11,6 +11,7 @@
 #include <array>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 
 DescriptorManager::DescriptorManager(const std::shared_ptr<Device>& device) : m_device(device) {
     createDescriptorSetLayout();
@@ -30,6 +31,7 @@ uint32_t DescriptorManager::storeImage(VkImageView imageView) {
 }
 
 void DescriptorManager::storeImage(VkImageView imageView, uint32_t index) {
+    const std::lock_guard<std::mutex> lock(m_mutex);
     const VkDescriptorImageInfo imageInfo{
         .imageView = imageView,
         .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
@@ -49,6 +51,13 @@ void DescriptorManager::storeImage(VkImageView imageView, uint32_t index) {
 }
 
 uint32_t DescriptorManager::storeSampledImage(VkImageView imageView, VkSampler sampler) {
+    storeSampledImage(imageView, sampler, m_combinedImageSamplerCount);
+    m_combinedImageSamplerCount++;
+    return m_combinedImageSamplerCount - 1;
+}
+
+void DescriptorManager::storeSampledImage(VkImageView imageView, VkSampler sampler, uint32_t index) {
+    const std::lock_guard<std::mutex> lock(m_mutex);
     const VkDescriptorImageInfo imageInfo{
         .sampler = sampler,
         .imageView = imageView,
@@ -59,19 +68,17 @@ uint32_t DescriptorManager::storeSampledImage(VkImageView imageView, VkSampler s
         .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
         .dstSet = m_descriptorSet,
         .dstBinding = COMBINED_IMAGE_SAMPLER_BINDING,
-        .dstArrayElement = m_combinedImageSamplerCount,
+        .dstArrayElement = index,
         .descriptorCount = 1,
         .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
         .pImageInfo = &imageInfo
     };
 
     vkUpdateDescriptorSets(m_device->getHandle(), 1, &write, 0, nullptr);
-
-    m_combinedImageSamplerCount++;
-    return m_combinedImageSamplerCount - 1;
 }
 
 void DescriptorManager::storeAccelerationStructure(VkAccelerationStructureKHR accelerationStructure) {
+    const std::lock_guard<std::mutex> lock(m_mutex);
     const VkWriteDescriptorSetAccelerationStructureKHR accelerationStructureInfo{
         .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR,
         .accelerationStructureCount = 1,
@@ -115,9 +122,9 @@ void DescriptorManager::createDescriptorSetLayout() {
     for (uint32_t i = 0; i < descriptorCount; ++i) {
         bindings[i].binding = i;
         bindings[i].descriptorType = types[i];
-        bindings[i].descriptorCount = types[i] == VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR ? 1 : 1000;
+        bindings[i].descriptorCount = types[i] == VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR ? 1 : ARRAY_DESCRIPTOR_COUNT;
         bindings[i].stageFlags = VK_SHADER_STAGE_ALL;
-        flags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT;
+        flags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
     }
 
     const VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {
@@ -9,12 +9,14 @@
 #include "volk.h"
 #include <vulkan/vulkan_core.h>
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
 #include <cstring>
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <vector>
 
@@ -40,6 +42,8 @@ Device::~Device() {
     if (m_device != VK_NULL_HANDLE)
         vkDeviceWaitIdle(m_device);
 
+    if (m_accelerationStructurePool != VK_NULL_HANDLE)
+        vmaDestroyPool(m_allocator, m_accelerationStructurePool);
     if (m_allocator != VK_NULL_HANDLE)
         vmaDestroyAllocator(m_allocator);
     if (m_descriptorPool != VK_NULL_HANDLE)
@@ -70,13 +74,19 @@ void Device::endSingleTimeCommands(QueueType queueType, VkCommandBuffer commandB
         .commandBufferCount = 1,
         .pCommandBuffers = &commandBuffer,
     };
-    VK_CHECK(vkQueueSubmit(m_queueDatas[queueType].queue, 1, &submitInfo, m_singleTimeCommandsFence));
+    {
+        const std::lock_guard<std::mutex> lock(m_queueMutex);
+        VK_CHECK(vkQueueSubmit(m_queueDatas[queueType].queue, 1, &submitInfo, m_singleTimeCommandsFence));
+    }
 
     VK_CHECK(vkWaitForFences(m_device, 1, &m_singleTimeCommandsFence, VK_TRUE, std::numeric_limits<uint64_t>::max()));
     VK_CHECK(vkResetFences(m_device, 1, &m_singleTimeCommandsFence));
+    m_singleTimeCommandsMutex.unlock();
 }
 
 VkCommandBuffer Device::beginSingleTimeCommands(QueueType queueType) const {
+    // Released by endSingleTimeCommands(), the command buffers and the fence are shared by every thread
+    m_singleTimeCommandsMutex.lock();
     VkCommandBuffer commandBuffer = m_queueDatas[queueType].singleTimeCommandBuffer;
 
     const VkCommandBufferBeginInfo beginInfo = {
@@ -161,6 +171,27 @@ void Device::createAllocator() {
     };
 
     VK_CHECK(vmaCreateAllocator(&allocatorInfo, &m_allocator));
+
+
+    // Acceleration structures, micromaps & their scratch memory are many small buffers: suballocated from blocks of their own, which are
+    // neither fragmented by textures nor counted against maxMemoryAllocationCount one by one. Without an explicit block size, VMA still
+    // gives a dedicated allocation to the buffers too large for its blocks
+    const VkBufferCreateInfo accelerationStructureBufferInfo = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = 65536,
+        .usage = VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_MICROMAP_STORAGE_BIT_EXT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+    const VmaAllocationCreateInfo accelerationStructureAllocationInfo = {
+        .usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+    };
+    uint32_t memoryTypeIndex = 0;
+    VK_CHECK(vmaFindMemoryTypeIndexForBufferInfo(m_allocator, &accelerationStructureBufferInfo, &accelerationStructureAllocationInfo, &memoryTypeIndex));
+
+    const VmaPoolCreateInfo poolInfo = {
+        .memoryTypeIndex = memoryTypeIndex,
+    };
+    VK_CHECK(vmaCreatePool(m_allocator, &poolInfo, &m_accelerationStructurePool));
 }
 
 void Device::createDescriptorPool() {
@@ -274,9 +305,11 @@ bool Device::checkForRequiredFeatures(VkPhysicalDevice device) {
         && static_cast<bool>(vulkan12Features.descriptorBindingPartiallyBound)
         && static_cast<bool>(vulkan12Features.descriptorBindingSampledImageUpdateAfterBind)
         && static_cast<bool>(vulkan12Features.descriptorBindingStorageImageUpdateAfterBind)
+        && static_cast<bool>(vulkan12Features.descriptorBindingUpdateUnusedWhilePending)
         && static_cast<bool>(vulkan12Features.shaderSampledImageArrayNonUniformIndexing)
         && static_cast<bool>(vulkan12Features.runtimeDescriptorArray)
         && static_cast<bool>(vulkan12Features.scalarBlockLayout)
+        && static_cast<bool>(vulkan12Features.timelineSemaphore)
         && static_cast<bool>(vulkan13Features.dynamicRendering)
         && static_cast<bool>(vulkan14Features.hostImageCopy)
         && static_cast<bool>(deviceFeatures2.features.samplerAnisotropy)
@@ -287,26 +320,27 @@ bool Device::checkForRequiredFeatures(VkPhysicalDevice device) {
 }
 
 bool Device::checkForRequiredExtensions(VkPhysicalDevice device) {
+    for (const char* requiredExtension : Config::REQUIRED_DEVICE_EXTENSIONS) {
+        if (!isExtensionAvailable(device, requiredExtension))
+            return false;
+    }
+
+    return true;
+}
+
+bool Device::isExtensionAvailable(VkPhysicalDevice device, const char* extensionName) {
     uint32_t extensionCount = 0;
     VK_CHECK(vkEnumerateDeviceExtensionProperties(device, VK_NULL_HANDLE, &extensionCount, VK_NULL_HANDLE));
 
     std::vector<VkExtensionProperties> availableExtensions(extensionCount);
     VK_CHECK(vkEnumerateDeviceExtensionProperties(device, VK_NULL_HANDLE, &extensionCount, availableExtensions.data()));
 
-    for (const char* requiredExtension : Config::REQUIRED_DEVICE_EXTENSIONS) {
-        bool found = false;
-        for (const VkExtensionProperties& extension : availableExtensions) {
-            if (strcmp(extension.extensionName, requiredExtension) == 0) {
-                found = true;
-                break;
-            }
-        }
-
-        if (!found)
-            return false;
+    for (const VkExtensionProperties& extension : availableExtensions) {
+        if (strcmp(extension.extensionName, extensionName) == 0)
+            return true;
     }
 
-    return true;
+    return false;
 }
 
 bool Device::findQueueFamilies(VkPhysicalDevice device, QueueFamilyIndices& indices) {
@@ -409,7 +443,27 @@ void Device::createDevice() {
     vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &m_memoryProperties);
 
 
-    // Required features
+    // Layouts an image can be in while the host copies to it, and alignment of the host memory imported as buffers
+    // Host memory import is optional, without it every upload goes through staging memory
+    const bool externalMemoryHost = isExtensionAvailable(m_physicalDevice, VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
+    VkPhysicalDeviceExternalMemoryHostPropertiesEXT externalMemoryHostProperties{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT };
+    VkPhysicalDeviceHostImageCopyProperties hostImageCopyProperties{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_PROPERTIES,
+        .pNext = externalMemoryHost ? &externalMemoryHostProperties : nullptr,
+    };
+    VkPhysicalDeviceProperties2 properties2{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2, .pNext = &hostImageCopyProperties };
+    vkGetPhysicalDeviceProperties2(m_physicalDevice, &properties2);
+
+    m_hostImageCopyDstLayouts.resize(hostImageCopyProperties.copyDstLayoutCount);
+    hostImageCopyProperties.pCopyDstLayouts = m_hostImageCopyDstLayouts.data();
+    vkGetPhysicalDeviceProperties2(m_physicalDevice, &properties2);
+    m_minImportedHostPointerAlignment = externalMemoryHost ? externalMemoryHostProperties.minImportedHostPointerAlignment : 0;
+
+
+    // Required features, BC texture compression is optional: passed through textures are checked against the format support on load
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(m_physicalDevice, &supportedFeatures);
+
     VkPhysicalDeviceOpacityMicromapFeaturesEXT opacityMicromapFeatures{
         .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_OPACITY_MICROMAP_FEATURES_EXT,
         .micromap = VK_TRUE,
@@ -434,9 +488,11 @@ void Device::createDevice() {
         .shaderSampledImageArrayNonUniformIndexing = VK_TRUE,
         .descriptorBindingSampledImageUpdateAfterBind = VK_TRUE,
         .descriptorBindingStorageImageUpdateAfterBind = VK_TRUE,
+        .descriptorBindingUpdateUnusedWhilePending = VK_TRUE,
         .descriptorBindingPartiallyBound = VK_TRUE,
         .runtimeDescriptorArray = VK_TRUE,
         .scalarBlockLayout = VK_TRUE,
+        .timelineSemaphore = VK_TRUE,
         .bufferDeviceAddress = VK_TRUE,
     };
 
@@ -456,7 +512,7 @@ void Device::createDevice() {
     VkPhysicalDeviceFeatures2 deviceFeatures2{
         .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
         .pNext = &vulkan14Features,
-        .features = { .samplerAnisotropy = VK_TRUE }
+        .features = { .samplerAnisotropy = VK_TRUE, .textureCompressionBC = supportedFeatures.textureCompressionBC }
     };
 
 
@@ -500,6 +556,10 @@ void Device::createDevice() {
 
 
     // Device creation
+    std::vector<const char*> extensions(Config::REQUIRED_DEVICE_EXTENSIONS.begin(), Config::REQUIRED_DEVICE_EXTENSIONS.end());
+    if (externalMemoryHost)
+        extensions.push_back(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
+
     const VkDeviceCreateInfo deviceCreateInfo = {
         .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
         .pNext = &deviceFeatures2,
@@ -507,8 +567,8 @@ void Device::createDevice() {
         .pQueueCreateInfos = queueCreateInfos.data(),
         .enabledLayerCount = static_cast<uint32_t>(Config::REQUIRED_VALIDATION_LAYERS.size()),
         .ppEnabledLayerNames = Config::REQUIRED_VALIDATION_LAYERS.empty() ? nullptr : Config::REQUIRED_VALIDATION_LAYERS.data(),
-        .enabledExtensionCount = static_cast<uint32_t>(Config::REQUIRED_DEVICE_EXTENSIONS.size()),
-        .ppEnabledExtensionNames = Config::REQUIRED_DEVICE_EXTENSIONS.data(),
+        .enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
+        .ppEnabledExtensionNames = extensions.data(),
     };
 
     VK_CHECK(vkCreateDevice(m_physicalDevice, &deviceCreateInfo, VK_NULL_HANDLE, &m_device));
@@ -570,6 +630,7 @@ void Device::createInstance() {
 }
 
 void Device::waitIdle() const {
+    const std::lock_guard<std::mutex> lock(m_queueMutex);
     VK_CHECK(vkDeviceWaitIdle(m_device));
 }
 
@@ -580,3 +641,12 @@ uint32_t Device::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags prope
 
     throw std::runtime_error("Failed to find suitable memory type.");
 }
+
+bool Device::supportsHostImageCopy(VkFormat format, VkImageLayout dstLayout) const {
+    VkFormatProperties3 formatProperties3{ .sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_3 };
+    VkFormatProperties2 formatProperties2{ .sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2, .pNext = &formatProperties3 };
+    vkGetPhysicalDeviceFormatProperties2(m_physicalDevice, format, &formatProperties2);
+
+    return (formatProperties3.optimalTilingFeatures & VK_FORMAT_FEATURE_2_HOST_IMAGE_TRANSFER_BIT) != 0
+        && std::ranges::find(m_hostImageCopyDstLayouts, dstLayout) != m_hostImageCopyDstLayouts.end();
+}
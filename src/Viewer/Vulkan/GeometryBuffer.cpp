@@ -0,0 +1,78 @@
+#include "Viewer/Vulkan/GeometryBuffer.hpp"
+
+#include "Viewer/Vulkan/Buffer.hpp"
+#include "Viewer/Vulkan/Device.hpp"
+#include "Viewer/Vulkan/Utils.hpp"
+
+#include "vk_mem_alloc.h"
+#include <vulkan/vulkan_core.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+GeometryBuffer::GeometryBuffer(const std::shared_ptr<Device>& device, VkDeviceSize blockSize) : m_device(device), m_blockSize(blockSize) {}
+
+GeometryBuffer::~GeometryBuffer() {
+    for (const Block& block : m_blocks) {
+        vmaClearVirtualBlock(block.virtualBlock);
+        vmaDestroyVirtualBlock(block.virtualBlock);
+    }
+}
+
+GeometryBuffer::Allocation GeometryBuffer::allocate(VkDeviceSize size) {
+    const VmaVirtualAllocationCreateInfo allocationCreateInfo = {
+        .size = size,
+        .alignment = ALLOCATION_ALIGNMENT,
+    };
+
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    VmaVirtualAllocation virtualAllocation = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    for (const Block& block : m_blocks) {
+        if (vmaVirtualAllocate(block.virtualBlock, &allocationCreateInfo, &virtualAllocation, &offset) == VK_SUCCESS)
+            return Allocation{ .buffer = block.buffer.get(), .offset = offset, .deviceAddress = block.buffer->getDeviceAddress() + offset, .virtualAllocation = virtualAllocation };
+    }
+
+
+    // No room left in the current buffers, the new one can hold at least this allocation
+    const VkDeviceSize blockSize = std::max(m_blockSize, size);
+    Block block{
+        .buffer = std::make_unique<Buffer>(m_device, blockSize, VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT),
+        .virtualBlock = VK_NULL_HANDLE,
+    };
+    const VmaVirtualBlockCreateInfo virtualBlockCreateInfo = {
+        .size = blockSize,
+    };
+    VK_CHECK(vmaCreateVirtualBlock(&virtualBlockCreateInfo, &block.virtualBlock));
+
+    if (vmaVirtualAllocate(block.virtualBlock, &allocationCreateInfo, &virtualAllocation, &offset) != VK_SUCCESS) {
+        vmaDestroyVirtualBlock(block.virtualBlock);
+        throw std::runtime_error("Error: Failed to allocate " + std::to_string(size) + " bytes of geometry");
+    }
+    m_blocks.push_back(std::move(block));
+    return Allocation{ .buffer = m_blocks.back().buffer.get(), .offset = offset, .deviceAddress = m_blocks.back().buffer->getDeviceAddress() + offset, .virtualAllocation = virtualAllocation };
+}
+
+void GeometryBuffer::free(const Allocation& allocation) {
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    const auto block = std::ranges::find_if(m_blocks, [&](const Block& block) { return block.buffer.get() == allocation.buffer; });
+    if (block == m_blocks.end())
+        return;
+
+    vmaVirtualFree(block->virtualBlock, allocation.virtualAllocation);
+    if (m_blocks.size() > 1 && vmaIsVirtualBlockEmpty(block->virtualBlock) == VK_TRUE) {
+        vmaDestroyVirtualBlock(block->virtualBlock);
+        m_blocks.erase(block);
+    }
+}
+
+size_t GeometryBuffer::getBufferCount() const {
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    return m_blocks.size();
+}
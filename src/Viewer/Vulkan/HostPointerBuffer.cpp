@@ -0,0 +1,81 @@
+#include "Viewer/Vulkan/HostPointerBuffer.hpp"
+
+#include "Viewer/Vulkan/Device.hpp"
+#include "Viewer/Vulkan/Utils.hpp"
+
+#include <vulkan/vulkan_core.h>
+
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+HostPointerBuffer::HostPointerBuffer(const std::shared_ptr<Device>& device, std::shared_ptr<const void> memoryOwner) : m_device(device), m_memoryOwner(std::move(memoryOwner)) {}
+
+HostPointerBuffer::~HostPointerBuffer() {
+    if (m_buffer != VK_NULL_HANDLE)
+        vkDestroyBuffer(m_device->getHandle(), m_buffer, nullptr);
+    if (m_memory != VK_NULL_HANDLE)
+        vkFreeMemory(m_device->getHandle(), m_memory, nullptr);
+}
+
+std::unique_ptr<HostPointerBuffer> HostPointerBuffer::tryImport(const std::shared_ptr<Device>& device, std::shared_ptr<const void> memoryOwner, const void* pointer, VkDeviceSize size) {
+    const VkDeviceSize alignment = device->getMinImportedHostPointerAlignment();
+    if (alignment == 0 || size == 0 || reinterpret_cast<uintptr_t>(pointer) % alignment != 0 || size % alignment != 0)
+        return nullptr;
+
+    // The specification lets drivers refuse any pointer, file mappings in particular, that isn't an error
+    constexpr VkExternalMemoryHandleTypeFlagBits handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+    VkMemoryHostPointerPropertiesEXT pointerProperties{ .sType = VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT };
+    if (vkGetMemoryHostPointerPropertiesEXT(device->getHandle(), handleType, pointer, &pointerProperties) != VK_SUCCESS)
+        return nullptr;
+
+    std::unique_ptr<HostPointerBuffer> buffer(new HostPointerBuffer(device, std::move(memoryOwner)));
+
+
+    // Buffer creation
+    const VkExternalMemoryBufferCreateInfo externalMemoryCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO,
+        .handleTypes = handleType,
+    };
+
+    const VkBufferCreateInfo bufferCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .pNext = &externalMemoryCreateInfo,
+        .size = size,
+        .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE
+    };
+
+    VK_CHECK(vkCreateBuffer(device->getHandle(), &bufferCreateInfo, nullptr, &buffer->m_buffer));
+
+
+    // Memory import, in the first memory type allowed both for the buffer and for the pointer
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(device->getHandle(), buffer->m_buffer, &memoryRequirements);
+
+    const uint32_t memoryTypeBits = memoryRequirements.memoryTypeBits & pointerProperties.memoryTypeBits;
+    if (memoryTypeBits == 0)
+        return nullptr;
+
+    const VkImportMemoryHostPointerInfoEXT importInfo = {
+        .sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT,
+        .handleType = handleType,
+        .pHostPointer = const_cast<void*>(pointer),     // Only read, through a transfer source buffer
+    };
+
+    const VkMemoryAllocateInfo allocateInfo = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .pNext = &importInfo,
+        .allocationSize = size,
+        .memoryTypeIndex = static_cast<uint32_t>(std::countr_zero(memoryTypeBits)),
+    };
+
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    if (vkAllocateMemory(device->getHandle(), &allocateInfo, nullptr, &memory) != VK_SUCCESS)
+        return nullptr;
+
+    buffer->m_memory = memory;
+    VK_CHECK(vkBindBufferMemory(device->getHandle(), buffer->m_buffer, buffer->m_memory, 0));
+    return buffer;
+}
@@ -129,14 +129,22 @@ void Image::createImageView() {
 }
 
 void Image::cmdTransitionLayout(VkCommandBuffer commandBuffer, const Layout& oldLayout, const Layout& newLayout, uint32_t baseMipLevel, uint32_t levelCount) {
+    cmdBarrier(commandBuffer, oldLayout, newLayout, baseMipLevel, levelCount, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED);
+}
+
+void Image::cmdTransferOwnership(VkCommandBuffer commandBuffer, const Layout& oldLayout, const Layout& newLayout, uint32_t srcQueueFamilyIndex, uint32_t dstQueueFamilyIndex) {
+    cmdBarrier(commandBuffer, oldLayout, newLayout, 0, VK_REMAINING_MIP_LEVELS, srcQueueFamilyIndex, dstQueueFamilyIndex);
+}
+
+void Image::cmdBarrier(VkCommandBuffer commandBuffer, const Layout& oldLayout, const Layout& newLayout, uint32_t baseMipLevel, uint32_t levelCount, uint32_t srcQueueFamilyIndex, uint32_t dstQueueFamilyIndex) {
     const VkImageMemoryBarrier barrier{
         .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
         .srcAccessMask = oldLayout.accessMask,
         .dstAccessMask = newLayout.accessMask,
         .oldLayout = oldLayout.layout,
         .newLayout = newLayout.layout,
-        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .srcQueueFamilyIndex = srcQueueFamilyIndex,
+        .dstQueueFamilyIndex = dstQueueFamilyIndex,
         .image = m_image,
         .subresourceRange = {
             .aspectMask = m_createInfo.aspectFlags,
@@ -215,9 +223,9 @@ void Image::cmdGenerateMipmaps(VkCommandBuffer commandBuffer, const Layout& fina
     cmdTransitionLayout(commandBuffer, dstLayout, finalLayout, m_createInfo.mipLevels - 1, 1);
 }
 
-void Image::cmdCopyFromBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer, const VkExtent3D& extent, uint32_t mipLevel) {
+void Image::cmdCopyFromBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer, const VkExtent3D& extent, uint32_t mipLevel, VkDeviceSize bufferOffset) {
     const VkBufferImageCopy region{
-        .bufferOffset = 0,
+        .bufferOffset = bufferOffset,
         .bufferRowLength = 0,
         .bufferImageHeight = 0,
         .imageSubresource = {
@@ -233,6 +241,51 @@ void Image::cmdCopyFromBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer, co
     vkCmdCopyBufferToImage(commandBuffer, buffer, m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
 }
 
+void Image::transitionLayoutOnHost(VkImageLayout oldLayout, VkImageLayout newLayout) {
+    const VkHostImageLayoutTransitionInfo transitionInfo{
+        .sType = VK_STRUCTURE_TYPE_HOST_IMAGE_LAYOUT_TRANSITION_INFO,
+        .image = m_image,
+        .oldLayout = oldLayout,
+        .newLayout = newLayout,
+        .subresourceRange = {
+            .aspectMask = m_createInfo.aspectFlags,
+            .baseMipLevel = 0,
+            .levelCount = VK_REMAINING_MIP_LEVELS,
+            .baseArrayLayer = 0,
+            .layerCount = m_createInfo.arrayLayers
+        }
+    };
+
+    VK_CHECK(vkTransitionImageLayout(m_device->getHandle(), 1, &transitionInfo));
+}
+
+void Image::copyFromMemory(const void* data, const VkExtent3D& extent, uint32_t mipLevel, VkImageLayout layout) {
+    const VkMemoryToImageCopy region{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_TO_IMAGE_COPY,
+        .pHostPointer = data,
+        .memoryRowLength = 0,
+        .memoryImageHeight = 0,
+        .imageSubresource = {
+            .aspectMask = m_createInfo.aspectFlags,
+            .mipLevel = mipLevel,
+            .baseArrayLayer = 0,
+            .layerCount = m_createInfo.arrayLayers
+        },
+        .imageOffset = {0, 0, 0},
+        .imageExtent = extent
+    };
+
+    const VkCopyMemoryToImageInfo copyInfo{
+        .sType = VK_STRUCTURE_TYPE_COPY_MEMORY_TO_IMAGE_INFO,
+        .dstImage = m_image,
+        .dstImageLayout = layout,
+        .regionCount = 1,
+        .pRegions = &region
+    };
+
+    VK_CHECK(vkCopyMemoryToImage(m_device->getHandle(), &copyInfo));
+}
+
 void Image::cmdCopyFromImage(VkCommandBuffer commandBuffer, const Image& srcImage) {
     const VkImageCopy copyRegion {
         .srcSubresource = {
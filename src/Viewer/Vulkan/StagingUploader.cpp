@@ -0,0 +1,407 @@
+#include "Viewer/Vulkan/StagingUploader.hpp"
+
+#include "Viewer/Vulkan/Buffer.hpp"
+#include "Viewer/Vulkan/Device.hpp"
+#include "Viewer/Vulkan/Image.hpp"
+#include "Viewer/Vulkan/Utils.hpp"
+
+#include "vk_mem_alloc.h"
+#include <vulkan/vulkan_core.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+StagingUploader::StagingUploader(const std::shared_ptr<Device>& device, VkDeviceSize ringSize) :
+    m_device(device),
+    m_ownershipTransfer(device->getQueueFamilyIndex(Device::Transfer) != device->getQueueFamilyIndex(Device::Graphics)),
+    m_ringSize(ringSize),
+    m_slots(std::make_unique<Slot[]>(QUEUE_CAPACITY))
+{
+    for (size_t i = 0; i < QUEUE_CAPACITY; ++i)
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+
+
+    // Staging memory is read back by the CPU (checksums, LZ4 matches, mesh decoding), so it has to be cached
+    m_ringBuffer = std::make_unique<Buffer>(m_device, ringSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT);
+
+
+    // Timeline semaphores, their value is the ticket of the last request complete on the queue signaling them
+    const VkSemaphoreTypeCreateInfo semaphoreTypeCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        .initialValue = 0,
+    };
+    const VkSemaphoreCreateInfo semaphoreCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &semaphoreTypeCreateInfo,
+    };
+    VK_CHECK(vkCreateSemaphore(m_device->getHandle(), &semaphoreCreateInfo, nullptr, &m_timelineSemaphore));
+    if (m_ownershipTransfer)
+        VK_CHECK(vkCreateSemaphore(m_device->getHandle(), &semaphoreCreateInfo, nullptr, &m_transferSemaphore));
+
+
+    // Command pools of the submitter thread, the only one recording into them
+    VkCommandPoolCreateInfo commandPoolCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+        .queueFamilyIndex = m_device->getQueueFamilyIndex(Device::Transfer),
+    };
+    VK_CHECK(vkCreateCommandPool(m_device->getHandle(), &commandPoolCreateInfo, nullptr, &m_transferCommandPool));
+
+    if (m_ownershipTransfer) {
+        commandPoolCreateInfo.queueFamilyIndex = m_device->getQueueFamilyIndex(Device::Graphics);
+        VK_CHECK(vkCreateCommandPool(m_device->getHandle(), &commandPoolCreateInfo, nullptr, &m_acquireCommandPool));
+    }
+
+    m_submitterThread = std::thread(&StagingUploader::submitLoop, this);
+}
+
+StagingUploader::~StagingUploader() {
+    // The submitter only stops once every published request is submitted
+    m_stop = true;
+    m_wakeups.fetch_add(1, std::memory_order_release);
+    m_wakeups.notify_one();
+    if (m_submitterThread.joinable())
+        m_submitterThread.join();
+
+    if (!m_batches.empty()) {
+        const VkSemaphoreWaitInfo waitInfo{
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+            .semaphoreCount = 1,
+            .pSemaphores = &m_timelineSemaphore,
+            .pValues = &m_batches.back().lastTicket,
+        };
+        vkWaitSemaphores(m_device->getHandle(), &waitInfo, std::numeric_limits<uint64_t>::max());
+    }
+
+    if (m_transferCommandPool != VK_NULL_HANDLE)
+        vkDestroyCommandPool(m_device->getHandle(), m_transferCommandPool, nullptr);
+    if (m_acquireCommandPool != VK_NULL_HANDLE)
+        vkDestroyCommandPool(m_device->getHandle(), m_acquireCommandPool, nullptr);
+    if (m_transferSemaphore != VK_NULL_HANDLE)
+        vkDestroySemaphore(m_device->getHandle(), m_transferSemaphore, nullptr);
+    if (m_timelineSemaphore != VK_NULL_HANDLE)
+        vkDestroySemaphore(m_device->getHandle(), m_timelineSemaphore, nullptr);
+}
+
+StagingUploader::Allocation StagingUploader::allocate(VkDeviceSize size) {
+    size = std::max(ALLOCATION_ALIGNMENT, (size + ALLOCATION_ALIGNMENT - 1) & ~(ALLOCATION_ALIGNMENT - 1));
+    if (size > m_ringSize / 2) {
+        auto buffer = std::make_shared<Buffer>(m_device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT);
+        return Allocation{
+            .data = static_cast<std::byte*>(buffer->getMappedData()),
+            .buffer = buffer->getHandle(),
+            .offset = 0,
+            .size = size,
+            .ringEnd = 0,
+            .dedicatedBuffer = std::move(buffer),
+        };
+    }
+
+    std::unique_lock lock(m_ringMutex);
+    while (true) {
+        reclaimRing();
+
+        // Allocations never wrap around the end of the buffer, the space left there is skipped
+        const uint64_t headOffset = m_ringHead % m_ringSize;
+        const uint64_t begin = headOffset + size > m_ringSize ? m_ringHead + (m_ringSize - headOffset) : m_ringHead;
+        if (begin + size - m_ringTail <= m_ringSize) {
+            m_ringHead = begin + size;
+            m_ringEntries.push_back(RingEntry{ .end = m_ringHead, .ticket = 0, .released = false });
+
+            return Allocation{
+                .data = static_cast<std::byte*>(m_ringBuffer->getMappedData()) + (begin % m_ringSize),
+                .buffer = m_ringBuffer->getHandle(),
+                .offset = begin % m_ringSize,
+                .size = size,
+                .ringEnd = m_ringHead,
+                .dedicatedBuffer = nullptr,
+            };
+        }
+
+
+        // The oldest allocation is in the way: waited for on the GPU once released, or until its owner releases it
+        if (m_ringEntries.front().released) {
+            const uint64_t ticket = m_ringEntries.front().ticket;
+            lock.unlock();
+            wait(ticket);
+            lock.lock();
+        } else {
+            m_ringCondition.wait(lock);
+        }
+    }
+}
+
+void StagingUploader::release(Allocation&& allocation, uint64_t ticket) {
+    {
+        const std::lock_guard<std::mutex> lock(m_ringMutex);
+        if (allocation.dedicatedBuffer != nullptr) {
+            m_retainedResources.emplace_back(ticket, std::move(allocation.dedicatedBuffer));
+        } else {
+            const auto entry = std::ranges::lower_bound(m_ringEntries, allocation.ringEnd, {}, &RingEntry::end);
+            entry->ticket = ticket;
+            entry->released = true;
+        }
+        reclaimRing();
+    }
+    m_ringCondition.notify_all();
+}
+
+void StagingUploader::retain(std::shared_ptr<const void> resource, uint64_t ticket) {
+    const std::lock_guard<std::mutex> lock(m_ringMutex);
+    m_retainedResources.emplace_back(ticket, std::move(resource));
+    reclaimRing();
+}
+
+void StagingUploader::reclaimRing() {
+    if (m_ringEntries.empty() && m_retainedResources.empty())
+        return;
+
+    // Allocations are reused in ring order, an allocation released early waits for the older ones
+    const uint64_t completedTicket = getCompletedTicket();
+    while (!m_ringEntries.empty() && m_ringEntries.front().released && m_ringEntries.front().ticket <= completedTicket) {
+        m_ringTail = m_ringEntries.front().end;
+        m_ringEntries.pop_front();
+    }
+
+    std::erase_if(m_retainedResources, [&](const auto& retainedResource) { return retainedResource.first <= completedTicket; });
+}
+
+uint64_t StagingUploader::enqueue(std::function<void(const Commands&)>&& record) {
+    // A slot is claimed by moving the position past it once the submitter recorded its previous request, a full queue waits for the submitter
+    uint64_t position = m_enqueuePosition.load(std::memory_order_relaxed);
+    Slot* slot = nullptr;
+    while (true) {
+        slot = &m_slots[position & (QUEUE_CAPACITY - 1)];
+        const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        if (sequence == position) {
+            if (m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        } else {
+            if (sequence < position)
+                std::this_thread::yield();
+            position = m_enqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+
+
+    // Published once filled, the submitter records the requests in position order
+    slot->record = std::move(record);
+    slot->sequence.store(position + 1, std::memory_order_release);
+    m_wakeups.fetch_add(1, std::memory_order_release);
+    m_wakeups.notify_one();
+
+    return position + 1;
+}
+
+void StagingUploader::cmdHandOver(const Commands& commands, Image& image, const Image::Layout& newLayout) {
+    const Image::Layout transferLayout{
+        .layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .accessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .stageFlags = VK_PIPELINE_STAGE_TRANSFER_BIT,
+    };
+    if (commands.acquire == VK_NULL_HANDLE) {
+        image.cmdTransitionLayout(commands.transfer, transferLayout, newLayout);
+        return;
+    }
+
+    // The layout transition is part of the transfer, it is specified identically on both queues
+    image.cmdTransferOwnership(commands.transfer, transferLayout, { .layout = newLayout.layout, .accessMask = 0, .stageFlags = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT }, commands.srcQueueFamilyIndex, commands.dstQueueFamilyIndex);
+    image.cmdTransferOwnership(commands.acquire, { .layout = transferLayout.layout, .accessMask = 0, .stageFlags = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT }, newLayout, commands.srcQueueFamilyIndex, commands.dstQueueFamilyIndex);
+}
+
+void StagingUploader::cmdHandOver(const Commands& commands, const Buffer& buffer, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask, VkDeviceSize offset, VkDeviceSize size) {
+    if (commands.acquire == VK_NULL_HANDLE) {
+        buffer.cmdTransferOwnership(commands.transfer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, dstAccessMask, dstStageMask, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, offset, size);
+        return;
+    }
+
+    // Only the range changes hands, the rest of the buffer may be in use by the graphics queue meanwhile
+    buffer.cmdTransferOwnership(commands.transfer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, commands.srcQueueFamilyIndex, commands.dstQueueFamilyIndex, offset, size);
+    buffer.cmdTransferOwnership(commands.acquire, 0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstAccessMask, dstStageMask, commands.srcQueueFamilyIndex, commands.dstQueueFamilyIndex, offset, size);
+}
+
+void StagingUploader::wait(uint64_t ticket) const {
+    // Woken up regularly to notice a failed submitter, which would never signal the ticket
+    constexpr uint64_t WAIT_TIMEOUT_NANOSECONDS = 100'000'000;
+    const VkSemaphoreWaitInfo waitInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .semaphoreCount = 1,
+        .pSemaphores = &m_timelineSemaphore,
+        .pValues = &ticket,
+    };
+
+    while (true) {
+        const VkResult result = vkWaitSemaphores(m_device->getHandle(), &waitInfo, WAIT_TIMEOUT_NANOSECONDS);
+        if (result != VK_TIMEOUT) {
+            VK_CHECK(result);
+            return;
+        }
+        rethrowSubmitterException();
+    }
+}
+
+void StagingUploader::submitLoop() {
+    try {
+        while (true) {
+            // Read before looking for requests, so that a request published in between doesn't let the thread sleep
+            const uint32_t wakeups = m_wakeups.load(std::memory_order_acquire);
+            retireBatches(false);
+
+            const Slot& slot = m_slots[m_dequeuePosition & (QUEUE_CAPACITY - 1)];
+            if (slot.sequence.load(std::memory_order_acquire) != m_dequeuePosition + 1) {
+                if (m_stop)
+                    return;
+                m_wakeups.wait(wakeups, std::memory_order_acquire);
+                continue;
+            }
+
+            // Requests pile up in the queue while the GPU is busy, so that the next batch is larger
+            if (m_batches.size() == MAX_BATCHES_IN_FLIGHT) {
+                retireBatches(true);
+                continue;
+            }
+            submitBatch();
+        }
+    } catch (...) {
+        const std::lock_guard<std::mutex> lock(m_exceptionMutex);
+        m_submitterException = std::current_exception();
+    }
+}
+
+void StagingUploader::submitBatch() {
+    // Command buffers are reused once their batch is complete
+    Batch batch{ .lastTicket = 0, .commands = {}, .records = {} };
+    if (m_freeCommands.empty()) {
+        batch.commands = Commands{
+            .transfer = VK_NULL_HANDLE,
+            .acquire = VK_NULL_HANDLE,
+            .srcQueueFamilyIndex = m_ownershipTransfer ? m_device->getQueueFamilyIndex(Device::Transfer) : VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = m_ownershipTransfer ? m_device->getQueueFamilyIndex(Device::Graphics) : VK_QUEUE_FAMILY_IGNORED,
+        };
+
+        VkCommandBufferAllocateInfo allocateInfo{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = m_transferCommandPool,
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1,
+        };
+        VK_CHECK(vkAllocateCommandBuffers(m_device->getHandle(), &allocateInfo, &batch.commands.transfer));
+
+        if (m_ownershipTransfer) {
+            allocateInfo.commandPool = m_acquireCommandPool;
+            VK_CHECK(vkAllocateCommandBuffers(m_device->getHandle(), &allocateInfo, &batch.commands.acquire));
+        }
+    } else {
+        batch.commands = m_freeCommands.back();
+        m_freeCommands.pop_back();
+    }
+
+    const VkCommandBufferBeginInfo beginInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+    };
+    VK_CHECK(vkBeginCommandBuffer(batch.commands.transfer, &beginInfo));
+    if (m_ownershipTransfer)
+        VK_CHECK(vkBeginCommandBuffer(batch.commands.acquire, &beginInfo));
+
+
+    // Every request published so far, each slot is handed back to the producers once recorded
+    while (true) {
+        Slot& slot = m_slots[m_dequeuePosition & (QUEUE_CAPACITY - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != m_dequeuePosition + 1)
+            break;
+
+        slot.record(batch.commands);
+        batch.records.push_back(std::move(slot.record));
+        slot.record = nullptr;
+        slot.sequence.store(m_dequeuePosition + QUEUE_CAPACITY, std::memory_order_release);
+        m_dequeuePosition++;
+    }
+    batch.lastTicket = m_dequeuePosition;
+
+
+    VK_CHECK(vkEndCommandBuffer(batch.commands.transfer));
+    if (m_ownershipTransfer)
+        VK_CHECK(vkEndCommandBuffer(batch.commands.acquire));
+
+
+    // Submissions, signaling the ticket of the last request of the batch. Without ownership transfer the transfer queue is the
+    // graphics one and the barriers of the records cover the later submissions, e.g. acceleration structure builds reading uploaded vertices
+    const VkTimelineSemaphoreSubmitInfo transferTimelineSubmitInfo{
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .signalSemaphoreValueCount = 1,
+        .pSignalSemaphoreValues = &batch.lastTicket,
+    };
+    const VkSubmitInfo transferSubmitInfo{
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = &transferTimelineSubmitInfo,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &batch.commands.transfer,
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores = m_ownershipTransfer ? &m_transferSemaphore : &m_timelineSemaphore,
+    };
+
+    const VkTimelineSemaphoreSubmitInfo acquireTimelineSubmitInfo{
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .waitSemaphoreValueCount = 1,
+        .pWaitSemaphoreValues = &batch.lastTicket,
+        .signalSemaphoreValueCount = 1,
+        .pSignalSemaphoreValues = &batch.lastTicket,
+    };
+    constexpr VkPipelineStageFlags acquireWaitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    const VkSubmitInfo acquireSubmitInfo{
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = &acquireTimelineSubmitInfo,
+        .waitSemaphoreCount = 1,
+        .pWaitSemaphores = &m_transferSemaphore,
+        .pWaitDstStageMask = &acquireWaitStage,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &batch.commands.acquire,
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores = &m_timelineSemaphore,
+    };
+    {
+        const std::lock_guard<std::mutex> lock(m_device->getQueueMutex());
+        VK_CHECK(vkQueueSubmit(m_device->getQueue(Device::Transfer), 1, &transferSubmitInfo, VK_NULL_HANDLE));
+        if (m_ownershipTransfer)
+            VK_CHECK(vkQueueSubmit(m_device->getQueue(Device::Graphics), 1, &acquireSubmitInfo, VK_NULL_HANDLE));
+    }
+
+    m_batches.push_back(std::move(batch));
+}
+
+void StagingUploader::retireBatches(bool waitForOldest) {
+    if (m_batches.empty())
+        return;
+    if (waitForOldest)
+        wait(m_batches.front().lastTicket);
+
+    // Their records are destroyed with what they captured
+    const uint64_t completedTicket = getCompletedTicket();
+    while (!m_batches.empty() && m_batches.front().lastTicket <= completedTicket) {
+        m_freeCommands.push_back(m_batches.front().commands);
+        m_batches.pop_front();
+    }
+}
+
+uint64_t StagingUploader::getCompletedTicket() const {
+    uint64_t completedTicket = 0;
+    VK_CHECK(vkGetSemaphoreCounterValue(m_device->getHandle(), m_timelineSemaphore, &completedTicket));
+    return completedTicket;
+}
+
+void StagingUploader::rethrowSubmitterException() const {
+    const std::lock_guard<std::mutex> lock(m_exceptionMutex);
+    if (m_submitterException)
+        std::rethrow_exception(m_submitterException);
+}
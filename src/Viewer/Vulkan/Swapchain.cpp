@@ -12,6 +12,7 @@
 #include <cstdint>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 Swapchain::Swapchain(const std::shared_ptr<Device>& device, const glm::ivec2& size) : m_device(device) {
@@ -199,6 +200,7 @@ void Swapchain::endFrame(VkCommandBuffer commandBuffer, VkPipelineStageFlags wai
     };
 
     VK_CHECK(vkEndCommandBuffer(commandBuffer));
+    const std::lock_guard<std::mutex> lock(m_device->getQueueMutex());
     VK_CHECK(vkQueueSubmit(m_device->getQueue(Device::Graphics), 1, &submitInfo, m_inFlightFences[m_currentFrameIndex]));
 
 
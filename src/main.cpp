@@ -1,11 +1,21 @@
 #include "Viewer/Viewer.hpp"
+#include "Common/KelpFile.hpp"
+#include "Common/ThreadPool.hpp"
+#include "Converter/BatchConverter.hpp"
 #include "Converter/Converter.hpp"
 
+#include "glm/ext/matrix_transform.hpp"
+#include "glm/trigonometric.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
 #include <exception>
 #include <functional>
 #include <iostream>
 #include <map>
+#include <stdexcept>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -13,8 +23,11 @@
 using CommandHandler = std::function<int(const std::vector<std::string_view>&)>;
 constexpr std::string_view usageMessage = R"(Usage:
   KelpEngine --help
-  KelpEngine --view <path to .kelp file>
-  KelpEngine --convert <path to .gltf/.glb file> <output .kelp path>
+  KelpEngine --view <path to .kelp file> [--memory-budget <MB>] [--prefetch-radius <distance>] [--no-lods]
+  KelpEngine --verify <path to .kelp file>
+  KelpEngine --convert <path to .gltf/.glb/.obj/.ply file> <output .kelp path> [--compress] [--encode-meshes] [--cell-size <size>]
+  KelpEngine --convert-bundle <output .kelp path> <path to .gltf/.glb/.obj/.ply file>[@x,y,z[,scale[,yaw degrees]]]... [--compress] [--encode-meshes] [--cell-size <size>]
+  KelpEngine --convert-batch <input directory or list file> <output directory> [--compress] [--encode-meshes] [--cell-size <size>] [--memory-budget <MB>] [--force]
 )";
 
 namespace {
@@ -23,15 +36,40 @@ namespace {
         return EXIT_SUCCESS;
     }
 
+    float parseOptionValue(const std::vector<std::string_view>& args, size_t& i) {
+        if (i + 1 >= args.size())
+            throw std::runtime_error("Missing value after " + std::string(args[i]));
+        i++;
+
+        const float value = std::stof(std::string(args[i]));
+        if (value <= 0)
+            throw std::runtime_error("Invalid value for " + std::string(args[i - 1]) + ": " + std::string(args[i]));
+        return value;
+    }
+
     int handleView(const std::vector<std::string_view>& args) {
-        if (args.size() != 3) {
-            std::cerr << "Error: --view requires exactly one argument: <path to .kelp file>" << std::endl << usageMessage << std::endl;
+        if (args.size() < 3) {
+            std::cerr << "Error: --view requires a <path to .kelp file>, optionally followed by --memory-budget, --prefetch-radius and --no-lods" << std::endl << usageMessage << std::endl;
             return EXIT_FAILURE;
         }
 
         try {
+            StreamingOptions options;
+            for (size_t i = 3; i < args.size(); i++) {
+                if (args[i] == "--memory-budget") {
+                    options.memoryBudget = static_cast<uint64_t>(parseOptionValue(args, i)) * 1024 * 1024;
+                } else if (args[i] == "--prefetch-radius") {
+                    options.prefetchRadius = parseOptionValue(args, i);
+                } else if (args[i] == "--no-lods") {
+                    options.meshLods = false;
+                } else {
+                    std::cerr << "Error: Unknown --view option: " << std::string(args[i]) << std::endl << usageMessage << std::endl;
+                    return EXIT_FAILURE;
+                }
+            }
+
             Viewer viewer;
-            viewer.run(args[2]);
+            viewer.run(args[2], options);
             return EXIT_SUCCESS;
         } catch (const std::exception& e) {
             std::cerr << "Viewer error: " << e.what() << std::endl;
@@ -39,21 +77,153 @@ namespace {
         }
     }
 
+    int handleVerify(const std::vector<std::string_view>& args) {
+        if (args.size() != 3) {
+            std::cerr << "Error: --verify requires exactly one argument: <path to .kelp file>" << std::endl << usageMessage << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        try {
+            const auto timeStart = std::chrono::high_resolution_clock::now();
+            const KelpFile file(args[2]);
+            ThreadPool threadPool;
+            const std::vector<std::string> errors = file.verify(threadPool);
+            const double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - timeStart).count();
+
+            for (const std::string& error : errors)
+                std::cerr << "Corrupted " << error << std::endl;
+            std::cout << "Verified " << file.getHeader().fileSize / 1024 / 1024 << " MB in " << static_cast<int>(seconds * 1000) << " ms ("
+                << static_cast<double>(file.getHeader().fileSize) / seconds / 1e9 << " GB/s, " << threadPool.getThreadCount() << " threads): "
+                << (errors.empty() ? "no corruption found" : std::to_string(errors.size()) + " corrupted ranges") << std::endl;
+            return errors.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+        } catch (const std::exception& e) {
+            std::cerr << "Verify error: " << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    bool parseConversionOption(const std::vector<std::string_view>& args, size_t& i, ConversionOptions& options) {
+        if (args[i] == "--compress") {
+            options.compress = true;
+        } else if (args[i] == "--encode-meshes") {
+            options.encodeMeshes = true;
+        } else if (args[i] == "--cell-size") {
+            options.cellSize = parseOptionValue(args, i);
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    BundleInput parseBundleInput(std::string_view arg) {
+        // <path>[@x,y,z[,scale[,yaw]]], the input is scaled, then rotated around the up axis, then translated
+        const size_t separator = arg.rfind('@');
+        BundleInput input{ .path = arg.substr(0, separator) };
+        if (separator == std::string_view::npos)
+            return input;
+
+        std::vector<float> values;
+        std::string_view transform = arg.substr(separator + 1);
+        while (!transform.empty()) {
+            const size_t comma = transform.find(',');
+            values.push_back(std::stof(std::string(transform.substr(0, comma))));
+            transform = comma == std::string_view::npos ? std::string_view() : transform.substr(comma + 1);
+        }
+        if (values.size() != 3 && values.size() != 4 && values.size() != 5)
+            throw std::runtime_error("Invalid transform for \"" + input.path.string() + "\": expected x,y,z[,scale[,yaw]]");
+
+        const float scale = values.size() > 3 ? values[3] : 1.0F;
+        const float yaw = values.size() > 4 ? values[4] : 0.0F;
+        input.transform = glm::translate(glm::mat4(1), glm::vec3(values[0], values[1], values[2]))
+            * glm::rotate(glm::mat4(1), glm::radians(yaw), glm::vec3(0, 1, 0))
+            * glm::scale(glm::mat4(1), glm::vec3(scale));
+        return input;
+    }
+
     int handleConvert(const std::vector<std::string_view>& args) {
-        if (args.size() != 4) {
-            std::cerr << "Error: --convert requires exactly two arguments: <input path> <output path>" << std::endl << usageMessage << std::endl;
+        if (args.size() < 4) {
+            std::cerr << "Error: --convert requires two arguments: <input path> <output path>, optionally followed by --compress, --encode-meshes and --cell-size" << std::endl << usageMessage << std::endl;
             return EXIT_FAILURE;
         }
 
         try {
+            ConversionOptions options;
+            for (size_t i = 4; i < args.size(); i++) {
+                if (!parseConversionOption(args, i, options)) {
+                    std::cerr << "Error: Unknown --convert option: " << std::string(args[i]) << std::endl << usageMessage << std::endl;
+                    return EXIT_FAILURE;
+                }
+            }
+
             Converter converter;
-            converter.convert(args[2], args[3]);
+            converter.convert(args[2], args[3], options);
             return EXIT_SUCCESS;
         } catch (const std::exception& e) {
             std::cerr << "Converter error: " << e.what() << std::endl;
             return EXIT_FAILURE;
         }
     }
+
+    int handleConvertBundle(const std::vector<std::string_view>& args) {
+        if (args.size() < 4) {
+            std::cerr << "Error: --convert-bundle requires an output path followed by at least one input path" << std::endl << usageMessage << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        try {
+            ConversionOptions options;
+            std::vector<BundleInput> inputs;
+            for (size_t i = 3; i < args.size(); i++) {
+                if (args[i].starts_with("--")) {
+                    if (!parseConversionOption(args, i, options)) {
+                        std::cerr << "Error: Unknown --convert-bundle option: " << std::string(args[i]) << std::endl << usageMessage << std::endl;
+                        return EXIT_FAILURE;
+                    }
+                } else {
+                    inputs.push_back(parseBundleInput(args[i]));
+                }
+            }
+
+            Converter converter;
+            converter.convertBundle(inputs, args[2], options);
+            return EXIT_SUCCESS;
+        } catch (const std::exception& e) {
+            std::cerr << "Converter error: " << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    int handleConvertBatch(const std::vector<std::string_view>& args) {
+        if (args.size() < 4) {
+            std::cerr << "Error: --convert-batch requires two arguments: <input directory or list file> <output directory>" << std::endl << usageMessage << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        try {
+            BatchOptions options;
+            for (size_t i = 4; i < args.size(); i++) {
+                if (args[i] == "--memory-budget") {
+                    options.memoryBudget = static_cast<uint64_t>(parseOptionValue(args, i)) * 1024 * 1024;
+                } else if (args[i] == "--force") {
+                    options.force = true;
+                } else if (!parseConversionOption(args, i, options.conversion)) {
+                    std::cerr << "Error: Unknown --convert-batch option: " << std::string(args[i]) << std::endl << usageMessage << std::endl;
+                    return EXIT_FAILURE;
+                }
+            }
+
+            const auto timeStart = std::chrono::high_resolution_clock::now();
+            BatchConverter batchConverter(options);
+            const std::vector<BatchConverter::Result> results = batchConverter.convert(args[2], args[3]);
+            BatchConverter::printSummary(results, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - timeStart).count());
+
+            const bool failed = std::ranges::any_of(results, [](const BatchConverter::Result& result) { return result.status == BatchConverter::Status::Failed; });
+            return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+        } catch (const std::exception& e) {
+            std::cerr << "Converter error: " << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
 }   // namespace
 
 int main(int argc, char *argv[]) {
@@ -64,9 +234,12 @@ int main(int argc, char *argv[]) {
     }
 
     const std::map<std::string_view, CommandHandler> command_handlers = {
-        {"--help",    handleHelp},
-        {"--view",    handleView},
-        {"--convert", handleConvert}
+        {"--help",           handleHelp},
+        {"--view",           handleView},
+        {"--verify",         handleVerify},
+        {"--convert",        handleConvert},
+        {"--convert-bundle", handleConvertBundle},
+        {"--convert-batch",  handleConvertBatch}
     };
 
     try {